@@ -0,0 +1,29 @@
+-- Проверка V13: замена картинки в занятом слоте поднимает row_version строки каталога на 1.
+-- Шаги идут отдельными транзакциями (autocommit psql), как отдельные запросы /row/updateCell;
+-- тестовая строка удаляется перед проверкой результата.
+--   psql -v ON_ERROR_STOP=1 -d <база> -f db/checks/row_version_image_replace.sql
+\set ON_ERROR_STOP on
+
+INSERT INTO public.milling_tool_catalog (name) VALUES ('row_version check')
+    RETURNING id AS tool_id \gset
+
+-- первый запрос: картинка в пустой слот
+INSERT INTO public.milling_tool_images (tool_id, slot, big_object_key)
+    VALUES (:tool_id, 'image_exists', 'check/old');
+SELECT row_version AS version_before FROM public.milling_tool_catalog WHERE id = :tool_id \gset
+
+-- второй запрос: замена тем же путём, что upsert_image_slot (id строки изображений не меняется)
+INSERT INTO public.milling_tool_images (tool_id, slot, big_object_key)
+    VALUES (:tool_id, 'image_exists', 'check/new')
+    ON CONFLICT (tool_id, slot) DO UPDATE SET big_object_key = EXCLUDED.big_object_key, updated_at = now();
+SELECT row_version AS version_after FROM public.milling_tool_catalog WHERE id = :tool_id \gset
+
+DELETE FROM public.milling_tool_catalog WHERE id = :tool_id;
+
+SELECT (:version_after = :version_before + 1) AS version_bumped \gset
+\if :version_bumped
+\echo 'ok: replace image in existing slot -> row_version' :version_before '->' :version_after
+\else
+\echo 'FAIL: replace image in existing slot -> row_version' :version_before '->' :version_after ', expected +1'
+DO $$ BEGIN RAISE EXCEPTION 'row_version was not bumped on image replace'; END $$;
+\endif
@@ -0,0 +1,28 @@
+-- Версия строки каталога для оптимистичной блокировки (expectedVersion в /row/updateCell).
+-- row_version увеличивает триггер при каждом изменении строки; updated_at — время последнего изменения.
+-- Замена картинки в занятом слоте (тот же id milling_tool_images) строку сама не меняет —
+-- версию поднимает sync-триггер, трогающий updated_at (V13).
+ALTER TABLE public.milling_tool_catalog
+    ADD COLUMN IF NOT EXISTS row_version BIGINT NOT NULL DEFAULT 1,
+    ADD COLUMN IF NOT EXISTS updated_at TIMESTAMPTZ NOT NULL DEFAULT now();
+
+CREATE OR REPLACE FUNCTION public.bump_row_version()
+RETURNS TRIGGER
+LANGUAGE plpgsql
+AS $$
+BEGIN
+  -- значение из UPDATE игнорируется: версию ведёт только сервер
+  NEW.row_version := OLD.row_version + 1;
+  NEW.updated_at := now();
+  RETURN NEW;
+END;
+$$;
+
+DROP TRIGGER IF EXISTS trg_milling_tool_catalog_row_version ON public.milling_tool_catalog;
+
+-- WHEN: UPDATE без фактических изменений версию не меняет
+CREATE TRIGGER trg_milling_tool_catalog_row_version
+BEFORE UPDATE ON public.milling_tool_catalog
+FOR EACH ROW
+WHEN (OLD.* IS DISTINCT FROM NEW.*)
+EXECUTE FUNCTION public.bump_row_version();
@@ -0,0 +1,5 @@
+-- Отметка сборки мусора: строка помечается короткой транзакцией, объект удаляется вне её,
+-- затем строка удаляется. Пока отметка стоит, reserve() строку не продлевает и ждёт
+-- окончания сборки; отметка старше 10 минут считается брошенной (упавший проход).
+ALTER TABLE public.storage_blobs
+    ADD COLUMN IF NOT EXISTS gc_started_at TIMESTAMPTZ;
@@ -0,0 +1,10 @@
+-- Ключ идемпотентности принадлежит вызывающему: owner — SHA-256 токена запроса,
+-- одинаковые Idempotency-Key разных клиентов не видят ответы друг друга.
+-- Записи, созданные до миграции, получают пустого владельца и истекают по expires_at.
+ALTER TABLE public.request_idempotency
+    ADD COLUMN IF NOT EXISTS owner TEXT NOT NULL DEFAULT '';
+
+ALTER TABLE public.request_idempotency
+    DROP CONSTRAINT IF EXISTS pk_request_idempotency;
+ALTER TABLE public.request_idempotency
+    ADD CONSTRAINT pk_request_idempotency PRIMARY KEY (scope, owner, idem_key);
@@ -0,0 +1,41 @@
+-- Замена картинки в занятом слоте идёт через ON CONFLICT (tool_id, slot) DO UPDATE: id строки
+-- milling_tool_images не меняется, и sync-триггер пишет в image_* то же значение. Без изменений
+-- строки каталога триггер row_version (WHEN OLD.* IS DISTINCT FROM NEW.*) версию не поднимал,
+-- и запрос со старым expectedVersion перезаписывал картинку. Теперь sync-триггер при установке
+-- слота трогает updated_at каталога: версия растёт на 1 и при замене картинки в том же слоте.
+-- now() одинаков в пределах транзакции, поэтому строка, уже изменённая этим же запросом, второй раз
+-- версию не поднимает.
+CREATE OR REPLACE FUNCTION public.sync_milling_tool_images_to_catalog()
+RETURNS TRIGGER
+LANGUAGE plpgsql
+AS $$
+BEGIN
+  IF (TG_OP = 'INSERT') THEN
+    EXECUTE format('UPDATE public.milling_tool_catalog SET %I = $1, updated_at = now() WHERE id = $2', NEW.slot)
+      USING NEW.id, NEW.tool_id;
+    RETURN NEW;
+  END IF;
+
+  IF (TG_OP = 'UPDATE') THEN
+    -- если картинку переместили на другой tool/slot, сначала очистим старую ячейку (только если она указывала на OLD.id)
+    IF (NEW.tool_id <> OLD.tool_id) OR (NEW.slot <> OLD.slot) THEN
+      EXECUTE format('UPDATE public.milling_tool_catalog SET %I = NULL WHERE id = $1 AND %I = $2', OLD.slot, OLD.slot)
+        USING OLD.tool_id, OLD.id;
+    END IF;
+
+    -- затем выставим новую ячейку; updated_at меняет строку и при том же id картинки (замена в слоте)
+    EXECUTE format('UPDATE public.milling_tool_catalog SET %I = $1, updated_at = now() WHERE id = $2', NEW.slot)
+      USING NEW.id, NEW.tool_id;
+
+    RETURN NEW;
+  END IF;
+
+  IF (TG_OP = 'DELETE') THEN
+    EXECUTE format('UPDATE public.milling_tool_catalog SET %I = NULL WHERE id = $1 AND %I = $2', OLD.slot, OLD.slot)
+      USING OLD.tool_id, OLD.id;
+    RETURN OLD;
+  END IF;
+
+  RETURN NULL;
+END;
+$$;
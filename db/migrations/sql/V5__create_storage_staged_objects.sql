@@ -0,0 +1,22 @@
+-- Журнал объектов, загруженных в MinIO до открытия транзакции (staged write).
+-- Строки батча удаляются в той же транзакции, которая записывает ссылки на объекты:
+-- это и есть "коммит" ключей. Строки старше TTL считаются сиротами —
+-- их объекты удаляет StagedUploadPlugin.
+CREATE TABLE IF NOT EXISTS public.storage_staged_objects (
+    -- id: первичный ключ записи журнала
+    id BIGSERIAL PRIMARY KEY,
+    -- batch_id: идентификатор запроса записи (все объекты одного запроса)
+    batch_id TEXT NOT NULL,
+    -- bucket/object_key: куда загружен объект
+    bucket TEXT NOT NULL,
+    object_key TEXT NOT NULL,
+    -- created_at: время регистрации (от него считается TTL)
+    created_at TIMESTAMPTZ NOT NULL DEFAULT now()
+);
+
+-- indexes: коммит батча и выборка просроченных записей
+CREATE INDEX IF NOT EXISTS idx_storage_staged_objects_batch_id
+    ON public.storage_staged_objects (batch_id);
+
+CREATE INDEX IF NOT EXISTS idx_storage_staged_objects_created_at
+    ON public.storage_staged_objects (created_at);
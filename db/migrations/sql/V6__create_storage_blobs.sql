@@ -0,0 +1,26 @@
+-- Контентно-адресуемое хранение вложений: один объект MinIO на одинаковые байты.
+-- Ключ объекта выводится из SHA-256 (blobs/<2 символа>/<sha256>, без расширения),
+-- ref_count — число ссылок на объект из строк *images.
+-- Строки с ref_count = 0 старше grace_minutes вместе с объектом удаляет BlobStorePlugin.
+CREATE TABLE IF NOT EXISTS public.storage_blobs (
+    -- id: первичный ключ записи
+    id BIGSERIAL PRIMARY KEY,
+    -- bucket/object_key: где лежит объект
+    bucket TEXT NOT NULL,
+    object_key TEXT NOT NULL,
+    -- sha256: hex-дайджест содержимого
+    sha256 TEXT NOT NULL,
+    size_bytes BIGINT NOT NULL,
+    mime_type TEXT,
+    -- ref_count: число ссылок из строк; 0 — кандидат на сборку мусора
+    ref_count BIGINT NOT NULL DEFAULT 0,
+    created_at TIMESTAMPTZ NOT NULL DEFAULT now(),
+    -- updated_at: последнее изменение ссылок или резерв перед загрузкой (от него считается grace)
+    updated_at TIMESTAMPTZ NOT NULL DEFAULT now(),
+    CONSTRAINT uq_storage_blobs_object UNIQUE (bucket, object_key)
+);
+
+-- indexes: выборка кандидатов на удаление
+CREATE INDEX IF NOT EXISTS idx_storage_blobs_unreferenced
+    ON public.storage_blobs (updated_at)
+    WHERE ref_count <= 0;
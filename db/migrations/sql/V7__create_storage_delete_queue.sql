@@ -0,0 +1,22 @@
+-- Очередь удаления объектов MinIO (outbox).
+-- Запись добавляется в той же транзакции, что удаляет ссылку на объект (или после отката записи),
+-- а сам объект удаляет фоновый воркер StorageDeleteQueuePlugin пачками через S3 multi-object delete.
+-- Неудачные попытки откладываются с экспоненциальной задержкой, запись не теряется.
+CREATE TABLE IF NOT EXISTS public.storage_delete_queue (
+    -- id: первичный ключ записи очереди
+    id BIGSERIAL PRIMARY KEY,
+    -- bucket/object_key: что удалить
+    bucket TEXT NOT NULL,
+    object_key TEXT NOT NULL,
+    -- attempts: число неудачных попыток
+    attempts INT NOT NULL DEFAULT 0,
+    -- next_attempt_at: раньше этого времени запись не берётся в работу
+    next_attempt_at TIMESTAMPTZ NOT NULL DEFAULT now(),
+    -- last_error: текст последней ошибки (для диагностики)
+    last_error TEXT,
+    created_at TIMESTAMPTZ NOT NULL DEFAULT now()
+);
+
+-- indexes: выборка готовых к обработке записей
+CREATE INDEX IF NOT EXISTS idx_storage_delete_queue_next_attempt_at
+    ON public.storage_delete_queue (next_attempt_at);
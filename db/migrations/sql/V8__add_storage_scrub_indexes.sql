@@ -0,0 +1,13 @@
+-- Индексы для сверки хранилища (StorageScrubberPlugin): поиск ссылок на объект по ключу.
+-- Без них проверка страницы ключей bucket-а читает таблицы целиком.
+CREATE INDEX IF NOT EXISTS idx_milling_tool_images_big_object_key
+    ON public.milling_tool_images (big_object_key);
+
+CREATE INDEX IF NOT EXISTS idx_milling_tool_images_small_object_key
+    ON public.milling_tool_images (small_object_key);
+
+CREATE INDEX IF NOT EXISTS idx_storage_staged_objects_object
+    ON public.storage_staged_objects (bucket, object_key);
+
+CREATE INDEX IF NOT EXISTS idx_storage_delete_queue_object
+    ON public.storage_delete_queue (bucket, object_key);
@@ -0,0 +1,22 @@
+-- Ключи идемпотентности записи (заголовок Idempotency-Key у /row/addRow и /row/updateCell).
+-- Первый запрос резервирует ключ (status_code IS NULL), после успешной записи сохраняется
+-- компактный ответ, и повторы с тем же ключом получают его без новой записи и загрузки файлов.
+-- Просроченные строки удаляет IdempotencyPlugin.
+CREATE TABLE IF NOT EXISTS public.request_idempotency (
+    -- scope/idem_key: операция (addRow, updateCell) и ключ клиента
+    scope TEXT NOT NULL,
+    idem_key TEXT NOT NULL,
+    -- fingerprint: SHA-256 payload и вложений; тот же ключ с другим запросом отклоняется
+    fingerprint TEXT NOT NULL,
+    -- status_code/response: сохранённый ответ; NULL — запрос ещё выполняется
+    status_code INT,
+    response TEXT,
+    created_at TIMESTAMPTZ NOT NULL DEFAULT now(),
+    -- expires_at: резерв живёт pending_timeout_seconds, ответ — ttl_minutes
+    expires_at TIMESTAMPTZ NOT NULL,
+    CONSTRAINT pk_request_idempotency PRIMARY KEY (scope, idem_key)
+);
+
+-- indexes: очистка просроченных записей
+CREATE INDEX IF NOT EXISTS idx_request_idempotency_expires_at
+    ON public.request_idempotency (expires_at);
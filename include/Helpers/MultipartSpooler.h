@@ -0,0 +1,141 @@
+#pragma once
+
+#include "Helpers/Sha256.h"
+#include "Lan/RowAdd/RowWriteTypes.h"
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpTypes.h>
+#include <drogon/RequestStream.h>
+#include <json/json.h>
+#include <trantor/net/EventLoop.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/// Потоковый приём multipart-запроса с вложениями (для RequestStreamReader::newMultipartReader):
+/// - часть "payload" (JSON) должна идти первой и держится в памяти;
+/// - файловые части пишутся в spoolDir с инкрементальным SHA-256 и в RAM целиком не попадают;
+/// - как только payload получен, вызывается onPayload — там можно запустить раннюю валидацию
+///   и при ошибке вызвать reject(): оставшиеся байты файлов больше не пишутся на диск.
+/// Spool-файлы удаляются в деструкторе; toAttachments() отображает их в память (mmap) до этого.
+/// Разбор частей идёт на IO-потоке Drogon, а fopen/fwrite/SHA-256/fclose — задачами на Options::ioLoop
+/// (по порядку, один loop на запрос); onFinish вызывается в цикле, где закончилось чтение тела,
+/// после того как все записи выполнены. Без ioLoop файловые операции выполняются на месте.
+class MultipartSpooler : public std::enable_shared_from_this<MultipartSpooler>
+{
+public:
+    struct Options
+    {
+        std::string spoolDir = "./uploads/tmp";
+        size_t maxPayloadBytes = 1024 * 1024;
+        size_t maxFileBytes = 0; // 0 — без лимита на файл (общий лимит задаёт client_max_body_size)
+        trantor::EventLoop *ioLoop = nullptr; // поток для записи spool-файлов
+    };
+
+    struct SpooledFile
+    {
+        std::string partName;
+        std::string filename;
+        std::string contentType;
+        std::string path;
+        size_t size = 0;
+        std::string sha256;
+    };
+
+    struct Rejection
+    {
+        std::string code;
+        std::string message;
+        Json::Value details;
+        drogon::HttpStatusCode status = drogon::k400BadRequest;
+    };
+
+    struct Result
+    {
+        Json::Value payload;
+        std::vector<SpooledFile> files;
+    };
+
+    using PayloadCallback = std::function<void(const Json::Value &payload)>;
+    using FinishCallback = std::function<void(std::shared_ptr<MultipartSpooler> spooler)>;
+
+    static std::shared_ptr<MultipartSpooler> create(Options options,
+                                                    PayloadCallback onPayload,
+                                                    FinishCallback onFinish);
+    ~MultipartSpooler();
+
+    MultipartSpooler(const MultipartSpooler &) = delete;
+    MultipartSpooler &operator=(const MultipartSpooler &) = delete;
+
+    /// Reader для RequestStream::setStreamReader.
+    drogon::RequestStreamReaderPtr makeReader(const drogon::HttpRequestPtr &req);
+
+    /// Отклонить запрос (потокобезопасно). Первая причина сохраняется, повторные вызовы игнорируются.
+    void reject(Rejection rejection);
+    std::optional<Rejection> rejection() const;
+
+    /// Результат приёма (валиден после onFinish, если нет rejection()).
+    const Result &result() const { return result_; }
+
+    /// Метаданные вложений из payload.attachments без байтов — для ранней проверки по payload.
+    /// Бросает std::runtime_error, если у элемента нет id/dbName/role.
+    static std::vector<AttachmentInput> describeAttachments(const Json::Value &payload);
+
+    /// Собрать вложения по payload.attachments: байты берутся из spool-файлов через mmap.
+    /// Бросает std::runtime_error при несоответствии payload и файловых частей.
+    std::vector<AttachmentInput> toAttachments() const;
+
+private:
+    MultipartSpooler(Options options, PayloadCallback onPayload, FinishCallback onFinish);
+
+    void onHeader(const drogon::MultipartHeader &header);
+    void onData(const char *data, size_t size);
+    void onFinish(std::exception_ptr ex);
+
+    void completePayload();
+    void closeCurrentFile();
+    bool isRejected() const { return rejected_.load(std::memory_order_acquire); }
+
+    // Файловые операции: выполняются по порядку на options_.ioLoop.
+    void runIo(std::function<void()> task);
+    void openFile(size_t index, const std::string &path);
+    void writeChunk(const std::string &chunk);
+    void closeFile();
+
+    Options options_;
+    PayloadCallback onPayload_;
+    FinishCallback onFinish_;
+
+    Result result_;
+    std::unordered_set<std::string> expectedParts_;
+
+    // Текущая часть
+    enum class PartKind
+    {
+        None,
+        Payload,
+        File,
+        Skip
+    };
+    PartKind current_ = PartKind::None;
+    std::string payloadText_;
+    bool payloadDone_ = false;
+
+    // Состояние записи: только в задачах runIo (и в деструкторе, когда задач уже нет).
+    std::FILE *file_ = nullptr;
+    size_t fileIndex_ = 0;
+    std::unique_ptr<Sha256> sha_;
+    std::vector<std::string> fileHashes_;
+
+    std::atomic<bool> rejected_{false};
+    mutable std::mutex rejectionMutex_;
+    std::optional<Rejection> rejection_;
+};
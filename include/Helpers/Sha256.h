@@ -0,0 +1,32 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// Инкрементальный SHA-256: данные подаются кусками по мере поступления
+/// (например, из потокового multipart), итог — hex-строка в нижнем регистре.
+class Sha256
+{
+public:
+    Sha256();
+
+    void update(const void *data, size_t size);
+    void update(std::string_view data) { update(data.data(), data.size()); }
+
+    /// Завершить вычисление и вернуть hex-дайджест. После вызова объект нужно пересоздать.
+    std::string finalHex();
+
+    /// Хэш целого буфера за один вызов.
+    static std::string hex(const void *data, size_t size);
+
+private:
+    void transform(const uint8_t *block);
+
+    std::array<uint32_t, 8> state_;
+    std::array<uint8_t, 64> buffer_{};
+    size_t bufferSize_ = 0;
+    uint64_t totalBytes_ = 0;
+};
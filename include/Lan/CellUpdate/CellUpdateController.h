@@ -4,10 +4,12 @@
 #include "Lan/RowAdd/RowWriteTypes.h"
 
 #include <drogon/HttpController.h>
+#include <drogon/RequestStream.h>
 #include <drogon/drogon.h>
 #include <drogon/utils/coroutine.h>
 #include <json/json.h>
 
+#include <memory>
 #include <string>
 
 /// Контроллер обновления одной ячейки по table/rowId/dbName.
@@ -16,6 +18,8 @@ class CellUpdateController : public drogon::HttpController<CellUpdateController>
 public:
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(CellUpdateController::updateCell, "/row/updateCell", drogon::Post);
+    ADD_METHOD_TO(CellUpdateController::updateCellStream, "/row/updateCell/stream", drogon::Post);
+    ADD_METHOD_TO(CellUpdateController::updateCells, "/row/updateCells", drogon::Post);
     METHOD_LIST_END
 
     /// Парсинг запроса: извлечение JSON payload и файлов.
@@ -27,6 +31,17 @@ public:
 
     drogon::Task<drogon::HttpResponsePtr> updateCell(drogon::HttpRequestPtr req);
 
+    /// Потоковый вариант updateCell: файлы пишутся на диск, payload проверяется до приёма файлов.
+    void updateCellStream(const drogon::HttpRequestPtr &req,
+                          drogon::RequestStreamPtr &&stream,
+                          std::function<void(const drogon::HttpResponsePtr &)> &&callback);
+
+    /// Пакетное обновление скалярных ячеек одной таблицы в одной транзакции.
+    /// Body (application/json): { "table", "types": { dbName: type }, "atomic"?: bool,
+    ///                            "cells": [{ "rowId", "dbName", "value" }, ...] }
+    /// Ответ: data { updated, notFound, invalid, results: [{ index, rowId, dbName, status, code?, message? }] }.
+    drogon::Task<drogon::HttpResponsePtr> updateCells(drogon::HttpRequestPtr req);
+
 private:
     ParsedRequest parseMultipartRequest(drogon::HttpRequestPtr req) const;
 
@@ -6,10 +6,34 @@
 
 #include <drogon/utils/coroutine.h>
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+/// Ячейка пакетного обновления (POST /row/updateCells) после проверки.
+struct CellBatchItem
+{
+    size_t index = 0; // позиция в payload.cells
+    int64_t rowId = 0;
+    std::string dbName;
+    Json::Value value;
+};
+
+/// Результат проверки пакета: корректные ячейки и ошибки по остальным.
+struct CellBatchValidation
+{
+    std::vector<CellBatchItem> cells;
+    Json::Value errors{Json::arrayValue};                  // [{ index, rowId?, dbName?, code, message }]
+    std::unordered_map<std::string, std::string> sqlTypes; // dbName -> udt_name для приведения text
+};
+
+/// Какие строки обновлены на самом деле: dbName -> rowId. Заполняют DbOp пакета.
+using CellBatchUpdated = std::unordered_map<std::string, std::unordered_set<int64_t>>;
 
 /// Интерфейс планировщика обновления для конкретной таблицы.
 /// Расширение:
@@ -29,6 +53,16 @@ public:
                                          const CellUpdateController::ParsedRequest &parsed,
                                          const std::unordered_map<std::string, std::string> &objectKeys,
                                          const MinioClient::Config &minioConfig) const = 0;
+
+    /// Проверка пакета скалярных ячеек за один проход (колонки таблицы читаются один раз).
+    /// Ошибки отдельных ячеек попадают в errors, ошибка пакета целиком — CellUpdateError.
+    virtual drogon::Task<CellBatchValidation> validateBatch(const Json::Value &payload) const = 0;
+
+    /// План пакета: по одному UPDATE ... FROM unnest(...) на колонку, без вложений.
+    /// При выполнении DbOp записывают обновлённые строки в updated.
+    virtual RowWritePlan buildBatchUpdatePlan(const std::string &table,
+                                              const CellBatchValidation &batch,
+                                              const std::shared_ptr<CellBatchUpdated> &updated) const = 0;
 };
 
 class CellUpdatePlannerRegistry
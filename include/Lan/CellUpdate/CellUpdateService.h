@@ -4,10 +4,13 @@
 #include "Lan/CellUpdate/CellUpdateErrors.h"
 #include "Lan/CellUpdate/CellUpdatePlanner.h"
 #include "Lan/RowAdd/RowWriteTypes.h"
+#include "Storage/BlobStorePlugin.h"
+#include "Storage/IObjectStorage.h"
 
 #include <drogon/utils/coroutine.h>
 #include <json/json.h>
 
+#include <cstddef>
 #include <exception>
 #include <memory>
 #include <string>
@@ -17,18 +20,41 @@
 class CellUpdateService
 {
 public:
-    CellUpdateService();
+    /// responseDebug — отдавать data.debug (тайминги загрузок, backend) в ответе.
+    CellUpdateService(std::shared_ptr<const CellUpdatePlannerRegistry> registry, bool responseDebug);
 
     drogon::Task<WriteResult> update(const CellUpdateController::ParsedRequest &parsed);
 
+    /// Ранняя проверка по одному payload (таблица, planner, validate) — до приёма файлов.
+    /// Вложения передаются только метаданными (data пустые). Бросает CellUpdateError.
+    drogon::Task<void> precheck(const CellUpdateController::ParsedRequest &parsed);
+
+    /// Пакетное обновление скалярных ячеек в одной транзакции (POST /row/updateCells).
+    /// Возвращает data ответа: счётчики и results по каждой ячейке
+    /// (status: updated | not_found | invalid). atomic = true — любая ошибка отменяет пакет.
+    drogon::Task<Json::Value> updateBatch(const Json::Value &payload);
+
+    /// Запись ячеек из буфера WriteBehindPlugin тем же пакетным UPDATE, что и updateBatch.
+    /// Значения проверены при постановке в буфер. Возвращает число обновлённых ячеек
+    /// (остальные — строки не найдены); ошибка БД откатывает пакет — CellUpdateError.
+    drogon::Task<size_t> writeBehindBatch(const std::string &table, const std::vector<CellBatchItem> &cells);
+
 private:
-    struct UploadedObject
-    {
-        std::string bucket;
-        std::string objectKey;
-    };
+    std::shared_ptr<const CellUpdatePlannerRegistry> registry_;
+    bool responseDebug_ = false;
+
+    std::shared_ptr<ITableCellUpdatePlanner> resolvePlanner(const Json::Value &payload) const;
+
+    // Пакетный план в одной транзакции: ошибка БД откатывает все ячейки (db_error),
+    // atomic — ненайденная строка тоже откатывает пакет (not_found).
+    drogon::Task<void> executeBatch(const ITableCellUpdatePlanner &planner,
+                                    const std::string &table,
+                                    const CellBatchValidation &batch,
+                                    const std::shared_ptr<CellBatchUpdated> &updated,
+                                    bool atomic);
 
-    std::shared_ptr<CellUpdatePlannerRegistry> registry_;
+    drogon::Task<void> validateRequest(const ITableCellUpdatePlanner &planner,
+                                       const CellUpdateController::ParsedRequest &parsed) const;
 
     std::unordered_map<std::string, const AttachmentInput *> buildAttachmentIndex(
         const std::vector<AttachmentInput> &attachments) const;
@@ -37,9 +63,35 @@ private:
                                int64_t rowId,
                                const AttachmentInput &attachment) const;
 
+    void collectUploadJobs(const RowWritePlan &plan,
+                           const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
+                           std::vector<IObjectStorage::PutJob> &jobs,
+                           std::vector<std::string> &attachmentIds) const;
+
+    drogon::Task<void> uploadObjects(IObjectStorage &storage,
+                                     const std::vector<IObjectStorage::PutJob> &jobs,
+                                     const std::vector<std::string> &attachmentIds,
+                                     std::vector<UploadedObject> &uploadedObjects,
+                                     Json::Value &debug);
+
+    // Дедупликация: резерв блобов плана и загрузка только отсутствующих (до транзакции).
+    drogon::Task<void> prepareBlobs(BlobStorePlugin &blobStore,
+                                    IObjectStorage &storage,
+                                    RowWritePlan &plan,
+                                    const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
+                                    const std::unordered_map<std::string, std::string> &shaById);
+
+    // uploadsStaged: объекты плана уже загружены до транзакции (staged write, блобы),
+    // выполняются только DB ops.
     drogon::Task<void> executePlan(const std::shared_ptr<drogon::orm::Transaction> &trans,
-                                   MinioClient &minioClient,
-                                   const RowWritePlan &plan,
+                                   IObjectStorage &storage,
+                                   RowWritePlan &plan,
                                    const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
-                                   std::vector<UploadedObject> &uploadedObjects);
+                                   std::vector<UploadedObject> &uploadedObjects,
+                                   bool uploadsStaged);
+
+    // Удаление загруженных объектов после отката: через очередь удаления, если она включена,
+    // иначе синхронно. true — все объекты удалены или поставлены в очередь.
+    drogon::Task<bool> discardUploaded(IObjectStorage &storage,
+                                       const std::vector<UploadedObject> &uploadedObjects);
 };
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Lan/AuthController.h"
+
+#include <drogon/HttpController.h>
+#include <drogon/drogon.h>
+#include <json/json.h>
+
+#include <string>
+
+/// Метрики буфера отложенной записи ячеек (WriteBehindPlugin).
+/// Маршрут: GET /row/writeBehind/stats
+class WriteBehindController : public drogon::HttpController<WriteBehindController>
+{
+public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(WriteBehindController::stats, "/row/writeBehind/stats", drogon::Get);
+    METHOD_LIST_END
+
+    drogon::Task<drogon::HttpResponsePtr> stats(drogon::HttpRequestPtr req);
+
+private:
+    static drogon::HttpResponsePtr makeErrorResponse(const std::string &code,
+                                                     const std::string &message,
+                                                     drogon::HttpStatusCode status);
+};
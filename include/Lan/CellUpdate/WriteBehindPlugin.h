@@ -0,0 +1,83 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/// Отложенная запись (write-behind) некритичных ячеек: заметки, счётчики, отметки времени.
+/// - колонки включаются явно: config.columns.<базовая таблица> = [dbName, ...];
+/// - /row/updateCell по такой колонке (скаляр, без expectedVersion) подтверждается после постановки
+///   в буфер: ключ (table, rowId, dbName), повторная запись ключа заменяет значение (coalescing);
+/// - flusher раз в flush_interval_ms пишет последние значения пакетным UPDATE, как /row/updateCells;
+/// - буфер ограничен max_pending ключами: новый ключ сверх лимита пишется синхронно;
+/// - неудачный пакет повторяется по одной ячейке; ячейки с ошибкой возвращаются в буфер
+///   (если ключ не перезаписан) до max_attempts попыток;
+/// - синхронная запись ячейки (expectedVersion, /row/updateCells, переполнение буфера) снимает
+///   её отложенное значение и ждёт конца прохода flusher-а, который уже взял это значение;
+/// - при остановке буфер дописывается одним проходом.
+/// Строка не проверяется при постановке: отсутствующие строки видны только в метриках (notFound).
+class WriteBehindPlugin : public drogon::Plugin<WriteBehindPlugin>
+{
+public:
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    bool enabled() const { return enabled_; }
+
+    /// Колонка пишется через буфер (table — имя из payload, дочерние резолвятся в базовую).
+    bool isWriteBehindColumn(const std::string &table, const std::string &dbName) const;
+
+    /// Поставить значение в буфер. false — буфер заполнен, значение нужно записать синхронно.
+    bool enqueue(const std::string &table, int64_t rowId, const std::string &dbName, const Json::Value &value);
+
+    /// Снять отложенное значение ячейки перед синхронной записью той же ячейки.
+    /// Если значение уже взял идущий проход flusher-а — дождаться его конца.
+    drogon::Task<void> discard(const std::string &table, int64_t rowId, const std::string &dbName);
+
+    /// Один проход flusher-а. Возвращает число записанных ячеек.
+    drogon::Task<size_t> flushOnce();
+
+    /// Счётчики буфера и flusher-а.
+    Json::Value stats() const;
+
+private:
+    struct PendingCell
+    {
+        std::string table;
+        int64_t rowId = 0;
+        std::string dbName;
+        Json::Value value;
+        int attempts = 0;
+    };
+
+    static std::string cellKey(const std::string &table, int64_t rowId, const std::string &dbName);
+
+    bool enabled_ = false;
+    size_t maxPending_ = 10000;
+    int maxAttempts_ = 3;
+    std::unordered_map<std::string, std::unordered_set<std::string>> columns_; // базовая таблица -> dbName
+    trantor::TimerId timerId_{trantor::InvalidTimerId};
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, PendingCell> pending_;
+    std::unordered_set<std::string> flushing_; // ключи, взятые идущим проходом
+
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> enqueuedTotal_{0};
+    std::atomic<uint64_t> coalescedTotal_{0};
+    std::atomic<uint64_t> overflowTotal_{0};
+    std::atomic<uint64_t> flushedTotal_{0};
+    std::atomic<uint64_t> notFoundTotal_{0};
+    std::atomic<uint64_t> retriedTotal_{0};
+    std::atomic<uint64_t> droppedTotal_{0};
+    std::atomic<uint64_t> batchesTotal_{0};
+    std::atomic<int64_t> lastFlushMs_{0};
+};
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Lan/Images/ThumbnailCache.h"
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Прогрев превью для строк отданной страницы.
+/// После выдачи страницы (TableDataService::getPage) клиент почти всегда запрашивает превью
+/// всех image_*-колонок этих строк; плагин заранее читает метаданные и small-объекты из хранилища (StoragePlugin)
+/// в ThumbnailCache, и TableImageSender отдаёт их из памяти.
+/// Прогрев не блокирует ответ; одновременно прогревается не больше max_concurrency страниц,
+/// лишние пропускаются. enabled = false полностью выключает прогрев и кэш.
+class ImagePrefetchPlugin : public drogon::Plugin<ImagePrefetchPlugin>
+{
+public:
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    bool enabled() const { return enabled_.load(); }
+
+    /// Запланировать прогрев превью для строк страницы (не ждёт завершения).
+    /// imageColumns — image_*-колонки таблицы, rowIds — локальные id строк.
+    void schedulePage(const std::string &baseTable,
+                      std::vector<std::string> imageColumns,
+                      std::vector<int64_t> rowIds);
+
+    /// Превью из кэша или nullptr.
+    std::shared_ptr<const ThumbnailCache::Entry> lookup(const std::string &objectKey);
+
+    /// Положить превью, прочитанное в обход прогрева (read-through).
+    /// Возвращает запись с теми же байтами (без копии), даже если в кэш она не попала.
+    std::shared_ptr<const ThumbnailCache::Entry> remember(const std::string &objectKey,
+                                                         std::vector<uint8_t> bytes,
+                                                         std::string mimeType);
+
+private:
+    drogon::Task<void> warmPage(std::string baseTable,
+                                std::vector<std::string> imageColumns,
+                                std::vector<int64_t> rowIds);
+
+    std::atomic<bool> enabled_{false};
+    int maxConcurrency_ = 2;
+    size_t maxObjectBytes_ = 512 * 1024;
+    // Прогрев держит свою копию указателя: shutdown() не освобождает кэш под идущим warmPage.
+    std::shared_ptr<ThumbnailCache> cache_;
+
+    std::atomic<int> inflight_{0};
+};
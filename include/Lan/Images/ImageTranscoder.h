@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Декодирование/масштабирование/перекодирование изображений для серверных превью.
+/// Кодеки подключаются при сборке:
+/// - WORKSHOP_HAS_STB: stb_image / stb_image_write (JPEG/PNG), обязательны для сборки;
+/// - WORKSHOP_HAS_WEBP: libwebp (кодирование в WebP).
+/// Без кодека формата методы возвращают std::nullopt, вызывающая сторона сама решает, что делать.
+/// maxPixels > 0 ограничивает width*height входного изображения: размер читается из заголовка
+/// до декодирования, изображения больше лимита не распаковываются (std::nullopt).
+class ImageTranscoder
+{
+public:
+    enum class Format
+    {
+        Jpeg,
+        Png,
+        Webp
+    };
+
+    struct EncodedImage
+    {
+        std::vector<uint8_t> bytes;
+        std::string mimeType;
+        std::string extension; // без точки: "jpg", "png", "webp"
+        int width = 0;
+        int height = 0;
+    };
+
+    /// Разобрать имя формата из конфига ("jpeg"/"jpg"/"png"/"webp").
+    static bool parseFormat(const std::string &name, Format &out);
+
+    /// MIME-тип и расширение (без точки) результата кодирования в format.
+    static std::string mimeType(Format format);
+    static std::string extension(Format format);
+
+    /// Есть ли декодер входных изображений в этой сборке.
+    static bool canDecode();
+
+    /// Можно ли кодировать в указанный формат в этой сборке.
+    static bool canEncode(Format format);
+
+    /// Уменьшить изображение так, чтобы большая сторона не превышала maxSide, и закодировать в format.
+    /// Изображения меньше maxSide не увеличиваются (только перекодируются).
+    static std::optional<EncodedImage> makeThumbnail(const uint8_t *data,
+                                                     size_t size,
+                                                     int maxSide,
+                                                     Format format,
+                                                     int quality,
+                                                     uint64_t maxPixels);
+
+    /// Перекодировать изображение без изменения размера.
+    static std::optional<EncodedImage> reencode(const uint8_t *data,
+                                                size_t size,
+                                                Format format,
+                                                int quality,
+                                                uint64_t maxPixels);
+};
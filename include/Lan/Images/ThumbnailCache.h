@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/// LRU-кэш превью в памяти по object_key с ограничением по суммарному размеру.
+/// Ключи объектов неизменяемы (новая картинка — новый ключ), поэтому инвалидация не нужна.
+class ThumbnailCache
+{
+public:
+    struct Entry
+    {
+        std::vector<uint8_t> bytes;
+        std::string mimeType;
+    };
+
+    explicit ThumbnailCache(size_t maxBytes);
+
+    /// Запись из кэша (поднимается в начало LRU) или nullptr.
+    std::shared_ptr<const Entry> get(const std::string &objectKey);
+
+    bool contains(const std::string &objectKey) const;
+
+    /// Записи больше maxBytes не кэшируются.
+    void put(const std::string &objectKey, std::shared_ptr<const Entry> entry);
+
+    size_t sizeBytes() const;
+
+private:
+    using Item = std::pair<std::string, std::shared_ptr<const Entry>>;
+
+    size_t maxBytes_;
+    size_t bytes_ = 0;
+    mutable std::mutex mutex_;
+    std::list<Item> lru_;
+    std::unordered_map<std::string, std::list<Item>::iterator> index_;
+};
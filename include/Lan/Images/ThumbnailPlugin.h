@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Lan/Images/ImageTranscoder.h"
+#include "Lan/RowAdd/RowWriteTypes.h"
+
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Серверная генерация вариантов изображений перед записью в storage:
+/// - если клиент прислал только role "image", создаёт "image_small" (превью);
+/// - опционально перекодирует big в WebP.
+/// Также строит производные варианты для выдачи (TableImageSender: maxSide/format в запросе).
+/// Работа с пикселями выполняется на собственном пуле потоков, а не на IO-потоках Drogon.
+/// Настройки задаются по базовой таблице:
+/// config.json -> plugins -> ThumbnailPlugin -> config.tables.<table>.
+class ThumbnailPlugin : public drogon::Plugin<ThumbnailPlugin>
+{
+public:
+    struct TableConfig
+    {
+        bool enabled = false;
+        int smallMaxSide = 256;
+        ImageTranscoder::Format smallFormat = ImageTranscoder::Format::Jpeg;
+        int smallQuality = 80;
+        bool webpBig = false;
+        int webpQuality = 85;
+        // Если изображение не распознано или больше max_pixels — small становится копией оригинала.
+        bool fallbackCopyOriginal = false;
+    };
+
+    /// Производные варианты выдачи: config.variants.
+    struct VariantConfig
+    {
+        bool enabled = true;
+        // Запрошенная сторона округляется вверх до ближайшего шага: число вариантов
+        // одного объекта в хранилище ограничено длиной списка.
+        std::vector<int> sizes{64, 128, 256, 512, 1024, 2048};
+        int quality = 82;
+    };
+
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    /// Включена ли генерация для таблицы (дочерние таблицы резолвятся в базовую).
+    bool isEnabledFor(const std::string &table) const;
+
+    /// Настройки таблицы (nullptr, если генерация для неё выключена).
+    const TableConfig *findConfig(const std::string &table) const;
+
+    const VariantConfig &variantConfig() const { return variants_; }
+
+    /// Лимит width*height входного изображения (config.max_pixels), проверяется до декодирования.
+    uint64_t maxPixels() const { return maxPixels_; }
+
+    /// Шаг размера для запрошенной стороны: наименьший шаг >= requested, иначе наибольший.
+    int snapVariantSide(int requested) const;
+
+    /// Уменьшить source до maxSide и закодировать в format на пуле worker_threads.
+    /// std::nullopt — кодеков нет, изображение не распознано или больше max_pixels.
+    /// source должен жить до завершения co_await.
+    drogon::Task<std::optional<ImageTranscoder::EncodedImage>>
+    renderVariant(const std::vector<uint8_t> &source, int maxSide, ImageTranscoder::Format format);
+
+    /// Построить итоговый набор вложений с серверными вариантами.
+    /// Возвращает std::nullopt, если для таблицы генерация выключена или менять нечего.
+    drogon::Task<std::optional<std::vector<AttachmentInput>>>
+    buildVariants(const std::string &table, const std::vector<AttachmentInput> &attachments);
+
+private:
+    struct SlotVariants
+    {
+        std::optional<ImageTranscoder::EncodedImage> small;
+        std::optional<ImageTranscoder::EncodedImage> big;
+    };
+
+    trantor::EventLoop *nextWorkerLoop() const;
+
+    // Заполняется в initAndStart и дальше только читается.
+    std::unordered_map<std::string, TableConfig> tables_;
+    VariantConfig variants_;
+    uint64_t maxPixels_ = 40000000;
+    std::unique_ptr<trantor::EventLoopThreadPool> workers_;
+};
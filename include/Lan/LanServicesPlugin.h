@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Lan/CellUpdate/CellUpdateService.h"
+#include "Lan/RowAdd/RowImportService.h"
+#include "Lan/RowAdd/RowWriteService.h"
+#include "Lan/RowDelete/RowDeleteService.h"
+#include "Lan/TableDataService.h"
+
+#include <drogon/plugins/Plugin.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <memory>
+
+/// Сервисы чтения/записи таблиц, построенные один раз при старте приложения.
+/// - реестры планировщиков (запись, ячейки, удаление) создаются из createDefault*Registry()
+///   и дальше не меняются: сервисы и планировщики без изменяемого состояния, кроме
+///   собственных потокобезопасных кэшей (SQL вставок), и разделяются всеми потоками;
+/// - контроллеры берут готовые экземпляры через статические методы вместо создания на запрос.
+/// - указатели пишутся только в initAndStart и живут до разрушения плагина (shutdown их не сбрасывает),
+///   поэтому чтение из IO-потоков не требует синхронизации.
+/// config.json -> plugins -> LanServicesPlugin -> config: schema, db_client (выборки TableDataService),
+/// response_debug (data.debug в ответах addRow/updateCell, по умолчанию выключен),
+/// spool_threads (потоки записи spool-файлов потоковых маршрутов, по умолчанию 2).
+class LanServicesPlugin : public drogon::Plugin<LanServicesPlugin>
+{
+public:
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    /// Бросает RowWriteError (500), если плагин не инициализирован.
+    static std::shared_ptr<RowWriteService> rowWriter();
+    static std::shared_ptr<RowImportService> rowImporter();
+
+    /// Бросает CellUpdateError (500), если плагин не инициализирован.
+    static std::shared_ptr<CellUpdateService> cellUpdater();
+
+    /// Бросает RowDeleteError (500), если плагин не инициализирован.
+    static std::shared_ptr<RowDeleteService> rowDeleter();
+
+    /// Бросает std::runtime_error, если плагин не инициализирован.
+    static std::shared_ptr<const TableDataService> tableData();
+
+    /// Поток для файловых операций MultipartSpooler (nullptr, если плагин не инициализирован).
+    static trantor::EventLoop *spoolLoop();
+
+private:
+    static LanServicesPlugin *instance();
+
+    std::shared_ptr<RowWriteService> rowWriter_;
+    std::shared_ptr<RowImportService> rowImporter_;
+    std::shared_ptr<CellUpdateService> cellUpdater_;
+    std::shared_ptr<RowDeleteService> rowDeleter_;
+    std::shared_ptr<const TableDataService> tableData_;
+    std::unique_ptr<trantor::EventLoopThreadPool> spoolWorkers_;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Helpers/MultipartSpooler.h"
+#include "Lan/RowAdd/RowWriteTypes.h"
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/RequestStream.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Общий каркас потоковых multipart-маршрутов (/row/addRow/stream, /row/updateCell/stream):
+/// - файлы принимает MultipartSpooler, запись идёт на spool-потоке LanServicesPlugin;
+/// - сразу после payload (пока клиент ещё передаёт файлы) проверяются токен и precheck сервиса,
+///   ошибка останавливает запись остатка тела;
+/// - после приёма: отказ -> ответ с ошибкой, токен (если ранняя проверка не успела),
+///   сборка вложений из spool-файлов и handle() маршрута.
+/// Ответы об ошибках — в формате контроллеров: { ok: false, error: { code, message, details? } }.
+class MultipartStreamRoute
+{
+public:
+    struct Request
+    {
+        Json::Value payload;
+        std::vector<AttachmentInput> attachments;
+    };
+
+    /// Ранняя проверка: вложения только с метаданными (data пустые).
+    /// Ошибку сервиса возвращает как Rejection; прочие исключения дают 400.
+    using Precheck = std::function<drogon::Task<std::optional<MultipartSpooler::Rejection>>(Request probe)>;
+
+    /// Обработка принятого запроса (токен проверен, вложения отображены из spool-файлов).
+    /// Исключения, кроме ошибок сервиса, пойманных внутри, дают 500.
+    using Handle = std::function<drogon::Task<drogon::HttpResponsePtr>(Request request)>;
+
+    /// Запустить потоковый приём. routeName — для логов ("addRowStream", "updateCellStream").
+    static void start(const drogon::HttpRequestPtr &req,
+                      drogon::RequestStreamPtr &stream,
+                      std::function<void(const drogon::HttpResponsePtr &)> &&callback,
+                      std::string routeName,
+                      Precheck precheck,
+                      Handle handle);
+
+    /// JSON-ответ с ошибкой в формате контроллеров.
+    static drogon::HttpResponsePtr errorResponse(const std::string &code,
+                                                 const std::string &message,
+                                                 const Json::Value &details,
+                                                 drogon::HttpStatusCode status);
+};
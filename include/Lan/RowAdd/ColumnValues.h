@@ -0,0 +1,24 @@
+#pragma once
+
+#include "TableInfoCache.h"
+
+#include <drogon/orm/DbClient.h>
+#include <json/json.h>
+
+#include <string>
+
+/// Проверка значения ячейки по data_type колонки (TableInfoCache) до отправки в БД:
+/// целые (с диапазоном smallint/integer/bigint; JSON-число с нулевой дробной частью, например 3.0,
+/// тоже целое), numeric/real/double precision, boolean.
+/// Остальные типы принимают любой скаляр — их проверяет PostgreSQL.
+/// Возвращает пустую строку, если значение подходит, иначе текст ошибки.
+std::string checkColumnValue(const std::string &dataType, const Json::Value &value);
+
+/// Привязка значения ячейки к параметру запроса по типу колонки:
+/// int2/int4/int8 — int16_t/int32_t/int64_t, bool — bool (бинарный формат нужного размера),
+/// numeric/real/double precision и прочие типы — текстом (Drogon отдаёт double в PostgreSQL
+/// через std::to_string с потерей точности). Значение проверяется checkColumnValue,
+/// при несовпадении бросает std::invalid_argument.
+void bindColumnValue(drogon::orm::internal::SqlBinder &binder,
+                     const TableInfoCache::ColumnType &type,
+                     const Json::Value &value);
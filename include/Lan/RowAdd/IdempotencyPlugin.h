@@ -0,0 +1,86 @@
+#pragma once
+
+#include <drogon/HttpRequest.h>
+#include <drogon/HttpResponse.h>
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct AttachmentInput;
+
+/// Повторы записи по заголовку Idempotency-Key (addRow, updateCell).
+/// Запись ключа хранится в public.request_idempotency:
+/// - ключ принадлежит вызывающему (owner — SHA-256 токена): одинаковые ключи разных клиентов не пересекаются;
+/// - begin() — до записи: резервирует ключ (pending) или возвращает сохранённый ответ;
+/// - complete() — после записи: успешный ответ сохраняется на ttl_minutes, иначе резерв снимается;
+/// - ключ с другим payload отклоняется (422), ключ с незавершённой записью — 409.
+/// Пока запрос выполняется, резерв продлевается каждую треть pending_timeout_seconds;
+/// резерв упавшего процесса истекает, просроченные записи удаляет фоновая очистка.
+class IdempotencyPlugin : public drogon::Plugin<IdempotencyPlugin>
+{
+public:
+    /// Резерв ключа на время записи. Если complete() не был вызван, резерв снимается в деструкторе.
+    class Claim
+    {
+    public:
+        Claim(IdempotencyPlugin *plugin, std::string scope, std::string owner, std::string key);
+        ~Claim();
+        Claim(const Claim &) = delete;
+        Claim &operator=(const Claim &) = delete;
+
+    private:
+        friend class IdempotencyPlugin;
+
+        /// Остановить продление резерва.
+        void stopRefresh();
+
+        IdempotencyPlugin *plugin_;
+        std::string scope_;
+        std::string owner_;
+        std::string key_;
+        trantor::TimerId refreshTimerId_{trantor::InvalidTimerId};
+        bool finished_ = false;
+    };
+
+    struct Begin
+    {
+        drogon::HttpResponsePtr response; // готовый ответ: повтор или ошибка ключа
+        std::shared_ptr<Claim> claim;     // резерв; пусто, если ключа нет или плагин выключен
+    };
+
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    bool enabled() const { return enabled_; }
+
+    /// Разобрать Idempotency-Key запроса и зарезервировать его в области scope ("addRow", "updateCell").
+    /// Отпечаток запроса — SHA-256 payload и вложений. Недостающие хэши вложений считаются на spool-потоке
+    /// LanServicesPlugin и записываются в att.sha256: дедупликация при записи их не пересчитывает.
+    static drogon::Task<Begin> begin(const drogon::HttpRequestPtr &req,
+                                     const std::string &scope,
+                                     const Json::Value &payload,
+                                     std::vector<AttachmentInput> &attachments);
+
+    /// Сохранить ответ 2xx для повторов; для остальных ответов резерв снимается.
+    static drogon::Task<void> complete(const std::shared_ptr<Claim> &claim, const drogon::HttpResponsePtr &response);
+
+    /// Один проход очистки просроченных записей. Возвращает число удалённых строк.
+    drogon::Task<int> runOnce();
+
+private:
+    drogon::Task<Begin> reserve(const std::string &scope,
+                                const std::string &owner,
+                                const std::string &key,
+                                const std::string &fingerprint);
+    drogon::Task<void> release(const std::string &scope, const std::string &owner, const std::string &key);
+    drogon::Task<void> refresh(const std::string &scope, const std::string &owner, const std::string &key);
+
+    bool enabled_ = false;
+    int ttlMinutes_ = 1440;
+    int pendingTimeoutSeconds_ = 300;
+    trantor::TimerId timerId_{trantor::InvalidTimerId};
+};
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Lan/RowAdd/RowWriteTypes.h"
+#include "Storage/IObjectStorage.h"
+
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <optional>
+#include <string>
+#include <vector>
+
+/// Загрузка объектов записи через storage.putAll с замерами (RowWriteService, CellUpdateService).
+/// В debug: uploads (attachmentId, objectKey, sizeBytes, ms, lane, ok), uploadsTotalMs,
+/// uploadConcurrency, storageBackend. Успешно загруженные объекты дописываются в uploadedObjects,
+/// чтобы откат записи мог их удалить. logPrefix — имя сервиса в логе.
+/// Возвращает details первой неудачной загрузки (bucket, objectKey, mimeType, sizeBytes),
+/// ошибку нужного типа бросает вызывающий сервис.
+drogon::Task<std::optional<Json::Value>> uploadObjectsTimed(IObjectStorage &storage,
+                                                            const std::vector<IObjectStorage::PutJob> &jobs,
+                                                            const std::vector<std::string> &attachmentIds,
+                                                            std::vector<UploadedObject> &uploadedObjects,
+                                                            Json::Value &debug,
+                                                            const std::string &logPrefix);
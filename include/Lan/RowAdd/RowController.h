@@ -4,9 +4,11 @@
 #include "RowWriteTypes.h"
 
 #include <drogon/HttpController.h>
+#include <drogon/RequestStream.h>
 #include <drogon/drogon.h>
 #include <drogon/utils/coroutine.h>
 #include <json/json.h>
+#include <memory>
 #include <string>
 
 /// Минимальный контроллер для создания записи.
@@ -16,6 +18,8 @@ class RowController : public drogon::HttpController<RowController>
 public:
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(RowController::addRow, "/row/addRow", drogon::Post);
+    ADD_METHOD_TO(RowController::addRowStream, "/row/addRow/stream", drogon::Post);
+    ADD_METHOD_TO(RowController::importRows, "/row/import", drogon::Post);
     METHOD_LIST_END
 
     /// Парсинг запроса: извлечение JSON payload.
@@ -29,6 +33,19 @@ public:
     /// Основной метод обработки создания записи
     drogon::Task<drogon::HttpResponsePtr> addRow(drogon::HttpRequestPtr req);
 
+    /// То же, что addRow, но тело читается потоком: файлы пишутся на диск (uploads/tmp),
+    /// payload проверяется сразу после получения, и при ошибке остаток тела не сохраняется.
+    /// Требует "enable_request_stream": true; без него работает как addRow.
+    void addRowStream(const drogon::HttpRequestPtr &req,
+                      drogon::RequestStreamPtr &&stream,
+                      std::function<void(const drogon::HttpResponsePtr &)> &&callback);
+
+    /// Массовый импорт строк без вложений (RowImportService).
+    /// Query: table=<имя таблицы>, format=ndjson|csv (иначе по Content-Type), atomic=true|false.
+    /// Body: NDJSON (объект {"column": value} на строку) или CSV с заголовком.
+    /// Ответ: data { received, inserted, failed, ids: [{ line, id, globalId }], errors: [{ line, message }] }.
+    drogon::Task<drogon::HttpResponsePtr> importRows(drogon::HttpRequestPtr req);
+
 private:
     /// Распарсить запрос и получить payload
     /// @return ParsedRequest или выбрасывает исключение при ошибке формата/JSON
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Lan/RowAdd/RowWritePlanner.h"
+
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+/// Массовый импорт строк таблицы (POST /row/import): NDJSON или CSV без вложений.
+/// - каждая строка входа проверяется по колонкам TableInfoCache (имя колонки, вид значения по data_type);
+/// - строки с ошибками пропускаются и попадают в errors, при atomic = true отменяют весь импорт;
+/// - корректные строки группируются по набору колонок и вставляются INSERT ... SELECT FROM unnest
+///   пачками в одной транзакции (один текст запроса на набор колонок): ошибка БД откатывает весь импорт;
+/// - в ответе id и global_id вставленных строк с номерами строк входа.
+/// Таблица должна быть зарегистрирована в createDefaultRowWritePlannerRegistry().
+/// Ошибки уровня запроса (таблица, формат, заголовок CSV, ошибка БД) — RowWriteError.
+class RowImportService
+{
+public:
+    enum class Format
+    {
+        Ndjson, // одна строка — один JSON-объект {"column": value}
+        Csv     // первая строка — имена колонок; пустое поле без кавычек — NULL
+    };
+
+    struct Options
+    {
+        std::string table;
+        Format format = Format::Ndjson;
+        bool atomic = false;
+    };
+
+    struct Result
+    {
+        size_t received = 0;
+        size_t inserted = 0;
+        Json::Value ids{Json::arrayValue};    // [{ line, id, globalId? }]
+        Json::Value errors{Json::arrayValue}; // [{ line, message }]
+        bool errorsTruncated = false;
+
+        Json::Value toJson() const;
+    };
+
+    explicit RowImportService(std::shared_ptr<const RowWritePlannerRegistry> registry);
+
+    drogon::Task<Result> import(const Options &options, std::string_view body);
+
+private:
+    std::shared_ptr<const RowWritePlannerRegistry> registry_;
+};
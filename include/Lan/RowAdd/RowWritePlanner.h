@@ -28,16 +28,17 @@ public:
     /// - Здесь же проверяйте whitelist колонок (например, image_*).
     virtual drogon::Task<std::optional<ValidationError>> validate(const RowController::ParsedRequest &parsed) const = 0;
 
-    /// Создаёт базовую строку и возвращает rowId.
+    /// Создаёт базовую строку и возвращает её (одна строка результата).
     /// Расширение:
-    /// - Можно переиспользовать общую логику вставки (buildInsertCommand).
-    /// - Важно: INSERT должен вернуть id (RETURNING id).
-    virtual drogon::Task<int64_t> insertBaseRow(const RowController::ParsedRequest &parsed,
-                                                const std::shared_ptr<drogon::orm::Transaction> &trans) const = 0;
+    /// - Можно переиспользовать общую логику вставки (InsertSqlCache в RowWritePlanner.cpp).
+    /// - Важно: INSERT должен вернуть строку целиком (RETURNING *): из неё берутся id и data.row ответа.
+    virtual drogon::Task<drogon::orm::Result> insertBaseRow(const RowController::ParsedRequest &parsed,
+                                                            const std::shared_ptr<drogon::orm::Transaction> &trans) const = 0;
 
     /// Строит план записи, который затем выполнит RowWriteService.
     /// Расширение:
     /// - Для новых типов файлов добавляйте UploadOp + DbOp в plan.
+    /// - Если DbOp-ы меняют строку после INSERT (триггеры), перечитайте её в plan.writtenRow.
     /// - Вся семантика таблицы должна быть здесь, а не в контроллере.
     virtual RowWritePlan buildWritePlan(int64_t rowId,
                                         const RowController::ParsedRequest &parsed,
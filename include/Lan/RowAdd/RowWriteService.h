@@ -3,6 +3,8 @@
 #include "Lan/RowAdd/RowController.h"
 #include "Lan/RowAdd/RowWritePlanner.h"
 #include "Lan/RowAdd/RowWriteTypes.h"
+#include "Storage/BlobStorePlugin.h"
+#include "Storage/IObjectStorage.h"
 
 #include <drogon/utils/coroutine.h>
 #include <json/json.h>
@@ -40,18 +42,23 @@ private:
 class RowWriteService
 {
 public:
-    RowWriteService();
+    /// responseDebug — отдавать data.debug (тайминги загрузок, backend) в ответе.
+    RowWriteService(std::shared_ptr<const RowWritePlannerRegistry> registry, bool responseDebug);
 
     drogon::Task<WriteResult> write(const RowController::ParsedRequest &parsed);
 
+    /// Ранняя проверка по одному payload (таблица, planner, validate) — до приёма файлов.
+    /// Вложения передаются только метаданными (data пустые). Бросает RowWriteError.
+    drogon::Task<void> precheck(const RowController::ParsedRequest &parsed);
+
 private:
-    struct UploadedObject
-    {
-        std::string bucket;
-        std::string objectKey;
-    };
+    std::shared_ptr<const RowWritePlannerRegistry> registry_;
+    bool responseDebug_ = false;
 
-    std::shared_ptr<RowWritePlannerRegistry> registry_;
+    std::shared_ptr<ITableRowWritePlanner> resolvePlanner(const Json::Value &payload) const;
+
+    drogon::Task<void> validateRequest(const ITableRowWritePlanner &planner,
+                                       const RowController::ParsedRequest &parsed) const;
 
     std::unordered_map<std::string, const AttachmentInput *> buildAttachmentIndex(
         const std::vector<AttachmentInput> &attachments) const;
@@ -60,10 +67,38 @@ private:
                                int64_t rowId,
                                const AttachmentInput &attachment) const;
 
+    std::string buildStagedObjectKey(const std::string &table,
+                                     const std::string &rowFolder,
+                                     const AttachmentInput &attachment) const;
+
+    drogon::Task<void> uploadObjects(IObjectStorage &storage,
+                                     const std::vector<IObjectStorage::PutJob> &jobs,
+                                     const std::vector<std::string> &attachmentIds,
+                                     std::vector<UploadedObject> &uploadedObjects,
+                                     Json::Value &debug);
+
+    // Дедупликация: ключи по хэшу содержимого, загружаются только отсутствующие блобы.
+    // blobObjects — все объекты, на которые может ссылаться план.
+    drogon::Task<void> prepareBlobs(BlobStorePlugin &blobStore,
+                                    IObjectStorage &storage,
+                                    const std::string &bucket,
+                                    const std::vector<AttachmentInput> &attachments,
+                                    std::unordered_map<std::string, std::string> &objectKeys,
+                                    std::vector<UploadedObject> &blobObjects,
+                                    Json::Value &debug);
+
+    // preUploaded: объекты плана уже загружены до транзакции (staged write, блобы),
+    // выполняются только DB ops; nullptr — загрузка внутри транзакции.
     drogon::Task<void> executePlan(const std::shared_ptr<drogon::orm::Transaction> &trans,
-                                   MinioClient &minioClient,
-                                   const RowWritePlan &plan,
+                                   IObjectStorage &storage,
+                                   RowWritePlan &plan,
                                    const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
-                                   std::vector<UploadedObject> &uploadedObjects);
+                                   std::vector<UploadedObject> &uploadedObjects,
+                                   const std::vector<UploadedObject> *preUploaded);
+
+    // Удаление загруженных объектов после отката: через очередь удаления, если она включена,
+    // иначе синхронно. true — все объекты удалены или поставлены в очередь.
+    drogon::Task<bool> discardUploaded(IObjectStorage &storage,
+                                       const std::vector<UploadedObject> &uploadedObjects);
 };
 
@@ -5,12 +5,55 @@
 #include <drogon/utils/coroutine.h>
 #include <json/json.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+/// Содержимое вложения без копирования: указатель на байты + владелец памяти.
+/// Владельцем может быть запрос (байты файла лежат в теле запроса) или собственный буфер
+/// (например, превью, сгенерированное сервером). Копирование AttachmentBuffer не копирует байты.
+class AttachmentBuffer
+{
+public:
+    AttachmentBuffer() = default;
+
+    /// Ссылка на чужую память; owner держит её живой.
+    AttachmentBuffer(std::shared_ptr<const void> owner, const uint8_t *data, size_t size)
+        : owner_(std::move(owner)), data_(data), size_(size)
+    {
+    }
+
+    /// Забрать владение байтами.
+    static AttachmentBuffer fromBytes(std::vector<uint8_t> bytes)
+    {
+        auto holder = std::make_shared<const std::vector<uint8_t>>(std::move(bytes));
+        const uint8_t *ptr = holder->data();
+        const size_t size = holder->size();
+        return AttachmentBuffer(std::move(holder), ptr, size);
+    }
+
+    const uint8_t *data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    const uint8_t *begin() const noexcept { return data_; }
+    const uint8_t *end() const noexcept { return data_ + size_; }
+    std::string_view view() const noexcept
+    {
+        return std::string_view(reinterpret_cast<const char *>(data_), size_);
+    }
+
+private:
+    std::shared_ptr<const void> owner_;
+    const uint8_t *data_ = nullptr;
+    size_t size_ = 0;
+};
+
 struct AttachmentInput
 {
     std::string id;
@@ -18,7 +61,8 @@ struct AttachmentInput
     std::string role;
     std::string filename;
     std::string mimeType;
-    std::vector<uint8_t> data;
+    AttachmentBuffer data;
+    std::string sha256; // hex SHA-256 содержимого, если уже посчитан при приёме (иначе пусто)
 };
 
 struct UploadOp
@@ -35,6 +79,20 @@ struct DbOp
     std::function<drogon::Task<void>(const std::shared_ptr<drogon::orm::Transaction> &)> exec;
 };
 
+/// Записанная строка (INSERT/UPDATE ... RETURNING * или SELECT * последним шагом плана).
+/// В JSON кодируется после коммита тем же кодировщиком, что и страница (TableDataService::encodeRows).
+struct WrittenRow
+{
+    std::optional<drogon::orm::Result> result;
+};
+
+/// Объект, загруженный в хранилище в ходе записи: при откате его нужно удалить.
+struct UploadedObject
+{
+    std::string bucket;
+    std::string objectKey;
+};
+
 struct RowWritePlan
 {
     std::vector<DbOp> preUploadDbOps;
@@ -43,6 +101,8 @@ struct RowWritePlan
     Json::Value successExtra;
     Json::Value warnings;
     Json::Value debug;
+    // Строка после записи: заполняют DbOp-ы плана внутри транзакции, после коммита уходит в ответ (data.row).
+    std::shared_ptr<WrittenRow> writtenRow;
 };
 
 struct WriteResult
@@ -8,20 +8,28 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 /// Контроллер для soft delete записи.
 /// Маршрут: POST /row/delete
 /// Ожидает JSON: { "table": "...", "rowId": 123 }
+/// Массовые варианты: POST /row/deleteMany, POST /row/restoreMany — одним UPDATE на запрос.
+/// Ожидают JSON: { "table": "...", "ids": [1, 2, ...] } или { "table": "...", "filters": [...] }
+/// (filters — как в /table/getTableData, TableQueryBuilder). Ответ: data { affected, ids }.
 class RowDeleteController : public drogon::HttpController<RowDeleteController>
 {
 public:
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(RowDeleteController::deleteRow, "/row/delete", drogon::Post);
     ADD_METHOD_TO(RowDeleteController::restoreRow, "/row/restore", drogon::Post);
+    ADD_METHOD_TO(RowDeleteController::deleteRows, "/row/deleteMany", drogon::Post);
+    ADD_METHOD_TO(RowDeleteController::restoreRows, "/row/restoreMany", drogon::Post);
     METHOD_LIST_END
 
     drogon::Task<drogon::HttpResponsePtr> deleteRow(drogon::HttpRequestPtr req);
     drogon::Task<drogon::HttpResponsePtr> restoreRow(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> deleteRows(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> restoreRows(drogon::HttpRequestPtr req);
 
 private:
     struct ParsedRequest
@@ -30,9 +38,21 @@ private:
         int64_t rowId = 0;
     };
 
+    /// Массовый запрос: либо ids (без повторов), либо непустой filters.
+    struct ParsedBulkRequest
+    {
+        std::string table;
+        std::vector<int64_t> ids;
+        Json::Value filters{Json::nullValue};
+    };
+
+    /// Общая часть deleteRows/restoreRows: deleted — новое значение is_deleted.
+    static drogon::Task<drogon::HttpResponsePtr> setDeletedMany(drogon::HttpRequestPtr req, bool deleted);
+
     static drogon::HttpResponsePtr makeSuccessResponse(int64_t rowId);
     static drogon::HttpResponsePtr makeErrorResponse(const std::string &code,
                                                      const std::string &message,
                                                      drogon::HttpStatusCode status);
     static ParsedRequest parseJsonRequest(drogon::HttpRequestPtr req);
+    static ParsedBulkRequest parseBulkJsonRequest(drogon::HttpRequestPtr req);
 };
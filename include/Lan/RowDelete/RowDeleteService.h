@@ -37,16 +37,16 @@ private:
 class RowDeleteService
 {
 public:
-    RowDeleteService();
+    explicit RowDeleteService(std::shared_ptr<const RowDeletePlannerRegistry> registry);
 
     /// Пример использования (без эндпоинта):
-    /// RowDeleteService service;
+    /// auto service = LanServicesPlugin::rowDeleter();
     /// RowDeleteRequest req;
     /// req.table = "milling_tool_catalog";
     /// req.rowId = 123;
-    /// auto result = co_await service.deleteRow(req);
+    /// auto result = co_await service->deleteRow(req);
     drogon::Task<DeleteResult> deleteRow(const RowDeleteRequest &request);
 
 private:
-    std::shared_ptr<RowDeletePlannerRegistry> registry_;
+    std::shared_ptr<const RowDeletePlannerRegistry> registry_;
 };
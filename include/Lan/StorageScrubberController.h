@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Lan/AuthController.h"
+
+#include <drogon/HttpController.h>
+#include <drogon/drogon.h>
+#include <json/json.h>
+
+#include <string>
+
+/// Ручной запуск одного прохода сверки хранилища.
+/// Маршрут: POST /storage/scrub
+class StorageScrubberController : public drogon::HttpController<StorageScrubberController>
+{
+public:
+    METHOD_LIST_BEGIN
+    ADD_METHOD_TO(StorageScrubberController::scrub, "/storage/scrub", drogon::Post);
+    METHOD_LIST_END
+
+    drogon::Task<drogon::HttpResponsePtr> scrub(drogon::HttpRequestPtr req);
+
+private:
+    static drogon::HttpResponsePtr makeErrorResponse(const std::string &code,
+                                                     const std::string &message,
+                                                     drogon::HttpStatusCode status);
+};
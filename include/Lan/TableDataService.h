@@ -4,9 +4,12 @@
 #include <json/json.h>
 
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
 
 class TableRepository;
+struct WrittenRow;
 
 /// Бизнес-логика выдачи табличных данных (list/page) без MinIO.
 class TableDataService
@@ -20,18 +23,31 @@ public:
         Json::Value rows{Json::arrayValue};
     };
 
-    TableDataService();
+    /// Экземпляр один на приложение (LanServicesPlugin): состояние неизменяемо после создания.
+    TableDataService(std::string schema, std::shared_ptr<const TableRepository> repo);
 
     drogon::Task<PageResult> getPage(const std::string &tableName,
                                      const Json::Value &filters,
                                      int offset,
                                      int limit) const;
 
+    /// Строки результата (SELECT * / RETURNING * базовой таблицы) в JSON, как в getPage:
+    /// колонки и типы по TableInfoCache для tableName, id заменяется на global_id
+    /// (из колонки global_id строки; global_object_registry — только для строк без неё).
+    static drogon::Task<Json::Value> encodeRows(const std::string &tableName, const drogon::orm::Result &result);
+
+    /// data.row ответа записи: первая строка RETURNING * плана в кодировке encodeRows.
+    /// global_id берётся из колонки строки, а не из реестра, поэтому строка видна и до завершения коммита.
+    /// nullopt — строки нет; ошибка кодирования только логируется (logPrefix — имя сервиса).
+    static drogon::Task<std::optional<Json::Value>> encodeWrittenRow(const std::string &tableName,
+                                                                     const std::shared_ptr<WrittenRow> &row,
+                                                                     const std::string &logPrefix);
+
     // Заготовка под будущее (не используем сейчас).
     drogon::Task<Json::Value> getById(const std::string &tableName, int64_t id) const;
 
 private:
-    std::string schema_{"public"};
-    std::shared_ptr<TableRepository> repo_;
+    std::string schema_;
+    std::shared_ptr<const TableRepository> repo_;
 };
 
@@ -12,12 +12,28 @@
 /// POST /table/images/get
 /// Headers: token
 /// Body: { "nodeId": <int, 1-based>, "small": <bool>, "rowId": <uint64 or string>, "dbName": <string> }
+/// Опционально: Range: bytes=a-b | a- | -n (один диапазон) и If-Range: <etag> —
+/// ответ 206, бинарная часть содержит только диапазон и заголовок Content-Range.
+/// Опционально: "maxSide": <int> и/или "format": "jpeg"|"png"|"webp" (тогда small необязателен) —
+/// отдаётся сохранённый small, если он подходит, иначе производный вариант из big, который
+/// при первом запросе строится ThumbnailPlugin и сохраняется под variants/<objectKey>/<side>.<ext>.
+/// Без format формат выбирается по Accept (WebP, если клиент его принимает). Range к производным
+/// вариантам не применяется.
+///
+/// POST /table/images/urls (MinioPlugin.presign_enabled)
+/// Headers: token
+/// Body: { "nodeId": <int>, "small": <bool>, "dbName": <string>, "rowIds": [<uint64 or string>, ...] }
+/// Ответ: { "ok": true, "items": [{ rowId, url, expiresAt, mimeType, filename, linkName?, linkUrl? }],
+///          "errors": [{ rowId, message }] } — байты клиент скачивает напрямую из MinIO.
+/// Ссылки берутся из кэша; промахи страницы подписываются одним заходом на потоках StoragePlugin.
 class TableImageSender : public drogon::HttpController<TableImageSender>
 {
 public:
     METHOD_LIST_BEGIN
     ADD_METHOD_TO(TableImageSender::getTableImages, "/table/images/get", drogon::Post);
+    ADD_METHOD_TO(TableImageSender::getTableImageUrls, "/table/images/urls", drogon::Post);
     METHOD_LIST_END
 
     drogon::Task<drogon::HttpResponsePtr> getTableImages(drogon::HttpRequestPtr req);
+    drogon::Task<drogon::HttpResponsePtr> getTableImageUrls(drogon::HttpRequestPtr req);
 };
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <drogon/orm/DbClient.h>
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/// Дедупликация вложений по содержимому: ключ объекта — SHA-256 байтов,
+/// одинаковые файлы хранятся в MinIO одним объектом. Счётчик ссылок — public.storage_blobs:
+/// - reserve() — до загрузки (вне транзакции): создаёт запись с ref_count = 0 или продлевает
+///   существующую и возвращает ключи, которые нужно загрузить;
+/// - retain()  — внутри транзакции записи, +1 за каждую ссылку;
+/// - release() — внутри транзакции удаления/замены, -1 за каждую ссылку.
+/// Объект удаляется фоновым проходом, когда ref_count = 0 дольше grace_minutes:
+/// grace защищает загрузку, зарезервированную параллельным запросом.
+/// Проход не держит транзакцию на время удаления из хранилища: строки помечаются (gc_started_at),
+/// объекты удаляются, затем строки удаляются; reserve() помеченную строку ждёт, а не продлевает.
+class BlobStorePlugin : public drogon::Plugin<BlobStorePlugin>
+{
+public:
+    struct Blob
+    {
+        std::string bucket;
+        std::string objectKey;
+        std::string sha256;
+        size_t sizeBytes = 0;
+        std::string mimeType;
+    };
+
+    struct BlobRef
+    {
+        std::string bucket;
+        std::string objectKey;
+        int64_t count = 1;
+    };
+
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    /// Включена ли дедупликация для сервисов записи.
+    bool enabled() const { return enabled_; }
+
+    /// Ключ объекта по хэшу: blobs/<sha[0:2]>/<sha>. Расширение в ключ не входит:
+    /// одинаковые байты под разными именами (.JPG/.jpeg) — один объект.
+    static std::string objectKeyFor(const std::string &sha256);
+
+    /// Ключ принадлежит контентно-адресуемому хранилищу (управляется счётчиком ссылок).
+    static bool isBlobKey(const std::string &objectKey);
+
+    /// Зарезервировать блобы перед загрузкой. Возвращает "bucket/objectKey" тех,
+    /// которых ещё нет в хранилище (нужно загрузить).
+    /// Бросает std::runtime_error, если блоб дольше ~5 с остаётся помеченным сборкой мусора.
+    drogon::Task<std::unordered_set<std::string>> reserve(const std::vector<Blob> &blobs);
+
+    /// Увеличить счётчики в транзакции записи.
+    /// Бросает std::runtime_error, если резерв уже забрала сборка мусора.
+    static drogon::Task<void> retain(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                     const std::vector<BlobRef> &refs);
+
+    /// Уменьшить счётчики в транзакции удаления/замены. Ключи без записи только логируются.
+    static drogon::Task<void> release(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                      const std::vector<BlobRef> &refs);
+
+    /// Один проход сборки мусора. Возвращает количество удалённых объектов.
+    drogon::Task<int> runOnce();
+
+private:
+    bool enabled_ = false;
+    int graceMinutes_ = 60;
+    int batchSize_ = 200;
+    trantor::TimerId timerId_{trantor::InvalidTimerId};
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <drogon/utils/coroutine.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Асинхронный интерфейс объектного хранилища (bucket + key).
+/// Реализации: MinioStorage (MinIO/S3) и LocalFsStorage (каталог на диске).
+/// Блокирующий ввод-вывод выполняется на потоках реализации, а не на IO-потоках Drogon;
+/// вызывающая корутина продолжается на своём цикле событий.
+/// Аргументы по ссылке и буферы данных должны жить до завершения co_await.
+class IObjectStorage
+{
+public:
+    struct Status
+    {
+        bool ok = false;
+        std::string error;
+        bool notFound = false; // объекта нет (в отличие от сбоя хранилища)
+
+        explicit operator bool() const { return ok; }
+
+        static Status success() { return Status{true, {}}; }
+        static Status failure(std::string error) { return Status{false, std::move(error)}; }
+        static Status missing(std::string error) { return Status{false, std::move(error), true}; }
+    };
+
+    struct ObjectStat
+    {
+        size_t size = 0;
+        std::string etag;
+        std::string contentType; // может быть пустым, если backend не хранит MIME-тип
+    };
+
+    struct PutJob
+    {
+        std::string bucket;
+        std::string objectKey;
+        std::string contentType;
+        // Данные должны жить до завершения put/putAll.
+        const uint8_t *data = nullptr;
+        size_t size = 0;
+    };
+
+    struct PutResult
+    {
+        bool ok = false;
+        std::string error;
+        double durationMs = 0.0;
+        size_t lane = 0;
+    };
+
+    virtual ~IObjectStorage() = default;
+
+    /// Имя backend-а для логов и debug ("minio", "local").
+    virtual const char *name() const = 0;
+
+    /// Сколько загрузок putAll выполняет параллельно.
+    virtual size_t concurrency() const = 0;
+
+    /// Загрузить набор объектов. Не бросает на ошибках загрузки:
+    /// результат по каждому job возвращается в том же порядке.
+    virtual drogon::Task<std::vector<PutResult>> putAll(const std::vector<PutJob> &jobs) = 0;
+
+    /// Прочитать объект целиком (outData перезаписывается).
+    virtual drogon::Task<Status> get(const std::string &bucket,
+                                     const std::string &objectKey,
+                                     std::vector<uint8_t> &outData,
+                                     std::string *outContentType) = 0;
+
+    /// Прочитать диапазон [offset, offset + length) — диапазон должен лежать внутри объекта.
+    virtual drogon::Task<Status> getRange(const std::string &bucket,
+                                          const std::string &objectKey,
+                                          size_t offset,
+                                          size_t length,
+                                          std::vector<uint8_t> &outData,
+                                          std::string *outContentType) = 0;
+
+    /// Метаданные объекта. Отсутствующий объект — Status с notFound = true.
+    virtual drogon::Task<Status> stat(const std::string &bucket, const std::string &objectKey, ObjectStat &outStat) = 0;
+
+    /// Ключи bucket-а по возрастанию, начиная после startAfter (пусто — с начала),
+    /// не больше maxKeys; outKeys перезаписывается. Меньше maxKeys — перечисление закончено.
+    virtual drogon::Task<Status> list(const std::string &bucket,
+                                      const std::string &prefix,
+                                      const std::string &startAfter,
+                                      size_t maxKeys,
+                                      std::vector<std::string> &outKeys) = 0;
+
+    /// Удалить объект. Отсутствующий объект удалением не считается ошибкой.
+    virtual drogon::Task<Status> remove(const std::string &bucket, const std::string &objectKey) = 0;
+
+    /// Удалить несколько объектов bucket-а; failedKeys — ключи, которые удалить не удалось.
+    virtual drogon::Task<Status> removeMany(const std::string &bucket,
+                                            const std::vector<std::string> &objectKeys,
+                                            std::vector<std::string> &failedKeys) = 0;
+
+    /// Presigned GET-ссылки на ключи bucket-а: outUrls в порядке objectKeys, пустая строка —
+    /// подпись не удалась (Status содержит первую ошибку). Backend без ссылок возвращает failure.
+    virtual drogon::Task<Status> presignGetMany(const std::string &bucket,
+                                                const std::vector<std::string> &objectKeys,
+                                                unsigned int expirySeconds,
+                                                std::vector<std::string> &outUrls) = 0;
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Storage/IObjectStorage.h"
+
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/// IObjectStorage в каталоге на диске: объект хранится в <root>/<bucket>/<objectKey>.
+/// Запись идёт во временный файл рядом с итоговым; fsync выполняется пачками
+/// раз в fsyncBatchMs для всех putAll, пришедших за это время, после чего файлы
+/// переименовываются в итоговые и синхронизируются их каталоги. putAll завершается
+/// только после fsync — загруженный объект переживает падение процесса и ОС.
+/// MIME-тип не сохраняется: get/stat возвращают пустой contentType.
+class LocalFsStorage : public IObjectStorage
+{
+public:
+    struct Config
+    {
+        std::string root = "./uploads/objects";
+        size_t ioThreads = 4;
+        int fsyncBatchMs = 5;
+    };
+
+    explicit LocalFsStorage(Config config);
+    ~LocalFsStorage() override;
+
+    const char *name() const override { return "local"; }
+    size_t concurrency() const override { return cfg_.ioThreads; }
+
+    drogon::Task<std::vector<PutResult>> putAll(const std::vector<PutJob> &jobs) override;
+
+    drogon::Task<Status> get(const std::string &bucket,
+                             const std::string &objectKey,
+                             std::vector<uint8_t> &outData,
+                             std::string *outContentType) override;
+
+    drogon::Task<Status> getRange(const std::string &bucket,
+                                  const std::string &objectKey,
+                                  size_t offset,
+                                  size_t length,
+                                  std::vector<uint8_t> &outData,
+                                  std::string *outContentType) override;
+
+    drogon::Task<Status> stat(const std::string &bucket, const std::string &objectKey, ObjectStat &outStat) override;
+
+    drogon::Task<Status> list(const std::string &bucket,
+                              const std::string &prefix,
+                              const std::string &startAfter,
+                              size_t maxKeys,
+                              std::vector<std::string> &outKeys) override;
+
+    drogon::Task<Status> remove(const std::string &bucket, const std::string &objectKey) override;
+
+    drogon::Task<Status> removeMany(const std::string &bucket,
+                                    const std::vector<std::string> &objectKeys,
+                                    std::vector<std::string> &failedKeys) override;
+
+    drogon::Task<Status> presignGetMany(const std::string &bucket,
+                                        const std::vector<std::string> &objectKeys,
+                                        unsigned int expirySeconds,
+                                        std::vector<std::string> &outUrls) override;
+
+private:
+    class PutAwaiter;
+    friend class PutAwaiter;
+
+    /// Файлы одного putAll, ожидающие fsync. Индексы совпадают с jobs/results;
+    /// в пачку попадают только job с results[i].ok.
+    struct SyncBatch
+    {
+        std::vector<std::string> tmpPaths;
+        std::vector<std::string> finalPaths;
+        std::vector<std::chrono::steady_clock::time_point> started;
+        std::vector<PutResult> *results = nullptr;
+        std::coroutine_handle<> waiter;
+        trantor::EventLoop *resumeLoop = nullptr; // цикл вызывающего putAll; nullptr — поток workers_
+    };
+
+    /// Путь объекта на диске; пустая строка, если bucket/ключ выходят за пределы root.
+    std::string pathFor(const std::string &bucket, const std::string &objectKey) const;
+
+    /// Поставить записанные файлы в ближайшую пачку fsync.
+    void scheduleSync(std::shared_ptr<SyncBatch> batch);
+
+    /// Выполняется на потоке fsync: fsync файлов, rename, fsync каталогов, возобновление ожидающих.
+    void flushPending();
+
+    Config cfg_;
+    std::unique_ptr<trantor::EventLoopThreadPool> workers_;
+    std::unique_ptr<trantor::EventLoopThreadPool> syncer_;
+
+    std::mutex syncMutex_;
+    std::vector<std::shared_ptr<SyncBatch>> pending_;
+    bool flushScheduled_ = false;
+    std::atomic<uint64_t> tmpSeq_{0};
+};
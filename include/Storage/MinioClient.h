@@ -4,13 +4,28 @@
 #include <vector>
 #include <memory>
 #include <optional>
-#include <mutex>
 
 /// Обёртка над MinIO C++ SDK для загрузки и удаления объектов.
 /// Использует minio-cpp SDK (https://github.com/minio/minio-cpp)
+/// Экземпляр не потокобезопасен (SDK кэширует регионы без блокировок):
+/// для общих вызовов берите клиент из MinioClientPool.
 class MinioClient
 {
 public:
+    /// Результат вызова: ошибка возвращается вызывающему, а не хранится в клиенте.
+    struct CallResult
+    {
+        bool ok = false;
+        std::string error; // текст ошибки SDK (пусто при успехе)
+        bool notFound = false; // сервер ответил, что объекта нет (404 / NoSuchKey)
+
+        explicit operator bool() const { return ok; }
+
+        static CallResult success() { return CallResult{true, {}}; }
+        static CallResult failure(std::string error) { return CallResult{false, std::move(error)}; }
+        static CallResult missing(std::string error) { return CallResult{false, std::move(error), true}; }
+    };
+
     /// Структура для хранения конфигурации MinIO
     struct Config
     {
@@ -19,6 +34,11 @@ public:
         std::string secretKey;
         std::string bucket;      // имя bucket по умолчанию
         bool useSSL = false;     // использовать ли HTTPS
+        // Размер части multipart-загрузки в байтах (0 — выбирает SDK, минимум S3 — 5 МиБ).
+        // Объекты больше partSize грузятся по частям.
+        size_t partSize = 0;
+        // Регион bucket-ов; если задан, SDK не запрашивает его у сервера (нужно для presign без сети).
+        std::string region;
     };
 
     /// Инициализация клиента с конфигурацией
@@ -36,52 +56,102 @@ public:
     /// @param objectKey ключ объекта (путь)
     /// @param data данные для загрузки
     /// @param contentType MIME-тип (опционально)
-    /// @return true при успехе, false при ошибке
-    bool putObject(const std::string &bucket,
-                   const std::string &objectKey,
-                   const std::vector<uint8_t> &data,
-                   const std::string &contentType = "");
+    /// @return ok при успехе, иначе error с описанием
+    CallResult putObject(const std::string &bucket,
+                         const std::string &objectKey,
+                         const std::vector<uint8_t> &data,
+                         const std::string &contentType = "");
 
     /// Загрузить объект в MinIO (перегрузка для string_view)
-    bool putObject(const std::string &bucket,
-                   const std::string &objectKey,
-                   const std::string_view &data,
-                   const std::string &contentType = "");
+    CallResult putObject(const std::string &bucket,
+                         const std::string &objectKey,
+                         const std::string_view &data,
+                         const std::string &contentType = "");
 
     /// Удалить объект из MinIO
     /// @param bucket имя bucket
     /// @param objectKey ключ объекта
-    /// @return true при успехе, false при ошибке
-    bool deleteObject(const std::string &bucket, const std::string &objectKey);
+    /// @return ok при успехе, иначе error с описанием
+    CallResult deleteObject(const std::string &bucket, const std::string &objectKey);
+
+    /// Удалить несколько объектов одним запросом S3 DeleteObjects (multi-object delete).
+    /// @param bucket имя bucket (если пустое, используется из config)
+    /// @param objectKeys ключи объектов (S3 принимает до 1000 за запрос, SDK делит сам)
+    /// @param failedKeys ключи, которые удалить не удалось (при ошибке всего запроса — все)
+    /// @return ok, если удалены все объекты
+    CallResult removeObjects(const std::string &bucket,
+                             const std::vector<std::string> &objectKeys,
+                             std::vector<std::string> &failedKeys);
 
     /// Выгрузить (скачать) объект из MinIO
     /// @param bucket имя bucket (если пустое, используется из config)
     /// @param objectKey ключ объекта
     /// @param outData буфер, в который будет записано содержимое объекта (перезаписывается)
     /// @param outContentType опционально: MIME-тип из ответа (если доступен)
-    /// @return true при успехе, false при ошибке
-    bool getObject(const std::string &bucket,
-                   const std::string &objectKey,
-                   std::vector<uint8_t> &outData,
-                   std::string *outContentType = nullptr);
+    /// @return ok при успехе, иначе error с описанием
+    CallResult getObject(const std::string &bucket,
+                         const std::string &objectKey,
+                         std::vector<uint8_t> &outData,
+                         std::string *outContentType = nullptr);
+
+    /// Выгрузить диапазон байт объекта [offset, offset + length) (S3 GetObject с Range).
+    /// Диапазон должен лежать внутри объекта (см. statObject).
+    CallResult getObjectRange(const std::string &bucket,
+                              const std::string &objectKey,
+                              size_t offset,
+                              size_t length,
+                              std::vector<uint8_t> &outData,
+                              std::string *outContentType = nullptr);
+
+    /// Метаданные объекта без тела (S3 HeadObject).
+    struct ObjectInfo
+    {
+        size_t size = 0;
+        std::string etag;
+        std::string contentType;
+    };
+
+    /// Получить размер, ETag и MIME-тип объекта. Отсутствие объекта — failure с notFound = true.
+    CallResult statObject(const std::string &bucket, const std::string &objectKey, ObjectInfo &outInfo);
+
+    /// Перечислить ключи bucket-а (S3 ListObjectsV2, рекурсивно) в лексикографическом порядке.
+    /// @param prefix только ключи с этим префиксом (пусто — все)
+    /// @param startAfter продолжить после этого ключа (пусто — с начала)
+    /// @param maxKeys не больше стольких ключей (outKeys перезаписывается)
+    CallResult listObjects(const std::string &bucket,
+                           const std::string &prefix,
+                           const std::string &startAfter,
+                           size_t maxKeys,
+                           std::vector<std::string> &outKeys);
+
+    /// Подписать временную ссылку на скачивание (S3 presigned GET).
+    /// Подпись считается локально; при заданном Config::region запросов к серверу нет.
+    /// @param expirySeconds время жизни ссылки (S3 допускает до 7 суток)
+    CallResult presignGetObject(const std::string &bucket,
+                                const std::string &objectKey,
+                                unsigned int expirySeconds,
+                                std::string &outUrl);
 
     /// Получить конфигурацию
     const Config &getConfig() const { return config_; }
 
-    /// Последняя ошибка, полученная от SDK (для диагностики).
-    /// Возвращает пустую строку, если последняя операция прошла успешно
-    /// или если ошибка не была установлена.
-    std::string lastError() const;
-
 private:
     Config config_;
     // PIMPL: скрываем детали реализации minio-cpp
     class Impl;
     std::unique_ptr<Impl> pImpl_;
 
-    void setLastError(std::string err);
-    void clearLastError();
-    mutable std::mutex lastErrorMutex_;
-    std::string lastError_;
+    struct ByteRange
+    {
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    // range == nullptr — объект целиком.
+    CallResult fetchObject(const std::string &bucket,
+                           const std::string &objectKey,
+                           const ByteRange *range,
+                           std::vector<uint8_t> &outData,
+                           std::string *outContentType);
 };
 
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "Storage/MinioClient.h"
+
+/// Пул клиентов MinIO для вызовов с потоков Drogon.
+/// Клиент выдаётся в аренду (Lease) на время одного синхронного вызова и возвращается
+/// в пул деструктором аренды; при исчерпании пула lease() ждёт освобождения клиента.
+/// Аренду нельзя держать через co_await: иначе пул может исчерпаться на IO-потоках.
+class MinioClientPool
+{
+public:
+    class Lease
+    {
+    public:
+        Lease(Lease &&other) noexcept;
+        Lease &operator=(Lease &&) = delete;
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+        ~Lease();
+
+        MinioClient *operator->() const { return client_; }
+        MinioClient &operator*() const { return *client_; }
+
+    private:
+        friend class MinioClientPool;
+        Lease(MinioClientPool *pool, MinioClient *client) : pool_(pool), client_(client) {}
+
+        MinioClientPool *pool_ = nullptr;
+        MinioClient *client_ = nullptr;
+    };
+
+    MinioClientPool(const MinioClient::Config &config, size_t size);
+
+    MinioClientPool(const MinioClientPool &) = delete;
+    MinioClientPool &operator=(const MinioClientPool &) = delete;
+
+    /// Взять свободный клиент (блокирует поток, пока все клиенты заняты).
+    Lease lease();
+
+    size_t size() const { return clients_.size(); }
+
+private:
+    void release(MinioClient *client);
+
+    std::vector<std::unique_ptr<MinioClient>> clients_;
+    std::mutex mutex_;
+    std::condition_variable available_;
+    std::vector<MinioClient *> idle_;
+};
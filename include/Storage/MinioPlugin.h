@@ -1,29 +1,60 @@
 #pragma once
 
 #include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
 #include <json/json.h>
 
 #include <memory>
+#include <optional>
 #include <string>
+#include <vector>
 
 #include "Storage/MinioClient.h"
+#include "Storage/MinioClientPool.h"
+#include "Storage/ParallelUploader.h"
+#include "Storage/PresignedUrlCache.h"
 
-/// Drogon-плагин, который создаёт один MinioClient на всё приложение
-/// и отдаёт его другим компонентам через app().getPlugin<MinioPlugin>().
+/// Drogon-плагин, который создаёт пул MinioClient на всё приложение
+/// и отдаёт клиентов другим компонентам через app().getPlugin<MinioPlugin>().
 class MinioPlugin : public drogon::Plugin<MinioPlugin>
 {
 public:
     void initAndStart(const Json::Value &config) override;
     void shutdown() override;
 
-    /// Доступ к клиенту (инициализируется в initAndStart).
-    MinioClient &client();
+    /// Клиент из пула на время одного вызова: minioPlugin->client()->getObject(...).
+    /// Аренду не держать через co_await.
+    MinioClientPool::Lease client();
+
+    /// Пул клиентов (client_pool_size, инициализируется в initAndStart).
+    MinioClientPool &clientPool();
 
     /// Текущая конфигурация клиента.
     const MinioClient::Config &minioConfig() const;
 
+    /// Параллельная загрузка (upload_concurrency полос со своими клиентами).
+    ParallelUploader &uploader();
+
+    /// Разрешена ли выдача presigned-ссылок (presign_enabled).
+    bool presignEnabled() const { return presignEnabled_; }
+
+    /// Время жизни новой presigned-ссылки (presign_expiry_seconds).
+    unsigned int presignExpirySeconds() const { return presignExpirySeconds_; }
+
+    /// Presigned GET-ссылки в порядке objectKeys: из кэша или новая подпись (все промахи —
+    /// одним заходом на потоки StoragePlugin). Ссылка из кэша действительна ещё как минимум
+    /// четверть presign_expiry_seconds. std::nullopt — подпись не удалась (ошибка в логе).
+    drogon::Task<std::vector<std::optional<PresignedUrlCache::Entry>>>
+    presignedUrls(const std::string &bucket, const std::vector<std::string> &objectKeys);
+
 private:
-    std::unique_ptr<MinioClient> client_;
+    std::unique_ptr<MinioClientPool> clients_;
+    std::unique_ptr<ParallelUploader> uploader_;
+    size_t clientPoolSize_ = 8;
+    size_t uploadConcurrency_ = 4;
+    bool presignEnabled_ = false;
+    unsigned int presignExpirySeconds_ = 300;
+    std::unique_ptr<PresignedUrlCache> presignCache_;
     MinioClient::Config cfg_;
 };
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Storage/IObjectStorage.h"
+#include "Storage/MinioClientPool.h"
+#include "Storage/ParallelUploader.h"
+
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <memory>
+
+/// IObjectStorage поверх MinIO: загрузки — через полосы ParallelUploader,
+/// остальные вызовы — клиентами из MinioClientPool на собственных потоках.
+/// Пул и uploader принадлежат MinioPlugin и должны его пережить.
+class MinioStorage : public IObjectStorage
+{
+public:
+    MinioStorage(MinioClientPool &clients, ParallelUploader &uploader, size_t ioThreads);
+    ~MinioStorage() override;
+
+    const char *name() const override { return "minio"; }
+    size_t concurrency() const override { return uploader_.concurrency(); }
+
+    drogon::Task<std::vector<PutResult>> putAll(const std::vector<PutJob> &jobs) override;
+
+    drogon::Task<Status> get(const std::string &bucket,
+                             const std::string &objectKey,
+                             std::vector<uint8_t> &outData,
+                             std::string *outContentType) override;
+
+    drogon::Task<Status> getRange(const std::string &bucket,
+                                  const std::string &objectKey,
+                                  size_t offset,
+                                  size_t length,
+                                  std::vector<uint8_t> &outData,
+                                  std::string *outContentType) override;
+
+    drogon::Task<Status> stat(const std::string &bucket, const std::string &objectKey, ObjectStat &outStat) override;
+
+    drogon::Task<Status> list(const std::string &bucket,
+                              const std::string &prefix,
+                              const std::string &startAfter,
+                              size_t maxKeys,
+                              std::vector<std::string> &outKeys) override;
+
+    drogon::Task<Status> remove(const std::string &bucket, const std::string &objectKey) override;
+
+    drogon::Task<Status> removeMany(const std::string &bucket,
+                                    const std::vector<std::string> &objectKeys,
+                                    std::vector<std::string> &failedKeys) override;
+
+    drogon::Task<Status> presignGetMany(const std::string &bucket,
+                                        const std::vector<std::string> &objectKeys,
+                                        unsigned int expirySeconds,
+                                        std::vector<std::string> &outUrls) override;
+
+private:
+    MinioClientPool &clients_;
+    ParallelUploader &uploader_;
+    std::unique_ptr<trantor::EventLoopThreadPool> workers_;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <drogon/utils/coroutine.h>
+#include <trantor/net/EventLoopThreadPool.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Storage/IObjectStorage.h"
+#include "Storage/MinioClient.h"
+
+/// Параллельная загрузка объектов в MinIO.
+/// Каждая "полоса" (lane) — отдельный поток со своим MinioClient: вызовы SDK блокирующие,
+/// поэтому выполняются не на IO-потоках Drogon, а один клиент не используется из разных потоков.
+/// Создаётся MinioPlugin-ом, размер задаётся upload_concurrency.
+class ParallelUploader
+{
+public:
+    using Job = IObjectStorage::PutJob;
+    using Result = IObjectStorage::PutResult;
+
+    ParallelUploader(const MinioClient::Config &config, size_t concurrency);
+    ~ParallelUploader();
+
+    ParallelUploader(const ParallelUploader &) = delete;
+    ParallelUploader &operator=(const ParallelUploader &) = delete;
+
+    size_t concurrency() const { return clients_.size(); }
+
+    /// Загрузить все объекты, распределив их по полосам.
+    /// Не бросает на ошибках загрузки: результат по каждому job возвращается в том же порядке.
+    drogon::Task<std::vector<Result>> uploadAll(const std::vector<Job> &jobs);
+
+private:
+    std::vector<std::unique_ptr<MinioClient>> clients_;
+    std::unique_ptr<trantor::EventLoopThreadPool> workers_;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+/// Кэш presigned-ссылок MinIO по "bucket/key".
+/// Ссылка отдаётся повторно, пока до её истечения остаётся не меньше запрошенного запаса,
+/// так что подпись не пересчитывается на каждый запрос страницы.
+class PresignedUrlCache
+{
+public:
+    using Clock = std::chrono::system_clock;
+
+    struct Entry
+    {
+        std::string url;
+        Clock::time_point expiresAt;
+    };
+
+    explicit PresignedUrlCache(size_t maxEntries);
+
+    /// Ссылка, действительная как минимум до notBefore.
+    std::optional<Entry> get(const std::string &key, Clock::time_point notBefore) const;
+
+    void put(const std::string &key, Entry entry);
+
+private:
+    size_t maxEntries_;
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Entry> entries_;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <drogon/orm/DbClient.h>
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Staged write: вложения загружаются в MinIO до открытия транзакции,
+/// а транзакция содержит только SQL. Связь "объект загружен, но ещё не закоммичен"
+/// хранится в public.storage_staged_objects:
+/// - registerBatch() — до загрузки (вне транзакции);
+/// - commitBatch()   — внутри транзакции записи, удаляет строки батча;
+/// - discardBatch()  — после отката, когда объекты уже удалены.
+/// Всё, что осталось в журнале дольше ttl_minutes, удаляет фоновый reaper.
+/// Ключи объектов окончательные с момента загрузки (коммит не переносит объекты).
+/// Взаимоисключающий с BlobStorePlugin: при включённой дедупликации staged-режим не используется.
+class StagedUploadPlugin : public drogon::Plugin<StagedUploadPlugin>
+{
+public:
+    struct StagedObject
+    {
+        std::string bucket;
+        std::string objectKey;
+    };
+
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    /// Включён ли staged-режим для сервисов записи.
+    bool enabled() const { return enabled_; }
+
+    /// Зарегистрировать объекты в журнале. Возвращает batchId.
+    drogon::Task<std::string> registerBatch(const std::vector<StagedObject> &objects);
+
+    /// Закоммитить ключи батча в транзакции записи.
+    /// Бросает std::runtime_error, если часть записей уже забрал reaper (объекты могли быть удалены).
+    drogon::Task<void> commitBatch(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                   const std::string &batchId,
+                                   size_t expectedCount);
+
+    /// Убрать записи батча из журнала (best-effort, ошибки только логируются).
+    drogon::Task<void> discardBatch(const std::string &batchId);
+
+    /// Один проход reaper-а: удалить из storage объекты с просроченными записями.
+    drogon::Task<int> runOnce();
+
+private:
+    bool enabled_ = false;
+    int ttlMinutes_ = 60;
+    int batchSize_ = 200;
+    trantor::TimerId timerId_{trantor::InvalidTimerId};
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <drogon/orm/DbClient.h>
+#include <drogon/plugins/Plugin.h>
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Очередь удаления объектов из хранилища (outbox в public.storage_delete_queue).
+/// Запросы не ждут storage: удаление строки кладёт ключи в очередь в своей транзакции,
+/// откат записи — сразу после rollback. Фоновый воркер забирает записи пачками
+/// (FOR UPDATE SKIP LOCKED), удаляет объекты S3 multi-object delete и откладывает
+/// неудачные с экспоненциальной задержкой. Удаление идёт через StoragePlugin
+/// (IObjectStorage::removeMany) и не блокирует IO-потоки.
+class StorageDeleteQueuePlugin : public drogon::Plugin<StorageDeleteQueuePlugin>
+{
+public:
+    struct Object
+    {
+        std::string bucket;
+        std::string objectKey;
+    };
+
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    /// Включена ли очередь для сервисов (иначе они удаляют объекты синхронно).
+    bool enabled() const { return enabled_; }
+
+    /// Поставить объекты в очередь в транзакции (удаляются только после её коммита).
+    drogon::Task<void> enqueue(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                               const std::vector<Object> &objects);
+
+    /// Поставить объекты в очередь отдельным запросом (например, после отката записи).
+    drogon::Task<void> enqueue(const std::vector<Object> &objects);
+
+    /// Один проход воркера. Возвращает количество удалённых объектов.
+    drogon::Task<int> runOnce();
+
+    /// Счётчики воркера и состояние очереди в БД.
+    drogon::Task<Json::Value> stats();
+
+private:
+    bool enabled_ = false;
+    int batchSize_ = 500;
+    int baseBackoffSeconds_ = 10;
+    int maxBackoffSeconds_ = 3600;
+    trantor::TimerId timerId_{trantor::InvalidTimerId};
+
+    std::atomic<bool> running_{false};
+    std::atomic<uint64_t> enqueuedTotal_{0};
+    std::atomic<uint64_t> deletedTotal_{0};
+    std::atomic<uint64_t> failedTotal_{0};
+    std::atomic<uint64_t> batchesTotal_{0};
+    std::atomic<int64_t> lastBatchMs_{0};
+};
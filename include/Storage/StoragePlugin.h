@@ -0,0 +1,31 @@
+#pragma once
+
+#include <drogon/plugins/Plugin.h>
+#include <json/json.h>
+
+#include <memory>
+#include <string>
+
+#include "Storage/IObjectStorage.h"
+
+/// Выбор backend-а объектного хранилища для сервисов записи, чтения и удаления.
+/// backend = "minio" (по умолчанию) — MinioStorage поверх клиентов MinioPlugin;
+/// backend = "local" — LocalFsStorage в каталоге local_root без сети.
+/// Имена bucket-ов по-прежнему берутся из MinioPlugin::minioConfig().
+/// Presigned-ссылки выдаёт только MinIO (см. MinioPlugin::presignedUrls).
+class StoragePlugin : public drogon::Plugin<StoragePlugin>
+{
+public:
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    /// Активный backend. Бросает std::runtime_error до initAndStart/после shutdown.
+    IObjectStorage &storage();
+
+    /// true, если объекты лежат в MinIO (и доступны presigned-ссылки).
+    bool isMinio() const { return isMinio_; }
+
+private:
+    std::unique_ptr<IObjectStorage> storage_;
+    bool isMinio_ = true;
+};
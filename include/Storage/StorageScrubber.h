@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Storage/IObjectStorage.h"
+
+#include <drogon/utils/coroutine.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+struct StorageScrubberConfig
+{
+    // Строк milling_tool_images за проход (keyset по id).
+    int rowBatchSize = 200;
+    // Ключей bucket-а за проход (перечисление после последнего ключа прошлого прохода).
+    int listPageSize = 500;
+    // Ограничение запросов к хранилищу (stat + list) в секунду.
+    int maxRequestsPerSecond = 20;
+    // Префикс ключей, среди которых ищутся сироты (пусто — весь bucket).
+    std::string prefix;
+    // Объект удаляется, только если он не нужен ни одной записи на двух проходах с таким интервалом.
+    int orphanGraceMinutes = 60;
+    // false — только отчёт.
+    bool repairDangling = false;
+    bool repairOrphans = false;
+    bool useAdvisoryLock = true;
+    int64_t advisoryLockKey = 739002;
+};
+
+/// Итог одного прохода сверки.
+struct StorageScrubReport
+{
+    bool skipped = false; // идёт другой проход (этот инстанс или advisory lock другого)
+    int rowsScanned = 0;
+    int objectsChecked = 0;
+    int danglingKeys = 0;
+    int danglingRowsRepaired = 0;
+    int objectsListed = 0;
+    int orphanCandidates = 0;
+    int orphansConfirmed = 0;
+    int orphansRemoved = 0;
+    int storageErrors = 0;
+    bool imagesWrapped = false; // таблица пройдена до конца, следующий проход начнёт сначала
+    bool listingWrapped = false;
+    Json::Value samples{Json::arrayValue};
+
+    Json::Value toJson() const;
+};
+
+/// Сверка milling_tool_images с хранилищем объектов.
+/// Висячие ключи: строка ссылается на объект, которого нет (stat -> notFound).
+/// Сироты: объект bucket-а, на который не ссылается ни одна строка изображений, блоб,
+/// журнал staged write или очередь удаления.
+/// Каждый проход обрабатывает ограниченную порцию обеих сторон и продолжает с места,
+/// где остановился предыдущий; курсоры и кандидаты в сироты хранятся в памяти.
+class StorageScrubber
+{
+public:
+    explicit StorageScrubber(StorageScrubberConfig cfg);
+
+    /// Один проход сверки (порция строк + порция ключей bucket-а).
+    drogon::Task<StorageScrubReport> runOnce();
+
+private:
+    drogon::Task<void> scanImages(IObjectStorage &storage, const std::string &defaultBucket, StorageScrubReport &report);
+    drogon::Task<void> scanBucket(IObjectStorage &storage, const std::string &bucket, StorageScrubReport &report);
+    drogon::Task<bool> repairDanglingRow(int64_t imageId,
+                                         const std::string &bigBucket,
+                                         const std::string &bigKey,
+                                         const std::string &smallBucket,
+                                         const std::string &smallKey);
+    drogon::Task<void> throttle();
+
+    StorageScrubberConfig cfg_;
+    std::atomic<bool> running_{false};
+    int64_t imageCursor_ = 0;
+    std::string listCursor_;
+    // Ключ -> время, когда объект впервые оказался без ссылок.
+    std::unordered_map<std::string, std::chrono::steady_clock::time_point> orphanSeen_;
+    std::chrono::steady_clock::time_point nextRequestAt_{};
+};
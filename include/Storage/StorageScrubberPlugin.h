@@ -0,0 +1,23 @@
+#pragma once
+
+#include "Storage/StorageScrubber.h"
+
+#include <drogon/plugins/Plugin.h>
+#include <json/json.h>
+
+#include <memory>
+
+/// Периодическая сверка milling_tool_images с хранилищем (см. StorageScrubber).
+/// По умолчанию только отчёт в логах; repair_dangling / repair_orphans включают исправление.
+class StorageScrubberPlugin : public drogon::Plugin<StorageScrubberPlugin>
+{
+public:
+    void initAndStart(const Json::Value &config) override;
+    void shutdown() override;
+
+    drogon::Task<StorageScrubReport> runOnce();
+
+private:
+    std::shared_ptr<StorageScrubber> scrubber_;
+    trantor::TimerId timerId_{trantor::InvalidTimerId};
+};
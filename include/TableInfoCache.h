@@ -18,10 +18,22 @@ public:
     void initAndStart(const Json::Value &config) override;
     void shutdown() override;
 
+    /// Тип колонки из information_schema: data_type ("integer") и udt_name ("int4").
+    struct ColumnType
+    {
+        std::string dataType;
+        std::string udtName;
+    };
+    using ColumnTypes = std::unordered_map<std::string, ColumnType>;
+
     /// Получить (и при необходимости закешировать) список колонок таблицы.
     /// Возвращаем готовый Json-массив columns (как в ответе /table/get).
     drogon::Task<std::shared_ptr<const Json::Value>> getColumns(const std::string &tableName);
 
+    /// Типы колонок таблицы по имени колонки (строятся из getColumns и кешируются отдельно).
+    /// Нужны для типизированной привязки параметров при записи.
+    drogon::Task<std::shared_ptr<const ColumnTypes>> getColumnTypes(const std::string &tableName);
+
     /// Удалить запись из кеша для конкретной таблицы.
     void invalidate(const std::string &tableName);
 
@@ -34,5 +46,6 @@ private:
 
     mutable std::shared_mutex mu_;
     std::unordered_map<std::string, std::shared_ptr<const Json::Value>> columnsByTable_;
+    std::unordered_map<std::string, std::shared_ptr<const ColumnTypes>> typesByTable_;
 };
 
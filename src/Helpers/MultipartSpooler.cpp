@@ -0,0 +1,471 @@
+#include "Helpers/MultipartSpooler.h"
+
+#include <drogon/utils/Utilities.h>
+#include <json/reader.h>
+
+#include "Loger/Logger.h"
+
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#endif
+
+namespace
+{
+#if !defined(_WIN32)
+/// Владелец mmap-региона spool-файла (сам файл к этому моменту может быть уже удалён).
+struct MappedFile
+{
+    void *addr = nullptr;
+    size_t size = 0;
+
+    ~MappedFile()
+    {
+        if (addr && addr != MAP_FAILED)
+        {
+            ::munmap(addr, size);
+        }
+    }
+};
+#endif
+
+AttachmentBuffer mapSpooledFile(const std::string &path, size_t size)
+{
+    if (size == 0)
+    {
+        return AttachmentBuffer();
+    }
+#if !defined(_WIN32)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open spooled file");
+    }
+    void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map spooled file");
+    }
+    auto mapped = std::make_shared<MappedFile>();
+    mapped->addr = addr;
+    mapped->size = size;
+    const auto *data = static_cast<const uint8_t *>(addr);
+    return AttachmentBuffer(std::move(mapped), data, size);
+#else
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> bytes(size);
+    if (!in.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(size)))
+    {
+        throw std::runtime_error("Failed to read spooled file");
+    }
+    return AttachmentBuffer::fromBytes(std::move(bytes));
+#endif
+}
+} // namespace
+
+std::shared_ptr<MultipartSpooler> MultipartSpooler::create(Options options,
+                                                           PayloadCallback onPayload,
+                                                           FinishCallback onFinish)
+{
+    return std::shared_ptr<MultipartSpooler>(
+        new MultipartSpooler(std::move(options), std::move(onPayload), std::move(onFinish)));
+}
+
+MultipartSpooler::MultipartSpooler(Options options, PayloadCallback onPayload, FinishCallback onFinish)
+    : options_(std::move(options)),
+      onPayload_(std::move(onPayload)),
+      onFinish_(std::move(onFinish))
+{
+}
+
+MultipartSpooler::~MultipartSpooler()
+{
+    // Задачи runIo держат shared_ptr: здесь их уже нет, файл можно закрыть на месте.
+    if (file_)
+    {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+    // Отображённые в память вложения остаются валидными и после удаления файла.
+    for (const auto &f : result_.files)
+    {
+        std::error_code ec;
+        std::filesystem::remove(f.path, ec);
+    }
+}
+
+drogon::RequestStreamReaderPtr MultipartSpooler::makeReader(const drogon::HttpRequestPtr &req)
+{
+    auto self = shared_from_this();
+    return drogon::RequestStreamReader::newMultipartReader(
+        req,
+        [self](drogon::MultipartHeader header) { self->onHeader(header); },
+        [self](const char *data, size_t size) { self->onData(data, size); },
+        [self](std::exception_ptr ex) { self->onFinish(std::move(ex)); });
+}
+
+void MultipartSpooler::reject(Rejection rejection)
+{
+    std::lock_guard<std::mutex> lk(rejectionMutex_);
+    if (rejection_)
+    {
+        return;
+    }
+    rejection_ = std::move(rejection);
+    rejected_.store(true, std::memory_order_release);
+}
+
+std::optional<MultipartSpooler::Rejection> MultipartSpooler::rejection() const
+{
+    std::lock_guard<std::mutex> lk(rejectionMutex_);
+    return rejection_;
+}
+
+void MultipartSpooler::onHeader(const drogon::MultipartHeader &header)
+{
+    closeCurrentFile();
+    if (current_ == PartKind::Payload)
+    {
+        completePayload();
+    }
+    current_ = PartKind::Skip;
+
+    if (header.filename.empty())
+    {
+        if (header.name != "payload")
+        {
+            return;
+        }
+        if (payloadDone_ || !result_.files.empty())
+        {
+            reject(Rejection{"bad_request", "Duplicate or late 'payload' field", Json::nullValue, drogon::k400BadRequest});
+            return;
+        }
+        current_ = PartKind::Payload;
+        return;
+    }
+
+    if (isRejected())
+    {
+        return;
+    }
+    if (!payloadDone_)
+    {
+        reject(Rejection{"bad_request", "Field 'payload' must precede file parts", Json::nullValue, drogon::k400BadRequest});
+        return;
+    }
+    if (expectedParts_.find(header.name) == expectedParts_.end())
+    {
+        Json::Value details;
+        details["part"] = header.name;
+        reject(Rejection{"bad_request", "Unexpected file part without payload attachment: " + header.name, details, drogon::k400BadRequest});
+        return;
+    }
+    for (const auto &f : result_.files)
+    {
+        if (f.partName == header.name)
+        {
+            Json::Value details;
+            details["part"] = header.name;
+            reject(Rejection{"bad_request", "Duplicate file part: " + header.name, details, drogon::k400BadRequest});
+            return;
+        }
+    }
+
+    SpooledFile spooled;
+    spooled.partName = header.name;
+    spooled.filename = header.filename;
+    spooled.contentType = header.contentType;
+    spooled.path = options_.spoolDir + "/" + drogon::utils::getUuid(true) + ".part";
+    const size_t index = result_.files.size();
+    runIo([self = shared_from_this(), index, path = spooled.path]() { self->openFile(index, path); });
+    result_.files.push_back(std::move(spooled));
+    current_ = PartKind::File;
+}
+
+void MultipartSpooler::onData(const char *data, size_t size)
+{
+    switch (current_)
+    {
+    case PartKind::Payload:
+        if (payloadText_.size() + size > options_.maxPayloadBytes)
+        {
+            reject(Rejection{"bad_request", "Payload is too large", Json::nullValue, drogon::k413RequestEntityTooLarge});
+            current_ = PartKind::Skip;
+            return;
+        }
+        payloadText_.append(data, size);
+        return;
+    case PartKind::File:
+    {
+        // Запрос уже отклонён (например, ранней валидацией) — дальше на диск не пишем.
+        if (isRejected())
+        {
+            closeCurrentFile();
+            current_ = PartKind::Skip;
+            return;
+        }
+        auto &spooled = result_.files.back();
+        if (options_.maxFileBytes > 0 && spooled.size + size > options_.maxFileBytes)
+        {
+            Json::Value details;
+            details["part"] = spooled.partName;
+            details["maxBytes"] = static_cast<Json::UInt64>(options_.maxFileBytes);
+            reject(Rejection{"bad_request", "Attachment is too large", details, drogon::k413RequestEntityTooLarge});
+            closeCurrentFile();
+            current_ = PartKind::Skip;
+            return;
+        }
+        // Буфер reader-а действует только до возврата из onData: в задачу уходит копия куска.
+        runIo([self = shared_from_this(), chunk = std::string(data, size)]() { self->writeChunk(chunk); });
+        spooled.size += size;
+        return;
+    }
+    case PartKind::None:
+    case PartKind::Skip:
+        return;
+    }
+}
+
+void MultipartSpooler::onFinish(std::exception_ptr ex)
+{
+    closeCurrentFile();
+    if (current_ == PartKind::Payload)
+    {
+        completePayload();
+    }
+    current_ = PartKind::None;
+
+    if (ex)
+    {
+        reject(Rejection{"bad_request", "Failed to read request body", Json::nullValue, drogon::k400BadRequest});
+    }
+    else if (!payloadDone_)
+    {
+        reject(Rejection{"bad_request", "Missing 'payload' field in request", Json::nullValue, drogon::k400BadRequest});
+    }
+    else if (!isRejected())
+    {
+        for (const auto &id : expectedParts_)
+        {
+            bool found = false;
+            for (const auto &f : result_.files)
+            {
+                if (f.partName == id)
+                {
+                    found = true;
+                    break;
+                }
+            }
+            if (!found)
+            {
+                reject(Rejection{"bad_request", "Missing file part for attachment id: " + id, Json::nullValue, drogon::k400BadRequest});
+                break;
+            }
+        }
+    }
+
+    if (!onFinish_)
+    {
+        return;
+    }
+    // Колбэк — после всех записей (хеши и ошибки записи уже известны) и в исходном цикле.
+    trantor::EventLoop *caller = trantor::EventLoop::getEventLoopOfCurrentThread();
+    runIo([self = shared_from_this(), cb = std::move(onFinish_), caller]() mutable {
+        for (size_t i = 0; i < self->fileHashes_.size() && i < self->result_.files.size(); ++i)
+        {
+            self->result_.files[i].sha256 = std::move(self->fileHashes_[i]);
+        }
+        if (caller && !caller->isInLoopThread())
+        {
+            caller->queueInLoop([self, cb = std::move(cb)]() { cb(self); });
+            return;
+        }
+        cb(self);
+    });
+}
+
+void MultipartSpooler::completePayload()
+{
+    if (payloadDone_ || isRejected())
+    {
+        return;
+    }
+    Json::Reader reader;
+    Json::Value payload;
+    if (!reader.parse(payloadText_, payload) || !payload.isObject())
+    {
+        reject(Rejection{"bad_request", "Invalid JSON in payload field", Json::nullValue, drogon::k400BadRequest});
+        return;
+    }
+    payloadText_.clear();
+    payloadText_.shrink_to_fit();
+
+    if (payload.isMember("attachments"))
+    {
+        const Json::Value &attachments = payload["attachments"];
+        if (!attachments.isArray())
+        {
+            reject(Rejection{"bad_request", "Invalid payload: attachments must be array", Json::nullValue, drogon::k400BadRequest});
+            return;
+        }
+        for (const auto &att : attachments)
+        {
+            if (!att.isObject() || !att.isMember("id") || !att["id"].isString())
+            {
+                reject(Rejection{"bad_request", "Invalid payload: attachment.id is required", Json::nullValue, drogon::k400BadRequest});
+                return;
+            }
+            expectedParts_.insert(att["id"].asString());
+        }
+    }
+
+    result_.payload = std::move(payload);
+    payloadDone_ = true;
+    if (onPayload_)
+    {
+        onPayload_(result_.payload);
+    }
+}
+
+void MultipartSpooler::closeCurrentFile()
+{
+    if (current_ != PartKind::File)
+    {
+        return;
+    }
+    runIo([self = shared_from_this()]() { self->closeFile(); });
+}
+
+void MultipartSpooler::runIo(std::function<void()> task)
+{
+    if (!options_.ioLoop)
+    {
+        task();
+        return;
+    }
+    options_.ioLoop->queueInLoop(std::move(task));
+}
+
+void MultipartSpooler::openFile(size_t index, const std::string &path)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(options_.spoolDir, ec);
+    fileIndex_ = index;
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+    {
+        Logger::instance().error("MultipartSpooler: failed to create spool file path=" + path);
+        reject(Rejection{"internal", "Failed to spool attachment", Json::nullValue, drogon::k500InternalServerError});
+        return;
+    }
+    sha_ = std::make_unique<Sha256>();
+}
+
+void MultipartSpooler::writeChunk(const std::string &chunk)
+{
+    if (!file_ || isRejected())
+    {
+        return;
+    }
+    if (std::fwrite(chunk.data(), 1, chunk.size(), file_) != chunk.size())
+    {
+        Logger::instance().error("MultipartSpooler: write failed part=" + std::to_string(fileIndex_));
+        reject(Rejection{"internal", "Failed to spool attachment", Json::nullValue, drogon::k500InternalServerError});
+        return;
+    }
+    sha_->update(chunk.data(), chunk.size());
+}
+
+void MultipartSpooler::closeFile()
+{
+    if (!file_)
+    {
+        return;
+    }
+    std::fclose(file_);
+    file_ = nullptr;
+    if (sha_)
+    {
+        if (fileHashes_.size() <= fileIndex_)
+        {
+            fileHashes_.resize(fileIndex_ + 1);
+        }
+        fileHashes_[fileIndex_] = sha_->finalHex();
+    }
+    sha_.reset();
+}
+
+std::vector<AttachmentInput> MultipartSpooler::describeAttachments(const Json::Value &payload)
+{
+    std::vector<AttachmentInput> out;
+    if (!payload.isObject() || !payload.isMember("attachments") || !payload["attachments"].isArray())
+    {
+        return out;
+    }
+    for (const auto &att : payload["attachments"])
+    {
+        if (!att.isObject() || !att.isMember("id") || !att["id"].isString())
+        {
+            throw std::runtime_error("Invalid payload: attachment.id is required");
+        }
+        if (!att.isMember("dbName") || !att["dbName"].isString())
+        {
+            throw std::runtime_error("Invalid payload: attachment.dbName is required");
+        }
+        if (!att.isMember("role") || !att["role"].isString())
+        {
+            throw std::runtime_error("Invalid payload: attachment.role is required");
+        }
+        AttachmentInput input;
+        input.id = att["id"].asString();
+        input.dbName = att["dbName"].asString();
+        input.role = att["role"].asString();
+        if (att.isMember("filename") && att["filename"].isString())
+        {
+            input.filename = att["filename"].asString();
+        }
+        if (att.isMember("mimeType") && att["mimeType"].isString())
+        {
+            input.mimeType = att["mimeType"].asString();
+        }
+        out.push_back(std::move(input));
+    }
+    return out;
+}
+
+std::vector<AttachmentInput> MultipartSpooler::toAttachments() const
+{
+    std::vector<AttachmentInput> out = describeAttachments(result_.payload);
+
+    std::unordered_map<std::string, const SpooledFile *> byPart;
+    for (const auto &f : result_.files)
+    {
+        byPart.emplace(f.partName, &f);
+    }
+
+    for (auto &input : out)
+    {
+        auto it = byPart.find(input.id);
+        if (it == byPart.end())
+        {
+            throw std::runtime_error("Missing file part for attachment id: " + input.id);
+        }
+        const SpooledFile &spooled = *it->second;
+        if (input.filename.empty())
+        {
+            input.filename = spooled.filename;
+        }
+        input.data = mapSpooledFile(spooled.path, spooled.size);
+        input.sha256 = spooled.sha256;
+    }
+    return out;
+}
@@ -1,12 +1,16 @@
 #include "Lan/CellUpdate/CellUpdateController.h"
 #include "Lan/CellUpdate/CellUpdateErrors.h"
 #include "Lan/CellUpdate/CellUpdateService.h"
+#include "Lan/LanServicesPlugin.h"
+#include "Lan/RowAdd/IdempotencyPlugin.h"
+#include "Lan/MultipartStreamRoute.h"
 #include "Loger/Logger.h"
 
 #include <drogon/drogon.h>
 #include <drogon/MultiPart.h>
 #include <json/reader.h>
 
+#include <optional>
 #include <sstream>
 #include <unordered_set>
 
@@ -71,19 +75,27 @@ drogon::Task<drogon::HttpResponsePtr> CellUpdateController::updateCell(drogon::H
                                         k400BadRequest);
         }
 
+        const auto idempotency = co_await IdempotencyPlugin::begin(req, "updateCell", parsed.payload, parsed.attachments);
+        if (idempotency.response)
+        {
+            co_return idempotency.response;
+        }
+
+        HttpResponsePtr resp;
         try
         {
-            CellUpdateService service;
-            const WriteResult result = co_await service.update(parsed);
+            const WriteResult result = co_await LanServicesPlugin::cellUpdater()->update(parsed);
             const std::string dbName = parsed.payload.isMember("dbName") && parsed.payload["dbName"].isString()
                                            ? parsed.payload["dbName"].asString()
                                            : std::string();
-            co_return makeSuccessResponse(result.rowId, dbName, result.extra);
+            resp = makeSuccessResponse(result.rowId, dbName, result.extra);
         }
         catch (const CellUpdateError &e)
         {
-            co_return makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
+            resp = makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
         }
+        co_await IdempotencyPlugin::complete(idempotency.claim, resp);
+        co_return resp;
     }
     catch (const std::exception &e)
     {
@@ -94,6 +106,110 @@ drogon::Task<drogon::HttpResponsePtr> CellUpdateController::updateCell(drogon::H
     }
 }
 
+drogon::Task<drogon::HttpResponsePtr> CellUpdateController::updateCells(drogon::HttpRequestPtr req)
+{
+    using namespace drogon;
+
+    try
+    {
+        const std::string token = req->getHeader("token");
+        TokenValidator validator;
+        auto tokenStatus = co_await validator.check(token, req->getPeerAddr().toIp());
+        if (tokenStatus != TokenValidator::Status::Ok)
+        {
+            const auto httpCode = TokenValidator::toHttpCode(tokenStatus);
+            const std::string msg = TokenValidator::toError(tokenStatus);
+            const std::string code = (httpCode == k401Unauthorized) ? "unauthorized" : "internal";
+            co_return makeJsonResponse(makeErrorObj(code, msg), httpCode);
+        }
+
+        const auto json = req->getJsonObject();
+        if (!json || !json->isObject())
+        {
+            co_return makeErrorResponse("bad_request", "Invalid payload: expected JSON object", k400BadRequest);
+        }
+
+        try
+        {
+            Json::Value root;
+            root["ok"] = true;
+            root["data"] = co_await LanServicesPlugin::cellUpdater()->updateBatch(*json);
+            co_return makeJsonResponse(root, k200OK);
+        }
+        catch (const CellUpdateError &e)
+        {
+            co_return makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(std::string("updateCells fatal error: ") + e.what());
+        co_return makeErrorResponse("internal",
+                                    "Internal error: " + std::string(e.what()),
+                                    k500InternalServerError);
+    }
+}
+
+void CellUpdateController::updateCellStream(const drogon::HttpRequestPtr &req,
+                                            drogon::RequestStreamPtr &&stream,
+                                            std::function<void(const drogon::HttpResponsePtr &)> &&callback)
+{
+    using namespace drogon;
+
+    if (!stream)
+    {
+        async_run([this, req, callback = std::move(callback)]() -> Task<> {
+            callback(co_await updateCell(req));
+        });
+        return;
+    }
+
+    auto precheck = [](MultipartStreamRoute::Request probe) -> Task<std::optional<MultipartSpooler::Rejection>> {
+        ParsedRequest parsed;
+        parsed.payload = std::move(probe.payload);
+        parsed.attachments = std::move(probe.attachments);
+        try
+        {
+            co_await LanServicesPlugin::cellUpdater()->precheck(parsed);
+        }
+        catch (const CellUpdateError &e)
+        {
+            co_return MultipartSpooler::Rejection{e.code(), e.what(), e.details(), e.status()};
+        }
+        co_return std::nullopt;
+    };
+
+    auto handle = [req](MultipartStreamRoute::Request request) -> Task<HttpResponsePtr> {
+        ParsedRequest parsed;
+        parsed.payload = std::move(request.payload);
+        parsed.attachments = std::move(request.attachments);
+
+        const auto idempotency = co_await IdempotencyPlugin::begin(req, "updateCell", parsed.payload, parsed.attachments);
+        if (idempotency.response)
+        {
+            co_return idempotency.response;
+        }
+
+        HttpResponsePtr resp;
+        try
+        {
+            const WriteResult result = co_await LanServicesPlugin::cellUpdater()->update(parsed);
+            const std::string dbName = parsed.payload.isMember("dbName") && parsed.payload["dbName"].isString()
+                                           ? parsed.payload["dbName"].asString()
+                                           : std::string();
+            resp = makeSuccessResponse(result.rowId, dbName, result.extra);
+        }
+        catch (const CellUpdateError &e)
+        {
+            resp = makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
+        }
+        co_await IdempotencyPlugin::complete(idempotency.claim, resp);
+        co_return resp;
+    };
+
+    MultipartStreamRoute::start(req, stream, std::move(callback), "updateCellStream", std::move(precheck), std::move(handle));
+}
+
 CellUpdateController::ParsedRequest CellUpdateController::parseMultipartRequest(drogon::HttpRequestPtr req) const
 {
     ParsedRequest result;
@@ -180,8 +296,9 @@ CellUpdateController::ParsedRequest CellUpdateController::parseMultipartRequest(
                     input.mimeType = att["mimeType"].asString();
                 }
 
+                // Байты файла остаются в теле запроса: req держит их живыми до конца загрузки.
                 const auto content = fileIt->second.fileContent();
-                input.data.assign(content.begin(), content.end());
+                input.data = AttachmentBuffer(req, reinterpret_cast<const uint8_t *>(content.data()), content.size());
                 result.attachments.push_back(std::move(input));
                 seen.insert(id);
             }
@@ -1,18 +1,25 @@
 #include "Lan/CellUpdate/CellUpdatePlanner.h"
 #include "Lan/CellUpdate/CellUpdateErrors.h"
+#include "Lan/RowAdd/ColumnValues.h"
 #include "Lan/allTableList.h"
+#include "Storage/BlobStorePlugin.h"
 #include "TableInfoCache.h"
 
 #include <drogon/drogon.h>
 #include <algorithm>
 #include <cctype>
 #include <cmath>
+#include <memory>
 #include <optional>
 #include <stdexcept>
 #include <unordered_map>
+#include <utility>
 
 namespace
 {
+constexpr Json::ArrayIndex kMaxBatchCells = 5000;
+const std::string kRowVersionColumn = "row_version";
+
 bool isSafeIdentifier(const std::string &name)
 {
     if (name.empty())
@@ -34,37 +41,8 @@ std::string quoteIdent(const std::string &name)
     return "\"" + name + "\"";
 }
 
-void bindJsonValue(drogon::orm::internal::SqlBinder &binder, const Json::Value &value)
-{
-    if (value.isNull())
-    {
-        binder << nullptr;
-    }
-    else if (value.isBool())
-    {
-        binder << value.asBool();
-    }
-    else if (value.isInt() || value.isInt64() || value.isUInt() || value.isUInt64() || value.isDouble())
-    {
-        binder << value.asString();
-    }
-    else if (value.isString())
-    {
-        binder << value.asString();
-    }
-    else
-    {
-        throw std::runtime_error("Invalid field value type: expected scalar");
-    }
-}
-
-std::optional<int64_t> parseRowId(const Json::Value &payload)
+std::optional<int64_t> parseInt64(const Json::Value &v)
 {
-    if (!payload.isObject() || !payload.isMember("rowId"))
-    {
-        return std::nullopt;
-    }
-    const Json::Value &v = payload["rowId"];
     if (v.isInt64())
     {
         return v.asInt64();
@@ -109,11 +87,130 @@ std::optional<int64_t> parseRowId(const Json::Value &payload)
     return std::nullopt;
 }
 
+std::optional<int64_t> parseRowId(const Json::Value &payload)
+{
+    if (!payload.isObject() || !payload.isMember("rowId"))
+    {
+        return std::nullopt;
+    }
+    return parseInt64(payload["rowId"]);
+}
+
 bool isImageType(const std::string &typeStr)
 {
     return typeStr == "Image" || typeStr == "ImageWithLink";
 }
 
+/// Строка, которую меняет updateCell: базовая таблица, id и child_type_id дочерней таблицы.
+struct RowTarget
+{
+    std::string qualifiedTable; // "schema"."base"
+    std::string table;
+    int64_t rowId = 0;
+    bool isChild = false;
+    int childTypeId = 0;
+};
+
+/// Условие на строку: id = $first [AND child_type_id = $first+1].
+std::string rowCondition(bool isChild, int first)
+{
+    std::string cond = "id = $" + std::to_string(first);
+    if (isChild)
+    {
+        cond += " AND " + quoteIdent(kChildTypeIdColumn) + " = $" + std::to_string(first + 1);
+    }
+    return cond;
+}
+
+/// Текущая версия строки или nullopt, если строки нет.
+drogon::Task<std::optional<int64_t>> selectRowVersion(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                                      const RowTarget &target,
+                                                      bool lock)
+{
+    auto binder = (*trans << "SELECT " + quoteIdent(kRowVersionColumn) + " FROM " + target.qualifiedTable +
+                                 " WHERE " + rowCondition(target.isChild, 1) + (lock ? " FOR UPDATE" : ""));
+    binder << target.rowId;
+    if (target.isChild)
+    {
+        binder << target.childTypeId;
+    }
+    const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+    if (result.empty())
+    {
+        co_return std::nullopt;
+    }
+    co_return result[0][kRowVersionColumn].as<int64_t>();
+}
+
+/// Строки нет -> 404; строка есть, но версия другая -> 409 с текущей версией.
+[[noreturn]] void throwRowMismatch(int64_t rowId,
+                                   const std::string &dbName,
+                                   std::optional<int64_t> expectedVersion,
+                                   std::optional<int64_t> currentVersion)
+{
+    Json::Value details;
+    details["rowId"] = static_cast<Json::Int64>(rowId);
+    details["dbName"] = dbName;
+    if (!currentVersion)
+    {
+        throw CellUpdateError("not_found", "Row not found for update", drogon::k404NotFound, details);
+    }
+    details["expectedVersion"] = static_cast<Json::Int64>(*expectedVersion);
+    details["currentVersion"] = static_cast<Json::Int64>(*currentVersion);
+    throw CellUpdateError("version_conflict", "Row was changed by another update", drogon::k409Conflict, details);
+}
+
+/// Литерал text[] с NULL-элементами: значения в кавычках, \ и " экранируются.
+std::string pgNullableTextArray(const std::vector<const Json::Value *> &values)
+{
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (i > 0)
+        {
+            out += ",";
+        }
+        if (values[i]->isNull())
+        {
+            out += "NULL";
+            continue;
+        }
+        out += "\"";
+        for (const char c : values[i]->asString())
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += "\"";
+    }
+    out += "}";
+    return out;
+}
+
+void addBatchError(CellBatchValidation &batch,
+                   Json::ArrayIndex index,
+                   const Json::Value &cell,
+                   const std::string &code,
+                   const std::string &message)
+{
+    Json::Value err(Json::objectValue);
+    err["index"] = index;
+    if (cell.isObject() && cell.isMember("rowId"))
+    {
+        err["rowId"] = cell["rowId"];
+    }
+    if (cell.isObject() && cell["dbName"].isString())
+    {
+        err["dbName"] = cell["dbName"];
+    }
+    err["code"] = code;
+    err["message"] = message;
+    batch.errors.append(std::move(err));
+}
+
 class ImageSlotsUpdatePlanner : public ITableCellUpdatePlanner
 {
 public:
@@ -203,23 +300,48 @@ public:
             co_return err;
         }
 
-        std::unordered_map<std::string, bool> allowedColumns;
+        std::unordered_map<std::string, std::string> allowedColumns;
         for (const auto &c : *colsPtr)
         {
             if (c.isObject() && c.isMember("name") && c["name"].isString())
             {
-                allowedColumns.emplace(c["name"].asString(), true);
+                allowedColumns.emplace(c["name"].asString(), c["type"].asString());
             }
         }
-        allowedColumns.emplace("id", true);
+        allowedColumns.emplace("id", "bigint");
 
-        if (allowedColumns.find(dbName) == allowedColumns.end())
+        const auto columnIt = allowedColumns.find(dbName);
+        if (columnIt == allowedColumns.end())
         {
             err.code = "bad_request";
             err.message = "Invalid payload: unknown column";
             err.details["dbName"] = dbName;
             co_return err;
         }
+        if (dbName == kRowVersionColumn)
+        {
+            err.code = "bad_request";
+            err.message = "Invalid payload: row_version is maintained by server";
+            err.details["dbName"] = dbName;
+            co_return err;
+        }
+        if (payload.isMember("expectedVersion"))
+        {
+            const auto expectedVersion = parseInt64(payload["expectedVersion"]);
+            if (!expectedVersion || *expectedVersion <= 0)
+            {
+                err.code = "bad_request";
+                err.message = "Invalid payload: expectedVersion must be positive integer";
+                co_return err;
+            }
+            if (allowedColumns.find(kRowVersionColumn) == allowedColumns.end())
+            {
+                err.code = "bad_request";
+                err.message = "Invalid payload: table has no row_version";
+                err.details["table"] = payloadTable;
+                co_return err;
+            }
+        }
 
         const Json::Value &fields = payload["fields"];
         const auto fieldKeys = fields.getMemberNames();
@@ -232,6 +354,14 @@ public:
                 err.details["dbName"] = dbName;
                 co_return err;
             }
+            const std::string valueError = checkColumnValue(columnIt->second, fields[dbName]);
+            if (!valueError.empty())
+            {
+                err.code = "bad_request";
+                err.message = "Invalid field value: " + valueError;
+                err.details["dbName"] = dbName;
+                co_return err;
+            }
         }
         else if (!isImageType(typeStr) && parsed.attachments.empty())
         {
@@ -300,67 +430,119 @@ public:
         const std::string payloadBase = resolveBaseTable(payloadTable);
         const std::string dbName = payload["dbName"].asString();
 
+        const bool isChild = (payloadBase != payloadTable);
+        int childTypeId = 0;
+        if (isChild && !tryGetTableIdByName(payloadTable, childTypeId))
+        {
+            Json::Value details;
+            details["table"] = payloadTable;
+            throw CellUpdateError("bad_request",
+                                  "Unknown child table",
+                                  drogon::k400BadRequest,
+                                  details);
+        }
+        if (!isSafeIdentifier(schema_) || !isSafeIdentifier(payloadBase) || !isSafeIdentifier(dbName))
+        {
+            Json::Value details;
+            details["table"] = payloadBase;
+            details["dbName"] = dbName;
+            throw CellUpdateError("bad_request",
+                                  "Unsafe schema/table/column name",
+                                  drogon::k400BadRequest,
+                                  details);
+        }
+        const RowTarget target{quoteIdent(schema_) + "." + quoteIdent(payloadBase), payloadBase, rowId, isChild, childTypeId};
+        const std::optional<int64_t> expectedVersion =
+            payload.isMember("expectedVersion") ? parseInt64(payload["expectedVersion"]) : std::nullopt;
+        plan.writtenRow = std::make_shared<WrittenRow>();
+
         const Json::Value &fields = payload["fields"];
-        if (fields.isObject() && fields.isMember(dbName))
+        const bool scalarUpdate = fields.isObject() && fields.isMember(dbName);
+        if (scalarUpdate)
         {
             const Json::Value fieldValue = fields[dbName];
-            const bool isChild = (payloadBase != payloadTable);
-            int childTypeId = 0;
-            if (isChild && !tryGetTableIdByName(payloadTable, childTypeId))
-            {
-                Json::Value details;
-                details["table"] = payloadTable;
-                throw CellUpdateError("bad_request",
-                                      "Unknown child table",
-                                      drogon::k400BadRequest,
-                                      details);
-            }
 
             DbOp op;
             op.debugName = "update_cell";
-            op.exec = [schema = schema_,
-                       table = payloadBase,
-                       dbName,
-                       rowId,
-                       fieldValue,
-                       isChild,
-                       childTypeId](const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
-                if (!isSafeIdentifier(schema) || !isSafeIdentifier(table) || !isSafeIdentifier(dbName))
+            op.exec = [target, dbName, fieldValue, expectedVersion, written = plan.writtenRow](
+                          const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
+                auto cache = drogon::app().getPlugin<TableInfoCache>();
+                if (!cache)
+                {
+                    throw std::runtime_error("TableInfoCache is not initialized");
+                }
+                const auto columnTypes = co_await cache->getColumnTypes(target.table);
+                const auto typeIt = columnTypes->find(dbName);
+                if (typeIt == columnTypes->end())
                 {
                     Json::Value details;
-                    details["table"] = table;
                     details["dbName"] = dbName;
                     throw CellUpdateError("bad_request",
-                                          "Unsafe schema/table/column name",
+                                          "Invalid payload: unknown column",
                                           drogon::k400BadRequest,
                                           details);
                 }
 
-                std::string sql = "UPDATE " + quoteIdent(schema) + "." + quoteIdent(table) +
-                                  " SET " + quoteIdent(dbName) + " = $1 WHERE id = $2";
-                if (isChild)
+                // Версия проверяется в самом UPDATE: конфликт не требует отдельной блокировки строки.
+                std::string sql = "UPDATE " + target.qualifiedTable + " SET " + quoteIdent(dbName) +
+                                  " = $1 WHERE " + rowCondition(target.isChild, 2);
+                if (expectedVersion)
                 {
-                    sql += " AND " + quoteIdent(kChildTypeIdColumn) + " = $3";
+                    sql += " AND " + quoteIdent(kRowVersionColumn) + " = $" + std::to_string(target.isChild ? 4 : 3);
                 }
+                sql += " RETURNING *";
 
                 auto binder = (*trans << sql);
-                bindJsonValue(binder, fieldValue);
-                binder << rowId;
-                if (isChild)
+                try
                 {
-                    binder << childTypeId;
+                    bindColumnValue(binder, typeIt->second, fieldValue);
                 }
-                const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
-                if (result.affectedRows() == 0)
+                catch (const std::invalid_argument &e)
                 {
                     Json::Value details;
-                    details["rowId"] = static_cast<Json::Int64>(rowId);
                     details["dbName"] = dbName;
-                    throw CellUpdateError("not_found",
-                                          "Row not found for update",
-                                          drogon::k404NotFound,
+                    throw CellUpdateError("bad_request",
+                                          std::string("Invalid field value: ") + e.what(),
+                                          drogon::k400BadRequest,
                                           details);
                 }
+                binder << target.rowId;
+                if (target.isChild)
+                {
+                    binder << target.childTypeId;
+                }
+                if (expectedVersion)
+                {
+                    binder << *expectedVersion;
+                }
+                const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+                if (result.empty())
+                {
+                    if (expectedVersion)
+                    {
+                        const auto current = co_await selectRowVersion(trans, target, false);
+                        throwRowMismatch(target.rowId, dbName, expectedVersion, current);
+                    }
+                    throwRowMismatch(target.rowId, dbName, std::nullopt, std::nullopt);
+                }
+                written->result = result;
+                co_return;
+            };
+            plan.preUploadDbOps.push_back(std::move(op));
+        }
+        else if (expectedVersion)
+        {
+            // Картинка пишется в *images, а ячейку каталога меняет триггер:
+            // версию проверяем заранее и держим строку заблокированной до коммита.
+            DbOp op;
+            op.debugName = "check_row_version";
+            op.exec = [target, dbName, expectedVersion](
+                          const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
+                const auto current = co_await selectRowVersion(trans, target, true);
+                if (!current || *current != *expectedVersion)
+                {
+                    throwRowMismatch(target.rowId, dbName, expectedVersion, current);
+                }
                 co_return;
             };
             plan.preUploadDbOps.push_back(std::move(op));
@@ -395,8 +577,220 @@ public:
                                 objectKeys,
                                 minioConfig.bucket,
                                 typeStr == "ImageWithLink" ? imageMeta[dbName] : Json::Value(Json::nullValue));
+
+            // Триггер *images уже поменял ячейку и версию строки — читаем их последним шагом.
+            DbOp readOp;
+            readOp.debugName = "read_updated_row";
+            readOp.exec = [target, written = plan.writtenRow](
+                              const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
+                auto binder = (*trans << "SELECT * FROM " + target.qualifiedTable + " WHERE " +
+                                             rowCondition(target.isChild, 1));
+                binder << target.rowId;
+                if (target.isChild)
+                {
+                    binder << target.childTypeId;
+                }
+                written->result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+                co_return;
+            };
+            plan.postUploadDbOps.push_back(std::move(readOp));
+        }
+
+        return plan;
+    }
+
+    drogon::Task<CellBatchValidation> validateBatch(const Json::Value &payload) const override
+    {
+        if (!payload.isObject() || !payload["table"].isString())
+        {
+            throw CellUpdateError("bad_request", "Invalid payload: missing table", drogon::k400BadRequest);
+        }
+        const Json::Value &cells = payload["cells"];
+        if (!cells.isArray() || cells.empty())
+        {
+            throw CellUpdateError("bad_request", "Invalid payload: cells must be non-empty array", drogon::k400BadRequest);
+        }
+        if (cells.size() > kMaxBatchCells)
+        {
+            throw CellUpdateError("bad_request",
+                                  "Too many cells: limit is " + std::to_string(kMaxBatchCells),
+                                  drogon::k413RequestEntityTooLarge);
+        }
+        const Json::Value &types = payload["types"];
+        if (!types.isObject())
+        {
+            throw CellUpdateError("bad_request", "Invalid payload: types must be object", drogon::k400BadRequest);
+        }
+
+        auto cache = drogon::app().getPlugin<TableInfoCache>();
+        if (!cache)
+        {
+            throw std::runtime_error("TableInfoCache is not initialized");
+        }
+        auto colsPtr = co_await cache->getColumns(payload["table"].asString());
+        if (!colsPtr || !colsPtr->isArray())
+        {
+            throw std::runtime_error("TableInfoCache returned invalid columns");
+        }
+        if (colsPtr->empty())
+        {
+            throw CellUpdateError("bad_request", "Invalid payload: unknown table or empty schema", drogon::k400BadRequest);
+        }
+        // dbName -> (data_type, udt_name)
+        std::unordered_map<std::string, std::pair<std::string, std::string>> columns;
+        for (const auto &c : *colsPtr)
+        {
+            if (c.isObject() && c["name"].isString())
+            {
+                columns.emplace(c["name"].asString(), std::make_pair(c["type"].asString(), c["udt_name"].asString()));
+            }
+        }
+
+        CellBatchValidation batch;
+        std::unordered_set<std::string> seen;
+        for (Json::ArrayIndex i = 0; i < cells.size(); ++i)
+        {
+            const Json::Value &cell = cells[i];
+            if (!cell.isObject())
+            {
+                addBatchError(batch, i, cell, "bad_request", "Cell must be object");
+                continue;
+            }
+            const auto rowIdOpt = parseRowId(cell);
+            if (!rowIdOpt || *rowIdOpt <= 0)
+            {
+                addBatchError(batch, i, cell, "bad_request", "Missing or invalid rowId");
+                continue;
+            }
+            if (!cell["dbName"].isString())
+            {
+                addBatchError(batch, i, cell, "bad_request", "Missing dbName");
+                continue;
+            }
+            const std::string dbName = cell["dbName"].asString();
+            auto colIt = columns.find(dbName);
+            if (dbName == "id" || !isSafeIdentifier(dbName) || colIt == columns.end())
+            {
+                addBatchError(batch, i, cell, "bad_request", "Unknown column");
+                continue;
+            }
+            if (dbName == kRowVersionColumn)
+            {
+                addBatchError(batch, i, cell, "bad_request", "Column is maintained by server");
+                continue;
+            }
+            if (!types[dbName].isString())
+            {
+                addBatchError(batch, i, cell, "bad_request", "Types missing dbName");
+                continue;
+            }
+            if (isImageType(types[dbName].asString()))
+            {
+                // Картинке нужны файлы и upsert слота — это одиночный /row/updateCell.
+                addBatchError(batch, i, cell, "bad_request", "Image cells are not supported in batch update");
+                continue;
+            }
+            if (!cell.isMember("value"))
+            {
+                addBatchError(batch, i, cell, "bad_request", "Missing value");
+                continue;
+            }
+            const std::string valueError = checkColumnValue(colIt->second.first, cell["value"]);
+            if (!valueError.empty())
+            {
+                addBatchError(batch, i, cell, "bad_request", valueError);
+                continue;
+            }
+            if (!isSafeIdentifier(colIt->second.second))
+            {
+                addBatchError(batch, i, cell, "bad_request", "Unsupported column type");
+                continue;
+            }
+            // В одном UPDATE ... FROM строка не может получить два значения колонки.
+            if (!seen.insert(std::to_string(*rowIdOpt) + "/" + dbName).second)
+            {
+                addBatchError(batch, i, cell, "bad_request", "Duplicate cell in batch");
+                continue;
+            }
+            batch.sqlTypes.emplace(dbName, colIt->second.second);
+            batch.cells.push_back(CellBatchItem{i, *rowIdOpt, dbName, cell["value"]});
+        }
+        co_return batch;
+    }
+
+    RowWritePlan buildBatchUpdatePlan(const std::string &table,
+                                      const CellBatchValidation &batch,
+                                      const std::shared_ptr<CellBatchUpdated> &updated) const override
+    {
+        const std::string payloadBase = resolveBaseTable(table);
+        const bool isChild = (payloadBase != table);
+        int childTypeId = 0;
+        if (isChild && !tryGetTableIdByName(table, childTypeId))
+        {
+            Json::Value details;
+            details["table"] = table;
+            throw CellUpdateError("bad_request", "Unknown child table", drogon::k400BadRequest, details);
+        }
+        if (!isSafeIdentifier(schema_) || !isSafeIdentifier(payloadBase))
+        {
+            throw CellUpdateError("bad_request", "Unsafe schema/table name", drogon::k400BadRequest);
         }
 
+        std::unordered_map<std::string, std::vector<const CellBatchItem *>> byColumn;
+        for (const auto &cell : batch.cells)
+        {
+            byColumn[cell.dbName].push_back(&cell);
+        }
+
+        RowWritePlan plan;
+        for (const auto &kv : byColumn)
+        {
+            const std::string &dbName = kv.first;
+            std::string ids = "{";
+            std::vector<const Json::Value *> values;
+            values.reserve(kv.second.size());
+            for (const CellBatchItem *cell : kv.second)
+            {
+                if (values.size() > 0)
+                {
+                    ids += ",";
+                }
+                ids += std::to_string(cell->rowId);
+                values.push_back(&cell->value);
+            }
+            ids += "}";
+
+            // Значения идут текстом и приводятся к типу колонки: одно выражение на всю колонку.
+            std::string sql = "UPDATE " + quoteIdent(schema_) + "." + quoteIdent(payloadBase) + " AS t SET " +
+                              quoteIdent(dbName) + " = v.value::" + quoteIdent(batch.sqlTypes.at(dbName)) +
+                              " FROM unnest($1::bigint[], $2::text[]) AS v(id, value) WHERE t.id = v.id";
+            if (isChild)
+            {
+                sql += " AND t." + quoteIdent(kChildTypeIdColumn) + " = $3";
+            }
+            sql += " RETURNING t.id";
+
+            DbOp op;
+            op.debugName = "update_cells_" + dbName;
+            op.exec = [sql, dbName, ids, valuesLiteral = pgNullableTextArray(values), isChild, childTypeId, updated](
+                          const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
+                auto binder = (*trans << sql);
+                binder << ids;
+                binder << valuesLiteral;
+                if (isChild)
+                {
+                    binder << childTypeId;
+                }
+                const auto rows = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+                auto &done = (*updated)[dbName];
+                for (const auto &row : rows)
+                {
+                    done.insert(row["id"].as<int64_t>());
+                }
+                co_return;
+            };
+            plan.preUploadDbOps.push_back(std::move(op));
+        }
         return plan;
     }
 
@@ -465,6 +859,51 @@ private:
             "updated_at = now() "
             "RETURNING id";
 
+        if (big || small)
+        {
+            // Заменяемые контентно-адресуемые объекты слота теряют одну ссылку.
+            // Строка блокируется до upsert, чтобы параллельная замена не освободила ключ дважды.
+            const std::string selectSql =
+                "SELECT big_bucket, big_object_key, small_bucket, small_object_key FROM " + imagesTable +
+                " WHERE " + fkCol + " = $1 AND slot = $2 FOR UPDATE";
+            DbOp releaseOp;
+            releaseOp.debugName = "release_replaced_blobs";
+            releaseOp.exec = [rowId, dbName, bucket, replaceBig = (big != nullptr), replaceSmall = (small != nullptr), selectSql](
+                                 const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
+                auto binder = (*trans << selectSql);
+                binder << rowId;
+                binder << dbName;
+                const auto rows = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+                std::vector<BlobStorePlugin::BlobRef> refs;
+                auto addRef = [&](const drogon::orm::Field &bucketField, const drogon::orm::Field &keyField) {
+                    if (keyField.isNull())
+                    {
+                        return;
+                    }
+                    const std::string objectKey = keyField.as<std::string>();
+                    if (!BlobStorePlugin::isBlobKey(objectKey))
+                    {
+                        return;
+                    }
+                    refs.push_back(BlobStorePlugin::BlobRef{
+                        bucketField.isNull() ? bucket : bucketField.as<std::string>(), objectKey, 1});
+                };
+                for (const auto &row : rows)
+                {
+                    if (replaceBig)
+                    {
+                        addRef(row["big_bucket"], row["big_object_key"]);
+                    }
+                    if (replaceSmall)
+                    {
+                        addRef(row["small_bucket"], row["small_object_key"]);
+                    }
+                }
+                co_await BlobStorePlugin::release(trans, refs);
+            };
+            plan.postUploadDbOps.push_back(std::move(releaseOp));
+        }
+
         DbOp op;
         op.debugName = "upsert_image_slot";
         op.exec = [rowId, dbName, bucket, big, small, objectKeys, imageMeta, sql](
@@ -1,16 +1,29 @@
 #include "Lan/CellUpdate/CellUpdateService.h"
 
 #include <drogon/drogon.h>
+#include <drogon/orm/Exception.h>
 #include <drogon/utils/Utilities.h>
 
+#include "Helpers/Sha256.h"
+#include "Lan/CellUpdate/WriteBehindPlugin.h"
+#include "Lan/Images/ThumbnailPlugin.h"
+#include "Lan/RowAdd/ObjectUploads.h"
+#include "Lan/TableDataService.h"
+#include "Lan/allTableList.h"
 #include "Storage/MinioPlugin.h"
+#include "Storage/StagedUploadPlugin.h"
+#include "Storage/StorageDeleteQueuePlugin.h"
+#include "Storage/StoragePlugin.h"
 #include "Loger/Logger.h"
+#include "TableInfoCache.h"
 
 #include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <optional>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_set>
 
 namespace
 {
@@ -66,8 +79,8 @@ std::optional<int64_t> parseRowId(const Json::Value &payload)
 }
 } // namespace
 
-CellUpdateService::CellUpdateService()
-    : registry_(createDefaultCellUpdatePlannerRegistry())
+CellUpdateService::CellUpdateService(std::shared_ptr<const CellUpdatePlannerRegistry> registry, bool responseDebug)
+    : registry_(std::move(registry)), responseDebug_(responseDebug)
 {
 }
 
@@ -104,18 +117,13 @@ std::string CellUpdateService::buildObjectKey(const std::string &table,
     return key;
 }
 
-drogon::Task<void> CellUpdateService::executePlan(
-    const std::shared_ptr<drogon::orm::Transaction> &trans,
-    MinioClient &minioClient,
-    const RowWritePlan &plan,
-    const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
-    std::vector<UploadedObject> &uploadedObjects)
+void CellUpdateService::collectUploadJobs(const RowWritePlan &plan,
+                                          const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
+                                          std::vector<IObjectStorage::PutJob> &jobs,
+                                          std::vector<std::string> &attachmentIds) const
 {
-    for (const auto &op : plan.preUploadDbOps)
-    {
-        co_await op.exec(trans);
-    }
-
+    jobs.reserve(plan.uploads.size());
+    attachmentIds.reserve(plan.uploads.size());
     for (const auto &upload : plan.uploads)
     {
         auto it = attachmentIndex.find(upload.attachmentId);
@@ -128,26 +136,104 @@ drogon::Task<void> CellUpdateService::executePlan(
             throw CellUpdateError("bad_request", "Attachment not found for upload op", drogon::k400BadRequest);
         }
         const AttachmentInput *att = it->second;
-        const bool ok = minioClient.putObject(upload.bucket,
+        jobs.push_back(IObjectStorage::PutJob{upload.bucket, upload.objectKey, upload.mimeType, att->data.data(), att->data.size()});
+        attachmentIds.push_back(upload.attachmentId);
+    }
+}
+
+drogon::Task<void> CellUpdateService::uploadObjects(IObjectStorage &storage,
+                                                  const std::vector<IObjectStorage::PutJob> &jobs,
+                                                  const std::vector<std::string> &attachmentIds,
+                                                  std::vector<UploadedObject> &uploadedObjects,
+                                                  Json::Value &debug)
+{
+    if (auto details = co_await uploadObjectsTimed(storage, jobs, attachmentIds, uploadedObjects, debug, "CellUpdateService"))
+    {
+        throw CellUpdateError("storage_error", "Failed to upload object to storage", drogon::k500InternalServerError, *details);
+    }
+}
+
+drogon::Task<void> CellUpdateService::prepareBlobs(
+    BlobStorePlugin &blobStore,
+    IObjectStorage &storage,
+    RowWritePlan &plan,
+    const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
+    const std::unordered_map<std::string, std::string> &shaById)
+{
+    std::vector<BlobStorePlugin::Blob> blobs;
+    std::vector<BlobStorePlugin::BlobRef> refs;
+    blobs.reserve(plan.uploads.size());
+    refs.reserve(plan.uploads.size());
+    for (const auto &upload : plan.uploads)
+    {
+        auto it = attachmentIndex.find(upload.attachmentId);
+        if (it == attachmentIndex.end())
+        {
+            throw CellUpdateError("bad_request", "Attachment not found for upload op", drogon::k400BadRequest);
+        }
+        const AttachmentInput *att = it->second;
+        blobs.push_back(BlobStorePlugin::Blob{upload.bucket,
                                               upload.objectKey,
-                                              att->data,
-                                              upload.mimeType);
-        if (!ok)
+                                              shaById.at(upload.attachmentId),
+                                              att->data.size(),
+                                              upload.mimeType});
+        refs.push_back(BlobStorePlugin::BlobRef{upload.bucket, upload.objectKey, 1});
+    }
+
+    const auto missing = co_await blobStore.reserve(blobs);
+
+    std::vector<IObjectStorage::PutJob> jobs;
+    std::vector<std::string> attachmentIds;
+    collectUploadJobs(plan, attachmentIndex, jobs, attachmentIds);
+    std::vector<IObjectStorage::PutJob> missingJobs;
+    std::vector<std::string> missingIds;
+    std::unordered_set<std::string> queued;
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const std::string uniq = jobs[i].bucket + "/" + jobs[i].objectKey;
+        if (missing.count(uniq) && queued.insert(uniq).second)
         {
-            Json::Value details(Json::objectValue);
-            details["bucket"] = upload.bucket;
-            details["objectKey"] = upload.objectKey;
-            details["mimeType"] = upload.mimeType;
-            details["sizeBytes"] = static_cast<Json::UInt64>(att->data.size());
-            std::ostringstream oss;
-            oss << "CellUpdateError: MinIO upload failed"
-                << " bucket=" << upload.bucket
-                << " key=" << upload.objectKey
-                << " size=" << att->data.size();
-            Logger::instance().error(oss.str());
-            throw CellUpdateError("storage_error", "Failed to upload object to storage", drogon::k500InternalServerError, details);
+            missingJobs.push_back(jobs[i]);
+            missingIds.push_back(attachmentIds[i]);
         }
-        uploadedObjects.push_back(UploadedObject{upload.bucket, upload.objectKey});
+    }
+
+    // Загруженные блобы при ошибке не удаляются: их ref_count = 0, объект заберёт сборка мусора.
+    std::vector<UploadedObject> uploaded;
+    co_await uploadObjects(storage, missingJobs, missingIds, uploaded, plan.debug);
+    plan.debug["dedup"] = true;
+    plan.debug["dedupHits"] = static_cast<Json::UInt64>(jobs.size() - missingJobs.size());
+
+    plan.postUploadDbOps.push_back(DbOp{
+        "retain_blobs",
+        [refs](const std::shared_ptr<drogon::orm::Transaction> &t) -> drogon::Task<void> {
+            co_await BlobStorePlugin::retain(t, refs);
+        }});
+    co_return;
+}
+
+drogon::Task<void> CellUpdateService::executePlan(
+    const std::shared_ptr<drogon::orm::Transaction> &trans,
+    IObjectStorage &storage,
+    RowWritePlan &plan,
+    const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
+    std::vector<UploadedObject> &uploadedObjects,
+    bool uploadsStaged)
+{
+    for (const auto &op : plan.preUploadDbOps)
+    {
+        co_await op.exec(trans);
+    }
+
+    // В staged-режиме и при дедупликации объекты плана уже загружены до транзакции.
+    if (!uploadsStaged)
+    {
+        // Загрузки выполняются параллельно: транзакция удерживается на время самой долгой
+        // загрузки, а не на сумму всех.
+        std::vector<IObjectStorage::PutJob> jobs;
+        std::vector<std::string> attachmentIds;
+        collectUploadJobs(plan, attachmentIndex, jobs, attachmentIds);
+        co_await uploadObjects(storage, jobs, attachmentIds, uploadedObjects, plan.debug);
     }
 
     for (const auto &op : plan.postUploadDbOps)
@@ -158,14 +244,14 @@ drogon::Task<void> CellUpdateService::executePlan(
     co_return;
 }
 
-drogon::Task<WriteResult> CellUpdateService::update(const CellUpdateController::ParsedRequest &parsed)
+std::shared_ptr<ITableCellUpdatePlanner> CellUpdateService::resolvePlanner(const Json::Value &payload) const
 {
-    if (!parsed.payload.isObject() || !parsed.payload.isMember("table") || !parsed.payload["table"].isString())
+    if (!payload.isObject() || !payload.isMember("table") || !payload["table"].isString())
     {
         Logger::instance().error("CellUpdateError: invalid payload, missing table");
         throw CellUpdateError("bad_request", "Invalid payload: missing table", drogon::k400BadRequest);
     }
-    const std::string table = parsed.payload["table"].asString();
+    const std::string table = payload["table"].asString();
     auto planner = registry_->getPlanner(table);
     if (!planner)
     {
@@ -176,8 +262,13 @@ drogon::Task<WriteResult> CellUpdateService::update(const CellUpdateController::
         Logger::instance().error(oss.str());
         throw CellUpdateError("bad_request", "Table is not supported", drogon::k400BadRequest, details);
     }
+    return planner;
+}
 
-    if (auto validationErr = co_await planner->validate(parsed))
+drogon::Task<void> CellUpdateService::validateRequest(const ITableCellUpdatePlanner &planner,
+                                                      const CellUpdateController::ParsedRequest &parsed) const
+{
+    if (auto validationErr = co_await planner.validate(parsed))
     {
         std::ostringstream oss;
         oss << "CellUpdateError: validation failed"
@@ -190,6 +281,180 @@ drogon::Task<WriteResult> CellUpdateService::update(const CellUpdateController::
                               validationErr->status,
                               validationErr->details);
     }
+    co_return;
+}
+
+drogon::Task<void> CellUpdateService::precheck(const CellUpdateController::ParsedRequest &parsed)
+{
+    auto planner = resolvePlanner(parsed.payload);
+    co_await validateRequest(*planner, parsed);
+}
+
+drogon::Task<void> CellUpdateService::executeBatch(const ITableCellUpdatePlanner &planner,
+                                                  const std::string &table,
+                                                  const CellBatchValidation &batch,
+                                                  const std::shared_ptr<CellBatchUpdated> &updated,
+                                                  bool atomic)
+{
+    RowWritePlan plan = planner.buildBatchUpdatePlan(table, batch, updated);
+    std::shared_ptr<drogon::orm::Transaction> trans;
+    std::exception_ptr eptr;
+    size_t missing = 0;
+    try
+    {
+        auto dbClient = drogon::app().getDbClient("default");
+        trans = co_await dbClient->newTransactionCoro();
+        for (const auto &op : plan.preUploadDbOps)
+        {
+            co_await op.exec(trans);
+        }
+        for (const auto &cell : batch.cells)
+        {
+            if (!(*updated)[cell.dbName].count(cell.rowId))
+            {
+                ++missing;
+            }
+        }
+        if (atomic && missing > 0)
+        {
+            Json::Value details(Json::objectValue);
+            details["notFound"] = static_cast<Json::UInt64>(missing);
+            throw CellUpdateError("not_found", "Batch rejected: rows not found", drogon::k404NotFound, details);
+        }
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        // Ошибка БД в пакете отменяет все ячейки; текст отдаётся клиенту как есть.
+        Json::Value details(Json::objectValue);
+        details["error"] = e.base().what();
+        eptr = std::make_exception_ptr(
+            CellUpdateError("db_error", "Batch rolled back: database rejected update", drogon::k422UnprocessableEntity, details));
+    }
+    catch (...)
+    {
+        eptr = std::current_exception();
+    }
+    if (eptr)
+    {
+        if (trans)
+        {
+            trans->rollback();
+        }
+        std::rethrow_exception(eptr);
+    }
+}
+
+drogon::Task<size_t> CellUpdateService::writeBehindBatch(const std::string &table, const std::vector<CellBatchItem> &cells)
+{
+    auto planner = registry_->getPlanner(table);
+    if (!planner)
+    {
+        throw CellUpdateError("bad_request", "Table is not supported", drogon::k400BadRequest);
+    }
+    auto cache = drogon::app().getPlugin<TableInfoCache>();
+    if (!cache)
+    {
+        throw CellUpdateError("internal", "TableInfoCache is not initialized", drogon::k500InternalServerError);
+    }
+    const auto columnTypes = co_await cache->getColumnTypes(resolveBaseTable(table));
+
+    CellBatchValidation batch;
+    batch.cells = cells;
+    for (const auto &cell : cells)
+    {
+        const auto typeIt = columnTypes->find(cell.dbName);
+        if (typeIt == columnTypes->end())
+        {
+            Json::Value details;
+            details["dbName"] = cell.dbName;
+            throw CellUpdateError("bad_request", "Invalid payload: unknown column", drogon::k400BadRequest, details);
+        }
+        batch.sqlTypes.emplace(cell.dbName, typeIt->second.udtName);
+    }
+
+    auto updated = std::make_shared<CellBatchUpdated>();
+    co_await executeBatch(*planner, table, batch, updated, false);
+    size_t count = 0;
+    for (const auto &cell : cells)
+    {
+        count += (*updated)[cell.dbName].count(cell.rowId);
+    }
+    co_return count;
+}
+
+drogon::Task<Json::Value> CellUpdateService::updateBatch(const Json::Value &payload)
+{
+    auto planner = resolvePlanner(payload);
+    const std::string table = payload["table"].asString();
+    const bool atomic = payload["atomic"].isBool() && payload["atomic"].asBool();
+
+    const CellBatchValidation batch = co_await planner->validateBatch(payload);
+    if (atomic && !batch.errors.empty())
+    {
+        Json::Value details(Json::objectValue);
+        details["errors"] = batch.errors;
+        throw CellUpdateError("validation_failed", "Batch rejected: invalid cells", drogon::k422UnprocessableEntity, details);
+    }
+
+    // Ячейки write-behind колонок пишутся синхронно: их отложенные значения снимаются,
+    // чтобы flusher не перезаписал результат пакета старым значением.
+    auto writeBehind = drogon::app().getPlugin<WriteBehindPlugin>();
+    if (writeBehind && writeBehind->enabled())
+    {
+        for (const auto &cell : batch.cells)
+        {
+            if (writeBehind->isWriteBehindColumn(table, cell.dbName))
+            {
+                co_await writeBehind->discard(table, cell.rowId, cell.dbName);
+            }
+        }
+    }
+
+    auto updated = std::make_shared<CellBatchUpdated>();
+    if (!batch.cells.empty())
+    {
+        co_await executeBatch(*planner, table, batch, updated, atomic);
+    }
+
+    // Результаты в порядке payload.cells.
+    std::vector<Json::Value> byIndex(payload["cells"].size());
+    for (const auto &err : batch.errors)
+    {
+        Json::Value item = err;
+        item["status"] = "invalid";
+        byIndex[err["index"].asUInt()] = std::move(item);
+    }
+    size_t updatedCount = 0;
+    for (const auto &cell : batch.cells)
+    {
+        Json::Value item(Json::objectValue);
+        item["index"] = static_cast<Json::UInt>(cell.index);
+        item["rowId"] = static_cast<Json::Int64>(cell.rowId);
+        item["dbName"] = cell.dbName;
+        const bool done = (*updated)[cell.dbName].count(cell.rowId) > 0;
+        item["status"] = done ? "updated" : "not_found";
+        updatedCount += done ? 1 : 0;
+        byIndex[cell.index] = std::move(item);
+    }
+
+    Json::Value data(Json::objectValue);
+    data["table"] = table;
+    data["updated"] = static_cast<Json::UInt64>(updatedCount);
+    data["notFound"] = static_cast<Json::UInt64>(batch.cells.size() - updatedCount);
+    data["invalid"] = static_cast<Json::UInt64>(batch.errors.size());
+    data["results"] = Json::Value(Json::arrayValue);
+    for (auto &item : byIndex)
+    {
+        data["results"].append(std::move(item));
+    }
+    co_return data;
+}
+
+drogon::Task<WriteResult> CellUpdateService::update(const CellUpdateController::ParsedRequest &parsed)
+{
+    auto planner = resolvePlanner(parsed.payload);
+    const std::string table = parsed.payload["table"].asString();
+    co_await validateRequest(*planner, parsed);
 
     const auto rowIdOpt = parseRowId(parsed.payload);
     if (!rowIdOpt || *rowIdOpt <= 0)
@@ -198,31 +463,142 @@ drogon::Task<WriteResult> CellUpdateService::update(const CellUpdateController::
     }
     const int64_t rowId = *rowIdOpt;
 
-    auto dbClient = drogon::app().getDbClient("default");
-    auto trans = co_await dbClient->newTransactionCoro();
+    // Write-behind: скалярная ячейка колонки из WriteBehindPlugin подтверждается после постановки
+    // в буфер, в БД её запишет flusher плагина. Проверка expectedVersion требует синхронной записи
+    // (как и заполненный буфер): отложенное значение этой ячейки снимается, а запись встаёт за идущим
+    // проходом flusher-а, чтобы он не перезаписал результат.
+    auto writeBehind = drogon::app().getPlugin<WriteBehindPlugin>();
+    const std::string dbName = parsed.payload["dbName"].asString();
+    if (writeBehind && writeBehind->isWriteBehindColumn(table, dbName))
+    {
+        const Json::Value &fields = parsed.payload["fields"];
+        if (parsed.attachments.empty() && !parsed.payload.isMember("expectedVersion") && fields.isMember(dbName) &&
+            writeBehind->enqueue(table, rowId, dbName, fields[dbName]))
+        {
+            WriteResult queued;
+            queued.rowId = rowId;
+            queued.extra["writeBehind"] = true;
+            co_return queued;
+        }
+        co_await writeBehind->discard(table, rowId, dbName);
+    }
+
+    // Серверные варианты изображений (image_small, WebP) строятся до открытия транзакции,
+    // чтобы кодирование не удерживало соединение с БД.
+    CellUpdateController::ParsedRequest withVariants;
+    const CellUpdateController::ParsedRequest *effective = &parsed;
+    if (auto thumbnails = drogon::app().getPlugin<ThumbnailPlugin>())
+    {
+        if (auto variants = co_await thumbnails->buildVariants(table, parsed.attachments))
+        {
+            withVariants.payload = parsed.payload;
+            withVariants.attachments = std::move(*variants);
+            effective = &withVariants;
+        }
+    }
+    const CellUpdateController::ParsedRequest &input = *effective;
+
     auto minioPlugin = drogon::app().getPlugin<MinioPlugin>();
     if (!minioPlugin)
     {
         Logger::instance().error("CellUpdateError: MinioPlugin is not initialized");
         throw CellUpdateError("internal", "MinioPlugin is not initialized", drogon::k500InternalServerError);
     }
-    MinioClient &minioClient = minioPlugin->client();
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!storagePlugin)
+    {
+        Logger::instance().error("CellUpdateError: StoragePlugin is not initialized");
+        throw CellUpdateError("internal", "StoragePlugin is not initialized", drogon::k500InternalServerError);
+    }
+    IObjectStorage &storage = storagePlugin->storage();
+
+    // Дедупликация по содержимому: ключ объекта — хэш байтов.
+    auto blobStore = drogon::app().getPlugin<BlobStorePlugin>();
+    const bool dedupEnabled = blobStore && blobStore->enabled();
 
     std::unordered_map<std::string, std::string> objectKeys;
-    objectKeys.reserve(parsed.attachments.size());
-    for (const auto &att : parsed.attachments)
+    std::unordered_map<std::string, std::string> shaById;
+    objectKeys.reserve(input.attachments.size());
+    for (const auto &att : input.attachments)
     {
-        objectKeys.emplace(att.id, buildObjectKey(table, rowId, att));
+        if (dedupEnabled)
+        {
+            const std::string sha = att.sha256.empty() ? Sha256::hex(att.data.data(), att.data.size()) : att.sha256;
+            shaById.emplace(att.id, sha);
+            objectKeys.emplace(att.id, BlobStorePlugin::objectKeyFor(sha));
+        }
+        else
+        {
+            objectKeys.emplace(att.id, buildObjectKey(table, rowId, att));
+        }
     }
 
-    const RowWritePlan plan = planner->buildUpdatePlan(rowId, parsed, objectKeys, minioPlugin->minioConfig());
-    const auto attachmentIndex = buildAttachmentIndex(parsed.attachments);
+    RowWritePlan plan = planner->buildUpdatePlan(rowId, input, objectKeys, minioPlugin->minioConfig());
+    const auto attachmentIndex = buildAttachmentIndex(input.attachments);
+    const bool dedup = dedupEnabled && !plan.uploads.empty();
+
+    // Staged write: план строится без транзакции, поэтому его объекты можно загрузить заранее,
+    // а транзакция будет содержать только SQL.
+    auto staging = drogon::app().getPlugin<StagedUploadPlugin>();
+    const bool staged = !dedup && staging && staging->enabled() && !plan.uploads.empty();
 
     std::vector<UploadedObject> uploadedObjects;
+    std::string stagedBatchId;
+    if (dedup)
+    {
+        co_await prepareBlobs(*blobStore, storage, plan, attachmentIndex, shaById);
+    }
+    else if (staged)
+    {
+        std::vector<IObjectStorage::PutJob> jobs;
+        std::vector<std::string> attachmentIds;
+        collectUploadJobs(plan, attachmentIndex, jobs, attachmentIds);
+        std::vector<StagedUploadPlugin::StagedObject> ledger;
+        ledger.reserve(jobs.size());
+        for (const auto &job : jobs)
+        {
+            ledger.push_back(StagedUploadPlugin::StagedObject{job.bucket, job.objectKey});
+        }
+
+        // Журнал пишется до загрузки: если процесс упадёт между загрузкой и коммитом,
+        // объект найдёт reaper.
+        stagedBatchId = co_await staging->registerBatch(ledger);
+        std::exception_ptr uploadErr;
+        try
+        {
+            co_await uploadObjects(storage, jobs, attachmentIds, uploadedObjects, plan.debug);
+        }
+        catch (...)
+        {
+            uploadErr = std::current_exception();
+        }
+        if (uploadErr)
+        {
+            const bool allDeleted = co_await discardUploaded(storage, uploadedObjects);
+            if (allDeleted)
+            {
+                co_await staging->discardBatch(stagedBatchId);
+            }
+            std::rethrow_exception(uploadErr);
+        }
+
+        plan.debug["staged"] = true;
+        // Коммит ключей — последним шагом транзакции.
+        const size_t stagedCount = uploadedObjects.size();
+        plan.postUploadDbOps.push_back(DbOp{
+            "commit_staged_objects",
+            [staging, stagedBatchId, stagedCount](const std::shared_ptr<drogon::orm::Transaction> &t) -> drogon::Task<void> {
+                co_await staging->commitBatch(t, stagedBatchId, stagedCount);
+            }});
+    }
+
+    std::shared_ptr<drogon::orm::Transaction> trans;
     std::exception_ptr eptr;
     try
     {
-        co_await executePlan(trans, minioClient, plan, attachmentIndex, uploadedObjects);
+        auto dbClient = drogon::app().getDbClient("default");
+        trans = co_await dbClient->newTransactionCoro();
+        co_await executePlan(trans, storage, plan, attachmentIndex, uploadedObjects, staged || dedup);
     }
     catch (...)
     {
@@ -235,12 +611,15 @@ drogon::Task<WriteResult> CellUpdateService::update(const CellUpdateController::
         {
             trans->rollback();
         }
-        for (const auto &obj : uploadedObjects)
+        const bool allDeleted = co_await discardUploaded(storage, uploadedObjects);
+        if (staged && allDeleted)
         {
-            (void)minioClient.deleteObject(obj.bucket, obj.objectKey);
+            co_await staging->discardBatch(stagedBatchId);
         }
         std::rethrow_exception(eptr);
     }
+    // Последняя ссылка на транзакцию: коммит уходит сейчас, а не после кодирования ответа.
+    trans.reset();
 
     WriteResult result;
     result.rowId = rowId;
@@ -258,6 +637,57 @@ drogon::Task<WriteResult> CellUpdateService::update(const CellUpdateController::
     {
         extra["plan"] = plan.successExtra;
     }
+    if (auto row = co_await TableDataService::encodeWrittenRow(table, plan.writtenRow, "CellUpdateService"))
+    {
+        extra["row"] = std::move(*row);
+    }
+    if (responseDebug_ && !plan.debug.isNull())
+    {
+        extra["debug"] = plan.debug;
+    }
     result.extra = extra;
     co_return result;
 }
+
+drogon::Task<bool> CellUpdateService::discardUploaded(IObjectStorage &storage,
+                                                      const std::vector<UploadedObject> &uploadedObjects)
+{
+    if (uploadedObjects.empty())
+    {
+        co_return true;
+    }
+
+    auto deleteQueue = drogon::app().getPlugin<StorageDeleteQueuePlugin>();
+    if (deleteQueue && deleteQueue->enabled())
+    {
+        std::vector<StorageDeleteQueuePlugin::Object> objects;
+        objects.reserve(uploadedObjects.size());
+        for (const auto &obj : uploadedObjects)
+        {
+            objects.push_back(StorageDeleteQueuePlugin::Object{obj.bucket, obj.objectKey});
+        }
+        bool queued = false;
+        try
+        {
+            co_await deleteQueue->enqueue(objects);
+            queued = true;
+        }
+        catch (const std::exception &e)
+        {
+            Logger::instance().warning("CellUpdateService: failed to enqueue storage cleanup, deleting inline: " +
+                                       std::string(e.what()));
+        }
+        if (queued)
+        {
+            co_return true;
+        }
+    }
+
+    bool allDeleted = true;
+    for (const auto &obj : uploadedObjects)
+    {
+        const IObjectStorage::Status removed = co_await storage.remove(obj.bucket, obj.objectKey);
+        allDeleted = removed.ok && allDeleted;
+    }
+    co_return allDeleted;
+}
@@ -0,0 +1,366 @@
+#include "Lan/CellUpdate/WriteBehindPlugin.h"
+
+#include <drogon/drogon.h>
+#include <drogon/orm/Exception.h>
+
+#include "Lan/CellUpdate/CellUpdateService.h"
+#include "Lan/LanServicesPlugin.h"
+#include "Lan/allTableList.h"
+#include "Loger/Logger.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+/// Конец прохода: ключи прохода освобождаются для синхронной записи (discard), затем снимается флаг.
+struct RunningGuard
+{
+    std::atomic<bool> &flag;
+    std::mutex &mutex;
+    std::unordered_set<std::string> &flushing;
+    ~RunningGuard()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            flushing.clear();
+        }
+        flag.store(false);
+    }
+};
+} // namespace
+
+void WriteBehindPlugin::initAndStart(const Json::Value &config)
+{
+    if (config.isMember("enabled") && config["enabled"].isBool())
+    {
+        enabled_ = config["enabled"].asBool();
+    }
+    if (config.isMember("max_pending") && config["max_pending"].isInt())
+    {
+        maxPending_ = static_cast<size_t>(clampPositiveInt(config["max_pending"].asInt(), static_cast<int>(maxPending_)));
+    }
+    if (config.isMember("max_attempts") && config["max_attempts"].isInt())
+    {
+        maxAttempts_ = clampPositiveInt(config["max_attempts"].asInt(), maxAttempts_);
+    }
+    if (config.isMember("columns") && config["columns"].isObject())
+    {
+        const Json::Value &columns = config["columns"];
+        for (const auto &table : columns.getMemberNames())
+        {
+            if (!columns[table].isArray())
+            {
+                continue;
+            }
+            auto &set = columns_[resolveBaseTable(table)];
+            for (const auto &name : columns[table])
+            {
+                if (name.isString())
+                {
+                    set.insert(name.asString());
+                }
+            }
+        }
+    }
+
+    int flushIntervalMs = 1000;
+    if (config.isMember("flush_interval_ms") && config["flush_interval_ms"].isInt())
+    {
+        flushIntervalMs = clampPositiveInt(config["flush_interval_ms"].asInt(), flushIntervalMs);
+    }
+    if (!enabled_ || columns_.empty())
+    {
+        enabled_ = false;
+        return;
+    }
+
+    timerId_ = drogon::app().getLoop()->runEvery(
+        static_cast<double>(flushIntervalMs) / 1000.0,
+        drogon::async_func([this]() -> drogon::Task<void> {
+            try
+            {
+                (void)co_await flushOnce();
+            }
+            catch (const std::exception &e)
+            {
+                Logger::instance().error("WriteBehindPlugin: flush failed: " + std::string(e.what()));
+            }
+            co_return;
+        }));
+}
+
+void WriteBehindPlugin::shutdown()
+{
+    if (timerId_ != trantor::InvalidTimerId)
+    {
+        drogon::app().getLoop()->invalidateTimer(timerId_);
+        timerId_ = trantor::InvalidTimerId;
+    }
+    if (!enabled_)
+    {
+        return;
+    }
+
+    // Подтверждённые значения дописываются до остановки (без повторов).
+    // Проход таймера, начатый до остановки, сначала завершается.
+    for (int i = 0; i < 100 && running_.load(); ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    maxAttempts_ = 1;
+    try
+    {
+        const size_t written = drogon::sync_wait(flushOnce());
+        Logger::instance().info("WriteBehindPlugin: flushed on shutdown cells=" + std::to_string(written));
+    }
+    catch (const std::exception &e)
+    {
+        Logger::instance().error("WriteBehindPlugin: flush on shutdown failed: " + std::string(e.what()));
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pending_.empty())
+    {
+        Logger::instance().error("WriteBehindPlugin: cells lost on shutdown=" + std::to_string(pending_.size()));
+    }
+}
+
+std::string WriteBehindPlugin::cellKey(const std::string &table, int64_t rowId, const std::string &dbName)
+{
+    return table + "/" + std::to_string(rowId) + "/" + dbName;
+}
+
+bool WriteBehindPlugin::isWriteBehindColumn(const std::string &table, const std::string &dbName) const
+{
+    if (!enabled_)
+    {
+        return false;
+    }
+    auto it = columns_.find(resolveBaseTable(table));
+    return it != columns_.end() && it->second.count(dbName) > 0;
+}
+
+bool WriteBehindPlugin::enqueue(const std::string &table,
+                                int64_t rowId,
+                                const std::string &dbName,
+                                const Json::Value &value)
+{
+    const std::string key = cellKey(table, rowId, dbName);
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = pending_.find(key);
+    if (it != pending_.end())
+    {
+        it->second.value = value;
+        it->second.attempts = 0;
+        ++coalescedTotal_;
+        ++enqueuedTotal_;
+        return true;
+    }
+    if (pending_.size() >= maxPending_)
+    {
+        ++overflowTotal_;
+        return false;
+    }
+    pending_.emplace(key, PendingCell{table, rowId, dbName, value, 0});
+    ++enqueuedTotal_;
+    return true;
+}
+
+drogon::Task<void> WriteBehindPlugin::discard(const std::string &table, int64_t rowId, const std::string &dbName)
+{
+    if (!enabled_)
+    {
+        co_return;
+    }
+    const std::string key = cellKey(table, rowId, dbName);
+    trantor::EventLoop *loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    if (!loop)
+    {
+        loop = drogon::app().getLoop();
+    }
+    // Значение, уже взятое идущим проходом, снять нельзя: синхронная запись ждёт конца прохода,
+    // иначе пакет flusher-а мог бы записаться после неё. Неудачный пакет возвращает ячейку в буфер
+    // до конца прохода, поэтому буфер чистится на каждой итерации.
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            pending_.erase(key);
+            if (flushing_.count(key) == 0)
+            {
+                break;
+            }
+        }
+        co_await drogon::sleepCoro(loop, 0.01);
+    }
+    co_return;
+}
+
+drogon::Task<size_t> WriteBehindPlugin::flushOnce()
+{
+    // Проходы не перекрываются: значения одного ключа пишутся в порядке постановки.
+    if (running_.exchange(true))
+    {
+        co_return 0;
+    }
+    RunningGuard guard{running_, mutex_, flushing_};
+
+    std::unordered_map<std::string, PendingCell> taken;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        taken.swap(pending_);
+        for (const auto &kv : taken)
+        {
+            flushing_.insert(kv.first);
+        }
+    }
+    if (taken.empty())
+    {
+        co_return 0;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    std::unordered_map<std::string, std::vector<PendingCell *>> byTable;
+    for (auto &kv : taken)
+    {
+        byTable[kv.second.table].push_back(&kv.second);
+    }
+
+    size_t written = 0;
+    for (auto &kv : byTable)
+    {
+        const std::string &table = kv.first;
+        std::vector<CellBatchItem> items;
+        items.reserve(kv.second.size());
+        for (const PendingCell *cell : kv.second)
+        {
+            items.push_back(CellBatchItem{items.size(), cell->rowId, cell->dbName, cell->value});
+        }
+
+        std::string error;
+        try
+        {
+            const size_t updated = co_await LanServicesPlugin::cellUpdater()->writeBehindBatch(table, items);
+            written += updated;
+            flushedTotal_ += updated;
+            notFoundTotal_ += items.size() - updated;
+            continue;
+        }
+        catch (const drogon::orm::DrogonDbException &e)
+        {
+            error = e.base().what();
+        }
+        catch (const std::exception &e)
+        {
+            error = e.what();
+        }
+
+        // Пакет откатан целиком: ячейки пишутся по одной, чтобы ошибка одной ячейки
+        // (значение не приводится к типу, ограничение таблицы) не отбрасывала соседние.
+        std::vector<PendingCell *> failed;
+        if (kv.second.size() == 1)
+        {
+            failed = kv.second;
+        }
+        else
+        {
+            for (PendingCell *cell : kv.second)
+            {
+                std::vector<CellBatchItem> single;
+                single.push_back(CellBatchItem{0, cell->rowId, cell->dbName, cell->value});
+                try
+                {
+                    const size_t updated = co_await LanServicesPlugin::cellUpdater()->writeBehindBatch(table, single);
+                    written += updated;
+                    flushedTotal_ += updated;
+                    notFoundTotal_ += 1 - updated;
+                    continue;
+                }
+                catch (const drogon::orm::DrogonDbException &e)
+                {
+                    error = e.base().what();
+                }
+                catch (const std::exception &e)
+                {
+                    error = e.what();
+                }
+                failed.push_back(cell);
+            }
+        }
+
+        // Неудачные ячейки возвращаются в буфер, если их не перезаписали новым значением.
+        size_t dropped = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (PendingCell *cell : failed)
+            {
+                if (++cell->attempts >= maxAttempts_)
+                {
+                    ++dropped;
+                    continue;
+                }
+                if (pending_.emplace(cellKey(cell->table, cell->rowId, cell->dbName), std::move(*cell)).second)
+                {
+                    ++retriedTotal_;
+                }
+            }
+        }
+        droppedTotal_ += dropped;
+        if (!failed.empty())
+        {
+            Logger::instance().error("WriteBehindPlugin: batch failed table=" + table + " cells=" +
+                                     std::to_string(items.size()) + " failed=" + std::to_string(failed.size()) +
+                                     " dropped=" + std::to_string(dropped) + " error=" + error);
+        }
+    }
+
+    const auto elapsedMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    ++batchesTotal_;
+    lastFlushMs_ = static_cast<int64_t>(elapsedMs);
+    co_return written;
+}
+
+Json::Value WriteBehindPlugin::stats() const
+{
+    Json::Value out(Json::objectValue);
+    out["enabled"] = enabled_;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        out["pending"] = static_cast<Json::UInt64>(pending_.size());
+    }
+    out["maxPending"] = static_cast<Json::UInt64>(maxPending_);
+    out["enqueuedTotal"] = static_cast<Json::UInt64>(enqueuedTotal_.load());
+    out["coalescedTotal"] = static_cast<Json::UInt64>(coalescedTotal_.load());
+    out["overflowTotal"] = static_cast<Json::UInt64>(overflowTotal_.load());
+    out["flushedTotal"] = static_cast<Json::UInt64>(flushedTotal_.load());
+    out["notFoundTotal"] = static_cast<Json::UInt64>(notFoundTotal_.load());
+    out["retriedTotal"] = static_cast<Json::UInt64>(retriedTotal_.load());
+    out["droppedTotal"] = static_cast<Json::UInt64>(droppedTotal_.load());
+    out["batchesTotal"] = static_cast<Json::UInt64>(batchesTotal_.load());
+    out["lastFlushMs"] = static_cast<Json::Int64>(lastFlushMs_.load());
+    Json::Value columns(Json::objectValue);
+    for (const auto &kv : columns_)
+    {
+        Json::Value names(Json::arrayValue);
+        for (const auto &name : kv.second)
+        {
+            names.append(name);
+        }
+        columns[kv.first] = std::move(names);
+    }
+    out["columns"] = std::move(columns);
+    return out;
+}
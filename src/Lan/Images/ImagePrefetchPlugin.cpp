@@ -0,0 +1,244 @@
+#include "Lan/Images/ImagePrefetchPlugin.h"
+
+#include <drogon/drogon.h>
+
+#include "Lan/allTableList.h"
+#include "Storage/MinioPlugin.h"
+#include "Storage/StoragePlugin.h"
+#include "Loger/Logger.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+bool isSafeIdentifier(const std::string &s)
+{
+    if (s.empty())
+        return false;
+    const unsigned char c0 = static_cast<unsigned char>(s[0]);
+    if (!(std::isalpha(c0) || s[0] == '_'))
+        return false;
+    for (size_t i = 1; i < s.size(); ++i)
+    {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        if (!(std::isalnum(c) || s[i] == '_'))
+            return false;
+    }
+    return true;
+}
+
+std::string quoteIdent(const std::string &s)
+{
+    return "\"" + s + "\"";
+}
+} // namespace
+
+void ImagePrefetchPlugin::initAndStart(const Json::Value &config)
+{
+    if (config.isMember("enabled") && config["enabled"].isBool())
+    {
+        enabled_ = config["enabled"].asBool();
+    }
+    if (!enabled_)
+    {
+        return;
+    }
+    if (config.isMember("max_concurrency") && config["max_concurrency"].isInt())
+    {
+        maxConcurrency_ = clampPositiveInt(config["max_concurrency"].asInt(), maxConcurrency_);
+    }
+    if (config.isMember("max_object_kb") && config["max_object_kb"].isInt())
+    {
+        maxObjectBytes_ = static_cast<size_t>(clampPositiveInt(config["max_object_kb"].asInt(), 512)) * 1024;
+    }
+    int cacheMb = 64;
+    if (config.isMember("cache_mb") && config["cache_mb"].isInt())
+    {
+        cacheMb = clampPositiveInt(config["cache_mb"].asInt(), cacheMb);
+    }
+    cache_ = std::make_shared<ThumbnailCache>(static_cast<size_t>(cacheMb) * 1024 * 1024);
+}
+
+void ImagePrefetchPlugin::shutdown()
+{
+    // Новые страницы больше не ставятся, начатые прогревы останавливаются на следующем объекте.
+    enabled_ = false;
+    for (int i = 0; i < 100 && inflight_.load() > 0; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (inflight_.load() > 0)
+    {
+        Logger::instance().warning("ImagePrefetchPlugin: warm still running on shutdown=" +
+                                   std::to_string(inflight_.load()));
+    }
+    cache_.reset();
+}
+
+void ImagePrefetchPlugin::schedulePage(const std::string &baseTable,
+                                       std::vector<std::string> imageColumns,
+                                       std::vector<int64_t> rowIds)
+{
+    if (!enabled_ || imageColumns.empty() || rowIds.empty())
+    {
+        return;
+    }
+    if (inflight_.fetch_add(1) >= maxConcurrency_)
+    {
+        inflight_.fetch_sub(1);
+        return;
+    }
+
+    // Старт откладывается в очередь текущего цикла: ответ со страницей уходит раньше прогрева.
+    trantor::EventLoop *loop = trantor::EventLoop::getEventLoopOfCurrentThread();
+    if (!loop)
+    {
+        loop = drogon::app().getLoop();
+    }
+    loop->queueInLoop([this,
+                       baseTable,
+                       imageColumns = std::move(imageColumns),
+                       rowIds = std::move(rowIds)]() mutable {
+        drogon::async_run([this,
+                           baseTable = std::move(baseTable),
+                           imageColumns = std::move(imageColumns),
+                           rowIds = std::move(rowIds)]() mutable -> drogon::Task<void> {
+            try
+            {
+                co_await warmPage(std::move(baseTable), std::move(imageColumns), std::move(rowIds));
+            }
+            catch (const std::exception &e)
+            {
+                Logger::instance().warning("ImagePrefetchPlugin: warm failed: " + std::string(e.what()));
+            }
+            inflight_.fetch_sub(1);
+            co_return;
+        });
+    });
+}
+
+drogon::Task<void> ImagePrefetchPlugin::warmPage(std::string baseTable,
+                                                 std::vector<std::string> imageColumns,
+                                                 std::vector<int64_t> rowIds)
+{
+    auto itImages = kTableMinioBySlot.find(baseTable);
+    if (itImages == kTableMinioBySlot.end() || !isSafeIdentifier(baseTable) || !isSafeIdentifier(itImages->second))
+    {
+        co_return;
+    }
+    std::string slotRefs;
+    for (const auto &column : imageColumns)
+    {
+        if (column.rfind("image_", 0) != 0 || !isSafeIdentifier(column))
+        {
+            continue;
+        }
+        slotRefs += (slotRefs.empty() ? "c." : ", c.") + quoteIdent(column);
+    }
+    if (slotRefs.empty())
+    {
+        co_return;
+    }
+    std::string ids;
+    for (const int64_t id : rowIds)
+    {
+        ids += (ids.empty() ? "" : ",") + std::to_string(id);
+    }
+
+    auto minioPlugin = drogon::app().getPlugin<MinioPlugin>();
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    const std::shared_ptr<ThumbnailCache> cache = cache_;
+    if (!minioPlugin || !storagePlugin || !cache)
+    {
+        co_return;
+    }
+
+    // Все превью страницы одним запросом: картинки, на которые ссылаются image_*-колонки строк.
+    const std::string sql =
+        "SELECT DISTINCT i.small_object_key, i.small_mime_type"
+        " FROM " + quoteIdent("public") + "." + quoteIdent(itImages->second) + " i"
+        " JOIN " + quoteIdent("public") + "." + quoteIdent(baseTable) + " c ON i.id IN (" + slotRefs + ")"
+        " WHERE c.id = ANY($1::bigint[]) AND i.small_object_key IS NOT NULL";
+    auto dbClient = drogon::app().getDbClient("default");
+    const auto rows = co_await dbClient->execSqlCoro(sql, "{" + ids + "}");
+
+    const std::string bucket = minioPlugin->minioConfig().bucket;
+    IObjectStorage &storage = storagePlugin->storage();
+    int warmed = 0;
+    for (const auto &row : rows)
+    {
+        if (!enabled_)
+        {
+            break;
+        }
+        const std::string objectKey = row["small_object_key"].as<std::string>();
+        if (objectKey.empty() || cache->contains(objectKey))
+        {
+            continue;
+        }
+        // Объекты страницы читаются по одному: прогрев одной страницы занимает не больше одного потока storage.
+        std::vector<uint8_t> bytes;
+        std::string mimeType;
+        const IObjectStorage::Status fetched = co_await storage.get(bucket, objectKey, bytes, &mimeType);
+        if (!fetched || bytes.size() > maxObjectBytes_)
+        {
+            continue;
+        }
+        auto entry = std::make_shared<ThumbnailCache::Entry>();
+        entry->bytes = std::move(bytes);
+        entry->mimeType = row["small_mime_type"].isNull() ? mimeType : row["small_mime_type"].as<std::string>();
+        cache->put(objectKey, std::move(entry));
+        ++warmed;
+    }
+
+    if (warmed > 0)
+    {
+        std::ostringstream oss;
+        oss << "ImagePrefetchPlugin: warmed table=" << baseTable
+            << " rows=" << rowIds.size()
+            << " thumbnails=" << warmed
+            << " cacheBytes=" << cache->sizeBytes();
+        Logger::instance().info(oss.str());
+    }
+    co_return;
+}
+
+std::shared_ptr<const ThumbnailCache::Entry> ImagePrefetchPlugin::lookup(const std::string &objectKey)
+{
+    const std::shared_ptr<ThumbnailCache> cache = cache_;
+    if (!enabled_ || !cache)
+    {
+        return nullptr;
+    }
+    return cache->get(objectKey);
+}
+
+std::shared_ptr<const ThumbnailCache::Entry> ImagePrefetchPlugin::remember(const std::string &objectKey,
+                                                                           std::vector<uint8_t> bytes,
+                                                                           std::string mimeType)
+{
+    auto entry = std::make_shared<ThumbnailCache::Entry>();
+    entry->bytes = std::move(bytes);
+    entry->mimeType = std::move(mimeType);
+    const std::shared_ptr<ThumbnailCache> cache = cache_;
+    if (enabled_ && cache && entry->bytes.size() <= maxObjectBytes_)
+    {
+        cache->put(objectKey, entry);
+    }
+    return entry;
+}
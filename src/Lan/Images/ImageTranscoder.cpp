@@ -0,0 +1,303 @@
+#include "Lan/Images/ImageTranscoder.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <memory>
+
+#if defined(WORKSHOP_HAS_STB)
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_PNG
+#define STBI_ONLY_BMP
+#define STBI_ONLY_GIF
+#include <stb_image.h>
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#endif
+
+#if defined(WORKSHOP_HAS_WEBP)
+#include <webp/encode.h>
+#endif
+
+namespace
+{
+struct RawImage
+{
+    int width = 0;
+    int height = 0;
+    int channels = 0; // 3 (RGB) или 4 (RGBA)
+    std::vector<uint8_t> pixels;
+};
+
+std::optional<RawImage> decode(const uint8_t *data, size_t size, uint64_t maxPixels)
+{
+#if defined(WORKSHOP_HAS_STB)
+    if (!data || size == 0 || size > static_cast<size_t>(std::numeric_limits<int>::max()))
+    {
+        return std::nullopt;
+    }
+    int w = 0;
+    int h = 0;
+    int comp = 0;
+    if (!stbi_info_from_memory(data, static_cast<int>(size), &w, &h, &comp) || w <= 0 || h <= 0)
+    {
+        return std::nullopt;
+    }
+    // Сжатый файл в несколько килобайт может заявлять гигапиксели: лимит до выделения памяти.
+    if (maxPixels > 0 && static_cast<uint64_t>(w) * static_cast<uint64_t>(h) > maxPixels)
+    {
+        return std::nullopt;
+    }
+    // Альфа-канал сохраняем только если он есть во входном файле.
+    const int desired = (comp == 2 || comp == 4) ? 4 : 3;
+    std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> pixels(
+        stbi_load_from_memory(data, static_cast<int>(size), &w, &h, &comp, desired),
+        &stbi_image_free);
+    if (!pixels || w <= 0 || h <= 0)
+    {
+        return std::nullopt;
+    }
+    RawImage img;
+    img.width = w;
+    img.height = h;
+    img.channels = desired;
+    img.pixels.assign(pixels.get(), pixels.get() + static_cast<size_t>(w) * h * desired);
+    return img;
+#else
+    (void)data;
+    (void)size;
+    (void)maxPixels;
+    return std::nullopt;
+#endif
+}
+
+/// Уменьшение усреднением по площади (box filter): без внешних зависимостей,
+/// для превью качество достаточное и нет муара при сильном сжатии.
+RawImage downscale(const RawImage &src, int maxSide)
+{
+    if (maxSide <= 0 || (src.width <= maxSide && src.height <= maxSide))
+    {
+        return src;
+    }
+    const double scale = static_cast<double>(maxSide) / std::max(src.width, src.height);
+    RawImage dst;
+    dst.width = std::max(1, static_cast<int>(src.width * scale + 0.5));
+    dst.height = std::max(1, static_cast<int>(src.height * scale + 0.5));
+    dst.channels = src.channels;
+    dst.pixels.resize(static_cast<size_t>(dst.width) * dst.height * dst.channels);
+
+    const double xRatio = static_cast<double>(src.width) / dst.width;
+    const double yRatio = static_cast<double>(src.height) / dst.height;
+    for (int y = 0; y < dst.height; ++y)
+    {
+        const int sy0 = static_cast<int>(y * yRatio);
+        const int sy1 = std::min(src.height, std::max(sy0 + 1, static_cast<int>((y + 1) * yRatio)));
+        for (int x = 0; x < dst.width; ++x)
+        {
+            const int sx0 = static_cast<int>(x * xRatio);
+            const int sx1 = std::min(src.width, std::max(sx0 + 1, static_cast<int>((x + 1) * xRatio)));
+            const int count = (sy1 - sy0) * (sx1 - sx0);
+            for (int c = 0; c < dst.channels; ++c)
+            {
+                uint32_t sum = 0;
+                for (int sy = sy0; sy < sy1; ++sy)
+                {
+                    const uint8_t *row = src.pixels.data() + (static_cast<size_t>(sy) * src.width) * src.channels;
+                    for (int sx = sx0; sx < sx1; ++sx)
+                    {
+                        sum += row[static_cast<size_t>(sx) * src.channels + c];
+                    }
+                }
+                dst.pixels[(static_cast<size_t>(y) * dst.width + x) * dst.channels + c] =
+                    static_cast<uint8_t>(sum / static_cast<uint32_t>(count));
+            }
+        }
+    }
+    return dst;
+}
+
+#if defined(WORKSHOP_HAS_STB)
+void appendToVector(void *context, void *data, int size)
+{
+    auto *out = static_cast<std::vector<uint8_t> *>(context);
+    const auto *bytes = static_cast<const uint8_t *>(data);
+    out->insert(out->end(), bytes, bytes + size);
+}
+#endif
+
+std::optional<ImageTranscoder::EncodedImage> encode(const RawImage &img, ImageTranscoder::Format format, int quality)
+{
+    ImageTranscoder::EncodedImage out;
+    out.width = img.width;
+    out.height = img.height;
+    quality = std::clamp(quality, 1, 100);
+
+    switch (format)
+    {
+    case ImageTranscoder::Format::Jpeg:
+#if defined(WORKSHOP_HAS_STB)
+        if (!stbi_write_jpg_to_func(&appendToVector, &out.bytes, img.width, img.height, img.channels,
+                                    img.pixels.data(), quality))
+        {
+            return std::nullopt;
+        }
+        out.mimeType = "image/jpeg";
+        out.extension = "jpg";
+        return out;
+#else
+        return std::nullopt;
+#endif
+    case ImageTranscoder::Format::Png:
+#if defined(WORKSHOP_HAS_STB)
+        if (!stbi_write_png_to_func(&appendToVector, &out.bytes, img.width, img.height, img.channels,
+                                    img.pixels.data(), img.width * img.channels))
+        {
+            return std::nullopt;
+        }
+        out.mimeType = "image/png";
+        out.extension = "png";
+        return out;
+#else
+        return std::nullopt;
+#endif
+    case ImageTranscoder::Format::Webp:
+#if defined(WORKSHOP_HAS_WEBP)
+    {
+        uint8_t *encoded = nullptr;
+        const int stride = img.width * img.channels;
+        const size_t len = (img.channels == 4)
+                               ? WebPEncodeRGBA(img.pixels.data(), img.width, img.height, stride,
+                                                static_cast<float>(quality), &encoded)
+                               : WebPEncodeRGB(img.pixels.data(), img.width, img.height, stride,
+                                               static_cast<float>(quality), &encoded);
+        if (len == 0 || !encoded)
+        {
+            return std::nullopt;
+        }
+        out.bytes.assign(encoded, encoded + len);
+        WebPFree(encoded);
+        out.mimeType = "image/webp";
+        out.extension = "webp";
+        return out;
+    }
+#else
+        return std::nullopt;
+#endif
+    }
+    return std::nullopt;
+}
+} // namespace
+
+bool ImageTranscoder::parseFormat(const std::string &name, Format &out)
+{
+    std::string s = name;
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (s == "jpeg" || s == "jpg")
+    {
+        out = Format::Jpeg;
+        return true;
+    }
+    if (s == "png")
+    {
+        out = Format::Png;
+        return true;
+    }
+    if (s == "webp")
+    {
+        out = Format::Webp;
+        return true;
+    }
+    return false;
+}
+
+std::string ImageTranscoder::mimeType(Format format)
+{
+    switch (format)
+    {
+    case Format::Jpeg:
+        return "image/jpeg";
+    case Format::Png:
+        return "image/png";
+    case Format::Webp:
+        return "image/webp";
+    }
+    return "image/*";
+}
+
+std::string ImageTranscoder::extension(Format format)
+{
+    switch (format)
+    {
+    case Format::Jpeg:
+        return "jpg";
+    case Format::Png:
+        return "png";
+    case Format::Webp:
+        return "webp";
+    }
+    return {};
+}
+
+bool ImageTranscoder::canDecode()
+{
+#if defined(WORKSHOP_HAS_STB)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ImageTranscoder::canEncode(Format format)
+{
+    switch (format)
+    {
+    case Format::Jpeg:
+    case Format::Png:
+        return canDecode();
+    case Format::Webp:
+#if defined(WORKSHOP_HAS_WEBP)
+        return canDecode();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+std::optional<ImageTranscoder::EncodedImage> ImageTranscoder::makeThumbnail(const uint8_t *data,
+                                                                            size_t size,
+                                                                            int maxSide,
+                                                                            Format format,
+                                                                            int quality,
+                                                                            uint64_t maxPixels)
+{
+    if (!canEncode(format))
+    {
+        return std::nullopt;
+    }
+    auto img = decode(data, size, maxPixels);
+    if (!img)
+    {
+        return std::nullopt;
+    }
+    return encode(downscale(*img, maxSide), format, quality);
+}
+
+std::optional<ImageTranscoder::EncodedImage> ImageTranscoder::reencode(const uint8_t *data,
+                                                                       size_t size,
+                                                                       Format format,
+                                                                       int quality,
+                                                                       uint64_t maxPixels)
+{
+    if (!canEncode(format))
+    {
+        return std::nullopt;
+    }
+    auto img = decode(data, size, maxPixels);
+    if (!img)
+    {
+        return std::nullopt;
+    }
+    return encode(*img, format, quality);
+}
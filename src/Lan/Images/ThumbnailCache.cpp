@@ -0,0 +1,57 @@
+#include "Lan/Images/ThumbnailCache.h"
+
+ThumbnailCache::ThumbnailCache(size_t maxBytes)
+    : maxBytes_(maxBytes)
+{
+}
+
+std::shared_ptr<const ThumbnailCache::Entry> ThumbnailCache::get(const std::string &objectKey)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = index_.find(objectKey);
+    if (it == index_.end())
+    {
+        return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+}
+
+bool ThumbnailCache::contains(const std::string &objectKey) const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return index_.find(objectKey) != index_.end();
+}
+
+void ThumbnailCache::put(const std::string &objectKey, std::shared_ptr<const Entry> entry)
+{
+    if (!entry || entry->bytes.size() > maxBytes_)
+    {
+        return;
+    }
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = index_.find(objectKey);
+    if (it != index_.end())
+    {
+        bytes_ -= it->second->second->bytes.size();
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+    bytes_ += entry->bytes.size();
+    lru_.emplace_front(objectKey, std::move(entry));
+    index_[objectKey] = lru_.begin();
+
+    while (bytes_ > maxBytes_ && !lru_.empty())
+    {
+        auto &last = lru_.back();
+        bytes_ -= last.second->bytes.size();
+        index_.erase(last.first);
+        lru_.pop_back();
+    }
+}
+
+size_t ThumbnailCache::sizeBytes() const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    return bytes_;
+}
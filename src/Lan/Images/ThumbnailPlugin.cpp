@@ -0,0 +1,337 @@
+#include "Lan/Images/ThumbnailPlugin.h"
+
+#include <drogon/drogon.h>
+
+#include "Lan/allTableList.h"
+#include "Loger/Logger.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace
+{
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+std::string replaceExtension(const std::string &filename, const std::string &ext)
+{
+    const auto pos = filename.find_last_of('.');
+    const std::string stem = (pos == std::string::npos) ? filename : filename.substr(0, pos);
+    return (stem.empty() ? std::string("image") : stem) + "." + ext;
+}
+
+std::string smallFilename(const std::string &filename, const std::string &ext)
+{
+    const auto pos = filename.find_last_of('.');
+    const std::string stem = (pos == std::string::npos) ? filename : filename.substr(0, pos);
+    std::string name = (stem.empty() ? std::string("image") : stem) + "_small";
+    if (!ext.empty())
+    {
+        name += "." + ext;
+    }
+    else if (pos != std::string::npos && pos + 1 < filename.size())
+    {
+        name += filename.substr(pos);
+    }
+    return name;
+}
+
+ThumbnailPlugin::TableConfig parseTableConfig(const Json::Value &node)
+{
+    ThumbnailPlugin::TableConfig cfg;
+    cfg.enabled = true;
+    if (node.isMember("enabled") && node["enabled"].isBool())
+    {
+        cfg.enabled = node["enabled"].asBool();
+    }
+    if (node.isMember("small_max_side") && node["small_max_side"].isInt())
+    {
+        cfg.smallMaxSide = clampPositiveInt(node["small_max_side"].asInt(), cfg.smallMaxSide);
+    }
+    if (node.isMember("small_format") && node["small_format"].isString())
+    {
+        ImageTranscoder::Format format;
+        if (ImageTranscoder::parseFormat(node["small_format"].asString(), format))
+        {
+            cfg.smallFormat = format;
+        }
+        else
+        {
+            Logger::instance().warning("ThumbnailPlugin: unknown small_format=" + node["small_format"].asString());
+        }
+    }
+    if (node.isMember("small_quality") && node["small_quality"].isInt())
+    {
+        cfg.smallQuality = std::clamp(node["small_quality"].asInt(), 1, 100);
+    }
+    if (node.isMember("webp_big") && node["webp_big"].isBool())
+    {
+        cfg.webpBig = node["webp_big"].asBool();
+    }
+    if (node.isMember("webp_quality") && node["webp_quality"].isInt())
+    {
+        cfg.webpQuality = std::clamp(node["webp_quality"].asInt(), 1, 100);
+    }
+    if (node.isMember("fallback_copy_original") && node["fallback_copy_original"].isBool())
+    {
+        cfg.fallbackCopyOriginal = node["fallback_copy_original"].asBool();
+    }
+    return cfg;
+}
+
+ThumbnailPlugin::VariantConfig parseVariantConfig(const Json::Value &node)
+{
+    ThumbnailPlugin::VariantConfig cfg;
+    if (node.isMember("enabled") && node["enabled"].isBool())
+    {
+        cfg.enabled = node["enabled"].asBool();
+    }
+    if (node.isMember("sizes") && node["sizes"].isArray())
+    {
+        std::vector<int> sizes;
+        for (const auto &v : node["sizes"])
+        {
+            if (v.isInt() && v.asInt() > 0)
+            {
+                sizes.push_back(v.asInt());
+            }
+        }
+        std::sort(sizes.begin(), sizes.end());
+        sizes.erase(std::unique(sizes.begin(), sizes.end()), sizes.end());
+        if (!sizes.empty())
+        {
+            cfg.sizes = std::move(sizes);
+        }
+    }
+    if (node.isMember("quality") && node["quality"].isInt())
+    {
+        cfg.quality = std::clamp(node["quality"].asInt(), 1, 100);
+    }
+    return cfg;
+}
+} // namespace
+
+void ThumbnailPlugin::initAndStart(const Json::Value &config)
+{
+    int workerThreads = 2;
+    if (config.isMember("worker_threads") && config["worker_threads"].isInt())
+    {
+        workerThreads = clampPositiveInt(config["worker_threads"].asInt(), workerThreads);
+    }
+
+    if (config.isMember("max_pixels") && config["max_pixels"].isIntegral() && config["max_pixels"].asInt64() > 0)
+    {
+        maxPixels_ = static_cast<uint64_t>(config["max_pixels"].asInt64());
+    }
+
+    if (config.isMember("tables") && config["tables"].isObject())
+    {
+        const auto &tables = config["tables"];
+        for (const auto &name : tables.getMemberNames())
+        {
+            if (!tables[name].isObject())
+            {
+                continue;
+            }
+            tables_[resolveBaseTable(name)] = parseTableConfig(tables[name]);
+        }
+    }
+
+    if (config.isMember("variants") && config["variants"].isObject())
+    {
+        variants_ = parseVariantConfig(config["variants"]);
+    }
+
+    workers_ = std::make_unique<trantor::EventLoopThreadPool>(static_cast<size_t>(workerThreads), "ThumbnailWorker");
+    workers_->start();
+}
+
+void ThumbnailPlugin::shutdown()
+{
+    workers_.reset();
+    tables_.clear();
+    variants_ = VariantConfig{};
+}
+
+const ThumbnailPlugin::TableConfig *ThumbnailPlugin::findConfig(const std::string &table) const
+{
+    auto it = tables_.find(resolveBaseTable(table));
+    if (it == tables_.end() || !it->second.enabled)
+    {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+bool ThumbnailPlugin::isEnabledFor(const std::string &table) const
+{
+    return findConfig(table) != nullptr;
+}
+
+trantor::EventLoop *ThumbnailPlugin::nextWorkerLoop() const
+{
+    return workers_ ? workers_->getNextLoop() : nullptr;
+}
+
+int ThumbnailPlugin::snapVariantSide(int requested) const
+{
+    const auto it = std::lower_bound(variants_.sizes.begin(), variants_.sizes.end(), requested);
+    return it != variants_.sizes.end() ? *it : variants_.sizes.back();
+}
+
+drogon::Task<std::optional<ImageTranscoder::EncodedImage>> ThumbnailPlugin::renderVariant(
+    const std::vector<uint8_t> &source,
+    int maxSide,
+    ImageTranscoder::Format format)
+{
+    trantor::EventLoop *loop = nextWorkerLoop();
+    if (!loop || source.empty() || !ImageTranscoder::canDecode() || !ImageTranscoder::canEncode(format))
+    {
+        co_return std::nullopt;
+    }
+    const uint8_t *data = source.data();
+    const size_t size = source.size();
+    const int quality = variants_.quality;
+    const uint64_t maxPixels = maxPixels_;
+    co_return co_await drogon::queueInLoopCoro<std::optional<ImageTranscoder::EncodedImage>>(
+        loop,
+        [data, size, maxSide, format, quality, maxPixels]() {
+            return ImageTranscoder::makeThumbnail(data, size, maxSide, format, quality, maxPixels);
+        },
+        trantor::EventLoop::getEventLoopOfCurrentThread());
+}
+
+drogon::Task<std::optional<std::vector<AttachmentInput>>> ThumbnailPlugin::buildVariants(
+    const std::string &table,
+    const std::vector<AttachmentInput> &attachments)
+{
+    const TableConfig *cfg = findConfig(table);
+    if (!cfg || attachments.empty())
+    {
+        co_return std::nullopt;
+    }
+
+    // Слоты, где есть big, но нет small (или big надо перекодировать в WebP).
+    std::unordered_map<std::string, size_t> bigByDbName;
+    std::unordered_map<std::string, bool> hasSmall;
+    for (size_t i = 0; i < attachments.size(); ++i)
+    {
+        const auto &att = attachments[i];
+        if (att.role == "image")
+        {
+            bigByDbName.emplace(att.dbName, i);
+        }
+        else if (att.role == "image_small")
+        {
+            hasSmall[att.dbName] = true;
+        }
+    }
+
+    const bool webpBig = cfg->webpBig && ImageTranscoder::canEncode(ImageTranscoder::Format::Webp);
+    std::vector<AttachmentInput> result = attachments;
+    bool changed = false;
+
+    for (const auto &kv : bigByDbName)
+    {
+        const std::string &dbName = kv.first;
+        const bool needSmall = !hasSmall[dbName];
+        if (!needSmall && !webpBig)
+        {
+            continue;
+        }
+
+        const AttachmentInput &big = attachments[kv.second];
+        SlotVariants variants;
+        trantor::EventLoop *loop = nextWorkerLoop();
+        if (loop && ImageTranscoder::canDecode())
+        {
+            const TableConfig slotCfg = *cfg;
+            const uint8_t *data = big.data.data();
+            const size_t size = big.data.size();
+            const uint64_t maxPixels = maxPixels_;
+            // attachments живут до завершения co_await, поэтому передаём указатель без копии.
+            variants = co_await drogon::queueInLoopCoro<SlotVariants>(
+                loop,
+                [slotCfg, data, size, needSmall, webpBig, maxPixels]() {
+                    SlotVariants out;
+                    if (needSmall)
+                    {
+                        out.small = ImageTranscoder::makeThumbnail(data,
+                                                                   size,
+                                                                   slotCfg.smallMaxSide,
+                                                                   slotCfg.smallFormat,
+                                                                   slotCfg.smallQuality,
+                                                                   maxPixels);
+                    }
+                    if (webpBig)
+                    {
+                        out.big = ImageTranscoder::reencode(data,
+                                                            size,
+                                                            ImageTranscoder::Format::Webp,
+                                                            slotCfg.webpQuality,
+                                                            maxPixels);
+                    }
+                    return out;
+                },
+                // Запись строки продолжается на цикле запроса, а не на потоке кодирования.
+                trantor::EventLoop::getEventLoopOfCurrentThread());
+        }
+
+        AttachmentInput &outBig = result[kv.second];
+        if (variants.big)
+        {
+            outBig.data = AttachmentBuffer::fromBytes(std::move(variants.big->bytes));
+            outBig.sha256.clear();
+            outBig.mimeType = variants.big->mimeType;
+            outBig.filename = replaceExtension(outBig.filename, variants.big->extension);
+            changed = true;
+        }
+
+        if (!needSmall)
+        {
+            continue;
+        }
+
+        AttachmentInput small;
+        small.id = big.id + "__small";
+        small.dbName = dbName;
+        small.role = "image_small";
+        if (variants.small)
+        {
+            small.filename = smallFilename(big.filename, variants.small->extension);
+            small.mimeType = variants.small->mimeType;
+            small.data = AttachmentBuffer::fromBytes(std::move(variants.small->bytes));
+        }
+        else if (cfg->fallbackCopyOriginal)
+        {
+            Logger::instance().warning("ThumbnailPlugin: thumbnail not generated, using original copy"
+                                       " table=" + table + " dbName=" + dbName);
+            small.filename = smallFilename(outBig.filename, "");
+            small.mimeType = outBig.mimeType;
+            // Копия оригинала разделяет те же байты.
+            small.data = outBig.data;
+            small.sha256 = outBig.sha256;
+        }
+        else
+        {
+            Logger::instance().warning("ThumbnailPlugin: thumbnail not generated (unrecognized or above max_pixels)"
+                                       " table=" + table + " dbName=" + dbName);
+            continue;
+        }
+        result.push_back(std::move(small));
+        changed = true;
+    }
+
+    if (!changed)
+    {
+        co_return std::nullopt;
+    }
+    co_return result;
+}
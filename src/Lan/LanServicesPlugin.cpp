@@ -0,0 +1,125 @@
+#include "Lan/LanServicesPlugin.h"
+
+#include "Lan/TableRepository.h"
+#include "Loger/Logger.h"
+
+#include <drogon/drogon.h>
+
+#include <stdexcept>
+#include <string>
+
+void LanServicesPlugin::initAndStart(const Json::Value &config)
+{
+    std::string schema = "public";
+    if (config.isMember("schema") && config["schema"].isString())
+    {
+        schema = config["schema"].asString();
+    }
+    std::string dbClientName = "default";
+    if (config.isMember("db_client") && config["db_client"].isString())
+    {
+        dbClientName = config["db_client"].asString();
+    }
+    int spoolThreads = 2;
+    if (config.isMember("spool_threads") && config["spool_threads"].isInt() && config["spool_threads"].asInt() > 0)
+    {
+        spoolThreads = config["spool_threads"].asInt();
+    }
+    bool responseDebug = false;
+    if (config.isMember("response_debug") && config["response_debug"].isBool())
+    {
+        responseDebug = config["response_debug"].asBool();
+    }
+
+    // Реестры строятся один раз; RowWriteService и RowImportService делят один реестр
+    // (и кэш INSERT-ов его планировщиков).
+    std::shared_ptr<const RowWritePlannerRegistry> rowWriteRegistry = createDefaultRowWritePlannerRegistry();
+    rowWriter_ = std::make_shared<RowWriteService>(rowWriteRegistry, responseDebug);
+    rowImporter_ = std::make_shared<RowImportService>(rowWriteRegistry);
+    cellUpdater_ = std::make_shared<CellUpdateService>(createDefaultCellUpdatePlannerRegistry(), responseDebug);
+    rowDeleter_ = std::make_shared<RowDeleteService>(createDefaultRowDeletePlannerRegistry());
+    tableData_ = std::make_shared<const TableDataService>(
+        std::move(schema), std::make_shared<const TableRepository>(std::move(dbClientName)));
+    spoolWorkers_ = std::make_unique<trantor::EventLoopThreadPool>(static_cast<size_t>(spoolThreads), "MultipartSpool");
+    spoolWorkers_->start();
+
+    Logger::instance().info("LanServicesPlugin: services initialized");
+}
+
+void LanServicesPlugin::shutdown()
+{
+    // Сервисы и spool-потоки не сбрасываются: IO-потоки ещё могут читать указатели
+    // через статические методы без синхронизации. Они живут до разрушения плагина,
+    // когда IO-потоки уже остановлены.
+}
+
+LanServicesPlugin *LanServicesPlugin::instance()
+{
+    auto plugin = drogon::app().getPlugin<LanServicesPlugin>();
+    if (!plugin || !plugin->tableData_)
+    {
+        Logger::instance().error("LanServicesPlugin is not initialized");
+        return nullptr;
+    }
+    return plugin;
+}
+
+std::shared_ptr<RowWriteService> LanServicesPlugin::rowWriter()
+{
+    auto plugin = instance();
+    if (!plugin)
+    {
+        throw RowWriteError("internal", "LanServicesPlugin is not initialized", drogon::k500InternalServerError);
+    }
+    return plugin->rowWriter_;
+}
+
+std::shared_ptr<RowImportService> LanServicesPlugin::rowImporter()
+{
+    auto plugin = instance();
+    if (!plugin)
+    {
+        throw RowWriteError("internal", "LanServicesPlugin is not initialized", drogon::k500InternalServerError);
+    }
+    return plugin->rowImporter_;
+}
+
+std::shared_ptr<CellUpdateService> LanServicesPlugin::cellUpdater()
+{
+    auto plugin = instance();
+    if (!plugin)
+    {
+        throw CellUpdateError("internal", "LanServicesPlugin is not initialized", drogon::k500InternalServerError);
+    }
+    return plugin->cellUpdater_;
+}
+
+std::shared_ptr<RowDeleteService> LanServicesPlugin::rowDeleter()
+{
+    auto plugin = instance();
+    if (!plugin)
+    {
+        throw RowDeleteError("internal", "LanServicesPlugin is not initialized", drogon::k500InternalServerError);
+    }
+    return plugin->rowDeleter_;
+}
+
+std::shared_ptr<const TableDataService> LanServicesPlugin::tableData()
+{
+    auto plugin = instance();
+    if (!plugin)
+    {
+        throw std::runtime_error("LanServicesPlugin is not initialized");
+    }
+    return plugin->tableData_;
+}
+
+trantor::EventLoop *LanServicesPlugin::spoolLoop()
+{
+    auto plugin = drogon::app().getPlugin<LanServicesPlugin>();
+    if (!plugin || !plugin->spoolWorkers_)
+    {
+        return nullptr;
+    }
+    return plugin->spoolWorkers_->getNextLoop();
+}
@@ -0,0 +1,186 @@
+#include "Lan/MultipartStreamRoute.h"
+
+#include "AuthController.h"
+#include "Lan/LanServicesPlugin.h"
+#include "Loger/Logger.h"
+
+#include <drogon/drogon.h>
+
+#include <atomic>
+#include <memory>
+
+namespace
+{
+/// Состояние потокового запроса, общее для колбэков reader'а и ранней проверки payload.
+struct StreamContext
+{
+    std::weak_ptr<MultipartSpooler> spooler;
+    std::atomic<bool> tokenChecked{false};
+};
+
+MultipartSpooler::Options spoolOptions()
+{
+    MultipartSpooler::Options options;
+    options.spoolDir = drogon::app().getUploadPath() + "/tmp";
+    options.ioLoop = LanServicesPlugin::spoolLoop();
+    return options;
+}
+
+MultipartSpooler::Rejection tokenRejection(TokenValidator::Status status)
+{
+    const auto httpCode = TokenValidator::toHttpCode(status);
+    const std::string code = (httpCode == drogon::k401Unauthorized) ? "unauthorized" : "internal";
+    return MultipartSpooler::Rejection{code, TokenValidator::toError(status), Json::nullValue, httpCode};
+}
+
+drogon::HttpResponsePtr rejectionResponse(const MultipartSpooler::Rejection &rejection)
+{
+    return MultipartStreamRoute::errorResponse(rejection.code, rejection.message, rejection.details, rejection.status);
+}
+
+drogon::Task<void> runPrecheck(drogon::HttpRequestPtr req,
+                               std::shared_ptr<StreamContext> ctx,
+                               MultipartStreamRoute::Precheck precheck,
+                               Json::Value payload)
+{
+    auto spooler = ctx->spooler.lock();
+    if (!spooler)
+    {
+        co_return;
+    }
+    TokenValidator validator;
+    const auto tokenStatus = co_await validator.check(req->getHeader("token"), req->getPeerAddr().toIp());
+    if (tokenStatus != TokenValidator::Status::Ok)
+    {
+        spooler->reject(tokenRejection(tokenStatus));
+        co_return;
+    }
+    ctx->tokenChecked.store(true);
+
+    std::optional<MultipartSpooler::Rejection> rejection;
+    try
+    {
+        MultipartStreamRoute::Request probe;
+        probe.attachments = MultipartSpooler::describeAttachments(payload);
+        probe.payload = std::move(payload);
+        rejection = co_await precheck(std::move(probe));
+    }
+    catch (const std::exception &e)
+    {
+        rejection = MultipartSpooler::Rejection{"bad_request",
+                                                "Failed to parse request payload: " + std::string(e.what()),
+                                                Json::nullValue,
+                                                drogon::k400BadRequest};
+    }
+    if (rejection)
+    {
+        spooler->reject(std::move(*rejection));
+    }
+}
+
+drogon::Task<drogon::HttpResponsePtr> finishStream(drogon::HttpRequestPtr req,
+                                                   std::shared_ptr<MultipartSpooler> spooler,
+                                                   bool tokenChecked,
+                                                   const std::string &routeName,
+                                                   MultipartStreamRoute::Handle handle)
+{
+    using namespace drogon;
+
+    try
+    {
+        if (auto rejection = spooler->rejection())
+        {
+            co_return rejectionResponse(*rejection);
+        }
+
+        // Ранняя проверка могла ещё не завершиться — тогда токен проверяется здесь.
+        if (!tokenChecked)
+        {
+            TokenValidator validator;
+            const auto tokenStatus = co_await validator.check(req->getHeader("token"), req->getPeerAddr().toIp());
+            if (tokenStatus != TokenValidator::Status::Ok)
+            {
+                co_return rejectionResponse(tokenRejection(tokenStatus));
+            }
+        }
+
+        MultipartStreamRoute::Request request;
+        try
+        {
+            request.payload = spooler->result().payload;
+            request.attachments = spooler->toAttachments();
+        }
+        catch (const std::exception &e)
+        {
+            co_return MultipartStreamRoute::errorResponse("bad_request",
+                                                          "Failed to parse request payload: " + std::string(e.what()),
+                                                          Json::nullValue,
+                                                          k400BadRequest);
+        }
+
+        co_return co_await handle(std::move(request));
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(routeName + " fatal error: " + e.what());
+        co_return MultipartStreamRoute::errorResponse("internal",
+                                                      "Internal error: " + std::string(e.what()),
+                                                      Json::nullValue,
+                                                      k500InternalServerError);
+    }
+}
+} // namespace
+
+void MultipartStreamRoute::start(const drogon::HttpRequestPtr &req,
+                                 drogon::RequestStreamPtr &stream,
+                                 std::function<void(const drogon::HttpResponsePtr &)> &&callback,
+                                 std::string routeName,
+                                 Precheck precheck,
+                                 Handle handle)
+{
+    using namespace drogon;
+
+    if (req->contentType() != CT_MULTIPART_FORM_DATA)
+    {
+        callback(errorResponse("bad_request", "Expected multipart/form-data request", Json::nullValue, k400BadRequest));
+        return;
+    }
+
+    auto ctx = std::make_shared<StreamContext>();
+
+    // Ранняя проверка: токен и payload проверяются, пока клиент ещё передаёт файлы.
+    auto onPayload = [req, ctx, precheck = std::move(precheck)](const Json::Value &payload) {
+        async_run([req, ctx, precheck, payload]() -> Task<> {
+            co_await runPrecheck(req, ctx, precheck, payload);
+        });
+    };
+
+    auto onFinish = [req, ctx, routeName = std::move(routeName), handle = std::move(handle),
+                     callback = std::move(callback)](std::shared_ptr<MultipartSpooler> spooler) {
+        async_run([req, ctx, routeName, handle, callback, spooler]() -> Task<> {
+            callback(co_await finishStream(req, spooler, ctx->tokenChecked.load(), routeName, handle));
+        });
+    };
+
+    auto spooler = MultipartSpooler::create(spoolOptions(), std::move(onPayload), std::move(onFinish));
+    ctx->spooler = spooler;
+    stream->setStreamReader(spooler->makeReader(req));
+}
+
+drogon::HttpResponsePtr MultipartStreamRoute::errorResponse(const std::string &code,
+                                                            const std::string &message,
+                                                            const Json::Value &details,
+                                                            drogon::HttpStatusCode status)
+{
+    Json::Value root;
+    root["ok"] = false;
+    root["error"]["code"] = code;
+    root["error"]["message"] = message;
+    if (!details.isNull())
+    {
+        root["error"]["details"] = details;
+    }
+    auto resp = drogon::HttpResponse::newHttpJsonResponse(root);
+    resp->setStatusCode(status);
+    return resp;
+}
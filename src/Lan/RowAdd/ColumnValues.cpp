@@ -0,0 +1,181 @@
+#include "Lan/RowAdd/ColumnValues.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+std::string toLower(std::string s)
+{
+    std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return s;
+}
+
+const char *const kBoolWords[] = {"true", "false", "t", "f", "1", "0", "yes", "no", "on", "off"};
+
+/// Целое из Json-числа или строки; значение уже прошло checkColumnValue.
+int64_t integerValue(const Json::Value &value)
+{
+    if (value.type() == Json::realValue)
+    {
+        return static_cast<int64_t>(value.asDouble());
+    }
+    if (value.isNumeric())
+    {
+        return value.asInt64();
+    }
+    return std::strtoll(value.asCString(), nullptr, 10);
+}
+
+bool boolValue(const Json::Value &value)
+{
+    if (value.isBool())
+    {
+        return value.asBool();
+    }
+    const std::string text = toLower(value.asString());
+    // Истинные слова стоят в kBoolWords на чётных местах.
+    for (size_t i = 0; i < std::size(kBoolWords); i += 2)
+    {
+        if (text == kBoolWords[i])
+        {
+            return true;
+        }
+    }
+    return false;
+}
+} // namespace
+
+std::string checkColumnValue(const std::string &dataType, const Json::Value &value)
+{
+    if (value.isNull())
+    {
+        return {};
+    }
+    if (value.isObject() || value.isArray())
+    {
+        return "expected scalar value";
+    }
+
+    const bool integer = dataType == "smallint" || dataType == "integer" || dataType == "bigint";
+    if (integer)
+    {
+        if (value.isBool())
+        {
+            return "expected integer";
+        }
+        const long long limit = dataType == "smallint" ? std::numeric_limits<int16_t>::max()
+                                : dataType == "integer" ? std::numeric_limits<int32_t>::max()
+                                                        : std::numeric_limits<int64_t>::max();
+        if (value.type() == Json::realValue)
+        {
+            // 3.0 из JSON — целое: дробная часть нулевая. Границы -2^(n-1) и 2^(n-1) точны в double.
+            const double number = value.asDouble();
+            double whole = 0;
+            if (!std::isfinite(number) || std::modf(number, &whole) != 0.0)
+            {
+                return "expected integer";
+            }
+            const double lowest = static_cast<double>(-limit - 1);
+            if (number < lowest || number >= -lowest)
+            {
+                return "integer out of range for " + dataType;
+            }
+            return {};
+        }
+        const std::string text = value.asString();
+        char *end = nullptr;
+        errno = 0;
+        const long long parsed = std::strtoll(text.c_str(), &end, 10);
+        if (text.empty() || end == text.c_str() || *end != '\0' || errno == ERANGE)
+        {
+            return "expected integer";
+        }
+        if (parsed > limit || parsed < -limit - 1)
+        {
+            return "integer out of range for " + dataType;
+        }
+        return {};
+    }
+    if (dataType == "numeric" || dataType == "real" || dataType == "double precision")
+    {
+        if (value.isBool())
+        {
+            return "expected number";
+        }
+        if (value.isNumeric())
+        {
+            return {};
+        }
+        const std::string text = value.asString();
+        char *end = nullptr;
+        std::strtod(text.c_str(), &end);
+        if (text.empty() || end == text.c_str() || *end != '\0')
+        {
+            return "expected number";
+        }
+        return {};
+    }
+    if (dataType == "boolean")
+    {
+        if (value.isBool())
+        {
+            return {};
+        }
+        const std::string text = toLower(value.asString());
+        for (const char *word : kBoolWords)
+        {
+            if (text == word)
+            {
+                return {};
+            }
+        }
+        return "expected boolean";
+    }
+    return {};
+}
+
+void bindColumnValue(drogon::orm::internal::SqlBinder &binder,
+                     const TableInfoCache::ColumnType &type,
+                     const Json::Value &value)
+{
+    const std::string error = checkColumnValue(type.dataType, value);
+    if (!error.empty())
+    {
+        throw std::invalid_argument(error);
+    }
+    if (value.isNull())
+    {
+        binder << nullptr;
+        return;
+    }
+
+    const std::string &udt = type.udtName;
+    if (udt == "int4")
+    {
+        binder << static_cast<int32_t>(integerValue(value));
+    }
+    else if (udt == "int8")
+    {
+        binder << integerValue(value);
+    }
+    else if (udt == "int2")
+    {
+        binder << static_cast<int16_t>(integerValue(value));
+    }
+    else if (udt == "bool")
+    {
+        binder << boolValue(value);
+    }
+    else
+    {
+        binder << value.asString();
+    }
+}
@@ -0,0 +1,383 @@
+#include "Lan/RowAdd/IdempotencyPlugin.h"
+#include "Lan/RowAdd/RowWriteTypes.h"
+#include "Helpers/Sha256.h"
+#include "Lan/LanServicesPlugin.h"
+#include "Loger/Logger.h"
+
+#include <drogon/drogon.h>
+#include <drogon/orm/Exception.h>
+#include <json/writer.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+constexpr size_t kMaxKeyLength = 255;
+
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+Json::Value makeErrorObj(const std::string &code, const std::string &message)
+{
+    Json::Value root;
+    root["ok"] = false;
+    root["error"]["code"] = code;
+    root["error"]["message"] = message;
+    return root;
+}
+
+drogon::HttpResponsePtr makeJsonResponse(const Json::Value &body, drogon::HttpStatusCode status)
+{
+    auto resp = drogon::HttpResponse::newHttpJsonResponse(body);
+    resp->setStatusCode(status);
+    return resp;
+}
+
+/// Ключ — печатные ASCII без пробелов (обычно UUID клиента).
+bool isValidKey(const std::string &key)
+{
+    if (key.empty() || key.size() > kMaxKeyLength)
+    {
+        return false;
+    }
+    for (const char c : key)
+    {
+        if (c < 0x21 || c > 0x7e)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Посчитать недостающие att.sha256 (потоковый приём хэширует файлы сам, обычный multipart — нет).
+size_t hashAttachments(std::vector<AttachmentInput> &attachments)
+{
+    size_t hashed = 0;
+    for (auto &att : attachments)
+    {
+        if (att.sha256.empty())
+        {
+            att.sha256 = Sha256::hex(att.data.data(), att.data.size());
+            ++hashed;
+        }
+    }
+    return hashed;
+}
+
+/// Отпечаток запроса: хэши вложений уже посчитаны hashAttachments().
+std::string requestFingerprint(const Json::Value &payload, const std::vector<AttachmentInput> &attachments)
+{
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    Sha256 sha;
+    sha.update(Json::writeString(builder, payload));
+    for (const auto &att : attachments)
+    {
+        sha.update("\n" + att.id + "\n");
+        sha.update(att.sha256);
+    }
+    return sha.finalHex();
+}
+} // namespace
+
+IdempotencyPlugin::Claim::Claim(IdempotencyPlugin *plugin, std::string scope, std::string owner, std::string key)
+    : plugin_(plugin), scope_(std::move(scope)), owner_(std::move(owner)), key_(std::move(key))
+{
+    // Долгая запись (большие вложения, медленное хранилище) не должна терять резерв:
+    // до complete() срок резерва продлевается, пока процесс жив.
+    const double intervalSeconds = std::max(1.0, static_cast<double>(plugin_->pendingTimeoutSeconds_) / 3.0);
+    refreshTimerId_ = drogon::app().getLoop()->runEvery(
+        intervalSeconds,
+        [plugin = plugin_, scope = scope_, owner = owner_, key = key_]() {
+            drogon::async_run([plugin, scope, owner, key]() -> drogon::Task<> {
+                co_await plugin->refresh(scope, owner, key);
+            });
+        });
+}
+
+IdempotencyPlugin::Claim::~Claim()
+{
+    stopRefresh();
+    // Запрос завершился исключением до complete(): резерв снимается в фоне.
+    if (!finished_ && plugin_)
+    {
+        drogon::async_run([plugin = plugin_, scope = scope_, owner = owner_, key = key_]() -> drogon::Task<> {
+            co_await plugin->release(scope, owner, key);
+        });
+    }
+}
+
+void IdempotencyPlugin::Claim::stopRefresh()
+{
+    if (refreshTimerId_ != trantor::InvalidTimerId)
+    {
+        drogon::app().getLoop()->invalidateTimer(refreshTimerId_);
+        refreshTimerId_ = trantor::InvalidTimerId;
+    }
+}
+
+void IdempotencyPlugin::initAndStart(const Json::Value &config)
+{
+    if (config.isMember("enabled") && config["enabled"].isBool())
+    {
+        enabled_ = config["enabled"].asBool();
+    }
+    if (config.isMember("ttl_minutes") && config["ttl_minutes"].isInt())
+    {
+        ttlMinutes_ = clampPositiveInt(config["ttl_minutes"].asInt(), ttlMinutes_);
+    }
+    if (config.isMember("pending_timeout_seconds") && config["pending_timeout_seconds"].isInt())
+    {
+        pendingTimeoutSeconds_ = clampPositiveInt(config["pending_timeout_seconds"].asInt(), pendingTimeoutSeconds_);
+    }
+
+    int intervalMinutes = 10;
+    if (config.isMember("interval_minutes") && config["interval_minutes"].isInt())
+    {
+        intervalMinutes = clampPositiveInt(config["interval_minutes"].asInt(), intervalMinutes);
+    }
+    if (!enabled_)
+    {
+        return;
+    }
+
+    const double intervalSeconds = static_cast<double>(intervalMinutes) * 60.0;
+    timerId_ = drogon::app().getLoop()->runEvery(
+        intervalSeconds,
+        drogon::async_func([this]() -> drogon::Task<void> {
+            try
+            {
+                const int removed = co_await runOnce();
+                if (removed > 0)
+                {
+                    Logger::instance().info("IdempotencyPlugin: expired keys removed=" + std::to_string(removed));
+                }
+            }
+            catch (const drogon::orm::DrogonDbException &e)
+            {
+                Logger::instance().error("IdempotencyPlugin: runOnce failed: " + std::string(e.base().what()));
+            }
+            catch (const std::exception &e)
+            {
+                Logger::instance().error("IdempotencyPlugin: runOnce failed: " + std::string(e.what()));
+            }
+            co_return;
+        }));
+}
+
+void IdempotencyPlugin::shutdown()
+{
+    if (timerId_ != trantor::InvalidTimerId)
+    {
+        drogon::app().getLoop()->invalidateTimer(timerId_);
+        timerId_ = trantor::InvalidTimerId;
+    }
+}
+
+drogon::Task<IdempotencyPlugin::Begin> IdempotencyPlugin::begin(const drogon::HttpRequestPtr &req,
+                                                                const std::string &scope,
+                                                                const Json::Value &payload,
+                                                                std::vector<AttachmentInput> &attachments)
+{
+    Begin out;
+    const std::string key = req->getHeader("idempotency-key");
+    auto plugin = drogon::app().getPlugin<IdempotencyPlugin>();
+    if (key.empty() || !plugin || !plugin->enabled())
+    {
+        co_return out;
+    }
+    if (!isValidKey(key))
+    {
+        out.response = makeJsonResponse(makeErrorObj("bad_request", "Invalid Idempotency-Key header"),
+                                        drogon::k400BadRequest);
+        co_return out;
+    }
+
+    // Хэширование вложений — не на IO-потоке запроса; посчитанные хэши переиспользует дедупликация.
+    trantor::EventLoop *hashLoop = LanServicesPlugin::spoolLoop();
+    if (hashLoop && std::any_of(attachments.begin(), attachments.end(), [](const auto &att) { return att.sha256.empty(); }))
+    {
+        (void)co_await drogon::queueInLoopCoro<size_t>(hashLoop,
+                                                       [&attachments]() { return hashAttachments(attachments); },
+                                                       trantor::EventLoop::getEventLoopOfCurrentThread());
+    }
+    else
+    {
+        hashAttachments(attachments);
+    }
+
+    const std::string token = req->getHeader("token");
+    const std::string owner = Sha256::hex(token.data(), token.size());
+    co_return co_await plugin->reserve(scope, owner, key, requestFingerprint(payload, attachments));
+}
+
+drogon::Task<IdempotencyPlugin::Begin> IdempotencyPlugin::reserve(const std::string &scope,
+                                                                  const std::string &owner,
+                                                                  const std::string &key,
+                                                                  const std::string &fingerprint)
+{
+    Begin out;
+    std::string dbError;
+    try
+    {
+        auto dbClient = drogon::app().getDbClient("default");
+
+        // Новый ключ или просроченная запись -> резерв (pending) на pending_timeout_seconds.
+        const auto claimed = co_await dbClient->execSqlCoro(
+            "INSERT INTO public.request_idempotency (scope, owner, idem_key, fingerprint, expires_at) "
+            "VALUES ($1, $2, $3, $4, now() + $5::int * interval '1 second') "
+            "ON CONFLICT (scope, owner, idem_key) DO UPDATE "
+            "SET fingerprint = EXCLUDED.fingerprint, status_code = NULL, response = NULL, "
+            "    created_at = now(), expires_at = EXCLUDED.expires_at "
+            "WHERE request_idempotency.expires_at <= now() "
+            "RETURNING 1",
+            scope,
+            owner,
+            key,
+            fingerprint,
+            pendingTimeoutSeconds_);
+        if (!claimed.empty())
+        {
+            out.claim = std::make_shared<Claim>(this, scope, owner, key);
+            co_return out;
+        }
+
+        const auto rows = co_await dbClient->execSqlCoro(
+            "SELECT fingerprint, status_code, response FROM public.request_idempotency "
+            "WHERE scope = $1 AND owner = $2 AND idem_key = $3",
+            scope,
+            owner,
+            key);
+        if (rows.empty() || rows[0]["status_code"].isNull())
+        {
+            // Первый запрос с этим ключом ещё выполняется (или запись только что удалена очисткой).
+            out.response = makeJsonResponse(makeErrorObj("idempotency_in_progress",
+                                                         "Request with this Idempotency-Key is in progress"),
+                                            drogon::k409Conflict);
+            co_return out;
+        }
+        if (rows[0]["fingerprint"].as<std::string>() != fingerprint)
+        {
+            out.response = makeJsonResponse(makeErrorObj("idempotency_key_mismatch",
+                                                         "Idempotency-Key was used with a different request"),
+                                            drogon::k422UnprocessableEntity);
+            co_return out;
+        }
+
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(static_cast<drogon::HttpStatusCode>(rows[0]["status_code"].as<int>()));
+        resp->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+        resp->setBody(rows[0]["response"].as<std::string>());
+        resp->addHeader("Idempotent-Replayed", "true");
+        out.response = std::move(resp);
+        co_return out;
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        dbError = e.base().what();
+    }
+
+    Logger::instance().error("IdempotencyPlugin: reserve failed scope=" + scope + " error=" + dbError);
+    out.response = makeJsonResponse(makeErrorObj("idempotency_unavailable", "Idempotency store is unavailable"),
+                                    drogon::k503ServiceUnavailable);
+    co_return out;
+}
+
+drogon::Task<void> IdempotencyPlugin::complete(const std::shared_ptr<Claim> &claim,
+                                               const drogon::HttpResponsePtr &response)
+{
+    if (!claim || claim->finished_)
+    {
+        co_return;
+    }
+    claim->finished_ = true;
+    claim->stopRefresh();
+    IdempotencyPlugin *plugin = claim->plugin_;
+
+    const int status = response ? static_cast<int>(response->statusCode()) : 0;
+    if (status < 200 || status >= 300)
+    {
+        // Неудачная запись откатана целиком: повтор с тем же ключом выполнится заново.
+        co_await plugin->release(claim->scope_, claim->owner_, claim->key_);
+        co_return;
+    }
+
+    try
+    {
+        auto dbClient = drogon::app().getDbClient("default");
+        (void)co_await dbClient->execSqlCoro(
+            "UPDATE public.request_idempotency "
+            "SET status_code = $4, response = $5, expires_at = now() + $6::int * interval '1 minute' "
+            "WHERE scope = $1 AND owner = $2 AND idem_key = $3",
+            claim->scope_,
+            claim->owner_,
+            claim->key_,
+            status,
+            std::string(response->body()),
+            plugin->ttlMinutes_);
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        // Резерв остаётся pending и истечёт через pending_timeout_seconds.
+        Logger::instance().error("IdempotencyPlugin: store response failed scope=" + claim->scope_ +
+                                 " error=" + e.base().what());
+    }
+    co_return;
+}
+
+drogon::Task<void> IdempotencyPlugin::release(const std::string &scope, const std::string &owner, const std::string &key)
+{
+    try
+    {
+        auto dbClient = drogon::app().getDbClient("default");
+        (void)co_await dbClient->execSqlCoro(
+            "DELETE FROM public.request_idempotency "
+            "WHERE scope = $1 AND owner = $2 AND idem_key = $3 AND status_code IS NULL",
+            scope,
+            owner,
+            key);
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        Logger::instance().error("IdempotencyPlugin: release failed scope=" + scope + " error=" + e.base().what());
+    }
+    co_return;
+}
+
+drogon::Task<void> IdempotencyPlugin::refresh(const std::string &scope, const std::string &owner, const std::string &key)
+{
+    try
+    {
+        auto dbClient = drogon::app().getDbClient("default");
+        (void)co_await dbClient->execSqlCoro(
+            "UPDATE public.request_idempotency SET expires_at = now() + $4::int * interval '1 second' "
+            "WHERE scope = $1 AND owner = $2 AND idem_key = $3 AND status_code IS NULL",
+            scope,
+            owner,
+            key,
+            pendingTimeoutSeconds_);
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        // Следующий тик повторит продление; резерв истечёт, только если продления не проходят весь срок.
+        Logger::instance().warning("IdempotencyPlugin: refresh failed scope=" + scope + " error=" + e.base().what());
+    }
+    co_return;
+}
+
+drogon::Task<int> IdempotencyPlugin::runOnce()
+{
+    auto dbClient = drogon::app().getDbClient("default");
+    const auto result = co_await dbClient->execSqlCoro(
+        "DELETE FROM public.request_idempotency WHERE expires_at <= now()");
+    co_return static_cast<int>(result.affectedRows());
+}
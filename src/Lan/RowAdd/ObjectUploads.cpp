@@ -0,0 +1,77 @@
+#include "Lan/RowAdd/ObjectUploads.h"
+
+#include "Loger/Logger.h"
+
+#include <chrono>
+#include <sstream>
+
+drogon::Task<std::optional<Json::Value>> uploadObjectsTimed(IObjectStorage &storage,
+                                                            const std::vector<IObjectStorage::PutJob> &jobs,
+                                                            const std::vector<std::string> &attachmentIds,
+                                                            std::vector<UploadedObject> &uploadedObjects,
+                                                            Json::Value &debug,
+                                                            const std::string &logPrefix)
+{
+    if (jobs.empty())
+    {
+        co_return std::nullopt;
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    const auto results = co_await storage.putAll(jobs);
+    const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+
+    Json::Value timings(Json::arrayValue);
+    std::optional<size_t> failed;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto &job = jobs[i];
+        const auto &res = results[i];
+        Json::Value t(Json::objectValue);
+        t["attachmentId"] = attachmentIds[i];
+        t["objectKey"] = job.objectKey;
+        t["sizeBytes"] = static_cast<Json::UInt64>(job.size);
+        t["ms"] = res.durationMs;
+        t["lane"] = static_cast<Json::UInt64>(res.lane);
+        t["ok"] = res.ok;
+        timings.append(t);
+        if (res.ok)
+        {
+            uploadedObjects.push_back(UploadedObject{job.bucket, job.objectKey});
+        }
+        else if (!failed)
+        {
+            failed = i;
+        }
+    }
+    debug["uploads"] = timings;
+    debug["uploadsTotalMs"] = totalMs;
+    debug["uploadConcurrency"] = static_cast<Json::UInt64>(storage.concurrency());
+    debug["storageBackend"] = storage.name();
+    std::ostringstream log;
+    log << logPrefix << ": uploaded objects=" << jobs.size()
+        << " ok=" << uploadedObjects.size()
+        << " totalMs=" << totalMs
+        << " concurrency=" << storage.concurrency();
+    Logger::instance().info(log.str());
+
+    if (!failed)
+    {
+        co_return std::nullopt;
+    }
+
+    const auto &job = jobs[*failed];
+    Json::Value details(Json::objectValue);
+    details["bucket"] = job.bucket;
+    details["objectKey"] = job.objectKey;
+    details["mimeType"] = job.contentType;
+    details["sizeBytes"] = static_cast<Json::UInt64>(job.size);
+    std::ostringstream oss;
+    oss << logPrefix << ": MinIO upload failed"
+        << " bucket=" << job.bucket
+        << " key=" << job.objectKey
+        << " size=" << job.size
+        << " error=" << results[*failed].error;
+    Logger::instance().error(oss.str());
+    co_return details;
+}
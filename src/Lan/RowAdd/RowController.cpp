@@ -1,11 +1,16 @@
 #include "Lan/RowAdd/RowController.h"
 #include "Loger/Logger.h"
+#include "Lan/LanServicesPlugin.h"
+#include "Lan/RowAdd/IdempotencyPlugin.h"
+#include "Lan/RowAdd/RowImportService.h"
 #include "Lan/RowAdd/RowWriteService.h"
+#include "Lan/MultipartStreamRoute.h"
 
 #include <drogon/drogon.h>
 #include <drogon/MultiPart.h>
 #include <json/reader.h>
 #include <json/writer.h>
+#include <optional>
 #include <sstream>
 #include <unordered_set>
 
@@ -74,17 +79,26 @@ drogon::Task<drogon::HttpResponsePtr> RowController::addRow(drogon::HttpRequestP
             co_return makeErrorResponse("bad_request", "Invalid payload: expected JSON object", k400BadRequest);
         }
 
-        // 4) Универсальная запись строки (DB + storage) через сервис
+        // 4) Idempotency-Key: повтор получает сохранённый ответ без новой записи и загрузки файлов
+        const auto idempotency = co_await IdempotencyPlugin::begin(req, "addRow", parsed.payload, parsed.attachments);
+        if (idempotency.response)
+        {
+            co_return idempotency.response;
+        }
+
+        // 5) Универсальная запись строки (DB + storage) через сервис
+        HttpResponsePtr resp;
         try
         {
-            RowWriteService writer;
-            const WriteResult result = co_await writer.write(parsed);
-            co_return makeSuccessResponse(result.rowId, result.extra);
+            const WriteResult result = co_await LanServicesPlugin::rowWriter()->write(parsed);
+            resp = makeSuccessResponse(result.rowId, result.extra);
         }
         catch (const RowWriteError &e)
         {
-            co_return makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
+            resp = makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
         }
+        co_await IdempotencyPlugin::complete(idempotency.claim, resp);
+        co_return resp;
 
     }
     catch (const std::exception &e)
@@ -94,6 +108,135 @@ drogon::Task<drogon::HttpResponsePtr> RowController::addRow(drogon::HttpRequestP
     }
 }
 
+drogon::Task<drogon::HttpResponsePtr> RowController::importRows(drogon::HttpRequestPtr req)
+{
+    using namespace drogon;
+
+    try
+    {
+        const std::string token = req->getHeader("token");
+        TokenValidator validator;
+        auto tokenStatus = co_await validator.check(token, req->getPeerAddr().toIp());
+        if (tokenStatus != TokenValidator::Status::Ok)
+        {
+            const auto httpCode = TokenValidator::toHttpCode(tokenStatus);
+            const std::string msg = TokenValidator::toError(tokenStatus);
+            const std::string code = (httpCode == k401Unauthorized) ? "unauthorized" : "internal";
+            co_return makeJsonResponse(makeErrorObj(code, msg), httpCode);
+        }
+
+        RowImportService::Options options;
+        options.table = req->getParameter("table");
+        if (options.table.empty())
+        {
+            co_return makeErrorResponse("bad_request", "Missing table parameter", k400BadRequest);
+        }
+
+        std::string format = req->getParameter("format");
+        if (format.empty())
+        {
+            const std::string contentType = req->getHeader("content-type");
+            format = (contentType.find("csv") != std::string::npos) ? "csv" : "ndjson";
+        }
+        if (format == "csv")
+        {
+            options.format = RowImportService::Format::Csv;
+        }
+        else if (format == "ndjson" || format == "jsonl")
+        {
+            options.format = RowImportService::Format::Ndjson;
+        }
+        else
+        {
+            co_return makeErrorResponse("bad_request", "Unsupported format: " + format, k400BadRequest);
+        }
+        const std::string atomic = req->getParameter("atomic");
+        options.atomic = (atomic == "true" || atomic == "1");
+
+        if (req->body().empty())
+        {
+            co_return makeErrorResponse("bad_request", "Empty request body", k400BadRequest);
+        }
+
+        try
+        {
+            const RowImportService::Result result =
+                co_await LanServicesPlugin::rowImporter()->import(options, req->body());
+            Json::Value root;
+            root["ok"] = true;
+            root["data"] = result.toJson();
+            co_return makeJsonResponse(root, k200OK);
+        }
+        catch (const RowWriteError &e)
+        {
+            co_return makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(std::string("importRows fatal error: ") + e.what());
+        co_return makeErrorResponse("internal", "Internal error: " + std::string(e.what()), k500InternalServerError);
+    }
+}
+
+void RowController::addRowStream(const drogon::HttpRequestPtr &req,
+                                 drogon::RequestStreamPtr &&stream,
+                                 std::function<void(const drogon::HttpResponsePtr &)> &&callback)
+{
+    using namespace drogon;
+
+    if (!stream)
+    {
+        // Потоковый режим выключен в конфиге: тело уже в памяти, обычный путь.
+        async_run([this, req, callback = std::move(callback)]() -> Task<> {
+            callback(co_await addRow(req));
+        });
+        return;
+    }
+
+    auto precheck = [](MultipartStreamRoute::Request probe) -> Task<std::optional<MultipartSpooler::Rejection>> {
+        ParsedRequest parsed;
+        parsed.payload = std::move(probe.payload);
+        parsed.attachments = std::move(probe.attachments);
+        try
+        {
+            co_await LanServicesPlugin::rowWriter()->precheck(parsed);
+        }
+        catch (const RowWriteError &e)
+        {
+            co_return MultipartSpooler::Rejection{e.code(), e.what(), e.details(), e.status()};
+        }
+        co_return std::nullopt;
+    };
+
+    auto handle = [req](MultipartStreamRoute::Request request) -> Task<HttpResponsePtr> {
+        ParsedRequest parsed;
+        parsed.payload = std::move(request.payload);
+        parsed.attachments = std::move(request.attachments);
+
+        const auto idempotency = co_await IdempotencyPlugin::begin(req, "addRow", parsed.payload, parsed.attachments);
+        if (idempotency.response)
+        {
+            co_return idempotency.response;
+        }
+
+        HttpResponsePtr resp;
+        try
+        {
+            const WriteResult result = co_await LanServicesPlugin::rowWriter()->write(parsed);
+            resp = makeSuccessResponse(result.rowId, result.extra);
+        }
+        catch (const RowWriteError &e)
+        {
+            resp = makeJsonResponse(makeErrorObj(e.code(), e.what(), e.details()), e.status());
+        }
+        co_await IdempotencyPlugin::complete(idempotency.claim, resp);
+        co_return resp;
+    };
+
+    MultipartStreamRoute::start(req, stream, std::move(callback), "addRowStream", std::move(precheck), std::move(handle));
+}
+
 RowController::ParsedRequest RowController::parseMultipartRequest(drogon::HttpRequestPtr req) const
 {
     ParsedRequest result;
@@ -181,8 +324,9 @@ RowController::ParsedRequest RowController::parseMultipartRequest(drogon::HttpRe
                     input.mimeType = att["mimeType"].asString();
                 }
 
+                // Байты файла остаются в теле запроса: req держит их живыми до конца загрузки.
                 const auto content = fileIt->second.fileContent();
-                input.data.assign(content.begin(), content.end());
+                input.data = AttachmentBuffer(req, reinterpret_cast<const uint8_t *>(content.data()), content.size());
                 result.attachments.push_back(std::move(input));
                 seen.insert(id);
             }
@@ -0,0 +1,632 @@
+#include "Lan/RowAdd/RowImportService.h"
+
+#include "Lan/RowAdd/ColumnValues.h"
+#include "Lan/RowAdd/RowWriteService.h"
+#include "Lan/allTableList.h"
+#include "Loger/Logger.h"
+#include "TableInfoCache.h"
+
+#include <drogon/drogon.h>
+#include <drogon/orm/Exception.h>
+#include <json/reader.h>
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace
+{
+constexpr size_t kMaxImportRows = 50000;
+// Строки пачки идут массивами (один параметр на колонку), поэтому пачку ограничивает только число строк.
+constexpr size_t kBatchRows = 500;
+constexpr Json::ArrayIndex kMaxReportedErrors = 1000;
+
+bool isSafeIdentifier(const std::string &name)
+{
+    if (name.empty())
+    {
+        return false;
+    }
+    for (const char c : name)
+    {
+        if (!(std::isalnum(static_cast<unsigned char>(c)) || c == '_'))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string quoteIdent(const std::string &name)
+{
+    return "\"" + name + "\"";
+}
+
+std::string trimCr(std::string_view line)
+{
+    if (!line.empty() && line.back() == '\r')
+    {
+        line.remove_suffix(1);
+    }
+    return std::string(line);
+}
+
+// Значение строки входа: NULL, JSON-значение (NDJSON) или текст (CSV).
+struct ImportRow
+{
+    size_t line = 0;
+    std::vector<std::pair<size_t, Json::Value>> values; // индекс колонки импорта -> значение
+};
+
+/// Разбор одной записи CSV (RFC 4180) начиная с pos; кавычки допускают переводы строк внутри поля.
+/// Пустое поле без кавычек — NULL. Возвращает false, если вход закончился.
+bool readCsvRecord(std::string_view body, size_t &pos, size_t &line, std::vector<std::optional<std::string>> &out)
+{
+    out.clear();
+    if (pos >= body.size())
+    {
+        return false;
+    }
+    std::string field;
+    bool quoted = false;
+    bool wasQuoted = false;
+    while (pos < body.size())
+    {
+        const char c = body[pos++];
+        if (quoted)
+        {
+            if (c == '"')
+            {
+                if (pos < body.size() && body[pos] == '"')
+                {
+                    field += '"';
+                    ++pos;
+                }
+                else
+                {
+                    quoted = false;
+                }
+            }
+            else
+            {
+                if (c == '\n')
+                {
+                    ++line;
+                }
+                field += c;
+            }
+            continue;
+        }
+        if (c == '"' && field.empty() && !wasQuoted)
+        {
+            quoted = true;
+            wasQuoted = true;
+        }
+        else if (c == ',')
+        {
+            out.push_back(wasQuoted || !field.empty() ? std::optional<std::string>(std::move(field)) : std::nullopt);
+            field.clear();
+            wasQuoted = false;
+        }
+        else if (c == '\n')
+        {
+            ++line;
+            break;
+        }
+        else if (c != '\r')
+        {
+            field += c;
+        }
+    }
+    out.push_back(wasQuoted || !field.empty() ? std::optional<std::string>(std::move(field)) : std::nullopt);
+    return true;
+}
+
+class ImportCollector
+{
+public:
+    ImportCollector(const std::unordered_map<std::string, std::string> &columnTypes, RowImportService::Result &result)
+        : columnTypes_(columnTypes),
+          result_(result)
+    {
+    }
+
+    /// Индекс колонки импорта или сообщение об ошибке в error.
+    std::optional<size_t> columnIndex(const std::string &name, std::string &error)
+    {
+        auto it = indexByName_.find(name);
+        if (it != indexByName_.end())
+        {
+            return it->second;
+        }
+        auto typeIt = columnTypes_.find(name);
+        if (typeIt == columnTypes_.end() || !isSafeIdentifier(name))
+        {
+            error = "unknown column: " + name;
+            return std::nullopt;
+        }
+        if (name == "id" || name == "row_version" || name == "updated_at")
+        {
+            // id выдаёт последовательность таблицы (явный id сдвинул бы следующие addRow на занятые значения),
+            // row_version и updated_at ведёт триггер.
+            error = "column is maintained by server: " + name;
+            return std::nullopt;
+        }
+        if (name.rfind("image_", 0) == 0)
+        {
+            // image_* ведёт триггер по таблице изображений; файлы через импорт не загружаются.
+            error = "image column is not importable: " + name;
+            return std::nullopt;
+        }
+        const size_t index = columns_.size();
+        columns_.push_back(name);
+        types_.push_back(typeIt->second);
+        indexByName_.emplace(name, index);
+        return index;
+    }
+
+    const std::string &columnType(size_t index) const { return types_[index]; }
+
+    void addRow(ImportRow row) { rows_.push_back(std::move(row)); }
+
+    void addError(size_t line, const std::string &message)
+    {
+        if (result_.errors.size() >= kMaxReportedErrors)
+        {
+            result_.errorsTruncated = true;
+            return;
+        }
+        Json::Value err(Json::objectValue);
+        err["line"] = static_cast<Json::UInt64>(line);
+        err["message"] = message;
+        result_.errors.append(std::move(err));
+    }
+
+    const std::vector<std::string> &columns() const { return columns_; }
+    std::vector<ImportRow> &rows() { return rows_; }
+
+private:
+    const std::unordered_map<std::string, std::string> &columnTypes_;
+    RowImportService::Result &result_;
+    std::vector<std::string> columns_;
+    std::vector<std::string> types_;
+    std::unordered_map<std::string, size_t> indexByName_;
+    std::vector<ImportRow> rows_;
+};
+
+void collectNdjson(std::string_view body, ImportCollector &collector, size_t &received)
+{
+    size_t line = 0;
+    size_t pos = 0;
+    Json::CharReaderBuilder builder;
+    builder["collectComments"] = false;
+    const std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    while (pos < body.size())
+    {
+        const size_t eol = body.find('\n', pos);
+        const std::string text = trimCr(body.substr(pos, eol == std::string_view::npos ? std::string_view::npos : eol - pos));
+        pos = (eol == std::string_view::npos) ? body.size() : eol + 1;
+        ++line;
+        if (text.find_first_not_of(" \t") == std::string::npos)
+        {
+            continue;
+        }
+        if (++received > kMaxImportRows)
+        {
+            throw RowWriteError("bad_request",
+                                "Too many rows: limit is " + std::to_string(kMaxImportRows),
+                                drogon::k413RequestEntityTooLarge);
+        }
+
+        Json::Value obj;
+        std::string parseError;
+        if (!reader->parse(text.data(), text.data() + text.size(), &obj, &parseError) || !obj.isObject())
+        {
+            collector.addError(line, "invalid JSON object");
+            continue;
+        }
+
+        ImportRow row;
+        row.line = line;
+        std::string error;
+        for (const auto &name : obj.getMemberNames())
+        {
+            const auto index = collector.columnIndex(name, error);
+            if (!index)
+            {
+                break;
+            }
+            error = checkColumnValue(collector.columnType(*index), obj[name]);
+            if (!error.empty())
+            {
+                error = name + ": " + error;
+                break;
+            }
+            row.values.emplace_back(*index, obj[name]);
+        }
+        if (error.empty() && row.values.empty())
+        {
+            error = "row has no values";
+        }
+        if (!error.empty())
+        {
+            collector.addError(line, error);
+            continue;
+        }
+        collector.addRow(std::move(row));
+    }
+}
+
+void collectCsv(std::string_view body, ImportCollector &collector, size_t &received)
+{
+    size_t pos = 0;
+    size_t line = 0;
+    std::vector<std::optional<std::string>> fields;
+    if (!readCsvRecord(body, pos, line, fields))
+    {
+        throw RowWriteError("bad_request", "CSV header is missing", drogon::k400BadRequest);
+    }
+
+    // Заголовок целиком определяет колонки: неизвестная колонка — ошибка запроса, а не строки.
+    std::vector<size_t> headerIndex;
+    for (const auto &name : fields)
+    {
+        if (!name || name->empty())
+        {
+            throw RowWriteError("bad_request", "CSV header has an empty column name", drogon::k400BadRequest);
+        }
+        std::string error;
+        const auto index = collector.columnIndex(*name, error);
+        if (!index)
+        {
+            throw RowWriteError("bad_request", "Invalid CSV header: " + error, drogon::k400BadRequest);
+        }
+        headerIndex.push_back(*index);
+    }
+
+    while (true)
+    {
+        const size_t startLine = line + 1;
+        if (!readCsvRecord(body, pos, line, fields))
+        {
+            break;
+        }
+        if (fields.size() == 1 && !fields[0])
+        {
+            continue; // пустая строка
+        }
+        if (++received > kMaxImportRows)
+        {
+            throw RowWriteError("bad_request",
+                                "Too many rows: limit is " + std::to_string(kMaxImportRows),
+                                drogon::k413RequestEntityTooLarge);
+        }
+        if (fields.size() != headerIndex.size())
+        {
+            collector.addError(startLine,
+                               "expected " + std::to_string(headerIndex.size()) + " fields, got " +
+                                   std::to_string(fields.size()));
+            continue;
+        }
+
+        ImportRow row;
+        row.line = startLine;
+        std::string error;
+        for (size_t i = 0; i < fields.size(); ++i)
+        {
+            Json::Value value = fields[i] ? Json::Value(*fields[i]) : Json::Value(Json::nullValue);
+            error = checkColumnValue(collector.columnType(headerIndex[i]), value);
+            if (!error.empty())
+            {
+                error = collector.columns()[headerIndex[i]] + ": " + error;
+                break;
+            }
+            row.values.emplace_back(headerIndex[i], std::move(value));
+        }
+        if (error.empty() && row.values.empty())
+        {
+            error = "row has no values";
+        }
+        if (!error.empty())
+        {
+            collector.addError(startLine, error);
+            continue;
+        }
+        collector.addRow(std::move(row));
+    }
+}
+
+/// Литерал text[] с NULL-элементами: значения в кавычках, \ и " экранируются.
+std::string pgNullableTextArray(const std::vector<const Json::Value *> &values)
+{
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (i > 0)
+        {
+            out += ",";
+        }
+        if (values[i]->isNull())
+        {
+            out += "NULL";
+            continue;
+        }
+        out += "\"";
+        for (const char c : values[i]->asString())
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += "\"";
+    }
+    out += "}";
+    return out;
+}
+
+/// Набор колонок строки: индексы колонок импорта по возрастанию.
+std::vector<size_t> presentColumns(const ImportRow &row)
+{
+    std::vector<size_t> present;
+    present.reserve(row.values.size());
+    for (const auto &kv : row.values)
+    {
+        present.push_back(kv.first);
+    }
+    std::sort(present.begin(), present.end());
+    return present;
+}
+
+/// INSERT ... SELECT FROM unnest для строк с набором колонок present: по массиву text[] на колонку,
+/// значения приводятся к udt_name колонки. Текст запроса зависит только от набора колонок, не от числа строк;
+/// отсутствующие в наборе колонки получают DEFAULT. ORDER BY ord сохраняет порядок входа в RETURNING.
+std::string batchInsertSql(const std::string &table,
+                           const std::vector<std::string> &columns,
+                           const std::vector<std::string> &udtNames,
+                           const std::vector<size_t> &present,
+                           bool returnGlobalId)
+{
+    std::string target;
+    std::string select;
+    std::string arrays;
+    std::string aliases;
+    for (size_t i = 0; i < present.size(); ++i)
+    {
+        const std::string sep = (i > 0) ? ", " : "";
+        const std::string alias = "c" + std::to_string(i);
+        target += sep + quoteIdent(columns[present[i]]);
+        select += sep + "u." + alias + "::" + quoteIdent(udtNames[present[i]]);
+        arrays += sep + "$" + std::to_string(i + 1) + "::text[]";
+        aliases += sep + alias;
+    }
+    std::string sql = "INSERT INTO public." + quoteIdent(table) + " (" + target + ") SELECT " + select +
+                      " FROM unnest(" + arrays + ") WITH ORDINALITY AS u(" + aliases + ", ord) ORDER BY u.ord";
+    sql += returnGlobalId ? " RETURNING id, global_id" : " RETURNING id";
+    return sql;
+}
+} // namespace
+
+Json::Value RowImportService::Result::toJson() const
+{
+    Json::Value out(Json::objectValue);
+    out["received"] = static_cast<Json::UInt64>(received);
+    out["inserted"] = static_cast<Json::UInt64>(inserted);
+    out["failed"] = static_cast<Json::UInt64>(received - inserted);
+    out["ids"] = ids;
+    out["errors"] = errors;
+    if (errorsTruncated)
+    {
+        out["errorsTruncated"] = true;
+    }
+    return out;
+}
+
+RowImportService::RowImportService(std::shared_ptr<const RowWritePlannerRegistry> registry)
+    : registry_(std::move(registry))
+{
+}
+
+drogon::Task<RowImportService::Result> RowImportService::import(const Options &options, std::string_view body)
+{
+    if (options.table.empty() || !registry_->getPlanner(options.table))
+    {
+        throw RowWriteError("bad_request", "Unsupported table", drogon::k400BadRequest);
+    }
+    const std::string baseTable = resolveBaseTable(options.table);
+    if (!isSafeIdentifier(baseTable))
+    {
+        throw RowWriteError("bad_request", "Unsafe table name", drogon::k400BadRequest);
+    }
+
+    auto cache = drogon::app().getPlugin<TableInfoCache>();
+    if (!cache)
+    {
+        throw std::runtime_error("TableInfoCache is not initialized");
+    }
+    const auto colsPtr = co_await cache->getColumns(options.table);
+    if (!colsPtr || !colsPtr->isArray() || colsPtr->empty())
+    {
+        throw RowWriteError("bad_request", "Unknown table or empty schema", drogon::k400BadRequest);
+    }
+    std::unordered_map<std::string, std::string> columnTypes;
+    std::unordered_map<std::string, std::string> columnUdtNames;
+    for (const auto &c : *colsPtr)
+    {
+        // Значения приводятся к udt_name в тексте запроса: колонки с небезопасным именем типа не импортируются.
+        if (c.isObject() && c["name"].isString() && isSafeIdentifier(c["udt_name"].asString()))
+        {
+            columnTypes.emplace(c["name"].asString(), c["type"].asString());
+            columnUdtNames.emplace(c["name"].asString(), c["udt_name"].asString());
+        }
+    }
+    const bool returnGlobalId = columnTypes.count("global_id") > 0;
+
+    Result result;
+    ImportCollector collector(columnTypes, result);
+
+    // Дочерние таблицы пишутся в базовую с принудительным child_type_id (как insertBaseRow).
+    std::optional<size_t> childTypeIndex;
+    int childTableId = 0;
+    if (baseTable != options.table && tryGetTableIdByName(options.table, childTableId))
+    {
+        columnTypes.emplace(kChildTypeIdColumn, "integer");
+        columnUdtNames.emplace(kChildTypeIdColumn, "int4");
+        std::string error;
+        childTypeIndex = collector.columnIndex(kChildTypeIdColumn, error);
+    }
+
+    if (options.format == Format::Csv)
+    {
+        collectCsv(body, collector, result.received);
+    }
+    else
+    {
+        collectNdjson(body, collector, result.received);
+    }
+
+    std::vector<ImportRow> &rows = collector.rows();
+    if (options.atomic && !result.errors.empty())
+    {
+        Json::Value details(Json::objectValue);
+        details["errors"] = result.errors;
+        throw RowWriteError("validation_failed", "Import rejected: invalid rows", drogon::k422UnprocessableEntity, details);
+    }
+    if (rows.empty())
+    {
+        co_return result;
+    }
+    if (childTypeIndex)
+    {
+        for (auto &row : rows)
+        {
+            row.values.erase(std::remove_if(row.values.begin(),
+                                            row.values.end(),
+                                            [&](const auto &kv) { return kv.first == *childTypeIndex; }),
+                             row.values.end());
+            row.values.emplace_back(*childTypeIndex, Json::Value(std::to_string(childTableId)));
+        }
+    }
+
+    const std::vector<std::string> &columns = collector.columns();
+    std::vector<std::string> udtNames;
+    udtNames.reserve(columns.size());
+    for (const auto &name : columns)
+    {
+        udtNames.push_back(columnUdtNames.at(name));
+    }
+
+    // Строки группируются по набору колонок (порядок групп — по первой строке):
+    // у CSV набор один на весь импорт, у NDJSON — по одному на каждую форму объекта.
+    std::vector<std::vector<size_t>> groupColumns;
+    std::vector<std::vector<size_t>> groupRows;
+    {
+        std::map<std::vector<size_t>, size_t> groupByColumns;
+        for (size_t r = 0; r < rows.size(); ++r)
+        {
+            std::vector<size_t> present = presentColumns(rows[r]);
+            auto it = groupByColumns.find(present);
+            if (it == groupByColumns.end())
+            {
+                it = groupByColumns.emplace(present, groupColumns.size()).first;
+                groupColumns.push_back(std::move(present));
+                groupRows.emplace_back();
+            }
+            groupRows[it->second].push_back(r);
+        }
+    }
+
+    auto dbClient = drogon::app().getDbClient("default");
+    auto trans = co_await dbClient->newTransactionCoro();
+
+    std::vector<Json::Value> insertedItems(rows.size());
+    std::string dbError;
+    size_t failedFirstLine = 0;
+    size_t failedLastLine = 0;
+    for (size_t g = 0; g < groupColumns.size() && dbError.empty(); ++g)
+    {
+        const std::vector<size_t> &present = groupColumns[g];
+        const std::vector<size_t> &groupRowIndexes = groupRows[g];
+        const std::string sql = batchInsertSql(baseTable, columns, udtNames, present, returnGlobalId);
+        for (size_t begin = 0; begin < groupRowIndexes.size(); begin += kBatchRows)
+        {
+            const size_t end = std::min(groupRowIndexes.size(), begin + kBatchRows);
+            try
+            {
+                auto binder = (*trans << sql);
+                std::vector<const Json::Value *> values(end - begin);
+                for (size_t c = 0; c < present.size(); ++c)
+                {
+                    // Всё передаётся текстом и приводится к типу колонки в запросе.
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        const ImportRow &row = rows[groupRowIndexes[i]];
+                        values[i - begin] = &std::find_if(row.values.begin(), row.values.end(), [&](const auto &kv) {
+                                                 return kv.first == present[c];
+                                             })->second;
+                    }
+                    binder << pgNullableTextArray(values);
+                }
+                const auto inserted = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+                size_t i = begin;
+                for (const auto &row : inserted)
+                {
+                    const size_t r = groupRowIndexes[i++];
+                    Json::Value item(Json::objectValue);
+                    item["line"] = static_cast<Json::UInt64>(rows[r].line);
+                    item["id"] = static_cast<Json::Int64>(row["id"].as<int64_t>());
+                    if (returnGlobalId && !row["global_id"].isNull())
+                    {
+                        item["globalId"] = static_cast<Json::Int64>(row["global_id"].as<int64_t>());
+                    }
+                    insertedItems[r] = std::move(item);
+                }
+                result.inserted += inserted.size();
+            }
+            catch (const drogon::orm::DrogonDbException &e)
+            {
+                dbError = e.base().what();
+                failedFirstLine = rows[groupRowIndexes[begin]].line;
+                failedLastLine = rows[groupRowIndexes[end - 1]].line;
+            }
+            if (!dbError.empty())
+            {
+                break;
+            }
+        }
+    }
+
+    if (!dbError.empty())
+    {
+        trans->rollback();
+        Logger::instance().error("RowImportService: batch insert failed table=" + baseTable + " lines " +
+                                 std::to_string(failedFirstLine) + "-" + std::to_string(failedLastLine) +
+                                 " err=" + dbError);
+        Json::Value details(Json::objectValue);
+        details["firstLine"] = static_cast<Json::UInt64>(failedFirstLine);
+        details["lastLine"] = static_cast<Json::UInt64>(failedLastLine);
+        details["error"] = dbError;
+        throw RowWriteError("db_error", "Import rolled back: database rejected a batch", drogon::k422UnprocessableEntity,
+                            details);
+    }
+
+    // ids — в порядке строк входа, а не групп.
+    for (auto &item : insertedItems)
+    {
+        if (!item.isNull())
+        {
+            result.ids.append(std::move(item));
+        }
+    }
+
+    Logger::instance().info("RowImportService: imported table=" + options.table +
+                            " rows=" + std::to_string(result.inserted) +
+                            " skipped=" + std::to_string(result.received - result.inserted));
+    co_return result;
+}
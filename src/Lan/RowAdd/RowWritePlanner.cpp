@@ -1,15 +1,22 @@
 #include "Lan/RowAdd/RowWritePlanner.h"
+#include "Lan/RowAdd/ColumnValues.h"
 #include "Lan/allTableList.h"
 #include "TableInfoCache.h"
 
 #include <drogon/drogon.h>
 #include <algorithm>
 #include <cctype>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
 #include <stdexcept>
 #include <unordered_map>
+#include <vector>
 
 namespace
 {
+const std::string kRowVersionColumn = "row_version";
+
 bool isSafeIdentifier(const std::string &name)
 {
     if (name.empty())
@@ -31,101 +38,74 @@ std::string quoteIdent(const std::string &name)
     return "\"" + name + "\"";
 }
 
-struct SqlCommand
-{
-    std::string sql;
-    std::vector<std::function<void(drogon::orm::internal::SqlBinder &)>> binders;
-};
-
-void bindJsonValue(drogon::orm::internal::SqlBinder &binder, const Json::Value &value)
-{
-    if (value.isNull())
-    {
-        binder << nullptr;
-    }
-    else if (value.isBool())
-    {
-        binder << value.asBool();
-    }
-    else if (value.isInt() || value.isInt64() || value.isUInt() || value.isUInt64() || value.isDouble())
-    {
-        // Передаем числа как строки. PostgreSQL сам сконвертирует их в нужный тип 
-        // (int4, int8, numeric и т.д.) на стороне сервера. Это позволяет избежать 
-        // ошибок бинарного формата ("incorrect binary data format"), которые возникают 
-        // при несовпадении размера типа в C++ и в БД (например, int64_t vs INTEGER/int4).
-        binder << value.asString();
-    }
-    else if (value.isString())
-    {
-        binder << value.asString();
-    }
-    else
-    {
-        throw std::runtime_error("Invalid field value type: expected scalar");
-    }
-}
-
-SqlCommand buildInsertCommand(const Json::Value &payload,
-                              const std::string &schema,
-                              const std::string &table)
+/// INSERT-ы одной таблицы по наборам колонок (columns отсортированы, как ключи Json-объекта).
+/// Текст собирается один раз на набор колонок: Drogon готовит statement по тексту SQL
+/// на каждом соединении, поэтому вставки одной формы не пересобирают строку и не планируются
+/// сервером заново. Кэш живёт в планировщике (реестр строится один раз при старте),
+/// размер ограничен: сверх лимита SQL собирается без сохранения.
+class InsertSqlCache
 {
-    if (!isSafeIdentifier(schema) || !isSafeIdentifier(table))
-    {
-        throw std::runtime_error("Unsafe schema/table name");
-    }
-
-    const Json::Value &fields = payload["fields"];
-    if (!fields.isObject())
+public:
+    InsertSqlCache(const std::string &schema, const std::string &table)
+        : qualifiedTable_(quoteIdent(schema) + "." + quoteIdent(table))
     {
-        throw std::runtime_error("Invalid payload: fields must be object");
     }
 
-    std::vector<std::string> columns;
-    std::vector<std::function<void(drogon::orm::internal::SqlBinder &)>> binders;
-    const auto names = fields.getMemberNames();
-    for (const auto &name : names)
+    std::shared_ptr<const std::string> get(const std::vector<std::string> &columns) const
     {
-        if (name == "id")
+        std::string key;
+        for (const auto &column : columns)
         {
-            continue;
+            key += column;
+            key += ",";
         }
-        if (!isSafeIdentifier(name))
         {
-            throw std::runtime_error("Unsafe column name: " + name);
+            std::shared_lock lock(mutex_);
+            auto it = cache_.find(key);
+            if (it != cache_.end())
+            {
+                return it->second;
+            }
         }
-        columns.push_back(name);
-        Json::Value v = fields[name];
-        binders.push_back([v](drogon::orm::internal::SqlBinder &binder) { bindJsonValue(binder, v); });
-    }
 
-    SqlCommand cmd;
-    if (columns.empty())
-    {
-        cmd.sql = "INSERT INTO " + quoteIdent(schema) + "." + quoteIdent(table) + " DEFAULT VALUES RETURNING id";
-        return cmd;
-    }
+        std::string sql = "INSERT INTO " + qualifiedTable_;
+        if (columns.empty())
+        {
+            sql += " DEFAULT VALUES RETURNING *";
+        }
+        else
+        {
+            std::string colsSql;
+            std::string valsSql;
+            for (size_t i = 0; i < columns.size(); ++i)
+            {
+                if (i > 0)
+                {
+                    colsSql += ", ";
+                    valsSql += ", ";
+                }
+                colsSql += quoteIdent(columns[i]);
+                valsSql += "$" + std::to_string(i + 1);
+            }
+            sql += " (" + colsSql + ") VALUES (" + valsSql + ") RETURNING *";
+        }
 
-    std::string colsSql;
-    std::string valsSql;
-    for (size_t i = 0; i < columns.size(); ++i)
-    {
-        if (i > 0)
+        auto compiled = std::make_shared<const std::string>(std::move(sql));
+        std::unique_lock lock(mutex_);
+        if (cache_.size() >= kMaxCachedStatements)
         {
-            colsSql += ", ";
-            valsSql += ", ";
+            return compiled;
         }
-        colsSql += quoteIdent(columns[i]);
-        valsSql += "$" + std::to_string(i + 1);
+        return cache_.emplace(std::move(key), std::move(compiled)).first->second;
     }
-    cmd.sql = "INSERT INTO " + quoteIdent(schema) + "." + quoteIdent(table) + " (" + colsSql +
-              ") VALUES (" + valsSql + ") RETURNING id";
-    cmd.binders = std::move(binders);
-
 
+private:
+    static constexpr size_t kMaxCachedStatements = 512;
 
-    
-    return cmd;
-}
+    std::string qualifiedTable_;
+    mutable std::shared_mutex mutex_;
+    mutable std::unordered_map<std::string, std::shared_ptr<const std::string>> cache_;
+};
 
 class ImageSlotsPlanner : public ITableRowWritePlanner
 {
@@ -143,7 +123,8 @@ public:
           baseTable_(resolveBaseTable(tableName_)),
           imagesTableName_(std::move(imagesTableName)),
           fkColumn_(std::move(fkColumn)),
-          schema_(std::move(schema))
+          schema_(std::move(schema)),
+          insertSql_(schema_, baseTable_)
     {
     }
 
@@ -208,11 +189,13 @@ public:
         }
 
         std::unordered_map<std::string, bool> allowedColumns;
+        std::unordered_map<std::string, std::string> columnTypes;
         for (const auto &c : *colsPtr)
         {
             if (c.isObject() && c.isMember("name") && c["name"].isString())
             {
                 allowedColumns.emplace(c["name"].asString(), true);
+                columnTypes.emplace(c["name"].asString(), c["type"].asString());
             }
         }
         allowedColumns.emplace("id", true);
@@ -251,12 +234,28 @@ public:
             {
                 continue;
             }
+            if (k == kRowVersionColumn)
+            {
+                err.code = "bad_request";
+                err.message = "Invalid payload: row_version is maintained by server";
+                err.details["dbName"] = k;
+                co_return err;
+            }
             if (!types.isMember(k))
             {
                 err.code = "bad_request";
                 err.message = std::string("Invalid payload: types missing key for field: ") + k;
                 co_return err;
             }
+            // Значение проверяется по типу колонки здесь, а не ошибкой БД внутри транзакции.
+            const std::string valueError = checkColumnValue(columnTypes[k], fields[k]);
+            if (!valueError.empty())
+            {
+                err.code = "bad_request";
+                err.message = "Invalid field value: " + valueError;
+                err.details["dbName"] = k;
+                co_return err;
+            }
         }
 
         std::unordered_map<std::string, std::unordered_map<std::string, bool>> roleSeen;
@@ -321,45 +320,97 @@ public:
         co_return std::nullopt;
     }
 
-    drogon::Task<int64_t> insertBaseRow(const RowController::ParsedRequest &parsed,
-                                        const std::shared_ptr<drogon::orm::Transaction> &trans) const override
+    drogon::Task<drogon::orm::Result> insertBaseRow(const RowController::ParsedRequest &parsed,
+                                                    const std::shared_ptr<drogon::orm::Transaction> &trans) const override
     {
         // Универсальная вставка базовой строки:
-        // - Берём payload.fields как набор колонок.
-        // - Все значения параметризованы.
-        // - Возвращаем rowId.
-        Json::Value payload = parsed.payload;
-        if (payload.isMember("fields") && payload["fields"].isObject())
-        {
-            Json::Value &fields = payload["fields"];
-            const std::string payloadTable = payload.isMember("table") && payload["table"].isString()
-                                                 ? payload["table"].asString()
-                                                 : tableName_;
-            const std::string payloadBase = resolveBaseTable(payloadTable);
-            if (payloadBase == baseTable_ && payloadTable != payloadBase)
+        // - Берём payload.fields как набор колонок (id пропускается).
+        // - SQL берётся из кэша по набору колонок, значения привязываются прямо из payload
+        //   по типу колонки (int2/int4/int8/bool — бинарно, остальное — текстом).
+        // - Возвращаем вставленную строку целиком (RETURNING *).
+        const Json::Value &payload = parsed.payload;
+        const Json::Value &fields = payload["fields"];
+        if (!fields.isObject())
+        {
+            throw std::runtime_error("Invalid payload: fields must be object");
+        }
+        if (!isSafeIdentifier(schema_) || !isSafeIdentifier(baseTable_))
+        {
+            throw std::runtime_error("Unsafe schema/table name");
+        }
+
+        // Для дочерних таблиц всегда принудительно выставляем child_type_id.
+        std::optional<int> childTypeId;
+        const std::string payloadTable = payload.isMember("table") && payload["table"].isString()
+                                             ? payload["table"].asString()
+                                             : tableName_;
+        const std::string payloadBase = resolveBaseTable(payloadTable);
+        int tableId = 0;
+        if (payloadBase == baseTable_ && payloadTable != payloadBase && tryGetTableIdByName(payloadTable, tableId))
+        {
+            childTypeId = tableId;
+        }
+
+        // Ключи Json-объекта идут по возрастанию: порядок колонок стабилен для одной формы.
+        std::vector<std::string> columns;
+        std::vector<const Json::Value *> values;
+        columns.reserve(fields.size() + 1);
+        values.reserve(fields.size() + 1);
+        bool childColumnPlaced = false;
+        for (auto it = fields.begin(); it != fields.end(); ++it)
+        {
+            std::string name = it.name();
+            if (name == "id")
             {
-                int tableId = 0;
-                if (tryGetTableIdByName(payloadTable, tableId))
+                continue;
+            }
+            if (!isSafeIdentifier(name))
+            {
+                throw std::runtime_error("Unsafe column name: " + name);
+            }
+            if (childTypeId && !childColumnPlaced && name >= kChildTypeIdColumn)
+            {
+                columns.push_back(kChildTypeIdColumn);
+                values.push_back(nullptr);
+                childColumnPlaced = true;
+                if (name == kChildTypeIdColumn)
                 {
-                    // Для дочерних таблиц всегда принудительно выставляем child_type_id.
-                    fields[kChildTypeIdColumn] = static_cast<Json::Int64>(tableId);
+                    continue;
                 }
             }
+            columns.push_back(std::move(name));
+            values.push_back(&*it);
+        }
+        if (childTypeId && !childColumnPlaced)
+        {
+            columns.push_back(kChildTypeIdColumn);
+            values.push_back(nullptr);
         }
 
-        SqlCommand cmd = buildInsertCommand(payload, schema_, baseTable_);
-        auto binder = (*trans << cmd.sql);
-        for (const auto &bind : cmd.binders)
+        auto cache = drogon::app().getPlugin<TableInfoCache>();
+        if (!cache)
         {
-            bind(binder);
+            throw std::runtime_error("TableInfoCache is not initialized");
         }
-        const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+        const auto columnTypes = co_await cache->getColumnTypes(baseTable_);
+
+        const auto sql = insertSql_.get(columns);
+        auto binder = (*trans << *sql);
+        for (size_t i = 0; i < columns.size(); ++i)
+        {
+            const auto typeIt = columnTypes->find(columns[i]);
+            if (typeIt == columnTypes->end())
+            {
+                throw std::runtime_error("Unknown column: " + columns[i]);
+            }
+            bindColumnValue(binder, typeIt->second, values[i] ? *values[i] : Json::Value(*childTypeId));
+        }
+        auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
         if (result.empty())
         {
             throw std::runtime_error("Insert did not return id");
         }
-        const auto idField = result[0]["id"];
-        co_return idField.as<int64_t>();
+        co_return result;
     }
 
     RowWritePlan buildWritePlan(int64_t rowId,
@@ -403,6 +454,25 @@ public:
                                 minioConfig.bucket,
                                 typeStr == "ImageWithLink" ? imageMeta[dbName] : Json::Value(Json::nullValue));
         }
+
+        // image_* ячейки строки заполняет триггер *images — строку для ответа читаем последним шагом.
+        if (!plan.postUploadDbOps.empty())
+        {
+            if (!isSafeIdentifier(schema_) || !isSafeIdentifier(baseTable_))
+            {
+                throw std::runtime_error("Unsafe schema/table name");
+            }
+            plan.writtenRow = std::make_shared<WrittenRow>();
+            DbOp readOp;
+            readOp.debugName = "read_written_row";
+            readOp.exec = [sql = "SELECT * FROM " + quoteIdent(schema_) + "." + quoteIdent(baseTable_) + " WHERE id = $1",
+                           rowId,
+                           written = plan.writtenRow](const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
+                written->result = co_await trans->execSqlCoro(sql, rowId);
+                co_return;
+            };
+            plan.postUploadDbOps.push_back(std::move(readOp));
+        }
         return plan;
     }
 
@@ -578,6 +648,7 @@ private:
     std::string imagesTableName_;
     std::string fkColumn_;
     std::string schema_;
+    InsertSqlCache insertSql_;
 };
 } // namespace
 
@@ -1,17 +1,28 @@
 #include "Lan/RowAdd/RowWriteService.h"
 
 #include <drogon/drogon.h>
+#include <drogon/orm/Exception.h>
 #include <drogon/utils/Utilities.h>
 
+#include "Helpers/Sha256.h"
+#include "Lan/Images/ThumbnailPlugin.h"
+#include "Lan/RowAdd/ObjectUploads.h"
+#include "Lan/TableDataService.h"
 #include "Storage/MinioPlugin.h"
+#include "Storage/StagedUploadPlugin.h"
+#include "Storage/StorageDeleteQueuePlugin.h"
+#include "Storage/StoragePlugin.h"
 #include "Loger/Logger.h"
 
 #include <algorithm>
+#include <chrono>
+#include <optional>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_set>
 
-RowWriteService::RowWriteService()
-    : registry_(createDefaultRowWritePlannerRegistry())
+RowWriteService::RowWriteService(std::shared_ptr<const RowWritePlannerRegistry> registry, bool responseDebug)
+    : registry_(std::move(registry)), responseDebug_(responseDebug)
 {
 }
 
@@ -48,50 +59,147 @@ std::string RowWriteService::buildObjectKey(const std::string &table,
     return key;
 }
 
+std::string RowWriteService::buildStagedObjectKey(const std::string &table,
+                                                  const std::string &rowFolder,
+                                                  const AttachmentInput &attachment) const
+{
+    // В staged-режиме rowId ещё неизвестен: вместо него каталог строки — uuid запроса.
+    // Ключ окончательный с момента загрузки, "незакоммиченность" хранится только в журнале.
+    std::string ext;
+    const std::string &name = attachment.filename;
+    const auto pos = name.find_last_of('.');
+    if (pos != std::string::npos && pos + 1 < name.size())
+    {
+        ext = name.substr(pos + 1);
+    }
+
+    const std::string uuid = drogon::utils::getUuid(true);
+    std::string key = table + "/" + rowFolder + "/" + attachment.dbName + "_" + attachment.role + "_" + uuid;
+    if (!ext.empty())
+    {
+        key += "." + ext;
+    }
+    return key;
+}
+
+drogon::Task<void> RowWriteService::uploadObjects(IObjectStorage &storage,
+                                                  const std::vector<IObjectStorage::PutJob> &jobs,
+                                                  const std::vector<std::string> &attachmentIds,
+                                                  std::vector<UploadedObject> &uploadedObjects,
+                                                  Json::Value &debug)
+{
+    if (auto details = co_await uploadObjectsTimed(storage, jobs, attachmentIds, uploadedObjects, debug, "RowWriteService"))
+    {
+        throw RowWriteError("storage_error", "Failed to upload object to storage", drogon::k500InternalServerError, *details);
+    }
+}
+
+drogon::Task<void> RowWriteService::prepareBlobs(BlobStorePlugin &blobStore,
+                                                 IObjectStorage &storage,
+                                                 const std::string &bucket,
+                                                 const std::vector<AttachmentInput> &attachments,
+                                                 std::unordered_map<std::string, std::string> &objectKeys,
+                                                 std::vector<UploadedObject> &blobObjects,
+                                                 Json::Value &debug)
+{
+    std::vector<BlobStorePlugin::Blob> blobs;
+    blobs.reserve(attachments.size());
+    for (const auto &att : attachments)
+    {
+        // Хэш уже посчитан при потоковом приёме; для остальных — по буферу.
+        const std::string sha = att.sha256.empty() ? Sha256::hex(att.data.data(), att.data.size()) : att.sha256;
+        const std::string key = BlobStorePlugin::objectKeyFor(sha);
+        objectKeys.emplace(att.id, key);
+        blobs.push_back(BlobStorePlugin::Blob{bucket, key, sha, att.data.size(), att.mimeType});
+    }
+
+    const auto missing = co_await blobStore.reserve(blobs);
+
+    std::vector<IObjectStorage::PutJob> jobs;
+    std::vector<std::string> attachmentIds;
+    std::unordered_set<std::string> known;
+    for (const auto &att : attachments)
+    {
+        const std::string &key = objectKeys.at(att.id);
+        if (!known.insert(key).second)
+        {
+            continue;
+        }
+        blobObjects.push_back(UploadedObject{bucket, key});
+        if (missing.count(bucket + "/" + key))
+        {
+            jobs.push_back(IObjectStorage::PutJob{bucket, key, att.mimeType, att.data.data(), att.data.size()});
+            attachmentIds.push_back(att.id);
+        }
+    }
+
+    // Загруженные блобы при ошибке не удаляются: их ref_count = 0, объект заберёт сборка мусора,
+    // а параллельный запрос с теми же байтами может уже на него ссылаться.
+    std::vector<UploadedObject> uploaded;
+    co_await uploadObjects(storage, jobs, attachmentIds, uploaded, debug);
+    debug["dedup"] = true;
+    debug["dedupHits"] = static_cast<Json::UInt64>(blobObjects.size() - jobs.size());
+    co_return;
+}
+
 drogon::Task<void> RowWriteService::executePlan(
     const std::shared_ptr<drogon::orm::Transaction> &trans,
-    MinioClient &minioClient,
-    const RowWritePlan &plan,
+    IObjectStorage &storage,
+    RowWritePlan &plan,
     const std::unordered_map<std::string, const AttachmentInput *> &attachmentIndex,
-    std::vector<UploadedObject> &uploadedObjects)
+    std::vector<UploadedObject> &uploadedObjects,
+    const std::vector<UploadedObject> *preUploaded)
 {
     for (const auto &op : plan.preUploadDbOps)
     {
         co_await op.exec(trans);
     }
 
-    for (const auto &upload : plan.uploads)
+    if (preUploaded)
     {
-        auto it = attachmentIndex.find(upload.attachmentId);
-        if (it == attachmentIndex.end())
+        // Объекты уже загружены до транзакции — проверяем, что план ссылается только на них.
+        std::unordered_set<std::string> staged;
+        for (const auto &obj : *preUploaded)
         {
-            std::ostringstream oss;
-            oss << "RowWriteError: attachment not found for upload op"
-                << " attachmentId=" << upload.attachmentId;
-            Logger::instance().error(oss.str());
-            throw RowWriteError("bad_request", "Attachment not found for upload op", drogon::k400BadRequest);
+            staged.insert(obj.bucket + "/" + obj.objectKey);
         }
-        const AttachmentInput *att = it->second;
-        const bool ok = minioClient.putObject(upload.bucket,
-                                              upload.objectKey,
-                                              att->data,
-                                              upload.mimeType);
-        if (!ok)
+        for (const auto &upload : plan.uploads)
+        {
+            if (staged.find(upload.bucket + "/" + upload.objectKey) == staged.end())
+            {
+                std::ostringstream oss;
+                oss << "RowWriteError: upload op does not match staged object"
+                    << " bucket=" << upload.bucket
+                    << " key=" << upload.objectKey;
+                Logger::instance().error(oss.str());
+                throw RowWriteError("internal", "Upload op does not match staged object", drogon::k500InternalServerError);
+            }
+        }
+    }
+    else
+    {
+        // Загрузки выполняются параллельно: транзакция удерживается на время самой долгой
+        // загрузки, а не на сумму всех.
+        std::vector<IObjectStorage::PutJob> jobs;
+        std::vector<std::string> attachmentIds;
+        jobs.reserve(plan.uploads.size());
+        attachmentIds.reserve(plan.uploads.size());
+        for (const auto &upload : plan.uploads)
         {
-            Json::Value details(Json::objectValue);
-            details["bucket"] = upload.bucket;
-            details["objectKey"] = upload.objectKey;
-            details["mimeType"] = upload.mimeType;
-            details["sizeBytes"] = static_cast<Json::UInt64>(att->data.size());
-            std::ostringstream oss;
-            oss << "RowWriteError: MinIO upload failed"
-                << " bucket=" << upload.bucket
-                << " key=" << upload.objectKey
-                << " size=" << att->data.size();
-            Logger::instance().error(oss.str());
-            throw RowWriteError("storage_error", "Failed to upload object to storage", drogon::k500InternalServerError, details);
+            auto it = attachmentIndex.find(upload.attachmentId);
+            if (it == attachmentIndex.end())
+            {
+                std::ostringstream oss;
+                oss << "RowWriteError: attachment not found for upload op"
+                    << " attachmentId=" << upload.attachmentId;
+                Logger::instance().error(oss.str());
+                throw RowWriteError("bad_request", "Attachment not found for upload op", drogon::k400BadRequest);
+            }
+            const AttachmentInput *att = it->second;
+            jobs.push_back(IObjectStorage::PutJob{upload.bucket, upload.objectKey, upload.mimeType, att->data.data(), att->data.size()});
+            attachmentIds.push_back(upload.attachmentId);
         }
-        uploadedObjects.push_back(UploadedObject{upload.bucket, upload.objectKey});
+        co_await uploadObjects(storage, jobs, attachmentIds, uploadedObjects, plan.debug);
     }
 
     for (const auto &op : plan.postUploadDbOps)
@@ -102,17 +210,17 @@ drogon::Task<void> RowWriteService::executePlan(
     co_return;
 }
 
-drogon::Task<WriteResult> RowWriteService::write(const RowController::ParsedRequest &parsed)
+std::shared_ptr<ITableRowWritePlanner> RowWriteService::resolvePlanner(const Json::Value &payload) const
 {
     // Точка расширения по таблицам:
     // - новые таблицы добавляются через RowWritePlannerRegistry
     // - логика конкретной таблицы/типов НЕ должна появляться здесь
-    if (!parsed.payload.isObject() || !parsed.payload.isMember("table") || !parsed.payload["table"].isString())
+    if (!payload.isObject() || !payload.isMember("table") || !payload["table"].isString())
     {
         Logger::instance().error("RowWriteError: invalid payload, missing table");
         throw RowWriteError("bad_request", "Invalid payload: missing table", drogon::k400BadRequest);
     }
-    const std::string table = parsed.payload["table"].asString();
+    const std::string table = payload["table"].asString();
     auto planner = registry_->getPlanner(table);
     if (!planner)
     {
@@ -123,8 +231,13 @@ drogon::Task<WriteResult> RowWriteService::write(const RowController::ParsedRequ
         Logger::instance().error(oss.str());
         throw RowWriteError("bad_request", "Table is not supported", drogon::k400BadRequest, details);
     }
+    return planner;
+}
 
-    if (auto validationErr = co_await planner->validate(parsed))
+drogon::Task<void> RowWriteService::validateRequest(const ITableRowWritePlanner &planner,
+                                                    const RowController::ParsedRequest &parsed) const
+{
+    if (auto validationErr = co_await planner.validate(parsed))
     {
         std::ostringstream oss;
         oss << "RowWriteError: validation failed"
@@ -137,37 +250,186 @@ drogon::Task<WriteResult> RowWriteService::write(const RowController::ParsedRequ
                             validationErr->status,
                             validationErr->details);
     }
+    co_return;
+}
+
+drogon::Task<void> RowWriteService::precheck(const RowController::ParsedRequest &parsed)
+{
+    auto planner = resolvePlanner(parsed.payload);
+    co_await validateRequest(*planner, parsed);
+}
+
+drogon::Task<WriteResult> RowWriteService::write(const RowController::ParsedRequest &parsed)
+{
+    auto planner = resolvePlanner(parsed.payload);
+    const std::string table = parsed.payload["table"].asString();
+    co_await validateRequest(*planner, parsed);
+
+    // Серверные варианты изображений (image_small, WebP) строятся до открытия транзакции,
+    // чтобы кодирование не удерживало соединение с БД.
+    RowController::ParsedRequest withVariants;
+    const RowController::ParsedRequest *effective = &parsed;
+    if (auto thumbnails = drogon::app().getPlugin<ThumbnailPlugin>())
+    {
+        if (auto variants = co_await thumbnails->buildVariants(table, parsed.attachments))
+        {
+            withVariants.payload = parsed.payload;
+            withVariants.attachments = std::move(*variants);
+            effective = &withVariants;
+        }
+    }
+    const RowController::ParsedRequest &input = *effective;
 
-    auto dbClient = drogon::app().getDbClient("default");
-    auto trans = co_await dbClient->newTransactionCoro();
     auto minioPlugin = drogon::app().getPlugin<MinioPlugin>();
     if (!minioPlugin)
     {
         Logger::instance().error("RowWriteError: MinioPlugin is not initialized");
         throw RowWriteError("internal", "MinioPlugin is not initialized", drogon::k500InternalServerError);
     }
-    MinioClient &minioClient = minioPlugin->client();
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!storagePlugin)
+    {
+        Logger::instance().error("RowWriteError: StoragePlugin is not initialized");
+        throw RowWriteError("internal", "StoragePlugin is not initialized", drogon::k500InternalServerError);
+    }
+    IObjectStorage &storage = storagePlugin->storage();
+    const auto attachmentIndex = buildAttachmentIndex(input.attachments);
 
-    // Вставка базовой строки — делегируется planner-у.
-    const int64_t rowId = co_await planner->insertBaseRow(parsed, trans);
+    // Дедупликация по содержимому: одинаковые байты хранятся одним объектом,
+    // загрузка (только отсутствующих) тоже идёт до транзакции.
+    auto blobStore = drogon::app().getPlugin<BlobStorePlugin>();
+    const bool dedup = blobStore && blobStore->enabled() && !input.attachments.empty();
 
+    // Staged write: вложения загружаются до транзакции, транзакция содержит только SQL.
+    // Режимы взаимоисключающие: при включённом BlobStorePlugin staged не используется.
+    auto staging = drogon::app().getPlugin<StagedUploadPlugin>();
+    const bool staged = !dedup && staging && staging->enabled() && !input.attachments.empty();
 
     std::unordered_map<std::string, std::string> objectKeys;
-    objectKeys.reserve(parsed.attachments.size());
-    for (const auto &att : parsed.attachments)
+    objectKeys.reserve(input.attachments.size());
+    std::vector<UploadedObject> uploadedObjects;
+    std::vector<UploadedObject> blobObjects;
+    std::string stagedBatchId;
+    Json::Value stagedDebug(Json::objectValue);
+    if (dedup)
     {
-        objectKeys.emplace(att.id, buildObjectKey(table, rowId, att));
+        co_await prepareBlobs(*blobStore,
+                              storage,
+                              minioPlugin->minioConfig().bucket,
+                              input.attachments,
+                              objectKeys,
+                              blobObjects,
+                              stagedDebug);
     }
+    else if (staged)
+    {
+        const std::string &bucket = minioPlugin->minioConfig().bucket;
+        std::vector<StagedUploadPlugin::StagedObject> ledger;
+        std::vector<IObjectStorage::PutJob> jobs;
+        std::vector<std::string> attachmentIds;
+        ledger.reserve(input.attachments.size());
+        jobs.reserve(input.attachments.size());
+        attachmentIds.reserve(input.attachments.size());
+        const std::string rowFolder = drogon::utils::getUuid(true);
+        for (const auto &att : input.attachments)
+        {
+            const std::string key = buildStagedObjectKey(table, rowFolder, att);
+            objectKeys.emplace(att.id, key);
+            ledger.push_back(StagedUploadPlugin::StagedObject{bucket, key});
+            jobs.push_back(IObjectStorage::PutJob{bucket, key, att.mimeType, att.data.data(), att.data.size()});
+            attachmentIds.push_back(att.id);
+        }
 
-    // Построение плана записи (DB ops + uploads) — зона расширения по типам вложений.
-    const RowWritePlan plan = planner->buildWritePlan(rowId, parsed, objectKeys, minioPlugin->minioConfig());
-    const auto attachmentIndex = buildAttachmentIndex(parsed.attachments);
+        // Журнал пишется до загрузки: если процесс упадёт между загрузкой и коммитом,
+        // объект найдёт reaper.
+        stagedBatchId = co_await staging->registerBatch(ledger);
+        std::exception_ptr uploadErr;
+        try
+        {
+            co_await uploadObjects(storage, jobs, attachmentIds, uploadedObjects, stagedDebug);
+        }
+        catch (...)
+        {
+            uploadErr = std::current_exception();
+        }
+        if (uploadErr)
+        {
+            const bool allDeleted = co_await discardUploaded(storage, uploadedObjects);
+            if (allDeleted)
+            {
+                co_await staging->discardBatch(stagedBatchId);
+            }
+            std::rethrow_exception(uploadErr);
+        }
+    }
 
-    std::vector<UploadedObject> uploadedObjects;
+    std::shared_ptr<drogon::orm::Transaction> trans;
+    int64_t rowId = 0;
+    RowWritePlan plan;
     std::exception_ptr eptr;
     try
     {
-        co_await executePlan(trans, minioClient, plan, attachmentIndex, uploadedObjects);
+        auto dbClient = drogon::app().getDbClient("default");
+        trans = co_await dbClient->newTransactionCoro();
+
+        // Вставка базовой строки — делегируется planner-у.
+        auto inserted = co_await planner->insertBaseRow(input, trans);
+        rowId = inserted[0]["id"].as<int64_t>();
+
+        if (!staged && !dedup)
+        {
+            for (const auto &att : input.attachments)
+            {
+                objectKeys.emplace(att.id, buildObjectKey(table, rowId, att));
+            }
+        }
+
+        // Построение плана записи (DB ops + uploads) — зона расширения по типам вложений.
+        plan = planner->buildWritePlan(rowId, input, objectKeys, minioPlugin->minioConfig());
+        if (!plan.writtenRow)
+        {
+            // План строку не меняет: в ответ идёт результат RETURNING * самой вставки.
+            plan.writtenRow = std::make_shared<WrittenRow>();
+            plan.writtenRow->result = std::move(inserted);
+        }
+        if (staged)
+        {
+            for (const auto &name : stagedDebug.getMemberNames())
+            {
+                plan.debug[name] = stagedDebug[name];
+            }
+            plan.debug["staged"] = true;
+            // Коммит ключей — последним шагом транзакции.
+            const size_t stagedCount = uploadedObjects.size();
+            plan.postUploadDbOps.push_back(DbOp{
+                "commit_staged_objects",
+                [staging, stagedBatchId, stagedCount](const std::shared_ptr<drogon::orm::Transaction> &t) -> drogon::Task<void> {
+                    co_await staging->commitBatch(t, stagedBatchId, stagedCount);
+                }});
+        }
+
+        if (dedup)
+        {
+            for (const auto &name : stagedDebug.getMemberNames())
+            {
+                plan.debug[name] = stagedDebug[name];
+            }
+            // Ссылки считаются по UploadOp плана: вложение, не попавшее в строку, ref не получает.
+            std::vector<BlobStorePlugin::BlobRef> refs;
+            refs.reserve(plan.uploads.size());
+            for (const auto &upload : plan.uploads)
+            {
+                refs.push_back(BlobStorePlugin::BlobRef{upload.bucket, upload.objectKey, 1});
+            }
+            plan.postUploadDbOps.push_back(DbOp{
+                "retain_blobs",
+                [refs](const std::shared_ptr<drogon::orm::Transaction> &t) -> drogon::Task<void> {
+                    co_await BlobStorePlugin::retain(t, refs);
+                }});
+        }
+
+        const std::vector<UploadedObject> *preUploaded = dedup ? &blobObjects : (staged ? &uploadedObjects : nullptr);
+        co_await executePlan(trans, storage, plan, attachmentIndex, uploadedObjects, preUploaded);
     }
     catch (...)
     {
@@ -180,12 +442,15 @@ drogon::Task<WriteResult> RowWriteService::write(const RowController::ParsedRequ
         {
             trans->rollback();
         }
-        for (const auto &obj : uploadedObjects)
+        const bool allDeleted = co_await discardUploaded(storage, uploadedObjects);
+        if (staged && allDeleted)
         {
-            (void)minioClient.deleteObject(obj.bucket, obj.objectKey);
+            co_await staging->discardBatch(stagedBatchId);
         }
         std::rethrow_exception(eptr);
     }
+    // Последняя ссылка на транзакцию: коммит уходит сейчас, а не после кодирования ответа.
+    trans.reset();
 
     WriteResult result;
     result.rowId = rowId;
@@ -203,7 +468,57 @@ drogon::Task<WriteResult> RowWriteService::write(const RowController::ParsedRequ
     {
         extra["plan"] = plan.successExtra;
     }
+    if (auto row = co_await TableDataService::encodeWrittenRow(table, plan.writtenRow, "RowWriteService"))
+    {
+        extra["row"] = std::move(*row);
+    }
+    if (responseDebug_ && !plan.debug.isNull())
+    {
+        extra["debug"] = plan.debug;
+    }
     result.extra = extra;
     co_return result;
 }
 
+drogon::Task<bool> RowWriteService::discardUploaded(IObjectStorage &storage,
+                                                    const std::vector<UploadedObject> &uploadedObjects)
+{
+    if (uploadedObjects.empty())
+    {
+        co_return true;
+    }
+
+    auto deleteQueue = drogon::app().getPlugin<StorageDeleteQueuePlugin>();
+    if (deleteQueue && deleteQueue->enabled())
+    {
+        std::vector<StorageDeleteQueuePlugin::Object> objects;
+        objects.reserve(uploadedObjects.size());
+        for (const auto &obj : uploadedObjects)
+        {
+            objects.push_back(StorageDeleteQueuePlugin::Object{obj.bucket, obj.objectKey});
+        }
+        bool queued = false;
+        try
+        {
+            co_await deleteQueue->enqueue(objects);
+            queued = true;
+        }
+        catch (const std::exception &e)
+        {
+            Logger::instance().warning("RowWriteService: failed to enqueue storage cleanup, deleting inline: " +
+                                       std::string(e.what()));
+        }
+        if (queued)
+        {
+            co_return true;
+        }
+    }
+
+    bool allDeleted = true;
+    for (const auto &obj : uploadedObjects)
+    {
+        const IObjectStorage::Status removed = co_await storage.remove(obj.bucket, obj.objectKey);
+        allDeleted = removed.ok && allDeleted;
+    }
+    co_return allDeleted;
+}
@@ -1,12 +1,15 @@
 #include "Lan/RowDelete/RowDeleteController.h"
+#include "Lan/TableQueryBuilder.h"
 #include "Lan/allTableList.h"
 #include "Loger/Logger.h"
+#include "TableInfoCache.h"
 
 #include <json/reader.h>
 
 #include <cctype>
 #include <limits>
 #include <stdexcept>
+#include <unordered_set>
 
 namespace
 {
@@ -32,6 +35,10 @@ drogon::HttpResponsePtr makeJsonResponse(const Json::Value &body, drogon::HttpSt
     return resp;
 }
 
+// Одним запросом меняется не больше kMaxBulkIds строк по ids; filters — как у getTableData.
+constexpr size_t kMaxBulkIds = 10000;
+constexpr Json::ArrayIndex kMaxFilters = 100;
+
 bool isSafeIdentifier(const std::string &name)
 {
     if (name.empty())
@@ -232,6 +239,159 @@ drogon::Task<drogon::HttpResponsePtr> RowDeleteController::restoreRow(drogon::Ht
     }
 }
 
+drogon::Task<drogon::HttpResponsePtr> RowDeleteController::deleteRows(drogon::HttpRequestPtr req)
+{
+    co_return co_await setDeletedMany(req, true);
+}
+
+drogon::Task<drogon::HttpResponsePtr> RowDeleteController::restoreRows(drogon::HttpRequestPtr req)
+{
+    co_return co_await setDeletedMany(req, false);
+}
+
+drogon::Task<drogon::HttpResponsePtr> RowDeleteController::setDeletedMany(drogon::HttpRequestPtr req, bool deleted)
+{
+    using namespace drogon;
+    const std::string action = deleted ? "deleteMany" : "restoreMany";
+
+    try
+    {
+        const std::string token = req->getHeader("token");
+        TokenValidator validator;
+        auto tokenStatus = co_await validator.check(token, req->getPeerAddr().toIp());
+        if (tokenStatus != TokenValidator::Status::Ok)
+        {
+            const auto httpCode = TokenValidator::toHttpCode(tokenStatus);
+            const std::string msg = TokenValidator::toError(tokenStatus);
+            const std::string code = (httpCode == k401Unauthorized) ? "unauthorized" : "internal";
+            co_return makeJsonResponse(makeErrorObj(code, msg), httpCode);
+        }
+
+        ParsedBulkRequest parsed;
+        try
+        {
+            parsed = parseBulkJsonRequest(req);
+        }
+        catch (const std::exception &e)
+        {
+            co_return makeErrorResponse("bad_request",
+                                        "Failed to parse request payload: " + std::string(e.what()),
+                                        k400BadRequest);
+        }
+
+        const std::string baseTable = resolveBaseTable(parsed.table);
+        int tableId = 0;
+        if (!tryGetTableIdByName(baseTable, tableId))
+        {
+            Logger::instance().error("RowDeleteController: table is not supported: " + parsed.table);
+            co_return makeErrorResponse("bad_request", "Table is not supported", k400BadRequest);
+        }
+        if (!isSafeIdentifier(baseTable))
+        {
+            Logger::instance().error("RowDeleteController: unsafe table name: " + baseTable);
+            co_return makeErrorResponse("bad_request", "Invalid table name", k400BadRequest);
+        }
+
+        // Условие выборки: ids одним массивом ($1) или WHERE из фильтров клиента.
+        std::string whereSql;
+        if (parsed.filters.isNull())
+        {
+            whereSql = "WHERE id = ANY($1::bigint[])";
+        }
+        else
+        {
+            auto cache = app().getPlugin<TableInfoCache>();
+            if (!cache)
+            {
+                throw std::runtime_error("TableInfoCache is not initialized");
+            }
+            const auto colsPtr = co_await cache->getColumns(parsed.table);
+            if (!colsPtr || !colsPtr->isArray())
+            {
+                Logger::instance().error("RowDeleteController: invalid columns from TableInfoCache table=" + parsed.table);
+                co_return makeErrorResponse("internal", "TableInfoCache returned invalid columns", k500InternalServerError);
+            }
+            std::unordered_set<std::string> allowedColumns;
+            for (const auto &c : *colsPtr)
+            {
+                if (c.isObject() && c.isMember("name") && c["name"].isString())
+                {
+                    allowedColumns.insert(c["name"].asString());
+                }
+            }
+            try
+            {
+                whereSql = TableQueryBuilder::buildWhere(parsed.filters, allowedColumns);
+            }
+            catch (const std::exception &e)
+            {
+                co_return makeErrorResponse("bad_request", "Invalid filters: " + std::string(e.what()), k400BadRequest);
+            }
+            if (whereSql.empty())
+            {
+                co_return makeErrorResponse("bad_request", "Invalid filters: no conditions", k400BadRequest);
+            }
+        }
+        // Дочерняя таблица видит только свои строки базовой.
+        if (baseTable != parsed.table)
+        {
+            int childTypeId = 0;
+            if (!tryGetTableIdByName(parsed.table, childTypeId))
+            {
+                co_return makeErrorResponse("bad_request", "Unknown child table", k400BadRequest);
+            }
+            whereSql += " AND " + quoteIdent(kChildTypeIdColumn) + " = " + std::to_string(childTypeId);
+        }
+
+        // Меняются только строки в другом состоянии: повторное удаление не сдвигает deleted_at (срок purge).
+        const std::string sql =
+            "UPDATE public." + quoteIdent(baseTable) +
+            (deleted ? " SET is_deleted = TRUE, deleted_at = now() " : " SET is_deleted = FALSE, deleted_at = NULL ") +
+            whereSql + (deleted ? " AND is_deleted = FALSE" : " AND is_deleted = TRUE") + " RETURNING id";
+        auto dbClient = app().getDbClient("default");
+        auto binder = (*dbClient << sql);
+        if (parsed.filters.isNull())
+        {
+            std::string idsLiteral = "{";
+            for (size_t i = 0; i < parsed.ids.size(); ++i)
+            {
+                if (i > 0)
+                {
+                    idsLiteral += ",";
+                }
+                idsLiteral += std::to_string(parsed.ids[i]);
+            }
+            idsLiteral += "}";
+            binder << idsLiteral;
+        }
+        const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+
+        Json::Value root;
+        root["ok"] = true;
+        root["data"]["table"] = parsed.table;
+        root["data"]["affected"] = static_cast<Json::UInt64>(result.size());
+        Json::Value ids(Json::arrayValue);
+        for (const auto &row : result)
+        {
+            ids.append(static_cast<Json::Int64>(row["id"].as<int64_t>()));
+        }
+        root["data"]["ids"] = std::move(ids);
+        if (parsed.filters.isNull())
+        {
+            root["data"]["requested"] = static_cast<Json::UInt64>(parsed.ids.size());
+        }
+
+        Logger::instance().info("RowDeleteController: " + action + " " + baseTable +
+                                " affected=" + std::to_string(result.size()));
+        co_return makeJsonResponse(root, k200OK);
+    }
+    catch (const std::exception &e)
+    {
+        LOG_ERROR(action + " fatal error: " + e.what());
+        co_return makeErrorResponse("internal", "Internal error: " + std::string(e.what()), k500InternalServerError);
+    }
+}
+
 RowDeleteController::ParsedRequest RowDeleteController::parseJsonRequest(drogon::HttpRequestPtr req)
 {
     const std::string body(req->body());
@@ -270,6 +430,80 @@ RowDeleteController::ParsedRequest RowDeleteController::parseJsonRequest(drogon:
     return result;
 }
 
+RowDeleteController::ParsedBulkRequest RowDeleteController::parseBulkJsonRequest(drogon::HttpRequestPtr req)
+{
+    const std::string body(req->body());
+    if (body.empty())
+    {
+        throw std::runtime_error("Empty request body");
+    }
+
+    Json::Value payload;
+    Json::Reader reader;
+    if (!reader.parse(body, payload))
+    {
+        throw std::runtime_error("Invalid JSON in request body");
+    }
+    if (!payload.isObject())
+    {
+        throw std::runtime_error("Invalid payload: expected JSON object");
+    }
+
+    ParsedBulkRequest result;
+    if (!payload.isMember("table") || !payload["table"].isString())
+    {
+        throw std::runtime_error("Invalid payload: table is required");
+    }
+    result.table = payload["table"].asString();
+
+    const bool hasIds = payload.isMember("ids");
+    const bool hasFilters = payload.isMember("filters");
+    if (hasIds == hasFilters)
+    {
+        throw std::runtime_error("Invalid payload: exactly one of ids or filters is required");
+    }
+
+    if (hasFilters)
+    {
+        const Json::Value &filters = payload["filters"];
+        if (!filters.isArray() || filters.empty())
+        {
+            throw std::runtime_error("Invalid payload: filters must be non-empty array");
+        }
+        if (filters.size() > kMaxFilters)
+        {
+            throw std::runtime_error("Invalid payload: too many filters");
+        }
+        result.filters = filters;
+        return result;
+    }
+
+    const Json::Value &ids = payload["ids"];
+    if (!ids.isArray() || ids.empty())
+    {
+        throw std::runtime_error("Invalid payload: ids must be non-empty array");
+    }
+    if (ids.size() > kMaxBulkIds)
+    {
+        throw std::runtime_error("Invalid payload: too many ids (max " + std::to_string(kMaxBulkIds) + ")");
+    }
+    std::unordered_set<int64_t> seen;
+    result.ids.reserve(ids.size());
+    for (const auto &value : ids)
+    {
+        int64_t id = 0;
+        if (!parseRowId(value, id) || id <= 0)
+        {
+            throw std::runtime_error("Invalid payload: ids must be positive integers");
+        }
+        if (seen.insert(id).second)
+        {
+            result.ids.push_back(id);
+        }
+    }
+    return result;
+}
+
 drogon::HttpResponsePtr RowDeleteController::makeSuccessResponse(int64_t rowId)
 {
     Json::Value root;
@@ -1,5 +1,6 @@
 #include "Lan/RowDelete/RowDeletePlanner.h"
 #include "Lan/allTableList.h"
+#include "Storage/BlobStorePlugin.h"
 
 #include <drogon/drogon.h>
 
@@ -7,6 +8,7 @@
 #include <stdexcept>
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 namespace
 {
@@ -95,13 +97,14 @@ public:
         const std::string fkCol = quoteIdent(fkColumn_);
         const std::string sqlSelect =
             "SELECT big_bucket, big_object_key, small_bucket, small_object_key FROM " + imagesTable +
-            " WHERE " + fkCol + " = $1";
+            " WHERE " + fkCol + " = $1 FOR UPDATE";
 
         auto binder = (*trans << sqlSelect);
         binder << request.rowId;
         const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
 
         std::unordered_set<std::string> seen;
+        std::vector<BlobStorePlugin::BlobRef> blobRefs;
         auto addStorageOp = [&](const drogon::orm::Field &bucketField, const drogon::orm::Field &keyField)
         {
             if (keyField.isNull())
@@ -118,6 +121,13 @@ public:
             {
                 bucket = bucketField.as<std::string>();
             }
+            // Контентно-адресуемый объект может использоваться другими строками:
+            // только снимаем ссылку, удалит его сборка мусора BlobStorePlugin.
+            if (BlobStorePlugin::isBlobKey(objectKey))
+            {
+                blobRefs.push_back(BlobStorePlugin::BlobRef{bucket, objectKey, 1});
+                return;
+            }
             const std::string uniq = bucket + "/" + objectKey;
             if (seen.insert(uniq).second)
             {
@@ -131,6 +141,16 @@ public:
             addStorageOp(row["small_bucket"], row["small_object_key"]);
         }
 
+        if (!blobRefs.empty())
+        {
+            RowDeleteDbOp releaseOp;
+            releaseOp.debugName = "release_blobs";
+            releaseOp.exec = [blobRefs](const std::shared_ptr<drogon::orm::Transaction> &trans) -> drogon::Task<void> {
+                co_await BlobStorePlugin::release(trans, blobRefs);
+            };
+            plan.dbOps.push_back(std::move(releaseOp));
+        }
+
         const std::string sqlDeleteImages =
             "DELETE FROM " + imagesTable + " WHERE " + fkCol + " = $1";
         RowDeleteDbOp deleteImagesOp;
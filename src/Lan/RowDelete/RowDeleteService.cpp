@@ -3,13 +3,15 @@
 #include <drogon/drogon.h>
 
 #include "Storage/MinioPlugin.h"
+#include "Storage/StorageDeleteQueuePlugin.h"
+#include "Storage/StoragePlugin.h"
 #include "Loger/Logger.h"
 
 #include <sstream>
 #include <stdexcept>
 
-RowDeleteService::RowDeleteService()
-    : registry_(createDefaultRowDeletePlannerRegistry())
+RowDeleteService::RowDeleteService(std::shared_ptr<const RowDeletePlannerRegistry> registry)
+    : registry_(std::move(registry))
 {
 }
 
@@ -57,7 +59,14 @@ drogon::Task<DeleteResult> RowDeleteService::deleteRow(const RowDeleteRequest &r
         Logger::instance().error("RowDeleteError: MinioPlugin is not initialized");
         throw RowDeleteError("internal", "MinioPlugin is not initialized", drogon::k500InternalServerError);
     }
-    MinioClient &minioClient = minioPlugin->client();
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!storagePlugin)
+    {
+        Logger::instance().error("RowDeleteError: StoragePlugin is not initialized");
+        throw RowDeleteError("internal", "StoragePlugin is not initialized", drogon::k500InternalServerError);
+    }
+    auto deleteQueue = drogon::app().getPlugin<StorageDeleteQueuePlugin>();
+    const bool queued = deleteQueue && deleteQueue->enabled();
 
     RowDeletePlan plan;
     try
@@ -67,6 +76,17 @@ drogon::Task<DeleteResult> RowDeleteService::deleteRow(const RowDeleteRequest &r
         {
             co_await op.exec(trans);
         }
+        // Объекты попадают в очередь в той же транзакции: удалятся только если удалена строка.
+        if (queued && !plan.storageDeletes.empty())
+        {
+            std::vector<StorageDeleteQueuePlugin::Object> objects;
+            objects.reserve(plan.storageDeletes.size());
+            for (const auto &op : plan.storageDeletes)
+            {
+                objects.push_back(StorageDeleteQueuePlugin::Object{op.bucket, op.objectKey});
+            }
+            co_await deleteQueue->enqueue(trans, objects);
+        }
     }
     catch (const RowDeleteError &)
     {
@@ -102,16 +122,21 @@ drogon::Task<DeleteResult> RowDeleteService::deleteRow(const RowDeleteRequest &r
         }
     }
 
+    if (queued)
+    {
+        plan.storageDeletes.clear();
+    }
     for (const auto &op : plan.storageDeletes)
     {
-        const bool ok = minioClient.deleteObject(op.bucket, op.objectKey);
-        if (!ok)
+        const IObjectStorage::Status removed = co_await storagePlugin->storage().remove(op.bucket, op.objectKey);
+        if (!removed)
         {
             Json::Value warning(Json::objectValue);
             warning["bucket"] = op.bucket;
             warning["objectKey"] = op.objectKey;
             warnings.append(warning);
-            Logger::instance().error("RowDeleteWarning: MinIO delete failed bucket=" + op.bucket + " key=" + op.objectKey);
+            Logger::instance().error("RowDeleteWarning: storage delete failed bucket=" + op.bucket + " key=" + op.objectKey +
+                                     " err=" + removed.error);
         }
     }
 
@@ -1,6 +1,7 @@
 #include <drogon/drogon.h>
 #include <drogon/utils/coroutine.h>
 
+#include "Lan/LanServicesPlugin.h"
 #include "Lan/RowDelete/SoftDeletePurgerPlugin.h"
 #include "Loger/Logger.h"
 
@@ -49,7 +50,17 @@ void SoftDeletePurgerPlugin::initAndStart(const Json::Value &config)
         intervalMinutes = clampPositiveInt(config["interval_minutes"].asInt(), intervalMinutes);
     }
 
-    purger_ = std::make_shared<SoftDeletePurger>(cfg, std::make_shared<RowDeleteService>());
+    // Сервис удаления общий с приложением (LanServicesPlugin в dependencies).
+    std::shared_ptr<RowDeleteService> deleteService;
+    try
+    {
+        deleteService = LanServicesPlugin::rowDeleter();
+    }
+    catch (const RowDeleteError &e)
+    {
+        Logger::instance().error("SoftDeletePurgerPlugin: " + std::string(e.what()));
+    }
+    purger_ = std::make_shared<SoftDeletePurger>(cfg, std::move(deleteService));
 
     if (intervalMinutes > 0)
     {
@@ -1,5 +1,5 @@
 #include "Lan/RowsSendController.h"
-#include "Lan/TableDataService.h"
+#include "Lan/LanServicesPlugin.h"
 #include "Lan/ServiceErrors.h"
 #include "Helpers/RequestJsonLogger.h"
 
@@ -387,8 +387,7 @@ drogon::Task<drogon::HttpResponsePtr> RowsSendController::getTableData(drogon::H
     // 6) Service слой: выбираем данные из БД, считаем total, применяем фильтры/пагинацию.
     try
     {
-        TableDataService service;
-        auto page = co_await service.getPage(tableName, filters, offset, limit);
+        auto page = co_await LanServicesPlugin::tableData()->getPage(tableName, filters, offset, limit);
 
         Json::Value root;
         root["ok"] = true;
@@ -1,15 +1,18 @@
 #include "Lan/TableDataService.h"
 
+#include "Lan/RowAdd/RowWriteTypes.h"
 #include "Lan/TableQueryBuilder.h"
 #include "Lan/TableRepository.h"
 #include "Lan/ServiceErrors.h"
 #include "Lan/GlobalIdService.h"
 #include "TableInfoCache.h"
 #include "Lan/allTableList.h"
+#include "Lan/Images/ImagePrefetchPlugin.h"
 #include "Loger/Logger.h"
 
 #include <drogon/orm/Exception.h>
 
+#include <unordered_map>
 #include <unordered_set>
 
 namespace
@@ -54,8 +57,9 @@ Json::Value fieldToJson(const drogon::orm::Field &f, const std::string &dataType
 }
 } // namespace
 
-TableDataService::TableDataService()
-    : repo_(std::make_shared<TableRepository>("default"))
+TableDataService::TableDataService(std::string schema, std::shared_ptr<const TableRepository> repo)
+    : schema_(std::move(schema)),
+      repo_(std::move(repo))
 {
 }
 
@@ -134,6 +138,8 @@ TableDataService::getPage(const std::string &tableName,
         out.total = co_await repo_->countRows(schema_, baseTable, whereSql);
         auto result = co_await repo_->selectPage(schema_, baseTable, whereSql, out.offset, out.limit);
 
+        out.rows = co_await encodeRows(tableName, result);
+
         std::vector<int64_t> localIds;
         localIds.reserve(result.size());
         for (const auto &r : result)
@@ -145,57 +151,145 @@ TableDataService::getPage(const std::string &tableName,
             }
         }
 
+        // Клиент следом запросит превью image_*-колонок этих строк — прогреваем их в фоне.
+        auto prefetch = app().getPlugin<ImagePrefetchPlugin>();
+        if (prefetch && prefetch->enabled() && !localIds.empty())
+        {
+            std::vector<std::string> imageColumns;
+            for (const auto &c : cols)
+            {
+                if (c.isObject() && c.isMember("name") && c["name"].isString() &&
+                    c["name"].asString().rfind("image_", 0) == 0)
+                {
+                    imageColumns.push_back(c["name"].asString());
+                }
+            }
+            prefetch->schedulePage(baseTable, std::move(imageColumns), std::move(localIds));
+        }
+        co_return out;
+    }
+    catch (const DrogonDbException &e)
+    {
+        LOG_ERROR(std::string("TableDataService DB error: ") + e.base().what());
+        throw;
+    }
+}
+
+drogon::Task<Json::Value> TableDataService::encodeRows(const std::string &tableName,
+                                                      const drogon::orm::Result &result)
+{
+    auto cache = drogon::app().getPlugin<TableInfoCache>();
+    if (!cache)
+        throw std::runtime_error("TableInfoCache is not initialized");
+    auto colsPtr = co_await cache->getColumns(tableName);
+    const Json::Value &cols = *colsPtr;
+
+    // global_id берётся из самой строки (колонка базовой таблицы, её заполняет триггер вставки);
+    // реестр читается только для строк без неё. Так строка ещё не закоммиченной транзакции
+    // (RETURNING * записи) кодируется без запроса с другого соединения.
+    bool hasGlobalIdColumn = false;
+    for (size_t i = 0; i < result.columns(); ++i)
+    {
+        if (std::string(result.columnName(i)) == "global_id")
+        {
+            hasGlobalIdColumn = true;
+            break;
+        }
+    }
+
+    std::vector<int64_t> localIds;
+    localIds.reserve(result.size());
+    for (const auto &r : result)
+    {
+        const auto &field = r["id"];
+        if (!field.isNull() && (!hasGlobalIdColumn || r["global_id"].isNull()))
+        {
+            localIds.push_back(field.as<int64_t>());
+        }
+    }
+
+    std::unordered_map<int64_t, int64_t> globalIdsByLocal;
+    if (!localIds.empty())
+    {
         GlobalIdService globalIdService;
-        const auto globalIdsByLocal = co_await globalIdService.getGlobalIdsByLocalIds(tableName, localIds);
+        globalIdsByLocal = co_await globalIdService.getGlobalIdsByLocalIds(tableName, localIds);
+    }
 
-        Json::Value rows(Json::arrayValue);
-        rows.resize(0);
+    Json::Value rows(Json::arrayValue);
+    rows.resize(0);
 
-        for (const auto &r : result)
+    for (const auto &r : result)
+    {
+        Json::Value obj(Json::objectValue);
+        for (const auto &c : cols)
         {
-            Json::Value obj(Json::objectValue);
-            for (const auto &c : cols)
+            if (!c.isObject() || !c.isMember("name") || !c["name"].isString())
+                continue;
+            const std::string name = c["name"].asString();
+            const std::string type = c.get("type", "text").asString();
+
+            if (name == "global_id")
             {
-                if (!c.isObject() || !c.isMember("name") || !c["name"].isString())
-                    continue;
-                const std::string name = c["name"].asString();
-                const std::string type = c.get("type", "text").asString();
+                continue;
+            }
 
-                if (name == "global_id")
+            const auto &field = r[name];
+            if (name == "id" && !field.isNull())
+            {
+                if (hasGlobalIdColumn && !r["global_id"].isNull())
                 {
+                    obj[name] = Json::Value(static_cast<Json::Int64>(r["global_id"].as<int64_t>()));
                     continue;
                 }
-
-                const auto &field = r[name];
-                if (name == "id" && !field.isNull())
+                const int64_t localId = field.as<int64_t>();
+                const auto it = globalIdsByLocal.find(localId);
+                if (it != globalIdsByLocal.end())
                 {
-                    const int64_t localId = field.as<int64_t>();
-                    const auto it = globalIdsByLocal.find(localId);
-                    if (it != globalIdsByLocal.end())
-                    {
-                        obj[name] = Json::Value(static_cast<Json::Int64>(it->second));
-                    }
-                    else
-                    {
-                        obj[name] = fieldToJson(field, type);
-                        LOG_WARNING("GlobalIdService: missing global_id for local id " + std::to_string(localId));
-                    }
-                    continue;
+                    obj[name] = Json::Value(static_cast<Json::Int64>(it->second));
                 }
-
-                obj[name] = fieldToJson(field, type);
+                else
+                {
+                    obj[name] = fieldToJson(field, type);
+                    LOG_WARNING("GlobalIdService: missing global_id for local id " + std::to_string(localId));
+                }
+                continue;
             }
-            rows.append(std::move(obj));
+
+            obj[name] = fieldToJson(field, type);
         }
+        rows.append(std::move(obj));
+    }
+    co_return rows;
+}
 
-        out.rows = std::move(rows);
-        co_return out;
+drogon::Task<std::optional<Json::Value>> TableDataService::encodeWrittenRow(const std::string &tableName,
+                                                                           const std::shared_ptr<WrittenRow> &row,
+                                                                           const std::string &logPrefix)
+{
+    if (!row || !row->result || row->result->empty())
+    {
+        co_return std::nullopt;
     }
-    catch (const DrogonDbException &e)
+    std::string error;
+    try
     {
-        LOG_ERROR(std::string("TableDataService DB error: ") + e.base().what());
-        throw;
+        Json::Value rows = co_await encodeRows(tableName, *row->result);
+        if (rows.empty())
+        {
+            co_return std::nullopt;
+        }
+        co_return rows[0];
+    }
+    catch (const drogon::orm::DrogonDbException &e)
+    {
+        error = e.base().what();
+    }
+    catch (const std::exception &e)
+    {
+        error = e.what();
     }
+    Logger::instance().warning(logPrefix + ": encode written row failed table=" + tableName + " error=" + error);
+    co_return std::nullopt;
 }
 
 drogon::Task<Json::Value> TableDataService::getById(const std::string &tableName, int64_t id) const
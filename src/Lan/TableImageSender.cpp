@@ -7,7 +7,10 @@
 #include <json/reader.h>
 #include <json/writer.h>
 
+#include "Lan/Images/ImagePrefetchPlugin.h"
+#include "Lan/Images/ThumbnailPlugin.h"
 #include "Storage/MinioPlugin.h"
+#include "Storage/StoragePlugin.h"
 #include "TableInfoCache.h"
 
 #ifdef LOG_TRACE
@@ -33,9 +36,11 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <limits>
 #include <memory>
 #include <optional>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -192,7 +197,102 @@ std::string normalizeImageMime(const std::string &mime, const std::string &objec
     return inferImageMime(objectKey);
 }
 
+struct ByteRange
+{
+    size_t offset = 0;
+    size_t length = 0;
+};
+
+enum class RangeParse
+{
+    None,         // заголовка нет или он не поддерживается — отдаём объект целиком
+    Ok,
+    Unsatisfiable // 416
+};
+
+std::optional<size_t> parseRangeNumber(const std::string &s)
+{
+    if (s.empty() || s.size() > 19)
+    {
+        return std::nullopt;
+    }
+    size_t v = 0;
+    for (const unsigned char c : s)
+    {
+        if (c < '0' || c > '9')
+        {
+            return std::nullopt;
+        }
+        v = v * 10 + static_cast<size_t>(c - '0');
+    }
+    return v;
+}
+
+// Разбор "Range: bytes=a-b | a- | -n" для объекта размером totalSize.
+// Несколько диапазонов и нераспознанный синтаксис игнорируются (RFC 9110 допускает ответ 200).
+RangeParse parseRangeHeader(const std::string &header, size_t totalSize, ByteRange &out)
+{
+    static const std::string kPrefix = "bytes=";
+    if (header.size() <= kPrefix.size() || header.compare(0, kPrefix.size(), kPrefix) != 0)
+    {
+        return RangeParse::None;
+    }
+    const std::string spec = header.substr(kPrefix.size());
+    if (spec.find(',') != std::string::npos)
+    {
+        return RangeParse::None;
+    }
+    const auto dash = spec.find('-');
+    if (dash == std::string::npos)
+    {
+        return RangeParse::None;
+    }
+    const std::string first = spec.substr(0, dash);
+    const std::string last = spec.substr(dash + 1);
+
+    if (first.empty())
+    {
+        // Суффикс: последние n байт.
+        const auto suffix = parseRangeNumber(last);
+        if (!suffix)
+        {
+            return RangeParse::None;
+        }
+        if (*suffix == 0 || totalSize == 0)
+        {
+            return RangeParse::Unsatisfiable;
+        }
+        out.length = std::min(*suffix, totalSize);
+        out.offset = totalSize - out.length;
+        return RangeParse::Ok;
+    }
+
+    const auto start = parseRangeNumber(first);
+    if (!start)
+    {
+        return RangeParse::None;
+    }
+    size_t end = totalSize == 0 ? 0 : totalSize - 1;
+    if (!last.empty())
+    {
+        const auto parsedEnd = parseRangeNumber(last);
+        if (!parsedEnd || *parsedEnd < *start)
+        {
+            return RangeParse::None;
+        }
+        end = std::min(*parsedEnd, end);
+    }
+    if (*start >= totalSize)
+    {
+        return RangeParse::Unsatisfiable;
+    }
+    out.offset = *start;
+    out.length = end - *start + 1;
+    return RangeParse::Ok;
+}
+
 // Сформировать одну бинарную часть multipart/mixed.
+// contentRange — для ответа 206 ("bytes a-b/total"), иначе пусто.
 void appendBinaryPart(std::string &body,
                       const std::string &boundary,
                       int64_t rowId,
@@ -202,6 +302,7 @@ void appendBinaryPart(std::string &body,
                       const std::string &reason,
                       const std::string &linkName,
                       const std::string &linkUrl,
+                      const std::string &contentRange,
                       const std::vector<uint8_t> &bytes)
 {
     body += "--";
@@ -243,6 +344,12 @@ void appendBinaryPart(std::string &body,
         body += linkUrl;
         body += "\r\n";
     }
+    if (!contentRange.empty())
+    {
+        body += "Content-Range: ";
+        body += contentRange;
+        body += "\r\n";
+    }
 
     body += "\r\n";
     if (!bytes.empty())
@@ -252,6 +359,39 @@ void appendBinaryPart(std::string &body,
     body += "\r\n";
 }
 
+// SQL для выборки метаданных картинки одним запросом.
+// Текст зависит только от (baseTable, dbName, batch), поэтому кэшируется: строка не собирается
+// на каждый запрос, а Drogon переиспользует подготовленный statement по тексту.
+// batch: $1 — массив id строк ('{1,2,3}'), в выборке есть row_id.
+const std::string &imageMetaSql(const std::string &baseTable,
+                                const std::string &imagesTable,
+                                const std::string &dbName,
+                                bool batch = false)
+{
+    static std::shared_mutex mutex;
+    static std::unordered_map<std::string, std::string> cache;
+
+    const std::string key = baseTable + "." + dbName + (batch ? "#batch" : "");
+    {
+        std::shared_lock lock(mutex);
+        auto it = cache.find(key);
+        if (it != cache.end())
+        {
+            return it->second;
+        }
+    }
+
+    const std::string sql =
+        "SELECT c." + quoteIdent("id") + " AS row_id, c." + quoteIdent(dbName) + " AS image_ref, "
+        "i.id, i.slot, i.big_object_key, i.big_mime_type, i.small_object_key, i.small_mime_type, i.link_name, i.link_url "
+        "FROM " + quoteIdent("public") + "." + quoteIdent(baseTable) + " c "
+        "LEFT JOIN " + quoteIdent("public") + "." + quoteIdent(imagesTable) + " i ON i.id = c." + quoteIdent(dbName) +
+        " WHERE c." + quoteIdent("id") + (batch ? " = ANY($1::bigint[])" : " = $1");
+
+    std::unique_lock lock(mutex);
+    return cache.emplace(key, sql).first->second;
+}
+
 void appendJsonPart(std::string &body, const std::string &boundary, const Json::Value &json)
 {
     Json::StreamWriterBuilder w;
@@ -268,6 +408,260 @@ void appendJsonPart(std::string &body, const std::string &boundary, const Json::
     body += "\r\n";
 }
 
+struct ImageMeta
+{
+    int64_t id{};
+    std::string slot;
+    std::string bigObjectKey;
+    std::string bigMime;
+    std::string smallObjectKey;
+    std::string smallMime;
+    std::string linkName;
+    std::string linkUrl;
+};
+
+// Строка imageMetaSql с найденной картинкой (i.id не NULL).
+ImageMeta readImageMeta(const drogon::orm::Row &r)
+{
+    ImageMeta meta;
+    meta.id = r["id"].as<int64_t>();
+    if (!r["slot"].isNull())
+        meta.slot = r["slot"].as<std::string>();
+    if (!r["big_object_key"].isNull())
+        meta.bigObjectKey = r["big_object_key"].as<std::string>();
+    if (!r["big_mime_type"].isNull())
+        meta.bigMime = r["big_mime_type"].as<std::string>();
+    if (!r["small_object_key"].isNull())
+        meta.smallObjectKey = r["small_object_key"].as<std::string>();
+    if (!r["small_mime_type"].isNull())
+        meta.smallMime = r["small_mime_type"].as<std::string>();
+    if (!r["link_name"].isNull())
+        meta.linkName = r["link_name"].as<std::string>();
+    if (!r["link_url"].isNull())
+        meta.linkUrl = r["link_url"].as<std::string>();
+    return meta;
+}
+
+constexpr const char *kVariantPrefix = "variants/";
+
+// Вариант выдачи для запроса с maxSide/format.
+struct VariantPlan
+{
+    std::string objectKey; // сохранённый объект, который отдаётся (или исходник производного)
+    std::string mime;
+    std::string derivedKey; // непусто — производный вариант variants/<objectKey>/<side>.<ext>
+    int side = 0;
+    ImageTranscoder::Format format = ImageTranscoder::Format::Jpeg;
+};
+
+bool acceptsMime(const std::string &accept, const std::string &mime)
+{
+    std::string lowered = accept;
+    std::transform(lowered.begin(), lowered.end(), lowered.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    return lowered.find(mime) != std::string::npos;
+}
+
+// Сохранённый small подходит, если он не крупнее запрошенного и уже в нужном формате;
+// иначе вариант строится из big (из small, если big нет). Без кодеков или при выключенных
+// вариантах отдаётся ближайший сохранённый объект как есть.
+VariantPlan planVariant(const ImageMeta &meta,
+                        bool preferSmall,
+                        int requestedSide,
+                        const std::optional<ImageTranscoder::Format> &requestedFormat,
+                        const std::string &accept,
+                        const std::string &baseTable,
+                        const ThumbnailPlugin *thumbnails)
+{
+    const ThumbnailPlugin::TableConfig *tableCfg = thumbnails ? thumbnails->findConfig(baseTable) : nullptr;
+    const int smallSide = tableCfg ? tableCfg->smallMaxSide : 0;
+    const bool hasSmall = !meta.smallObjectKey.empty();
+    const bool hasBig = !meta.bigObjectKey.empty();
+
+    VariantPlan plan;
+    const bool smallFits = hasSmall && (!hasBig || (requestedSide > 0 ? (smallSide > 0 && requestedSide <= smallSide)
+                                                                      : preferSmall));
+    plan.objectKey = smallFits ? meta.smallObjectKey : meta.bigObjectKey;
+    plan.mime = normalizeImageMime(smallFits ? meta.smallMime : meta.bigMime, plan.objectKey);
+
+    if (!thumbnails || !thumbnails->variantConfig().enabled || !ImageTranscoder::canDecode())
+    {
+        return plan;
+    }
+
+    if (requestedFormat)
+    {
+        plan.format = *requestedFormat;
+    }
+    else if (acceptsMime(accept, "image/webp") && ImageTranscoder::canEncode(ImageTranscoder::Format::Webp))
+    {
+        plan.format = ImageTranscoder::Format::Webp;
+    }
+    else
+    {
+        plan.format = (plan.mime == "image/png") ? ImageTranscoder::Format::Png : ImageTranscoder::Format::Jpeg;
+    }
+    if (!ImageTranscoder::canEncode(plan.format))
+    {
+        return plan;
+    }
+    if (smallFits && plan.mime == ImageTranscoder::mimeType(plan.format))
+    {
+        return plan;
+    }
+
+    // Производный вариант берётся из самого крупного сохранённого объекта.
+    plan.objectKey = hasBig ? meta.bigObjectKey : meta.smallObjectKey;
+    plan.mime = normalizeImageMime(hasBig ? meta.bigMime : meta.smallMime, plan.objectKey);
+    const int wanted = requestedSide > 0 ? requestedSide : (preferSmall && smallSide > 0 ? smallSide : 0);
+    plan.side = wanted > 0 ? thumbnails->snapVariantSide(wanted) : thumbnails->variantConfig().sizes.back();
+    plan.derivedKey = std::string(kVariantPrefix) + plan.objectKey + "/" + std::to_string(plan.side) + "." +
+                      ImageTranscoder::extension(plan.format);
+    return plan;
+}
+
+// Производный вариант: из кэша прогрева, из хранилища или генерация из исходника с записью
+// под derivedKey (первый запрос). nullptr — отдать исходный объект как есть.
+drogon::Task<std::shared_ptr<const ThumbnailCache::Entry>> loadDerivedVariant(IObjectStorage &storage,
+                                                                              const std::string &bucket,
+                                                                              const VariantPlan &plan,
+                                                                              ThumbnailPlugin &thumbnails,
+                                                                              ImagePrefetchPlugin *prefetch)
+{
+    if (prefetch)
+    {
+        if (auto cached = prefetch->lookup(plan.derivedKey))
+        {
+            co_return cached;
+        }
+    }
+
+    std::vector<uint8_t> bytes;
+    const IObjectStorage::Status stored = co_await storage.get(bucket, plan.derivedKey, bytes, nullptr);
+    if (!stored && !stored.notFound)
+    {
+        LOG_ERROR(std::string("TableImageSender: variant get failed bucket=") + bucket + " key=" + plan.derivedKey +
+                  " err=" + stored.error);
+        co_return nullptr;
+    }
+    if (!stored)
+    {
+        std::vector<uint8_t> source;
+        const IObjectStorage::Status fetched = co_await storage.get(bucket, plan.objectKey, source, nullptr);
+        if (!fetched)
+        {
+            LOG_ERROR(std::string("TableImageSender: variant source get failed bucket=") + bucket +
+                      " key=" + plan.objectKey + " err=" + fetched.error);
+            co_return nullptr;
+        }
+        auto rendered = co_await thumbnails.renderVariant(source, plan.side, plan.format);
+        if (!rendered)
+        {
+            LOG_WARNING(std::string("TableImageSender: variant not rendered key=") + plan.objectKey +
+                        " side=" + std::to_string(plan.side));
+            co_return nullptr;
+        }
+        bytes = std::move(rendered->bytes);
+
+        // Параллельные первые запросы могут записать вариант дважды — объект тот же.
+        std::vector<IObjectStorage::PutJob> jobs(1);
+        jobs[0].bucket = bucket;
+        jobs[0].objectKey = plan.derivedKey;
+        jobs[0].contentType = ImageTranscoder::mimeType(plan.format);
+        jobs[0].data = bytes.data();
+        jobs[0].size = bytes.size();
+        const auto results = co_await storage.putAll(jobs);
+        if (results.empty() || !results.front().ok)
+        {
+            LOG_WARNING(std::string("TableImageSender: variant put failed key=") + plan.derivedKey +
+                        " err=" + (results.empty() ? std::string("no result") : results.front().error));
+        }
+    }
+
+    if (prefetch)
+    {
+        co_return prefetch->remember(plan.derivedKey, std::move(bytes), ImageTranscoder::mimeType(plan.format));
+    }
+    auto entry = std::make_shared<ThumbnailCache::Entry>();
+    entry->bytes = std::move(bytes);
+    entry->mimeType = ImageTranscoder::mimeType(plan.format);
+    co_return entry;
+}
+
+// Таблица по nodeId (mapping images-by-slot) и проверка, что dbName — image_*-колонка.
+// При ошибке возвращает готовый ответ, иначе nullptr и заполняет baseTable/imagesTable.
+drogon::Task<drogon::HttpResponsePtr> resolveImageColumn(int nodeId,
+                                                         const std::string &dbName,
+                                                         const std::string &peerIp,
+                                                         std::string &baseTable,
+                                                         std::string &imagesTable)
+{
+    using namespace drogon;
+
+    if (!tryGetTableNameById(nodeId, baseTable))
+    {
+        LOG_WARNING(std::string("TableImageSender: invalid nodeId from ") + peerIp + " nodeId=" + std::to_string(nodeId));
+        co_return makeJsonResponse(makeErrorMessage("Invalid nodeId"), k400BadRequest);
+    }
+    baseTable = resolveBaseTable(baseTable);
+    auto itImages = kTableMinioBySlot.find(baseTable);
+    if (itImages == kTableMinioBySlot.end())
+    {
+        LOG_WARNING(std::string("TableImageSender: mapping not found baseTable=") + baseTable);
+        co_return makeJsonResponse(makeErrorMessage("Images table mapping not found"), k400BadRequest);
+    }
+    imagesTable = itImages->second;
+    if (!isSafeIdentifier(baseTable) || !isSafeIdentifier(imagesTable))
+    {
+        LOG_ERROR(std::string("TableImageSender: unsafe identifiers baseTable=") + baseTable + " imagesTable=" + imagesTable);
+        co_return makeJsonResponse(makeErrorMessage("Unsafe table identifier"), k500InternalServerError);
+    }
+
+    // dbName должен быть image_*-колонкой таблицы (TableInfoCache).
+    bool dbNameFound = false;
+    try
+    {
+        auto cache = app().getPlugin<TableInfoCache>();
+        if (!cache)
+        {
+            LOG_ERROR("TableImageSender: TableInfoCache is not initialized");
+            co_return makeJsonResponse(makeErrorMessage("TableInfoCache is not initialized"), k500InternalServerError);
+        }
+        auto colsPtr = co_await cache->getColumns(baseTable);
+        if (!colsPtr || !colsPtr->isArray())
+        {
+            LOG_ERROR(std::string("TableImageSender: invalid columns from TableInfoCache table=") + baseTable);
+            co_return makeJsonResponse(makeErrorMessage("TableInfoCache returned invalid columns"), k500InternalServerError);
+        }
+        for (const auto &c : *colsPtr)
+        {
+            if (!c.isObject() || !c.isMember("name") || !c["name"].isString())
+                continue;
+            const std::string name = c["name"].asString();
+            if (name.rfind("image_", 0) == 0 && isSafeIdentifier(name))
+            {
+                if (name == dbName)
+                {
+                    dbNameFound = true;
+                    break;
+                }
+            }
+        }
+    }
+    catch (const std::exception &)
+    {
+        LOG_ERROR(std::string("TableImageSender: exception while loading columns table=") + baseTable);
+        co_return makeJsonResponse(makeErrorMessage("Failed to load table columns"), k500InternalServerError);
+    }
+    if (!dbNameFound)
+    {
+        LOG_WARNING(std::string("TableImageSender: dbName not found in table=") + baseTable + " dbName=" + dbName);
+        co_return makeJsonResponse(makeErrorMessage("dbName is not an image column"), k400BadRequest);
+    }
+    co_return nullptr;
+}
+
 } // namespace
 
 drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::HttpRequestPtr req)
@@ -312,11 +706,35 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
         LOG_WARNING(std::string("TableImageSender: missing/invalid nodeId from ") + peerIp);
         co_return makeJsonResponse(makeErrorMessage("Missing or invalid nodeId"), k400BadRequest);
     }
-    if (!rootReq.isMember("small") || !rootReq["small"].isBool())
+    // maxSide/format включают выбор варианта; small тогда необязателен.
+    const bool variantRequested = rootReq.isMember("maxSide") || rootReq.isMember("format");
+    const bool hasSmall = rootReq.isMember("small") && rootReq["small"].isBool();
+    if (!hasSmall && (!variantRequested || rootReq.isMember("small")))
     {
         LOG_WARNING(std::string("TableImageSender: missing/invalid small from ") + peerIp);
         co_return makeJsonResponse(makeErrorMessage("Missing or invalid small"), k400BadRequest);
     }
+    int maxSide = 0;
+    if (rootReq.isMember("maxSide"))
+    {
+        if (!rootReq["maxSide"].isInt() || rootReq["maxSide"].asInt() <= 0)
+        {
+            LOG_WARNING(std::string("TableImageSender: invalid maxSide from ") + peerIp);
+            co_return makeJsonResponse(makeErrorMessage("Invalid maxSide"), k400BadRequest);
+        }
+        maxSide = rootReq["maxSide"].asInt();
+    }
+    std::optional<ImageTranscoder::Format> requestedFormat;
+    if (rootReq.isMember("format"))
+    {
+        ImageTranscoder::Format format;
+        if (!rootReq["format"].isString() || !ImageTranscoder::parseFormat(rootReq["format"].asString(), format))
+        {
+            LOG_WARNING(std::string("TableImageSender: invalid format from ") + peerIp);
+            co_return makeJsonResponse(makeErrorMessage("Invalid format"), k400BadRequest);
+        }
+        requestedFormat = format;
+    }
     if (!rootReq.isMember("rowId"))
     {
         LOG_WARNING(std::string("TableImageSender: missing rowId from ") + peerIp);
@@ -329,7 +747,7 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
     }
 
     const int nodeId = rootReq["nodeId"].asInt(); // 1-based
-    const bool small = rootReq["small"].asBool();
+    const bool small = hasSmall && rootReq["small"].asBool();
     if (nodeId <= 0)
     {
         LOG_WARNING(std::string("TableImageSender: invalid nodeId from ") + peerIp + " nodeId=" + std::to_string(nodeId));
@@ -362,76 +780,22 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
         reason = sanitizeHeaderValue(rootReq["reason"].asString());
     }
 
+    // 3) Таблица по nodeId и проверка dbName через TableInfoCache
     std::string baseTable;
-    if (!tryGetTableNameById(nodeId, baseTable))
+    std::string imagesTable;
+    if (auto errResp = co_await resolveImageColumn(nodeId, dbName, peerIp, baseTable, imagesTable))
     {
-        LOG_WARNING(std::string("TableImageSender: invalid nodeId from ") + peerIp + " nodeId=" + std::to_string(nodeId));
-        co_return makeJsonResponse(makeErrorMessage("Invalid nodeId"), k400BadRequest);
-    }
-    baseTable = resolveBaseTable(baseTable);
-    auto itImages = kTableMinioBySlot.find(baseTable);
-    if (itImages == kTableMinioBySlot.end())
-    {
-        LOG_WARNING(std::string("TableImageSender: mapping not found baseTable=") + baseTable);
-        co_return makeJsonResponse(makeErrorMessage("Images table mapping not found"), k400BadRequest);
-    }
-    const std::string imagesTable = itImages->second;
-    if (!isSafeIdentifier(baseTable) || !isSafeIdentifier(imagesTable))
-    {
-        LOG_ERROR(std::string("TableImageSender: unsafe identifiers baseTable=") + baseTable + " imagesTable=" + imagesTable);
-        co_return makeJsonResponse(makeErrorMessage("Unsafe table identifier"), k500InternalServerError);
+        co_return errResp;
     }
 
-    // 3) Validate dbName via TableInfoCache
-    bool dbNameFound = false;
-    try
-    {
-        auto cache = app().getPlugin<TableInfoCache>();
-        if (!cache)
-        {
-            LOG_ERROR("TableImageSender: TableInfoCache is not initialized");
-            co_return makeJsonResponse(makeErrorMessage("TableInfoCache is not initialized"), k500InternalServerError);
-        }
-        auto colsPtr = co_await cache->getColumns(baseTable);
-        if (!colsPtr || !colsPtr->isArray())
-        {
-            LOG_ERROR(std::string("TableImageSender: invalid columns from TableInfoCache table=") + baseTable);
-            co_return makeJsonResponse(makeErrorMessage("TableInfoCache returned invalid columns"), k500InternalServerError);
-        }
-        for (const auto &c : *colsPtr)
-        {
-            if (!c.isObject() || !c.isMember("name") || !c["name"].isString())
-                continue;
-            const std::string name = c["name"].asString();
-            if (name.rfind("image_", 0) == 0 && isSafeIdentifier(name))
-            {
-                if (name == dbName)
-                {
-                    dbNameFound = true;
-                    break;
-                }
-            }
-        }
-    }
-    catch (const std::exception &)
-    {
-        LOG_ERROR(std::string("TableImageSender: exception while loading columns table=") + baseTable);
-        co_return makeJsonResponse(makeErrorMessage("Failed to load table columns"), k500InternalServerError);
-    }
-    if (!dbNameFound)
-    {
-        LOG_WARNING(std::string("TableImageSender: dbName not found in table=") + baseTable + " dbName=" + dbName);
-        co_return makeJsonResponse(makeErrorMessage("dbName is not an image column"), k400BadRequest);
-    }
-
-    // 4) Query baseTable: id + dbName
+    // 4) Query baseTable + imagesTable одним запросом (LEFT JOIN по ссылке слота).
+    // LEFT JOIN сохраняет различие "строки нет" / "картинки нет".
+    ImageMeta meta;
     int64_t imageId = 0;
     try
     {
         auto dbClient = app().getDbClient("default");
-        std::string sql = "SELECT " + quoteIdent("id") + ", " + quoteIdent(dbName) +
-                          " FROM " + quoteIdent("public") + "." + quoteIdent(baseTable) +
-                          " WHERE " + quoteIdent("id") + " = $1";
+        const std::string &sql = imageMetaSql(baseTable, imagesTable, dbName);
         auto binder = (*dbClient << sql);
         binder << rowId;
         const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
@@ -441,7 +805,7 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
             co_return makeJsonResponse(makeErrorMessage("Row not found"), k404NotFound);
         }
         const auto &r = result[0];
-        const auto f = r[dbName];
+        const auto f = r["image_ref"];
         if (f.isNull())
         {
             LOG_WARNING(std::string("TableImageSender: image id is null rowId=") + std::to_string(rowId) + " dbName=" + dbName);
@@ -453,70 +817,19 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
             LOG_WARNING(std::string("TableImageSender: invalid image id rowId=") + std::to_string(rowId) + " dbName=" + dbName);
             co_return makeJsonResponse(makeErrorMessage("Image not found"), k404NotFound);
         }
-    }
-    catch (const DrogonDbException &)
-    {
-        LOG_ERROR(std::string("TableImageSender: db error while querying base table=") + baseTable);
-        co_return makeJsonResponse(makeErrorMessage("db error"), k500InternalServerError);
-    }
-
-    // 5) Query imagesTable metadata
-    struct ImageMeta
-    {
-        int64_t id{};
-        std::string slot;
-        std::string bigObjectKey;
-        std::string bigMime;
-        std::string smallObjectKey;
-        std::string smallMime;
-        std::string linkName;
-        std::string linkUrl;
-    };
-    ImageMeta meta;
-    bool metaFound = false;
-    try
-    {
-        auto dbClient = app().getDbClient("default");
-        const std::string sql =
-            "SELECT id, slot, big_object_key, big_mime_type, small_object_key, small_mime_type, link_name, link_url "
-            "FROM " +
-            quoteIdent("public") + "." + quoteIdent(imagesTable) +
-            " WHERE id = $1";
-        auto binder = (*dbClient << sql);
-        binder << imageId;
-        const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
-        if (!result.empty())
-        {
-            const auto &r = result[0];
-            meta.id = r["id"].as<int64_t>();
-            if (!r["slot"].isNull())
-                meta.slot = r["slot"].as<std::string>();
-            if (!r["big_object_key"].isNull())
-                meta.bigObjectKey = r["big_object_key"].as<std::string>();
-            if (!r["big_mime_type"].isNull())
-                meta.bigMime = r["big_mime_type"].as<std::string>();
-            if (!r["small_object_key"].isNull())
-                meta.smallObjectKey = r["small_object_key"].as<std::string>();
-            if (!r["small_mime_type"].isNull())
-                meta.smallMime = r["small_mime_type"].as<std::string>();
-            if (!r["link_name"].isNull())
-                meta.linkName = r["link_name"].as<std::string>();
-            if (!r["link_url"].isNull())
-                meta.linkUrl = r["link_url"].as<std::string>();
-            metaFound = true;
+        if (r["id"].isNull())
+        {
+            LOG_WARNING(std::string("TableImageSender: image meta not found imagesTable=") + imagesTable +
+                        " imageId=" + std::to_string(imageId) + " rowId=" + std::to_string(rowId) + " dbName=" + dbName);
+            co_return makeJsonResponse(makeErrorMessage("Image not found"), k404NotFound);
         }
+        meta = readImageMeta(r);
     }
     catch (const DrogonDbException &)
     {
-        LOG_ERROR(std::string("TableImageSender: db error while querying images table=") + imagesTable);
+        LOG_ERROR(std::string("TableImageSender: db error while querying table=") + baseTable + " imagesTable=" + imagesTable);
         co_return makeJsonResponse(makeErrorMessage("db error"), k500InternalServerError);
     }
-    if (!metaFound)
-    {
-        LOG_WARNING(std::string("TableImageSender: image meta not found imagesTable=") + imagesTable +
-                    " imageId=" + std::to_string(imageId) + " rowId=" + std::to_string(rowId) + " dbName=" + dbName);
-        co_return makeJsonResponse(makeErrorMessage("Image not found"), k404NotFound);
-    }
     if (!meta.slot.empty() && meta.slot != dbName)
     {
         LOG_WARNING(std::string("TableImageSender: slot mismatch rowId=") + std::to_string(rowId) +
@@ -526,7 +839,26 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
 
     std::string objectKey;
     std::string mime;
-    if (small)
+    VariantPlan variant;
+    if (variantRequested)
+    {
+        if (meta.bigObjectKey.empty() && meta.smallObjectKey.empty())
+        {
+            LOG_WARNING(std::string("TableImageSender: no stored objects rowId=") + std::to_string(rowId) +
+                        " dbName=" + dbName + " imageId=" + std::to_string(imageId));
+            co_return makeJsonResponse(makeErrorMessage("Image not found"), k404NotFound);
+        }
+        variant = planVariant(meta,
+                              small,
+                              maxSide,
+                              requestedFormat,
+                              req->getHeader("accept"),
+                              baseTable,
+                              app().getPlugin<ThumbnailPlugin>());
+        objectKey = variant.objectKey;
+        mime = variant.mime;
+    }
+    else if (small)
     {
         if (meta.smallObjectKey.empty())
         {
@@ -549,29 +881,114 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
         mime = meta.bigMime;
     }
 
-    // 6) MinIO fetch + multipart build
+    // 5) Storage fetch + multipart build
     auto minioPlugin = app().getPlugin<MinioPlugin>();
-    if (!minioPlugin)
+    auto storagePlugin = app().getPlugin<StoragePlugin>();
+    if (!minioPlugin || !storagePlugin)
     {
-        LOG_ERROR("TableImageSender: MinioPlugin is not initialized");
-        co_return makeJsonResponse(makeErrorMessage("MinioPlugin is not initialized"), k500InternalServerError);
+        LOG_ERROR("TableImageSender: MinioPlugin/StoragePlugin is not initialized");
+        co_return makeJsonResponse(makeErrorMessage("Storage is not initialized"), k500InternalServerError);
     }
-    MinioClient &minio = minioPlugin->client();
+    IObjectStorage &storage = storagePlugin->storage();
     const auto &cfg = minioPlugin->minioConfig();
     const std::string bucket = cfg.bucket;
+    std::string etag;
+
+    // Производный вариант отдаётся целиком: Range к нему не применяется.
+    // Если вариант построить нельзя, ниже отдаётся исходный объект.
+    std::shared_ptr<const ThumbnailCache::Entry> derived;
+    if (!variant.derivedKey.empty())
+    {
+        auto prefetch = app().getPlugin<ImagePrefetchPlugin>();
+        derived = co_await loadDerivedVariant(storage,
+                                              bucket,
+                                              variant,
+                                              *app().getPlugin<ThumbnailPlugin>(),
+                                              (prefetch && prefetch->enabled()) ? prefetch : nullptr);
+        if (derived)
+        {
+            objectKey = variant.derivedKey;
+            mime = derived->mimeType;
+        }
+    }
+
+    // Range: отдаём только запрошенный диапазон (докачка после обрыва, прогрессивный просмотр).
+    // If-Range с устаревшим ETag означает, что объект сменился — тогда отдаём его целиком.
+    const std::string rangeHeader = derived ? std::string() : req->getHeader("range");
+    std::optional<ByteRange> range;
+    std::string contentRange;
+    if (!rangeHeader.empty())
+    {
+        IObjectStorage::ObjectStat info;
+        const IObjectStorage::Status stat = co_await storage.stat(bucket, objectKey, info);
+        if (!stat)
+        {
+            LOG_ERROR(std::string("TableImageSender: storage stat failed bucket=") + bucket +
+                      " key=" + objectKey + " err=" + stat.error);
+            co_return makeJsonResponse(makeErrorMessage("Image not found"), k404NotFound);
+        }
+        const std::string ifRange = req->getHeader("if-range");
+        const bool rangeValid = ifRange.empty() || ifRange == info.etag || ifRange == "\"" + info.etag + "\"";
+        ByteRange parsed;
+        const RangeParse parse = rangeValid ? parseRangeHeader(rangeHeader, info.size, parsed) : RangeParse::None;
+        if (parse == RangeParse::Unsatisfiable)
+        {
+            LOG_WARNING(std::string("TableImageSender: unsatisfiable range from ") + peerIp + " range=" + rangeHeader +
+                        " size=" + std::to_string(info.size));
+            auto resp = makeJsonResponse(makeErrorMessage("Requested range not satisfiable"), k416RequestedRangeNotSatisfiable);
+            resp->addHeader("Content-Range", "bytes */" + std::to_string(info.size));
+            co_return resp;
+        }
+        if (parse == RangeParse::Ok)
+        {
+            range = parsed;
+            contentRange = "bytes " + std::to_string(parsed.offset) + "-" +
+                           std::to_string(parsed.offset + parsed.length - 1) + "/" + std::to_string(info.size);
+        }
+        if (!info.etag.empty())
+        {
+            etag = info.etag;
+        }
+    }
+
+    // Превью целиком — сначала из кэша прогрева (ImagePrefetchPlugin), промах дополняет кэш.
+    auto prefetch = (small && !range && !derived) ? app().getPlugin<ImagePrefetchPlugin>() : nullptr;
+    if (prefetch && !prefetch->enabled())
+    {
+        prefetch = nullptr;
+    }
+    std::shared_ptr<const ThumbnailCache::Entry> cached = derived ? derived : nullptr;
+    if (!cached && prefetch)
+    {
+        cached = prefetch->lookup(objectKey);
+    }
 
     std::vector<uint8_t> bytes;
-    std::string mimeFromMinio;
-    const bool ok = minio.getObject(bucket, objectKey, bytes, &mimeFromMinio);
-    if (!ok)
+    std::string mimeFromStorage;
+    if (cached)
     {
-        LOG_ERROR(std::string("TableImageSender: MinIO getObject failed bucket=") + bucket +
-                  " key=" + objectKey + " err=" + minio.lastError());
-        co_return makeJsonResponse(makeErrorMessage("Image not found"), k404NotFound);
+        mimeFromStorage = cached->mimeType;
+    }
+    else
+    {
+        const IObjectStorage::Status fetched =
+            range ? co_await storage.getRange(bucket, objectKey, range->offset, range->length, bytes, &mimeFromStorage)
+                  : co_await storage.get(bucket, objectKey, bytes, &mimeFromStorage);
+        if (!fetched)
+        {
+            LOG_ERROR(std::string("TableImageSender: storage get failed bucket=") + bucket +
+                      " key=" + objectKey + " err=" + fetched.error);
+            co_return makeJsonResponse(makeErrorMessage("Image not found"), k404NotFound);
+        }
+        if (prefetch)
+        {
+            cached = prefetch->remember(objectKey, std::move(bytes), mimeFromStorage);
+        }
     }
-    if (mime.empty() && !mimeFromMinio.empty())
+    const std::vector<uint8_t> &payload = cached ? cached->bytes : bytes;
+    if (mime.empty() && !mimeFromStorage.empty())
     {
-        mime = mimeFromMinio;
+        mime = mimeFromStorage;
     }
     mime = normalizeImageMime(mime, objectKey);
 
@@ -579,7 +996,15 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
     std::string multipartBody;
     multipartBody.reserve(1024);
 
-    const std::string filename = basenameFromKey(objectKey);
+    std::string filename = basenameFromKey(objectKey);
+    if (derived)
+    {
+        // "<исходное имя>_<side>.<ext>" вместо "<side>.<ext>" из ключа варианта.
+        const std::string source = basenameFromKey(variant.objectKey);
+        const auto dot = source.find_last_of('.');
+        filename = (dot == std::string::npos ? source : source.substr(0, dot)) + "_" + std::to_string(variant.side) +
+                   "." + ImageTranscoder::extension(variant.format);
+    }
     appendBinaryPart(multipartBody,
                      boundary,
                      static_cast<int64_t>(rowId),
@@ -589,7 +1014,8 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
                      reason,
                      meta.linkName,
                      meta.linkUrl,
-                     bytes);
+                     contentRange,
+                     payload);
 
     // Финальная JSON-часть: ok=true, errors=[]
     Json::Value okJson(Json::objectValue);
@@ -602,8 +1028,257 @@ drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImages(drogon::H
     multipartBody += "--\r\n";
 
     auto resp = HttpResponse::newHttpResponse();
-    resp->setStatusCode(k200OK);
+    resp->setStatusCode(range ? k206PartialContent : k200OK);
     resp->setContentTypeString("multipart/mixed; boundary=" + boundary);
+    resp->addHeader("Accept-Ranges", "bytes");
+    if (range)
+    {
+        // Конверт multipart остаётся прежним; диапазон относится к бинарной части.
+        resp->addHeader("Content-Range", contentRange);
+    }
+    if (!etag.empty())
+    {
+        resp->addHeader("ETag", "\"" + etag + "\"");
+    }
+    if (variantRequested && !requestedFormat)
+    {
+        // Формат выбран по Accept.
+        resp->addHeader("Vary", "Accept");
+    }
     resp->setBody(std::move(multipartBody));
     co_return resp;
 }
+
+drogon::Task<drogon::HttpResponsePtr> TableImageSender::getTableImageUrls(drogon::HttpRequestPtr req)
+{
+    using namespace drogon;
+    using namespace drogon::orm;
+
+    // Ограничение на страницу: одна подпись — локальный HMAC, но ответ и SQL растут линейно.
+    constexpr Json::ArrayIndex kMaxRowsPerRequest = 500;
+
+    const std::string peerIp = req ? req->getPeerAddr().toIp() : std::string();
+
+    // 1) Auth (token header)
+    const std::string token = req->getHeader("token");
+    TokenValidator validator;
+    const auto status = co_await validator.check(token, req->getPeerAddr().toIp());
+    if (status != TokenValidator::Status::Ok)
+    {
+        const auto httpCode = TokenValidator::toHttpCode(status);
+        const std::string msg = TokenValidator::toError(status);
+        const std::string code = (httpCode == k401Unauthorized) ? "unauthorized" : "internal";
+        LOG_WARNING(std::string("TableImageSender: auth failed from ") + peerIp + " code=" + code + " message=" + msg);
+        co_return makeJsonResponse(makeErrorMessage(msg), httpCode);
+    }
+
+    auto minioPlugin = app().getPlugin<MinioPlugin>();
+    if (!minioPlugin)
+    {
+        LOG_ERROR("TableImageSender: MinioPlugin is not initialized");
+        co_return makeJsonResponse(makeErrorMessage("MinioPlugin is not initialized"), k500InternalServerError);
+    }
+    // Presigned-ссылки подписывает только MinIO: при локальном backend режим недоступен.
+    auto storagePlugin = app().getPlugin<StoragePlugin>();
+    if (!minioPlugin->presignEnabled() || (storagePlugin && !storagePlugin->isMinio()))
+    {
+        LOG_WARNING(std::string("TableImageSender: presigned URLs are disabled, request from ") + peerIp);
+        co_return makeJsonResponse(makeErrorMessage("Presigned URLs are disabled"), k404NotFound);
+    }
+
+    // 2) Parse JSON body
+    Json::Value rootReq;
+    {
+        const std::string body(req->body());
+        if (body.empty())
+        {
+            LOG_WARNING(std::string("TableImageSender: empty body from ") + peerIp);
+            co_return makeJsonResponse(makeErrorMessage("Empty request body"), k400BadRequest);
+        }
+        Json::Reader reader;
+        if (!reader.parse(body, rootReq) || !rootReq.isObject())
+        {
+            LOG_WARNING(std::string("TableImageSender: invalid JSON body from ") + peerIp);
+            co_return makeJsonResponse(makeErrorMessage("Invalid JSON body"), k400BadRequest);
+        }
+    }
+
+    if (!rootReq.isMember("nodeId") || !rootReq["nodeId"].isInt() || rootReq["nodeId"].asInt() <= 0)
+    {
+        LOG_WARNING(std::string("TableImageSender: missing/invalid nodeId from ") + peerIp);
+        co_return makeJsonResponse(makeErrorMessage("Missing or invalid nodeId"), k400BadRequest);
+    }
+    if (!rootReq.isMember("small") || !rootReq["small"].isBool())
+    {
+        LOG_WARNING(std::string("TableImageSender: missing/invalid small from ") + peerIp);
+        co_return makeJsonResponse(makeErrorMessage("Missing or invalid small"), k400BadRequest);
+    }
+    if (!rootReq.isMember("dbName") || !rootReq["dbName"].isString())
+    {
+        LOG_WARNING(std::string("TableImageSender: missing/invalid dbName from ") + peerIp);
+        co_return makeJsonResponse(makeErrorMessage("Missing or invalid dbName"), k400BadRequest);
+    }
+    if (!rootReq.isMember("rowIds") || !rootReq["rowIds"].isArray() || rootReq["rowIds"].empty())
+    {
+        LOG_WARNING(std::string("TableImageSender: missing/invalid rowIds from ") + peerIp);
+        co_return makeJsonResponse(makeErrorMessage("Missing or invalid rowIds"), k400BadRequest);
+    }
+    if (rootReq["rowIds"].size() > kMaxRowsPerRequest)
+    {
+        LOG_WARNING(std::string("TableImageSender: too many rowIds from ") + peerIp +
+                    " count=" + std::to_string(rootReq["rowIds"].size()));
+        co_return makeJsonResponse(makeErrorMessage("Too many rowIds (max " + std::to_string(kMaxRowsPerRequest) + ")"),
+                                   k400BadRequest);
+    }
+
+    const int nodeId = rootReq["nodeId"].asInt();
+    const bool small = rootReq["small"].asBool();
+    const std::string dbName = rootReq["dbName"].asString();
+    if (dbName.empty() || dbName.rfind("image_", 0) != 0 || !isSafeIdentifier(dbName))
+    {
+        LOG_WARNING(std::string("TableImageSender: invalid dbName from ") + peerIp + " dbName=" + dbName);
+        co_return makeJsonResponse(makeErrorMessage("Invalid dbName"), k400BadRequest);
+    }
+
+    // Порядок ответа — порядок rowIds запроса; повторы отдаются один раз.
+    std::vector<int64_t> rowIds;
+    std::unordered_set<int64_t> seen;
+    std::string rowIdsArray;
+    for (const auto &v : rootReq["rowIds"])
+    {
+        const auto parsed = parseRowId(v);
+        if (!parsed.has_value() || *parsed > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()))
+        {
+            LOG_WARNING(std::string("TableImageSender: invalid rowId in rowIds from ") + peerIp);
+            co_return makeJsonResponse(makeErrorMessage("Invalid rowId in rowIds"), k400BadRequest);
+        }
+        const int64_t id = static_cast<int64_t>(*parsed);
+        if (!seen.insert(id).second)
+        {
+            continue;
+        }
+        rowIds.push_back(id);
+        rowIdsArray += (rowIdsArray.empty() ? "" : ",") + std::to_string(id);
+    }
+
+    // 3) Таблица по nodeId и проверка dbName через TableInfoCache
+    std::string baseTable;
+    std::string imagesTable;
+    if (auto errResp = co_await resolveImageColumn(nodeId, dbName, peerIp, baseTable, imagesTable))
+    {
+        co_return errResp;
+    }
+
+    // 4) Метаданные всей страницы одним запросом
+    std::unordered_map<int64_t, std::optional<ImageMeta>> metaByRow;
+    try
+    {
+        auto dbClient = app().getDbClient("default");
+        const std::string &sql = imageMetaSql(baseTable, imagesTable, dbName, true);
+        auto binder = (*dbClient << sql);
+        binder << ("{" + rowIdsArray + "}");
+        const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+        for (const auto &r : result)
+        {
+            std::optional<ImageMeta> meta;
+            if (!r["image_ref"].isNull() && !r["id"].isNull())
+            {
+                meta = readImageMeta(r);
+            }
+            metaByRow[r["row_id"].as<int64_t>()] = std::move(meta);
+        }
+    }
+    catch (const DrogonDbException &)
+    {
+        LOG_ERROR(std::string("TableImageSender: db error while querying table=") + baseTable + " imagesTable=" + imagesTable);
+        co_return makeJsonResponse(makeErrorMessage("db error"), k500InternalServerError);
+    }
+
+    // 5) Подписи (из кэша, пока до истечения далеко)
+    const std::string bucket = minioPlugin->minioConfig().bucket;
+    Json::Value items(Json::arrayValue);
+    Json::Value errors(Json::arrayValue);
+    auto addError = [&errors](int64_t rowId, const std::string &message) {
+        Json::Value e(Json::objectValue);
+        e["rowId"] = static_cast<Json::Int64>(rowId);
+        e["message"] = message;
+        errors.append(e);
+    };
+    struct Signable
+    {
+        int64_t rowId = 0;
+        const ImageMeta *meta = nullptr;
+    };
+    std::vector<Signable> signable;
+    std::vector<std::string> objectKeys;
+    signable.reserve(rowIds.size());
+    objectKeys.reserve(rowIds.size());
+    for (const int64_t rowId : rowIds)
+    {
+        auto it = metaByRow.find(rowId);
+        if (it == metaByRow.end())
+        {
+            addError(rowId, "Row not found");
+            continue;
+        }
+        if (!it->second.has_value())
+        {
+            addError(rowId, "Image not found");
+            continue;
+        }
+        const ImageMeta &meta = *it->second;
+        if (!meta.slot.empty() && meta.slot != dbName)
+        {
+            LOG_WARNING(std::string("TableImageSender: slot mismatch rowId=") + std::to_string(rowId) +
+                        " dbName=" + dbName + " meta.slot=" + meta.slot);
+            addError(rowId, "Image slot mismatch");
+            continue;
+        }
+        const std::string &objectKey = small ? meta.smallObjectKey : meta.bigObjectKey;
+        if (objectKey.empty())
+        {
+            addError(rowId, small ? "Small image not found" : "Image not found");
+            continue;
+        }
+        signable.push_back(Signable{rowId, &meta});
+        objectKeys.push_back(objectKey);
+    }
+
+    // Промахи кэша подписываются одним заходом на потоки хранилища, а не на IO-потоке.
+    const auto presigned = co_await minioPlugin->presignedUrls(bucket, objectKeys);
+    for (size_t i = 0; i < signable.size(); ++i)
+    {
+        const int64_t rowId = signable[i].rowId;
+        const ImageMeta &meta = *signable[i].meta;
+        const std::string &objectKey = objectKeys[i];
+        if (!presigned[i])
+        {
+            LOG_ERROR(std::string("TableImageSender: presign failed bucket=") + bucket + " key=" + objectKey);
+            addError(rowId, "Failed to sign image URL");
+            continue;
+        }
+
+        Json::Value item(Json::objectValue);
+        item["rowId"] = static_cast<Json::Int64>(rowId);
+        item["url"] = presigned[i]->url;
+        item["expiresAt"] = static_cast<Json::Int64>(
+            std::chrono::duration_cast<std::chrono::seconds>(presigned[i]->expiresAt.time_since_epoch()).count());
+        item["mimeType"] = normalizeImageMime(small ? meta.smallMime : meta.bigMime, objectKey);
+        item["filename"] = basenameFromKey(objectKey);
+        if (!meta.linkName.empty())
+        {
+            item["linkName"] = meta.linkName;
+        }
+        if (!meta.linkUrl.empty())
+        {
+            item["linkUrl"] = meta.linkUrl;
+        }
+        items.append(item);
+    }
+
+    Json::Value root(Json::objectValue);
+    root["ok"] = true;
+    root["items"] = items;
+    root["errors"] = errors;
+    co_return makeJsonResponse(root, k200OK);
+}
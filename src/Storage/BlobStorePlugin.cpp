@@ -0,0 +1,360 @@
+#include "Storage/BlobStorePlugin.h"
+
+#include <drogon/drogon.h>
+
+#include "Storage/StoragePlugin.h"
+#include "Loger/Logger.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace
+{
+constexpr const char *kBlobPrefix = "blobs/";
+
+// Отметка сборки мусора старше этого считается брошенной (проход упал между шагами).
+constexpr int kGcStaleMinutes = 10;
+
+// reserve() ждёт окончания сборки помеченных блобов: попытки и пауза между ними.
+constexpr int kReserveAttempts = 25;
+constexpr double kReserveRetrySeconds = 0.2;
+
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+/// Схлопнуть повторы одного ключа и упорядочить: строки блокируются в одном порядке
+/// во всех запросах, что исключает взаимные блокировки.
+std::vector<BlobStorePlugin::BlobRef> mergeRefs(const std::vector<BlobStorePlugin::BlobRef> &refs)
+{
+    std::map<std::pair<std::string, std::string>, int64_t> merged;
+    for (const auto &ref : refs)
+    {
+        merged[{ref.bucket, ref.objectKey}] += ref.count;
+    }
+    std::vector<BlobStorePlugin::BlobRef> out;
+    out.reserve(merged.size());
+    for (const auto &kv : merged)
+    {
+        out.push_back(BlobStorePlugin::BlobRef{kv.first.first, kv.first.second, kv.second});
+    }
+    return out;
+}
+
+/// UPDATE по списку (bucket, object_key, cnt): $1.. — тройки параметров.
+std::string refsUpdateSql(const std::string &setExpr, size_t count, const std::string &extraWhere = {})
+{
+    std::string sql = "UPDATE public.storage_blobs AS b SET " + setExpr + ", updated_at = now() FROM (VALUES ";
+    int param = 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            sql += ", ";
+        }
+        sql += "($" + std::to_string(param) + ", $" + std::to_string(param + 1) + ", $" +
+               std::to_string(param + 2) + "::bigint)";
+        param += 3;
+    }
+    sql += ") AS v(bucket, object_key, cnt) WHERE b.bucket = v.bucket AND b.object_key = v.object_key";
+    sql += extraWhere;
+    return sql;
+}
+} // namespace
+
+void BlobStorePlugin::initAndStart(const Json::Value &config)
+{
+    if (config.isMember("enabled") && config["enabled"].isBool())
+    {
+        enabled_ = config["enabled"].asBool();
+    }
+    if (config.isMember("grace_minutes") && config["grace_minutes"].isInt())
+    {
+        graceMinutes_ = clampPositiveInt(config["grace_minutes"].asInt(), graceMinutes_);
+    }
+    if (config.isMember("batch_size") && config["batch_size"].isInt())
+    {
+        batchSize_ = clampPositiveInt(config["batch_size"].asInt(), batchSize_);
+    }
+
+    int intervalMinutes = 10;
+    if (config.isMember("interval_minutes") && config["interval_minutes"].isInt())
+    {
+        intervalMinutes = clampPositiveInt(config["interval_minutes"].asInt(), intervalMinutes);
+    }
+
+    // Сборка мусора работает и при выключенной дедупликации: ссылки на уже записанные
+    // блобы продолжают освобождаться при удалении строк.
+    const double intervalSeconds = static_cast<double>(intervalMinutes) * 60.0;
+    timerId_ = drogon::app().getLoop()->runEvery(
+        intervalSeconds,
+        drogon::async_func([this]() -> drogon::Task<void> {
+            try
+            {
+                const int collected = co_await runOnce();
+                if (collected > 0)
+                {
+                    Logger::instance().info("BlobStorePlugin: collected unreferenced blobs=" + std::to_string(collected));
+                }
+            }
+            catch (const std::exception &e)
+            {
+                Logger::instance().error("BlobStorePlugin: runOnce failed: " + std::string(e.what()));
+            }
+            co_return;
+        }));
+}
+
+void BlobStorePlugin::shutdown()
+{
+    if (timerId_ != trantor::InvalidTimerId)
+    {
+        drogon::app().getLoop()->invalidateTimer(timerId_);
+        timerId_ = trantor::InvalidTimerId;
+    }
+}
+
+std::string BlobStorePlugin::objectKeyFor(const std::string &sha256)
+{
+    return std::string(kBlobPrefix) + sha256.substr(0, 2) + "/" + sha256;
+}
+
+bool BlobStorePlugin::isBlobKey(const std::string &objectKey)
+{
+    return objectKey.rfind(kBlobPrefix, 0) == 0;
+}
+
+drogon::Task<std::unordered_set<std::string>> BlobStorePlugin::reserve(const std::vector<Blob> &blobs)
+{
+    std::unordered_set<std::string> missing;
+    if (blobs.empty())
+    {
+        co_return missing;
+    }
+
+    std::map<std::pair<std::string, std::string>, const Blob *> pending;
+    for (const auto &blob : blobs)
+    {
+        pending.emplace(std::make_pair(blob.bucket, blob.objectKey), &blob);
+    }
+
+    auto dbClient = drogon::app().getDbClient("default");
+    for (int attempt = 0; attempt < kReserveAttempts && !pending.empty(); ++attempt)
+    {
+        if (attempt > 0)
+        {
+            co_await drogon::sleepCoro(drogon::app().getLoop(), kReserveRetrySeconds);
+        }
+
+        // Один INSERT на все блобы запроса. Для существующих строк продлевается updated_at,
+        // чтобы сборка мусора не забрала объект, пока запрос не дошёл до retain().
+        // Строка, помеченная сборкой мусора, не возвращается: её объект сейчас удаляется,
+        // повтор после удаления строки вставит её заново (и объект будет загружен).
+        std::string sql =
+            "INSERT INTO public.storage_blobs (bucket, object_key, sha256, size_bytes, mime_type) VALUES ";
+        int param = 1;
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            if (i > 0)
+            {
+                sql += ", ";
+            }
+            sql += "($" + std::to_string(param) + ", $" + std::to_string(param + 1) + ", $" +
+                   std::to_string(param + 2) + ", $" + std::to_string(param + 3) + ", $" +
+                   std::to_string(param + 4) + ")";
+            param += 5;
+        }
+        sql += " ON CONFLICT (bucket, object_key) DO UPDATE SET updated_at = now(), gc_started_at = NULL"
+               " WHERE storage_blobs.gc_started_at IS NULL"
+               "    OR storage_blobs.gc_started_at <= now() - interval '" + std::to_string(kGcStaleMinutes) + " minutes'"
+               " RETURNING bucket, object_key, ref_count";
+
+        auto binder = (*dbClient << sql);
+        for (const auto &kv : pending)
+        {
+            const Blob &blob = *kv.second;
+            binder << blob.bucket;
+            binder << blob.objectKey;
+            binder << blob.sha256;
+            binder << static_cast<int64_t>(blob.sizeBytes);
+            if (!blob.mimeType.empty())
+                binder << blob.mimeType;
+            else
+                binder << nullptr;
+        }
+        const auto rows = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+
+        // ref_count = 0: запись новая, либо объект мог быть уже удалён сборкой мусора
+        // после неудачного коммита — загружаем заново.
+        for (const auto &row : rows)
+        {
+            const std::string bucket = row["bucket"].as<std::string>();
+            const std::string objectKey = row["object_key"].as<std::string>();
+            pending.erase(std::make_pair(bucket, objectKey));
+            if (row["ref_count"].as<int64_t>() <= 0)
+            {
+                missing.insert(bucket + "/" + objectKey);
+            }
+        }
+    }
+
+    if (!pending.empty())
+    {
+        Logger::instance().error("BlobStorePlugin: blobs are still being collected count=" +
+                                 std::to_string(pending.size()));
+        throw std::runtime_error("Blob is being collected, retry later");
+    }
+    co_return missing;
+}
+
+drogon::Task<void> BlobStorePlugin::retain(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                           const std::vector<BlobRef> &refs)
+{
+    const auto merged = mergeRefs(refs);
+    if (merged.empty())
+    {
+        co_return;
+    }
+    auto binder = (*trans << refsUpdateSql("ref_count = b.ref_count + v.cnt",
+                                           merged.size(),
+                                           " AND b.gc_started_at IS NULL"));
+    for (const auto &ref : merged)
+    {
+        binder << ref.bucket;
+        binder << ref.objectKey;
+        binder << ref.count;
+    }
+    const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+    if (result.affectedRows() != merged.size())
+    {
+        Logger::instance().error("BlobStorePlugin: blob reservation expired expected=" +
+                                 std::to_string(merged.size()) +
+                                 " found=" + std::to_string(result.affectedRows()));
+        throw std::runtime_error("Blob reservation expired");
+    }
+    co_return;
+}
+
+drogon::Task<void> BlobStorePlugin::release(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                            const std::vector<BlobRef> &refs)
+{
+    const auto merged = mergeRefs(refs);
+    if (merged.empty())
+    {
+        co_return;
+    }
+    auto binder = (*trans << refsUpdateSql("ref_count = GREATEST(b.ref_count - v.cnt, 0)", merged.size()));
+    for (const auto &ref : merged)
+    {
+        binder << ref.bucket;
+        binder << ref.objectKey;
+        binder << ref.count;
+    }
+    const auto result = co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+    if (result.affectedRows() != merged.size())
+    {
+        Logger::instance().warning("BlobStorePlugin: release for unknown blobs expected=" +
+                                   std::to_string(merged.size()) +
+                                   " found=" + std::to_string(result.affectedRows()));
+    }
+    co_return;
+}
+
+drogon::Task<int> BlobStorePlugin::runOnce()
+{
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!storagePlugin)
+    {
+        Logger::instance().error("BlobStorePlugin: StoragePlugin is not initialized");
+        co_return 0;
+    }
+    auto dbClient = drogon::app().getDbClient("default");
+
+    // 1) Короткая транзакция: пометить кандидатов. SKIP LOCKED позволяет нескольким
+    //    инстансам работать без advisory lock; брошенные отметки подбираются повторно.
+    const auto marked = co_await dbClient->execSqlCoro(
+        "UPDATE public.storage_blobs SET gc_started_at = now()"
+        " WHERE id IN ("
+        "   SELECT id FROM public.storage_blobs"
+        "    WHERE ref_count <= 0"
+        "      AND updated_at <= now() - ($1::int * interval '1 minute')"
+        "      AND (gc_started_at IS NULL OR gc_started_at <= now() - ($3::int * interval '1 minute'))"
+        "    ORDER BY updated_at"
+        "    LIMIT $2"
+        "    FOR UPDATE SKIP LOCKED)"
+        " RETURNING id, bucket, object_key",
+        graceMinutes_,
+        batchSize_,
+        kGcStaleMinutes);
+    if (marked.empty())
+    {
+        co_return 0;
+    }
+
+    // 2) Объекты удаляются вне транзакции, пачкой на bucket.
+    std::map<std::string, std::vector<std::pair<int64_t, std::string>>> byBucket;
+    for (const auto &row : marked)
+    {
+        byBucket[row["bucket"].as<std::string>()].emplace_back(row["id"].as<int64_t>(),
+                                                               row["object_key"].as<std::string>());
+    }
+    IObjectStorage &storage = storagePlugin->storage();
+    std::string removedIds;
+    std::string failedIds;
+    int collected = 0;
+    for (const auto &kv : byBucket)
+    {
+        std::vector<std::string> keys;
+        keys.reserve(kv.second.size());
+        for (const auto &item : kv.second)
+        {
+            keys.push_back(item.second);
+        }
+        std::vector<std::string> failedKeys;
+        const IObjectStorage::Status removed = co_await storage.removeMany(kv.first, keys, failedKeys);
+        if (!removed && failedKeys.empty())
+        {
+            failedKeys = keys;
+        }
+        std::unordered_set<std::string> failed(failedKeys.begin(), failedKeys.end());
+        for (const auto &item : kv.second)
+        {
+            std::string &ids = failed.count(item.second) ? failedIds : removedIds;
+            if (!ids.empty())
+            {
+                ids += ",";
+            }
+            ids += std::to_string(item.first);
+        }
+        if (!failed.empty())
+        {
+            // Запись остаётся — повтор на следующем проходе.
+            Logger::instance().error("BlobStorePlugin: storage delete failed bucket=" + kv.first +
+                                     " keys=" + std::to_string(failed.size()) + " err=" + removed.error);
+        }
+        collected += static_cast<int>(kv.second.size() - failed.size());
+    }
+
+    // 3) Короткие запросы: удалить записи удалённых объектов, снять отметку с остальных.
+    if (!removedIds.empty())
+    {
+        (void)co_await dbClient->execSqlCoro(
+            "DELETE FROM public.storage_blobs WHERE id = ANY($1::bigint[]) AND gc_started_at IS NOT NULL",
+            "{" + removedIds + "}");
+    }
+    if (!failedIds.empty())
+    {
+        (void)co_await dbClient->execSqlCoro(
+            "UPDATE public.storage_blobs SET gc_started_at = NULL WHERE id = ANY($1::bigint[])",
+            "{" + failedIds + "}");
+    }
+    co_return collected;
+}
@@ -0,0 +1,516 @@
+#include "Storage/LocalFsStorage.h"
+
+#include "Loger/Logger.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <set>
+#include <sstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+namespace fs = std::filesystem;
+
+/// Ключ хранится как относительный путь: запрещаем абсолютные пути и выход из bucket-а.
+bool isSafeRelativePath(const std::string &value, bool allowSlash)
+{
+    if (value.empty() || value.front() == '/' || value.front() == '\\')
+    {
+        return false;
+    }
+    if (value.find('\0') != std::string::npos || value.find('\\') != std::string::npos)
+    {
+        return false;
+    }
+    if (!allowSlash && value.find('/') != std::string::npos)
+    {
+        return false;
+    }
+    std::stringstream parts(value);
+    std::string part;
+    while (std::getline(parts, part, '/'))
+    {
+        if (part.empty() || part == "." || part == "..")
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// fsync файла или каталога. На Windows не поддерживается — считаем успешным.
+bool syncPath(const std::string &path, bool directory)
+{
+#if !defined(_WIN32)
+    const int fd = ::open(path.c_str(), directory ? (O_RDONLY | O_DIRECTORY) : O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#else
+    (void)path;
+    (void)directory;
+    return true;
+#endif
+}
+
+bool writeFile(const std::string &path, const uint8_t *data, size_t size, std::string &error)
+{
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    if (ec)
+    {
+        error = "Failed to create directory: " + ec.message();
+        return false;
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        error = "Failed to open file for writing";
+        return false;
+    }
+    if (size > 0)
+    {
+        out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size));
+    }
+    out.close();
+    if (!out)
+    {
+        error = "Failed to write file";
+        return false;
+    }
+    return true;
+}
+
+IObjectStorage::Status readFile(const std::string &path, size_t offset, size_t length, std::vector<uint8_t> &outData)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+    {
+        return IObjectStorage::Status::missing("Object not found");
+    }
+    outData.resize(length);
+    in.seekg(static_cast<std::streamoff>(offset));
+    if (length > 0 && !in.read(reinterpret_cast<char *>(outData.data()), static_cast<std::streamsize>(length)))
+    {
+        outData.clear();
+        return IObjectStorage::Status::failure("Failed to read object");
+    }
+    return IObjectStorage::Status::success();
+}
+/// Цикл, на котором продолжится корутина после работы на потоке хранилища: цикл вызывающего,
+/// как у ParallelUploader (вне цикла событий — поток хранилища).
+trantor::EventLoop *resumeLoop()
+{
+    return trantor::EventLoop::getEventLoopOfCurrentThread();
+}
+} // namespace
+
+/// Пишет временные файлы на потоках workers_ (как полосы ParallelUploader), затем
+/// отдаёт их в пачку fsync. Корутина возобновляется после fsync и rename на цикле вызывающего.
+class LocalFsStorage::PutAwaiter : public drogon::CallbackAwaiter<void>
+{
+public:
+    PutAwaiter(LocalFsStorage &storage, const std::vector<PutJob> &jobs, std::vector<PutResult> &results)
+        : storage_(storage), jobs_(jobs), results_(results)
+    {
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        auto batch = std::make_shared<SyncBatch>();
+        batch->tmpPaths.resize(jobs_.size());
+        batch->finalPaths.resize(jobs_.size());
+        batch->started.resize(jobs_.size());
+        batch->results = &results_;
+        batch->waiter = handle;
+        batch->resumeLoop = resumeLoop();
+
+        const size_t lanes = std::min(storage_.cfg_.ioThreads, jobs_.size());
+        auto remaining = std::make_shared<std::atomic<size_t>>(lanes);
+        auto next = std::make_shared<std::atomic<size_t>>(0);
+        for (size_t lane = 0; lane < lanes; ++lane)
+        {
+            storage_.workers_->getLoop(lane)->queueInLoop([this, lane, batch, remaining, next]() {
+                for (size_t i = next->fetch_add(1); i < jobs_.size(); i = next->fetch_add(1))
+                {
+                    writeJob(i, lane, *batch);
+                }
+                if (remaining->fetch_sub(1) == 1)
+                {
+                    storage_.scheduleSync(batch);
+                }
+            });
+        }
+    }
+
+private:
+    void writeJob(size_t i, size_t lane, SyncBatch &batch)
+    {
+        const PutJob &job = jobs_[i];
+        PutResult &res = results_[i];
+        res.lane = lane;
+        batch.started[i] = std::chrono::steady_clock::now();
+
+        const std::string finalPath = storage_.pathFor(job.bucket, job.objectKey);
+        if (finalPath.empty())
+        {
+            res.ok = false;
+            res.error = "Invalid bucket or object key";
+            return;
+        }
+        const std::string tmpPath = finalPath + ".tmp-" + std::to_string(storage_.tmpSeq_.fetch_add(1));
+        if (!writeFile(tmpPath, job.data, job.size, res.error))
+        {
+            std::error_code ec;
+            fs::remove(tmpPath, ec);
+            res.ok = false;
+            return;
+        }
+        batch.tmpPaths[i] = tmpPath;
+        batch.finalPaths[i] = finalPath;
+        res.ok = true;
+    }
+
+    LocalFsStorage &storage_;
+    const std::vector<PutJob> &jobs_;
+    std::vector<PutResult> &results_;
+};
+
+LocalFsStorage::LocalFsStorage(Config config) : cfg_(std::move(config))
+{
+    cfg_.ioThreads = std::max<size_t>(cfg_.ioThreads, 1);
+    cfg_.fsyncBatchMs = std::max(cfg_.fsyncBatchMs, 0);
+
+    std::error_code ec;
+    fs::create_directories(cfg_.root, ec);
+    if (ec)
+    {
+        Logger::instance().error("LocalFsStorage: failed to create root=" + cfg_.root + " err=" + ec.message());
+    }
+
+    workers_ = std::make_unique<trantor::EventLoopThreadPool>(cfg_.ioThreads, "LocalFsStorage");
+    workers_->start();
+    syncer_ = std::make_unique<trantor::EventLoopThreadPool>(1, "LocalFsSync");
+    syncer_->start();
+}
+
+LocalFsStorage::~LocalFsStorage()
+{
+    // flushPending() на потоке fsync продолжает запросы через workers_, поэтому первым останавливается syncer_:
+    // отложенная пачка дописывается сразу (не дожидаясь таймера), затем поток fsync завершается.
+    if (syncer_)
+    {
+        std::promise<void> drained;
+        syncer_->getLoop(0)->runInLoop([this, &drained]() {
+            flushPending();
+            drained.set_value();
+        });
+        drained.get_future().wait();
+        syncer_.reset();
+    }
+    workers_.reset();
+}
+
+std::string LocalFsStorage::pathFor(const std::string &bucket, const std::string &objectKey) const
+{
+    if (!isSafeRelativePath(bucket, false) || !isSafeRelativePath(objectKey, true))
+    {
+        return {};
+    }
+    return (fs::path(cfg_.root) / bucket / objectKey).string();
+}
+
+void LocalFsStorage::scheduleSync(std::shared_ptr<SyncBatch> batch)
+{
+    bool schedule = false;
+    {
+        std::lock_guard<std::mutex> lock(syncMutex_);
+        pending_.push_back(std::move(batch));
+        if (!flushScheduled_)
+        {
+            flushScheduled_ = true;
+            schedule = true;
+        }
+    }
+    if (schedule)
+    {
+        // Пачка набирается fsyncBatchMs: putAll соседних запросов делят один проход fsync.
+        syncer_->getLoop(0)->runAfter(static_cast<double>(cfg_.fsyncBatchMs) / 1000.0,
+                                      [this]() { flushPending(); });
+    }
+}
+
+void LocalFsStorage::flushPending()
+{
+    std::vector<std::shared_ptr<SyncBatch>> batches;
+    {
+        std::lock_guard<std::mutex> lock(syncMutex_);
+        batches.swap(pending_);
+        flushScheduled_ = false;
+    }
+
+    std::set<std::string> dirs;
+    for (const auto &batch : batches)
+    {
+        auto &results = *batch->results;
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            PutResult &res = results[i];
+            if (!res.ok)
+            {
+                continue;
+            }
+            const std::string &tmpPath = batch->tmpPaths[i];
+            const std::string &finalPath = batch->finalPaths[i];
+            std::error_code ec;
+            if (!syncPath(tmpPath, false))
+            {
+                res.ok = false;
+                res.error = "fsync failed";
+            }
+            else
+            {
+                fs::rename(tmpPath, finalPath, ec);
+                if (ec)
+                {
+                    res.ok = false;
+                    res.error = "Failed to rename file: " + ec.message();
+                }
+            }
+            if (!res.ok)
+            {
+                fs::remove(tmpPath, ec);
+            }
+            else
+            {
+                dirs.insert(fs::path(finalPath).parent_path().string());
+            }
+            res.durationMs =
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - batch->started[i]).count();
+        }
+    }
+
+    // rename становится устойчивым только после fsync каталога.
+    for (const auto &dir : dirs)
+    {
+        if (!syncPath(dir, true))
+        {
+            Logger::instance().warning("LocalFsStorage: directory fsync failed dir=" + dir);
+        }
+    }
+
+    // Продолжения запросов не выполняем на единственном потоке fsync: запрос продолжается на своём цикле.
+    for (const auto &batch : batches)
+    {
+        const auto waiter = batch->waiter;
+        trantor::EventLoop *loop = batch->resumeLoop ? batch->resumeLoop : workers_->getNextLoop();
+        loop->queueInLoop([waiter]() { waiter.resume(); });
+    }
+}
+
+drogon::Task<std::vector<IObjectStorage::PutResult>> LocalFsStorage::putAll(const std::vector<PutJob> &jobs)
+{
+    std::vector<PutResult> results(jobs.size());
+    if (jobs.empty())
+    {
+        co_return results;
+    }
+    co_await PutAwaiter(*this, jobs, results);
+    co_return results;
+}
+
+drogon::Task<IObjectStorage::Status> LocalFsStorage::get(const std::string &bucket,
+                                                         const std::string &objectKey,
+                                                         std::vector<uint8_t> &outData,
+                                                         std::string *outContentType)
+{
+    const std::string path = pathFor(bucket, objectKey);
+    if (path.empty())
+    {
+        co_return Status::failure("Invalid bucket or object key");
+    }
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        std::error_code ec;
+        const auto size = fs::file_size(path, ec);
+        if (ec)
+        {
+            return Status::missing("Object not found");
+        }
+        if (outContentType)
+        {
+            outContentType->clear();
+        }
+        return readFile(path, 0, static_cast<size_t>(size), outData);
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> LocalFsStorage::getRange(const std::string &bucket,
+                                                              const std::string &objectKey,
+                                                              size_t offset,
+                                                              size_t length,
+                                                              std::vector<uint8_t> &outData,
+                                                              std::string *outContentType)
+{
+    const std::string path = pathFor(bucket, objectKey);
+    if (path.empty())
+    {
+        co_return Status::failure("Invalid bucket or object key");
+    }
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        std::error_code ec;
+        const auto size = static_cast<size_t>(fs::file_size(path, ec));
+        if (ec)
+        {
+            return Status::missing("Object not found");
+        }
+        if (offset > size || length > size - offset)
+        {
+            return Status::failure("Range is outside of the object");
+        }
+        if (outContentType)
+        {
+            outContentType->clear();
+        }
+        return readFile(path, offset, length, outData);
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> LocalFsStorage::stat(const std::string &bucket,
+                                                          const std::string &objectKey,
+                                                          ObjectStat &outStat)
+{
+    const std::string path = pathFor(bucket, objectKey);
+    if (path.empty())
+    {
+        co_return Status::failure("Invalid bucket or object key");
+    }
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        std::error_code ec;
+        const auto size = fs::file_size(path, ec);
+        if (ec)
+        {
+            return ec == std::errc::no_such_file_or_directory ? Status::missing("Object not found")
+                                                              : Status::failure("Failed to stat file: " + ec.message());
+        }
+        const auto mtime = fs::last_write_time(path, ec);
+        // ETag из размера и mtime: меняется при перезаписи объекта, чего достаточно для If-Range.
+        std::ostringstream etag;
+        etag << std::hex << size << "-" << (ec ? 0 : mtime.time_since_epoch().count());
+        outStat.size = static_cast<size_t>(size);
+        outStat.etag = etag.str();
+        outStat.contentType.clear();
+        return Status::success();
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> LocalFsStorage::list(const std::string &bucket,
+                                                          const std::string &prefix,
+                                                          const std::string &startAfter,
+                                                          size_t maxKeys,
+                                                          std::vector<std::string> &outKeys)
+{
+    outKeys.clear();
+    if (!isSafeRelativePath(bucket, false))
+    {
+        co_return Status::failure("Invalid bucket");
+    }
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        const fs::path bucketDir = fs::path(cfg_.root) / bucket;
+        std::error_code ec;
+        if (!fs::exists(bucketDir, ec))
+        {
+            return Status::success();
+        }
+        // Полный обход каталога на каждую страницу: локальный backend рассчитан на небольшие объёмы.
+        // Из кандидатов держим только maxKeys наименьших ключей после startAfter.
+        std::set<std::string> keys;
+        for (fs::recursive_directory_iterator it(bucketDir, ec), end; !ec && it != end; it.increment(ec))
+        {
+            if (!it->is_regular_file(ec))
+            {
+                continue;
+            }
+            std::string key = fs::relative(it->path(), bucketDir, ec).generic_string();
+            if (ec || key.find(".tmp-") != std::string::npos)
+            {
+                continue;
+            }
+            if (key.compare(0, prefix.size(), prefix) != 0 || key <= startAfter)
+            {
+                continue;
+            }
+            keys.insert(std::move(key));
+            if (keys.size() > maxKeys)
+            {
+                keys.erase(std::prev(keys.end()));
+            }
+        }
+        if (ec)
+        {
+            return Status::failure("Failed to list directory: " + ec.message());
+        }
+        outKeys.assign(keys.begin(), keys.end());
+        return Status::success();
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> LocalFsStorage::remove(const std::string &bucket, const std::string &objectKey)
+{
+    const std::string path = pathFor(bucket, objectKey);
+    if (path.empty())
+    {
+        co_return Status::failure("Invalid bucket or object key");
+    }
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        std::error_code ec;
+        fs::remove(path, ec);
+        return ec ? Status::failure("Failed to remove file: " + ec.message()) : Status::success();
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> LocalFsStorage::removeMany(const std::string &bucket,
+                                                                const std::vector<std::string> &objectKeys,
+                                                                std::vector<std::string> &failedKeys)
+{
+    failedKeys.clear();
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        for (const auto &objectKey : objectKeys)
+        {
+            const std::string path = pathFor(bucket, objectKey);
+            if (path.empty())
+            {
+                failedKeys.push_back(objectKey);
+                continue;
+            }
+            std::error_code ec;
+            fs::remove(path, ec);
+            if (ec)
+            {
+                failedKeys.push_back(objectKey);
+            }
+        }
+        return failedKeys.empty() ? Status::success()
+                                  : Status::failure("Failed to remove " + std::to_string(failedKeys.size()) + " files");
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> LocalFsStorage::presignGetMany(const std::string &,
+                                                                    const std::vector<std::string> &objectKeys,
+                                                                    unsigned int,
+                                                                    std::vector<std::string> &outUrls)
+{
+    outUrls.assign(objectKeys.size(), std::string());
+    co_return Status::failure("Presigned URLs are not supported by local storage");
+}
@@ -3,33 +3,62 @@
 #include "Loger/Logger.h"
 
 #include <miniocpp/client.h>
+#include <algorithm>
 #include <sstream>
 #include <iostream>
+#include <streambuf>
 
-class MinioClient::Impl
+namespace
+{
+/// Поток чтения поверх чужого буфера без копирования данных.
+/// SDK читает объект (и части multipart) через std::istream, поэтому нужен только get-area + seek.
+class MemoryStreamBuf : public std::streambuf
 {
 public:
-    std::unique_ptr<minio::s3::Client> client;
-    std::unique_ptr<minio::creds::StaticProvider> credProvider;
-};
+    explicit MemoryStreamBuf(std::string_view data)
+    {
+        char *begin = const_cast<char *>(data.data());
+        setg(begin, begin, begin + data.size());
+    }
 
-void MinioClient::setLastError(std::string err)
-{
-    std::lock_guard<std::mutex> lk(lastErrorMutex_);
-    lastError_ = std::move(err);
-}
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (!(which & std::ios_base::in))
+        {
+            return pos_type(off_type(-1));
+        }
+        off_type base = 0;
+        if (dir == std::ios_base::cur)
+        {
+            base = gptr() - eback();
+        }
+        else if (dir == std::ios_base::end)
+        {
+            base = egptr() - eback();
+        }
+        const off_type target = base + off;
+        if (target < 0 || target > egptr() - eback())
+        {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + target, egptr());
+        return pos_type(target);
+    }
 
-void MinioClient::clearLastError()
-{
-    std::lock_guard<std::mutex> lk(lastErrorMutex_);
-    lastError_.clear();
-}
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+} // namespace
 
-std::string MinioClient::lastError() const
+class MinioClient::Impl
 {
-    std::lock_guard<std::mutex> lk(lastErrorMutex_);
-    return lastError_;
-}
+public:
+    std::unique_ptr<minio::s3::Client> client;
+    std::unique_ptr<minio::creds::StaticProvider> credProvider;
+};
 
 MinioClient::MinioClient(const Config &config)
     : config_(config), pImpl_(std::make_unique<Impl>())
@@ -52,22 +81,33 @@ MinioClient::MinioClient(const Config &config)
 
 MinioClient::~MinioClient() = default;
 
-bool MinioClient::putObject(const std::string &bucket,
-                            const std::string &objectKey,
-                            const std::vector<uint8_t> &data,
-                            const std::string &contentType)
+MinioClient::CallResult MinioClient::putObject(const std::string &bucket,
+                                               const std::string &objectKey,
+                                               const std::vector<uint8_t> &data,
+                                               const std::string &contentType)
+{
+    return putObject(bucket,
+                     objectKey,
+                     std::string_view(reinterpret_cast<const char *>(data.data()), data.size()),
+                     contentType);
+}
+
+MinioClient::CallResult MinioClient::putObject(const std::string &bucket,
+                                               const std::string &objectKey,
+                                               const std::string_view &data,
+                                               const std::string &contentType)
 {
     try
     {
-        clearLastError();
         std::string bucketName = bucket.empty() ? config_.bucket : bucket;
 
-        // Создаём поток из данных
-        std::string dataStr(data.begin(), data.end());
-        std::istringstream stream(dataStr);
+        // Поток читает данные напрямую из буфера вызывающей стороны (без копии).
+        MemoryStreamBuf buf(data);
+        std::istream stream(&buf);
 
-        // Формируем аргументы для загрузки
-        minio::s3::PutObjectArgs args(stream, static_cast<long>(data.size()), 0);
+        // Формируем аргументы для загрузки.
+        // При заданном partSize SDK сам делает multipart-загрузку для крупных объектов.
+        minio::s3::PutObjectArgs args(stream, static_cast<long>(data.size()), static_cast<long>(config_.partSize));
         args.bucket = bucketName;
         args.object = objectKey;
 
@@ -94,12 +134,10 @@ bool MinioClient::putObject(const std::string &bucket,
             }
             oss << " error=" << resp.Error().String();
             Logger::instance().error(oss.str());
-            setLastError(resp.Error().String());
-            return false;
+            return CallResult::failure(resp.Error().String());
         }
 
-        clearLastError();
-        return true;
+        return CallResult::success();
     }
     catch (const std::exception &e)
     {
@@ -112,25 +150,14 @@ bool MinioClient::putObject(const std::string &bucket,
             << " sizeBytes=" << data.size()
             << " what=" << e.what();
         Logger::instance().error(oss.str());
-        setLastError(e.what());
-        return false;
+        return CallResult::failure(e.what());
     }
 }
 
-bool MinioClient::putObject(const std::string &bucket,
-                            const std::string &objectKey,
-                            const std::string_view &data,
-                            const std::string &contentType)
-{
-    std::vector<uint8_t> vec(data.begin(), data.end());
-    return putObject(bucket, objectKey, vec, contentType);
-}
-
-bool MinioClient::deleteObject(const std::string &bucket, const std::string &objectKey)
+MinioClient::CallResult MinioClient::deleteObject(const std::string &bucket, const std::string &objectKey)
 {
     try
     {
-        clearLastError();
         std::string bucketName = bucket.empty() ? config_.bucket : bucket;
 
         minio::s3::RemoveObjectArgs args;
@@ -149,12 +176,10 @@ bool MinioClient::deleteObject(const std::string &bucket, const std::string &obj
                 << " key=" << objectKey
                 << " error=" << resp.Error().String();
             Logger::instance().error(oss.str());
-            setLastError(resp.Error().String());
-            return false;
+            return CallResult::failure(resp.Error().String());
         }
 
-        clearLastError();
-        return true;
+        return CallResult::success();
     }
     catch (const std::exception &e)
     {
@@ -166,25 +191,123 @@ bool MinioClient::deleteObject(const std::string &bucket, const std::string &obj
             << " key=" << objectKey
             << " what=" << e.what();
         Logger::instance().error(oss.str());
-        setLastError(e.what());
-        return false;
+        return CallResult::failure(e.what());
+    }
+}
+
+MinioClient::CallResult MinioClient::removeObjects(const std::string &bucket,
+                                                   const std::vector<std::string> &objectKeys,
+                                                   std::vector<std::string> &failedKeys)
+{
+    failedKeys.clear();
+    if (objectKeys.empty())
+    {
+        return CallResult::success();
+    }
+    const std::string bucketName = bucket.empty() ? config_.bucket : bucket;
+    std::string lastError;
+    try
+    {
+        minio::s3::RemoveObjectsArgs args;
+        args.bucket = bucketName;
+        size_t next = 0;
+        args.func = [&objectKeys, &next](minio::s3::DeleteObject &obj) -> bool {
+            if (next >= objectKeys.size())
+            {
+                return false;
+            }
+            obj.name = objectKeys[next++];
+            return true;
+        };
+
+        // Результат перечисляет только ошибки: по объекту (object_name заполнен)
+        // или всего запроса (object_name пуст).
+        minio::s3::RemoveObjectsResult result = pImpl_->client->RemoveObjects(args);
+        for (; result; ++result)
+        {
+            minio::s3::DeleteError err = *result;
+            if (err.object_name.empty())
+            {
+                std::ostringstream oss;
+                oss << "MinIO removeObjects failed"
+                    << " endpoint=" << config_.endpoint
+                    << " bucket=" << bucketName
+                    << " count=" << objectKeys.size()
+                    << " error=" << result.Error().String();
+                Logger::instance().error(oss.str());
+                failedKeys = objectKeys;
+                return CallResult::failure(result.Error().String());
+            }
+            std::ostringstream oss;
+            oss << "MinIO removeObjects: object not deleted"
+                << " bucket=" << bucketName
+                << " key=" << err.object_name
+                << " code=" << err.code
+                << " message=" << err.message;
+            Logger::instance().error(oss.str());
+            lastError = err.code + ": " + err.message;
+            failedKeys.push_back(err.object_name);
+        }
+        return failedKeys.empty() ? CallResult::success() : CallResult::failure(lastError);
+    }
+    catch (const std::exception &e)
+    {
+        std::ostringstream oss;
+        oss << "MinIO removeObjects exception"
+            << " endpoint=" << config_.endpoint
+            << " bucket=" << bucketName
+            << " count=" << objectKeys.size()
+            << " what=" << e.what();
+        Logger::instance().error(oss.str());
+        failedKeys = objectKeys;
+        return CallResult::failure(e.what());
     }
 }
 
-bool MinioClient::getObject(const std::string &bucket,
-                            const std::string &objectKey,
-                            std::vector<uint8_t> &outData,
-                            std::string *outContentType)
+MinioClient::CallResult MinioClient::getObject(const std::string &bucket,
+                                               const std::string &objectKey,
+                                               std::vector<uint8_t> &outData,
+                                               std::string *outContentType)
+{
+    return fetchObject(bucket, objectKey, nullptr, outData, outContentType);
+}
+
+MinioClient::CallResult MinioClient::getObjectRange(const std::string &bucket,
+                                                    const std::string &objectKey,
+                                                    size_t offset,
+                                                    size_t length,
+                                                    std::vector<uint8_t> &outData,
+                                                    std::string *outContentType)
+{
+    const ByteRange range{offset, length};
+    return fetchObject(bucket, objectKey, &range, outData, outContentType);
+}
+
+MinioClient::CallResult MinioClient::fetchObject(const std::string &bucket,
+                                                 const std::string &objectKey,
+                                                 const ByteRange *range,
+                                                 std::vector<uint8_t> &outData,
+                                                 std::string *outContentType)
 {
     try
     {
-        clearLastError();
         std::string bucketName = bucket.empty() ? config_.bucket : bucket;
         outData.clear();
 
         minio::s3::GetObjectArgs args;
         args.bucket = bucketName;
         args.object = objectKey;
+        // SDK принимает смещение и длину по указателю и сам формирует заголовок Range.
+        size_t offset = 0;
+        size_t length = 0;
+        if (range)
+        {
+            offset = range->offset;
+            length = range->length;
+            args.offset = &offset;
+            args.length = &length;
+            outData.reserve(length);
+        }
         args.datafunc = [&outData](minio::http::DataFunctionArgs cbArgs) -> bool {
             const std::string &chunk = cbArgs.datachunk;
             outData.insert(outData.end(), chunk.begin(), chunk.end());
@@ -200,11 +323,14 @@ bool MinioClient::getObject(const std::string &bucket,
                 << " endpoint=" << config_.endpoint
                 << " useSSL=" << (config_.useSSL ? "true" : "false")
                 << " bucket=" << bucketName
-                << " key=" << objectKey
-                << " error=" << resp.Error().String();
+                << " key=" << objectKey;
+            if (range)
+            {
+                oss << " offset=" << range->offset << " length=" << range->length;
+            }
+            oss << " error=" << resp.Error().String();
             Logger::instance().error(oss.str());
-            setLastError(resp.Error().String());
-            return false;
+            return CallResult::failure(resp.Error().String());
         }
 
         if (outContentType)
@@ -212,8 +338,7 @@ bool MinioClient::getObject(const std::string &bucket,
             *outContentType = resp.headers.GetFront("content-type");
         }
 
-        clearLastError();
-        return true;
+        return CallResult::success();
     }
     catch (const std::exception &e)
     {
@@ -225,7 +350,161 @@ bool MinioClient::getObject(const std::string &bucket,
             << " key=" << objectKey
             << " what=" << e.what();
         Logger::instance().error(oss.str());
-        setLastError(e.what());
-        return false;
+        return CallResult::failure(e.what());
+    }
+}
+
+MinioClient::CallResult MinioClient::statObject(const std::string &bucket,
+                                                const std::string &objectKey,
+                                                ObjectInfo &outInfo)
+{
+    try
+    {
+        std::string bucketName = bucket.empty() ? config_.bucket : bucket;
+
+        minio::s3::StatObjectArgs args;
+        args.bucket = bucketName;
+        args.object = objectKey;
+
+        minio::s3::StatObjectResponse resp = pImpl_->client->StatObject(args);
+
+        if (!resp)
+        {
+            std::ostringstream oss;
+            oss << "MinIO statObject failed"
+                << " endpoint=" << config_.endpoint
+                << " bucket=" << bucketName
+                << " key=" << objectKey
+                << " error=" << resp.Error().String();
+            if (resp.status_code == 404 || resp.code == "NoSuchKey")
+            {
+                // Отсутствие объекта — ожидаемый ответ (проверки целостности), не ошибка SDK.
+                Logger::instance().warning(oss.str());
+                return CallResult::missing(resp.Error().String());
+            }
+            Logger::instance().error(oss.str());
+            return CallResult::failure(resp.Error().String());
+        }
+
+        outInfo.size = resp.size;
+        outInfo.etag = resp.etag;
+        outInfo.contentType = resp.headers.GetFront("content-type");
+        return CallResult::success();
+    }
+    catch (const std::exception &e)
+    {
+        std::ostringstream oss;
+        oss << "MinIO statObject exception"
+            << " endpoint=" << config_.endpoint
+            << " bucket=" << (bucket.empty() ? config_.bucket : bucket)
+            << " key=" << objectKey
+            << " what=" << e.what();
+        Logger::instance().error(oss.str());
+        return CallResult::failure(e.what());
+    }
+}
+
+MinioClient::CallResult MinioClient::listObjects(const std::string &bucket,
+                                                 const std::string &prefix,
+                                                 const std::string &startAfter,
+                                                 size_t maxKeys,
+                                                 std::vector<std::string> &outKeys)
+{
+    outKeys.clear();
+    const std::string bucketName = bucket.empty() ? config_.bucket : bucket;
+    try
+    {
+        minio::s3::ListObjectsArgs args;
+        args.bucket = bucketName;
+        args.prefix = prefix;
+        args.start_after = startAfter;
+        args.recursive = true;
+        args.max_keys = static_cast<unsigned int>(std::min<size_t>(maxKeys, 1000));
+
+        // Результат ленивый: следующая страница запрашивается только при переходе за текущую,
+        // поэтому выход по maxKeys не тянет лишних страниц.
+        minio::s3::ListObjectsResult result = pImpl_->client->ListObjects(args);
+        for (; result && outKeys.size() < maxKeys; ++result)
+        {
+            minio::s3::Item item = *result;
+            if (!item)
+            {
+                std::ostringstream oss;
+                oss << "MinIO listObjects failed"
+                    << " endpoint=" << config_.endpoint
+                    << " bucket=" << bucketName
+                    << " prefix=" << prefix
+                    << " startAfter=" << startAfter
+                    << " error=" << item.Error().String();
+                Logger::instance().error(oss.str());
+                return CallResult::failure(item.Error().String());
+            }
+            if (item.is_prefix)
+            {
+                continue;
+            }
+            outKeys.push_back(item.name);
+        }
+        return CallResult::success();
+    }
+    catch (const std::exception &e)
+    {
+        std::ostringstream oss;
+        oss << "MinIO listObjects exception"
+            << " endpoint=" << config_.endpoint
+            << " bucket=" << bucketName
+            << " prefix=" << prefix
+            << " what=" << e.what();
+        Logger::instance().error(oss.str());
+        return CallResult::failure(e.what());
+    }
+}
+
+MinioClient::CallResult MinioClient::presignGetObject(const std::string &bucket,
+                                                      const std::string &objectKey,
+                                                      unsigned int expirySeconds,
+                                                      std::string &outUrl)
+{
+    try
+    {
+        std::string bucketName = bucket.empty() ? config_.bucket : bucket;
+
+        minio::s3::GetPresignedObjectUrlArgs args;
+        args.bucket = bucketName;
+        args.object = objectKey;
+        args.method = minio::http::Method::kGet;
+        args.expiry_seconds = expirySeconds;
+        if (!config_.region.empty())
+        {
+            args.region = config_.region;
+        }
+
+        minio::s3::GetPresignedObjectUrlResponse resp = pImpl_->client->GetPresignedObjectUrl(args);
+
+        if (!resp)
+        {
+            std::ostringstream oss;
+            oss << "MinIO presignGetObject failed"
+                << " endpoint=" << config_.endpoint
+                << " bucket=" << bucketName
+                << " key=" << objectKey
+                << " error=" << resp.Error().String();
+            Logger::instance().error(oss.str());
+            return CallResult::failure(resp.Error().String());
+        }
+
+        outUrl = resp.url;
+        return CallResult::success();
+    }
+    catch (const std::exception &e)
+    {
+        std::ostringstream oss;
+        oss << "MinIO presignGetObject exception"
+            << " endpoint=" << config_.endpoint
+            << " bucket=" << (bucket.empty() ? config_.bucket : bucket)
+            << " key=" << objectKey
+            << " what=" << e.what();
+        Logger::instance().error(oss.str());
+        return CallResult::failure(e.what());
     }
 }
@@ -0,0 +1,48 @@
+#include "Storage/MinioClientPool.h"
+
+#include <algorithm>
+
+MinioClientPool::Lease::Lease(Lease &&other) noexcept
+    : pool_(other.pool_), client_(other.client_)
+{
+    other.pool_ = nullptr;
+    other.client_ = nullptr;
+}
+
+MinioClientPool::Lease::~Lease()
+{
+    if (pool_ && client_)
+    {
+        pool_->release(client_);
+    }
+}
+
+MinioClientPool::MinioClientPool(const MinioClient::Config &config, size_t size)
+{
+    const size_t count = std::max<size_t>(size, 1);
+    clients_.reserve(count);
+    idle_.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        clients_.push_back(std::make_unique<MinioClient>(config));
+        idle_.push_back(clients_.back().get());
+    }
+}
+
+MinioClientPool::Lease MinioClientPool::lease()
+{
+    std::unique_lock<std::mutex> lk(mutex_);
+    available_.wait(lk, [this] { return !idle_.empty(); });
+    MinioClient *client = idle_.back();
+    idle_.pop_back();
+    return Lease(this, client);
+}
+
+void MinioClientPool::release(MinioClient *client)
+{
+    {
+        std::lock_guard<std::mutex> lk(mutex_);
+        idle_.push_back(client);
+    }
+    available_.notify_one();
+}
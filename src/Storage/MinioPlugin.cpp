@@ -1,7 +1,13 @@
 #include "Storage/MinioPlugin.h"
 
+#include <drogon/drogon.h>
+
 #include "Config/MinioConfig.h"
+#include "Storage/StoragePlugin.h"
+#include "Loger/Logger.h"
 
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 
 namespace
@@ -16,7 +22,9 @@ MinioClient::Config configFromPluginConfig(const Json::Value &config)
     //   "access_key": "...",
     //   "secret_key": "...",
     //   "bucket": "...",
-    //   "use_ssl": false
+    //   "use_ssl": false,
+    //   "region": "us-east-1",
+    //   "multipart_part_size": 8388608
     // }
     if (config.isObject() && !config.empty())
     {
@@ -25,6 +33,14 @@ MinioClient::Config configFromPluginConfig(const Json::Value &config)
         cfg.secretKey = config.get("secret_key", "").asString();
         cfg.bucket = config.get("bucket", "").asString();
         cfg.useSSL = config.get("use_ssl", false).asBool();
+        cfg.region = config.get("region", "").asString();
+        if (config.isMember("multipart_part_size") && config["multipart_part_size"].isUInt64())
+        {
+            // S3 не принимает части меньше 5 МиБ.
+            constexpr size_t kMinPartSize = 5 * 1024 * 1024;
+            const auto partSize = static_cast<size_t>(config["multipart_part_size"].asUInt64());
+            cfg.partSize = (partSize == 0) ? 0 : std::max(partSize, kMinPartSize);
+        }
         return cfg;
     }
 
@@ -36,21 +52,70 @@ MinioClient::Config configFromPluginConfig(const Json::Value &config)
 void MinioPlugin::initAndStart(const Json::Value &config)
 {
     cfg_ = configFromPluginConfig(config);
-    client_ = std::make_unique<MinioClient>(cfg_);
+
+    if (config.isMember("client_pool_size") && config["client_pool_size"].isInt() &&
+        config["client_pool_size"].asInt() > 0)
+    {
+        clientPoolSize_ = static_cast<size_t>(config["client_pool_size"].asInt());
+    }
+    clients_ = std::make_unique<MinioClientPool>(cfg_, clientPoolSize_);
+
+    if (config.isMember("upload_concurrency") && config["upload_concurrency"].isInt() &&
+        config["upload_concurrency"].asInt() > 0)
+    {
+        uploadConcurrency_ = static_cast<size_t>(config["upload_concurrency"].asInt());
+    }
+    uploader_ = std::make_unique<ParallelUploader>(cfg_, uploadConcurrency_);
+
+    if (config.isMember("presign_enabled") && config["presign_enabled"].isBool())
+    {
+        presignEnabled_ = config["presign_enabled"].asBool();
+    }
+    if (config.isMember("presign_expiry_seconds") && config["presign_expiry_seconds"].isInt())
+    {
+        // S3 принимает срок от 1 секунды до 7 суток; короче минуты кэш теряет смысл.
+        constexpr int kMinExpiry = 60;
+        constexpr int kMaxExpiry = 7 * 24 * 3600;
+        presignExpirySeconds_ =
+            static_cast<unsigned int>(std::clamp(config["presign_expiry_seconds"].asInt(), kMinExpiry, kMaxExpiry));
+    }
+    size_t presignCacheEntries = 10000;
+    if (config.isMember("presign_cache_max_entries") && config["presign_cache_max_entries"].isInt() &&
+        config["presign_cache_max_entries"].asInt() > 0)
+    {
+        presignCacheEntries = static_cast<size_t>(config["presign_cache_max_entries"].asInt());
+    }
+    presignCache_ = std::make_unique<PresignedUrlCache>(presignCacheEntries);
 }
 
 void MinioPlugin::shutdown()
 {
-    client_.reset();
+    uploader_.reset();
+    clients_.reset();
+    presignCache_.reset();
+}
+
+MinioClientPool::Lease MinioPlugin::client()
+{
+    return clientPool().lease();
 }
 
-MinioClient &MinioPlugin::client()
+MinioClientPool &MinioPlugin::clientPool()
 {
-    if (!client_)
+    if (!clients_)
     {
         throw std::runtime_error("MinioPlugin: MinioClient is not initialized");
     }
-    return *client_;
+    return *clients_;
+}
+
+ParallelUploader &MinioPlugin::uploader()
+{
+    if (!uploader_)
+    {
+        throw std::runtime_error("MinioPlugin: ParallelUploader is not initialized");
+    }
+    return *uploader_;
 }
 
 const MinioClient::Config &MinioPlugin::minioConfig() const
@@ -58,3 +123,61 @@ const MinioClient::Config &MinioPlugin::minioConfig() const
     return cfg_;
 }
 
+
+drogon::Task<std::vector<std::optional<PresignedUrlCache::Entry>>> MinioPlugin::presignedUrls(
+    const std::string &bucket,
+    const std::vector<std::string> &objectKeys)
+{
+    if (!presignCache_)
+    {
+        throw std::runtime_error("MinioPlugin: presigned URL cache is not initialized");
+    }
+    const std::string bucketName = bucket.empty() ? cfg_.bucket : bucket;
+    const auto now = PresignedUrlCache::Clock::now();
+    const auto margin = std::chrono::seconds(presignExpirySeconds_ / 4);
+
+    std::vector<std::optional<PresignedUrlCache::Entry>> out(objectKeys.size());
+    std::vector<std::string> missKeys;
+    std::vector<size_t> missIndex;
+    for (size_t i = 0; i < objectKeys.size(); ++i)
+    {
+        if (auto cached = presignCache_->get(bucketName + "/" + objectKeys[i], now + margin))
+        {
+            out[i] = std::move(*cached);
+            continue;
+        }
+        missKeys.push_back(objectKeys[i]);
+        missIndex.push_back(i);
+    }
+    if (missKeys.empty())
+    {
+        co_return out;
+    }
+
+    // Промахи подписываются одним заходом на потоки StoragePlugin: lease() и сетевой
+    // запрос региона не должны выполняться на IO-потоке.
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!storagePlugin)
+    {
+        throw std::runtime_error("MinioPlugin: StoragePlugin is not initialized");
+    }
+    std::vector<std::string> urls;
+    const IObjectStorage::Status signedUrls =
+        co_await storagePlugin->storage().presignGetMany(bucketName, missKeys, presignExpirySeconds_, urls);
+    if (!signedUrls)
+    {
+        Logger::instance().error("MinioPlugin: presign failed bucket=" + bucketName + " err=" + signedUrls.error);
+    }
+    const auto expiresAt = now + std::chrono::seconds(presignExpirySeconds_);
+    for (size_t j = 0; j < missKeys.size() && j < urls.size(); ++j)
+    {
+        if (urls[j].empty())
+        {
+            continue;
+        }
+        PresignedUrlCache::Entry entry{std::move(urls[j]), expiresAt};
+        presignCache_->put(bucketName + "/" + missKeys[j], entry);
+        out[missIndex[j]] = std::move(entry);
+    }
+    co_return out;
+}
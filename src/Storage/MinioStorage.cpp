@@ -0,0 +1,131 @@
+#include "Storage/MinioStorage.h"
+
+#include <algorithm>
+
+namespace
+{
+IObjectStorage::Status toStatus(const MinioClient::CallResult &result)
+{
+    if (result)
+    {
+        return IObjectStorage::Status::success();
+    }
+    return result.notFound ? IObjectStorage::Status::missing(result.error) : IObjectStorage::Status::failure(result.error);
+}
+/// Цикл, на котором продолжится корутина после работы на потоке хранилища: цикл вызывающего,
+/// как у ParallelUploader (вне цикла событий — поток хранилища).
+trantor::EventLoop *resumeLoop()
+{
+    return trantor::EventLoop::getEventLoopOfCurrentThread();
+}
+} // namespace
+
+MinioStorage::MinioStorage(MinioClientPool &clients, ParallelUploader &uploader, size_t ioThreads)
+    : clients_(clients), uploader_(uploader)
+{
+    workers_ = std::make_unique<trantor::EventLoopThreadPool>(std::max<size_t>(ioThreads, 1), "MinioStorage");
+    workers_->start();
+}
+
+MinioStorage::~MinioStorage()
+{
+    workers_.reset();
+}
+
+drogon::Task<std::vector<IObjectStorage::PutResult>> MinioStorage::putAll(const std::vector<PutJob> &jobs)
+{
+    co_return co_await uploader_.uploadAll(jobs);
+}
+
+drogon::Task<IObjectStorage::Status> MinioStorage::get(const std::string &bucket,
+                                                       const std::string &objectKey,
+                                                       std::vector<uint8_t> &outData,
+                                                       std::string *outContentType)
+{
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        return toStatus(clients_.lease()->getObject(bucket, objectKey, outData, outContentType));
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> MinioStorage::getRange(const std::string &bucket,
+                                                            const std::string &objectKey,
+                                                            size_t offset,
+                                                            size_t length,
+                                                            std::vector<uint8_t> &outData,
+                                                            std::string *outContentType)
+{
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        return toStatus(clients_.lease()->getObjectRange(bucket, objectKey, offset, length, outData, outContentType));
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> MinioStorage::stat(const std::string &bucket,
+                                                        const std::string &objectKey,
+                                                        ObjectStat &outStat)
+{
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        MinioClient::ObjectInfo info;
+        const MinioClient::CallResult result = clients_.lease()->statObject(bucket, objectKey, info);
+        if (result)
+        {
+            outStat.size = info.size;
+            outStat.etag = info.etag;
+            outStat.contentType = info.contentType;
+        }
+        return toStatus(result);
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> MinioStorage::list(const std::string &bucket,
+                                                        const std::string &prefix,
+                                                        const std::string &startAfter,
+                                                        size_t maxKeys,
+                                                        std::vector<std::string> &outKeys)
+{
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        return toStatus(clients_.lease()->listObjects(bucket, prefix, startAfter, maxKeys, outKeys));
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> MinioStorage::remove(const std::string &bucket, const std::string &objectKey)
+{
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        return toStatus(clients_.lease()->deleteObject(bucket, objectKey));
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> MinioStorage::removeMany(const std::string &bucket,
+                                                              const std::vector<std::string> &objectKeys,
+                                                              std::vector<std::string> &failedKeys)
+{
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        return toStatus(clients_.lease()->removeObjects(bucket, objectKeys, failedKeys));
+    }, resumeLoop());
+}
+
+drogon::Task<IObjectStorage::Status> MinioStorage::presignGetMany(const std::string &bucket,
+                                                                  const std::vector<std::string> &objectKeys,
+                                                                  unsigned int expirySeconds,
+                                                                  std::vector<std::string> &outUrls)
+{
+    // Подпись может запросить регион bucket-а по сети — поэтому на потоках хранилища.
+    co_return co_await drogon::queueInLoopCoro<Status>(workers_->getNextLoop(), [&]() {
+        outUrls.assign(objectKeys.size(), std::string());
+        auto client = clients_.lease();
+        Status status = Status::success();
+        for (size_t i = 0; i < objectKeys.size(); ++i)
+        {
+            const MinioClient::CallResult signedUrl =
+                client->presignGetObject(bucket, objectKeys[i], expirySeconds, outUrls[i]);
+            if (!signedUrl)
+            {
+                outUrls[i].clear();
+                if (status)
+                {
+                    status = toStatus(signedUrl);
+                }
+            }
+        }
+        return status;
+    }, resumeLoop());
+}
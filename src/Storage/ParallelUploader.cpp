@@ -0,0 +1,114 @@
+#include "Storage/ParallelUploader.h"
+
+#include "Loger/Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string_view>
+
+namespace
+{
+/// Запускает work(lane) на lanes потоках пула и возобновляет корутину,
+/// когда завершится последняя полоса.
+class LanesAwaiter : public drogon::CallbackAwaiter<void>
+{
+public:
+    LanesAwaiter(trantor::EventLoopThreadPool &pool, size_t lanes, std::function<void(size_t)> work)
+        : pool_(pool), lanes_(lanes), work_(std::move(work))
+    {
+    }
+
+    void await_suspend(std::coroutine_handle<> handle)
+    {
+        // Продолжение запроса возвращается в цикл вызывающего (IO-поток Drogon),
+        // а не остаётся на потоке полосы, которая закончила последней.
+        trantor::EventLoop *caller = trantor::EventLoop::getEventLoopOfCurrentThread();
+        auto remaining = std::make_shared<std::atomic<size_t>>(lanes_);
+        for (size_t lane = 0; lane < lanes_; ++lane)
+        {
+            pool_.getLoop(lane)->queueInLoop([this, lane, remaining, handle, caller]() {
+                work_(lane);
+                if (remaining->fetch_sub(1) != 1)
+                {
+                    return;
+                }
+                if (caller)
+                {
+                    caller->queueInLoop([handle]() { handle.resume(); });
+                }
+                else
+                {
+                    handle.resume();
+                }
+            });
+        }
+    }
+
+private:
+    trantor::EventLoopThreadPool &pool_;
+    size_t lanes_;
+    std::function<void(size_t)> work_;
+};
+} // namespace
+
+ParallelUploader::ParallelUploader(const MinioClient::Config &config, size_t concurrency)
+{
+    concurrency = std::max<size_t>(1, concurrency);
+    clients_.reserve(concurrency);
+    for (size_t i = 0; i < concurrency; ++i)
+    {
+        clients_.push_back(std::make_unique<MinioClient>(config));
+    }
+    workers_ = std::make_unique<trantor::EventLoopThreadPool>(concurrency, "MinioUpload");
+    workers_->start();
+}
+
+ParallelUploader::~ParallelUploader()
+{
+    // Сначала останавливаем потоки, затем освобождаем клиентов, которыми они пользуются.
+    workers_.reset();
+    clients_.clear();
+}
+
+drogon::Task<std::vector<ParallelUploader::Result>> ParallelUploader::uploadAll(const std::vector<Job> &jobs)
+{
+    std::vector<Result> results(jobs.size());
+    if (jobs.empty())
+    {
+        co_return results;
+    }
+
+    const size_t lanes = std::min(clients_.size(), jobs.size());
+    std::atomic<size_t> next{0};
+
+    co_await LanesAwaiter(*workers_, lanes, [this, &jobs, &results, &next](size_t lane) {
+        MinioClient &client = *clients_[lane];
+        for (size_t i = next.fetch_add(1); i < jobs.size(); i = next.fetch_add(1))
+        {
+            const Job &job = jobs[i];
+            Result &res = results[i];
+            res.lane = lane;
+            const auto started = std::chrono::steady_clock::now();
+            try
+            {
+                const MinioClient::CallResult put =
+                    client.putObject(job.bucket,
+                                     job.objectKey,
+                                     std::string_view(reinterpret_cast<const char *>(job.data), job.size),
+                                     job.contentType);
+                res.ok = put.ok;
+                res.error = put.error;
+            }
+            catch (const std::exception &e)
+            {
+                res.ok = false;
+                res.error = e.what();
+            }
+            res.durationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+        }
+    });
+
+    co_return results;
+}
@@ -0,0 +1,38 @@
+#include "Storage/PresignedUrlCache.h"
+
+#include <algorithm>
+
+PresignedUrlCache::PresignedUrlCache(size_t maxEntries)
+    : maxEntries_(std::max<size_t>(maxEntries, 1))
+{
+}
+
+std::optional<PresignedUrlCache::Entry> PresignedUrlCache::get(const std::string &key, Clock::time_point notBefore) const
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second.expiresAt < notBefore)
+    {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+void PresignedUrlCache::put(const std::string &key, Entry entry)
+{
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (entries_.size() >= maxEntries_ && entries_.find(key) == entries_.end())
+    {
+        // Сначала выбрасываем истёкшие; если их нет — кэш начинается заново.
+        const auto now = Clock::now();
+        for (auto it = entries_.begin(); it != entries_.end();)
+        {
+            it = (it->second.expiresAt <= now) ? entries_.erase(it) : std::next(it);
+        }
+        if (entries_.size() >= maxEntries_)
+        {
+            entries_.clear();
+        }
+    }
+    entries_[key] = std::move(entry);
+}
@@ -0,0 +1,204 @@
+#include "Storage/StagedUploadPlugin.h"
+
+#include <drogon/drogon.h>
+#include <drogon/utils/Utilities.h>
+
+#include "Storage/BlobStorePlugin.h"
+#include "Storage/StoragePlugin.h"
+#include "Loger/Logger.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+} // namespace
+
+void StagedUploadPlugin::initAndStart(const Json::Value &config)
+{
+    if (config.isMember("enabled") && config["enabled"].isBool())
+    {
+        enabled_ = config["enabled"].asBool();
+    }
+    if (config.isMember("ttl_minutes") && config["ttl_minutes"].isInt())
+    {
+        ttlMinutes_ = clampPositiveInt(config["ttl_minutes"].asInt(), ttlMinutes_);
+    }
+    if (config.isMember("batch_size") && config["batch_size"].isInt())
+    {
+        batchSize_ = clampPositiveInt(config["batch_size"].asInt(), batchSize_);
+    }
+
+    int intervalMinutes = 10;
+    if (config.isMember("interval_minutes") && config["interval_minutes"].isInt())
+    {
+        intervalMinutes = clampPositiveInt(config["interval_minutes"].asInt(), intervalMinutes);
+    }
+
+    if (enabled_)
+    {
+        // Порядок инициализации плагинов не задан: проверка после старта всех плагинов.
+        drogon::app().getLoop()->queueInLoop([]() {
+            auto blobStore = drogon::app().getPlugin<BlobStorePlugin>();
+            if (blobStore && blobStore->enabled())
+            {
+                Logger::instance().warning("StagedUploadPlugin: BlobStorePlugin is enabled, dedup takes precedence"
+                                           " and staged mode is not used");
+            }
+        });
+    }
+
+    // Reaper работает и при выключенном staged-режиме: подчищает хвосты после переключения.
+    const double intervalSeconds = static_cast<double>(intervalMinutes) * 60.0;
+    timerId_ = drogon::app().getLoop()->runEvery(
+        intervalSeconds,
+        drogon::async_func([this]() -> drogon::Task<void> {
+            try
+            {
+                const int reaped = co_await runOnce();
+                if (reaped > 0)
+                {
+                    Logger::instance().info("StagedUploadPlugin: reaped orphan objects=" + std::to_string(reaped));
+                }
+            }
+            catch (const std::exception &e)
+            {
+                Logger::instance().error("StagedUploadPlugin: runOnce failed: " + std::string(e.what()));
+            }
+            co_return;
+        }));
+}
+
+void StagedUploadPlugin::shutdown()
+{
+    if (timerId_ != trantor::InvalidTimerId)
+    {
+        drogon::app().getLoop()->invalidateTimer(timerId_);
+        timerId_ = trantor::InvalidTimerId;
+    }
+}
+
+drogon::Task<std::string> StagedUploadPlugin::registerBatch(const std::vector<StagedObject> &objects)
+{
+    const std::string batchId = drogon::utils::getUuid(true);
+    if (objects.empty())
+    {
+        co_return batchId;
+    }
+
+    // Один INSERT на весь батч: $1 — batch_id, далее пары (bucket, object_key).
+    std::string sql = "INSERT INTO public.storage_staged_objects (batch_id, bucket, object_key) VALUES ";
+    int param = 2;
+    for (size_t i = 0; i < objects.size(); ++i)
+    {
+        if (i > 0)
+        {
+            sql += ", ";
+        }
+        sql += "($1, $" + std::to_string(param) + ", $" + std::to_string(param + 1) + ")";
+        param += 2;
+    }
+
+    auto dbClient = drogon::app().getDbClient("default");
+    auto binder = (*dbClient << sql);
+    binder << batchId;
+    for (const auto &obj : objects)
+    {
+        binder << obj.bucket;
+        binder << obj.objectKey;
+    }
+    (void)co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+    co_return batchId;
+}
+
+drogon::Task<void> StagedUploadPlugin::commitBatch(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                                   const std::string &batchId,
+                                                   size_t expectedCount)
+{
+    const auto result = co_await trans->execSqlCoro(
+        "DELETE FROM public.storage_staged_objects WHERE batch_id = $1",
+        batchId);
+    if (result.affectedRows() != expectedCount)
+    {
+        Logger::instance().error("StagedUploadPlugin: staged batch expired batchId=" + batchId +
+                                 " expected=" + std::to_string(expectedCount) +
+                                 " found=" + std::to_string(result.affectedRows()));
+        throw std::runtime_error("Staged upload batch expired");
+    }
+    co_return;
+}
+
+drogon::Task<void> StagedUploadPlugin::discardBatch(const std::string &batchId)
+{
+    try
+    {
+        auto dbClient = drogon::app().getDbClient("default");
+        (void)co_await dbClient->execSqlCoro("DELETE FROM public.storage_staged_objects WHERE batch_id = $1", batchId);
+    }
+    catch (const std::exception &e)
+    {
+        Logger::instance().error("StagedUploadPlugin: discard failed batchId=" + batchId + " error=" + e.what());
+    }
+    co_return;
+}
+
+drogon::Task<int> StagedUploadPlugin::runOnce()
+{
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!storagePlugin)
+    {
+        Logger::instance().error("StagedUploadPlugin: StoragePlugin is not initialized");
+        co_return 0;
+    }
+    auto dbClient = drogon::app().getDbClient("default");
+
+    // Захват записей атомарен (SKIP LOCKED), поэтому несколько инстансов не мешают друг другу
+    // и advisory lock не нужен.
+    const auto rows = co_await dbClient->execSqlCoro(
+        "DELETE FROM public.storage_staged_objects"
+        " WHERE id IN ("
+        "   SELECT id FROM public.storage_staged_objects"
+        "    WHERE created_at <= now() - ($1::int * interval '1 minute')"
+        "    ORDER BY id"
+        "    LIMIT $2"
+        "    FOR UPDATE SKIP LOCKED)"
+        " RETURNING bucket, object_key",
+        ttlMinutes_,
+        batchSize_);
+
+    int reaped = 0;
+    for (const auto &row : rows)
+    {
+        const std::string bucket = row["bucket"].as<std::string>();
+        const std::string objectKey = row["object_key"].as<std::string>();
+        const IObjectStorage::Status removed = co_await storagePlugin->storage().remove(bucket, objectKey);
+        if (removed)
+        {
+            ++reaped;
+            continue;
+        }
+        // Не удалось — возвращаем запись в журнал, следующая попытка через TTL.
+        try
+        {
+            (void)co_await dbClient->execSqlCoro(
+                "INSERT INTO public.storage_staged_objects (batch_id, bucket, object_key) VALUES ($1, $2, $3)",
+                std::string("reaper-retry"),
+                bucket,
+                objectKey);
+        }
+        catch (const std::exception &e)
+        {
+            Logger::instance().error("StagedUploadPlugin: failed to requeue bucket=" + bucket +
+                                     " key=" + objectKey + " error=" + e.what());
+        }
+    }
+    co_return reaped;
+}
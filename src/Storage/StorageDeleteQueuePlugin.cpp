@@ -0,0 +1,278 @@
+#include "Storage/StorageDeleteQueuePlugin.h"
+
+#include <drogon/drogon.h>
+
+#include "Storage/StoragePlugin.h"
+#include "Loger/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+namespace
+{
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+/// INSERT на весь список: $1.. — пары (bucket, object_key).
+std::string enqueueSql(size_t count)
+{
+    std::string sql = "INSERT INTO public.storage_delete_queue (bucket, object_key) VALUES ";
+    int param = 1;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (i > 0)
+        {
+            sql += ", ";
+        }
+        sql += "($" + std::to_string(param) + ", $" + std::to_string(param + 1) + ")";
+        param += 2;
+    }
+    return sql;
+}
+
+struct RunningGuard
+{
+    std::atomic<bool> &flag;
+    ~RunningGuard() { flag.store(false); }
+};
+} // namespace
+
+void StorageDeleteQueuePlugin::initAndStart(const Json::Value &config)
+{
+    if (config.isMember("enabled") && config["enabled"].isBool())
+    {
+        enabled_ = config["enabled"].asBool();
+    }
+    if (config.isMember("batch_size") && config["batch_size"].isInt())
+    {
+        // S3 DeleteObjects принимает не более 1000 ключей за запрос.
+        batchSize_ = std::min(clampPositiveInt(config["batch_size"].asInt(), batchSize_), 1000);
+    }
+    if (config.isMember("base_backoff_seconds") && config["base_backoff_seconds"].isInt())
+    {
+        baseBackoffSeconds_ = clampPositiveInt(config["base_backoff_seconds"].asInt(), baseBackoffSeconds_);
+    }
+    if (config.isMember("max_backoff_seconds") && config["max_backoff_seconds"].isInt())
+    {
+        maxBackoffSeconds_ = clampPositiveInt(config["max_backoff_seconds"].asInt(), maxBackoffSeconds_);
+    }
+
+    int intervalSeconds = 5;
+    if (config.isMember("interval_seconds") && config["interval_seconds"].isInt())
+    {
+        intervalSeconds = clampPositiveInt(config["interval_seconds"].asInt(), intervalSeconds);
+    }
+
+    // Воркер работает и при выключенной очереди: дочищает записи, оставшиеся после переключения.
+    timerId_ = drogon::app().getLoop()->runEvery(
+        static_cast<double>(intervalSeconds),
+        drogon::async_func([this]() -> drogon::Task<void> {
+            try
+            {
+                (void)co_await runOnce();
+            }
+            catch (const std::exception &e)
+            {
+                Logger::instance().error("StorageDeleteQueuePlugin: runOnce failed: " + std::string(e.what()));
+            }
+            co_return;
+        }));
+}
+
+void StorageDeleteQueuePlugin::shutdown()
+{
+    if (timerId_ != trantor::InvalidTimerId)
+    {
+        drogon::app().getLoop()->invalidateTimer(timerId_);
+        timerId_ = trantor::InvalidTimerId;
+    }
+}
+
+drogon::Task<void> StorageDeleteQueuePlugin::enqueue(const std::shared_ptr<drogon::orm::Transaction> &trans,
+                                                     const std::vector<Object> &objects)
+{
+    if (objects.empty())
+    {
+        co_return;
+    }
+    auto binder = (*trans << enqueueSql(objects.size()));
+    for (const auto &obj : objects)
+    {
+        binder << obj.bucket;
+        binder << obj.objectKey;
+    }
+    (void)co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+    enqueuedTotal_ += objects.size();
+    co_return;
+}
+
+drogon::Task<void> StorageDeleteQueuePlugin::enqueue(const std::vector<Object> &objects)
+{
+    if (objects.empty())
+    {
+        co_return;
+    }
+    auto dbClient = drogon::app().getDbClient("default");
+    auto binder = (*dbClient << enqueueSql(objects.size()));
+    for (const auto &obj : objects)
+    {
+        binder << obj.bucket;
+        binder << obj.objectKey;
+    }
+    (void)co_await drogon::orm::internal::SqlAwaiter(std::move(binder));
+    enqueuedTotal_ += objects.size();
+    co_return;
+}
+
+drogon::Task<int> StorageDeleteQueuePlugin::runOnce()
+{
+    // Проход не перекрывается со следующим тиком таймера; другие инстансы разводит SKIP LOCKED.
+    if (running_.exchange(true))
+    {
+        co_return 0;
+    }
+    RunningGuard guard{running_};
+
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!storagePlugin)
+    {
+        Logger::instance().error("StorageDeleteQueuePlugin: StoragePlugin is not initialized");
+        co_return 0;
+    }
+    auto dbClient = drogon::app().getDbClient("default");
+    auto trans = co_await dbClient->newTransactionCoro();
+
+    const auto rows = co_await trans->execSqlCoro(
+        "SELECT id, bucket, object_key FROM public.storage_delete_queue"
+        " WHERE next_attempt_at <= now()"
+        " ORDER BY next_attempt_at, id"
+        " LIMIT $1"
+        " FOR UPDATE SKIP LOCKED",
+        batchSize_);
+    if (rows.empty())
+    {
+        co_return 0;
+    }
+
+    std::map<std::string, std::vector<std::pair<int64_t, std::string>>> byBucket;
+    for (const auto &row : rows)
+    {
+        byBucket[row["bucket"].as<std::string>()].emplace_back(row["id"].as<int64_t>(),
+                                                               row["object_key"].as<std::string>());
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    std::string doneIds;
+    std::string failedIds;
+    std::string lastError;
+    int deleted = 0;
+    int failed = 0;
+    for (const auto &kv : byBucket)
+    {
+        const std::string bucket = kv.first;
+        std::vector<std::string> keys;
+        keys.reserve(kv.second.size());
+        for (const auto &item : kv.second)
+        {
+            keys.push_back(item.second);
+        }
+
+        std::vector<std::string> failedList;
+        const IObjectStorage::Status result = co_await storagePlugin->storage().removeMany(bucket, keys, failedList);
+        if (!result.error.empty())
+        {
+            lastError = result.error;
+        }
+
+        const std::unordered_set<std::string> failedKeys(failedList.begin(), failedList.end());
+        for (const auto &item : kv.second)
+        {
+            std::string &ids = failedKeys.count(item.second) ? failedIds : doneIds;
+            if (!ids.empty())
+            {
+                ids += ",";
+            }
+            ids += std::to_string(item.first);
+            ++(failedKeys.count(item.second) ? failed : deleted);
+        }
+    }
+
+    if (!doneIds.empty())
+    {
+        (void)co_await trans->execSqlCoro(
+            "DELETE FROM public.storage_delete_queue WHERE id = ANY($1::bigint[])",
+            "{" + doneIds + "}");
+    }
+    if (!failedIds.empty())
+    {
+        // Экспоненциальная задержка от числа попыток, ограниченная max_backoff_seconds.
+        (void)co_await trans->execSqlCoro(
+            "UPDATE public.storage_delete_queue"
+            " SET attempts = attempts + 1,"
+            "     last_error = $2,"
+            "     next_attempt_at = now() + LEAST($3::float8 * power(2, attempts), $4::float8) * interval '1 second'"
+            " WHERE id = ANY($1::bigint[])",
+            "{" + failedIds + "}",
+            lastError.empty() ? std::string("delete failed") : lastError,
+            static_cast<double>(baseBackoffSeconds_),
+            static_cast<double>(maxBackoffSeconds_));
+    }
+
+    const auto elapsedMs =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    deletedTotal_ += static_cast<uint64_t>(deleted);
+    failedTotal_ += static_cast<uint64_t>(failed);
+    ++batchesTotal_;
+    lastBatchMs_ = static_cast<int64_t>(elapsedMs);
+
+    std::ostringstream oss;
+    oss << "StorageDeleteQueuePlugin: batch deleted=" << deleted
+        << " failed=" << failed
+        << " buckets=" << byBucket.size()
+        << " ms=" << elapsedMs;
+    if (failed > 0)
+    {
+        Logger::instance().warning(oss.str());
+    }
+    else
+    {
+        Logger::instance().info(oss.str());
+    }
+    co_return deleted;
+}
+
+drogon::Task<Json::Value> StorageDeleteQueuePlugin::stats()
+{
+    Json::Value out(Json::objectValue);
+    out["enabled"] = enabled_;
+    out["enqueuedTotal"] = static_cast<Json::UInt64>(enqueuedTotal_.load());
+    out["deletedTotal"] = static_cast<Json::UInt64>(deletedTotal_.load());
+    out["failedTotal"] = static_cast<Json::UInt64>(failedTotal_.load());
+    out["batchesTotal"] = static_cast<Json::UInt64>(batchesTotal_.load());
+    out["lastBatchMs"] = static_cast<Json::Int64>(lastBatchMs_.load());
+
+    auto dbClient = drogon::app().getDbClient("default");
+    const auto rows = co_await dbClient->execSqlCoro(
+        "SELECT count(*) AS pending,"
+        "       count(*) FILTER (WHERE attempts > 0) AS retrying,"
+        "       COALESCE(EXTRACT(EPOCH FROM now() - min(created_at)), 0)::bigint AS oldest_age_seconds"
+        "  FROM public.storage_delete_queue");
+    if (!rows.empty())
+    {
+        out["pending"] = static_cast<Json::Int64>(rows[0]["pending"].as<int64_t>());
+        out["retrying"] = static_cast<Json::Int64>(rows[0]["retrying"].as<int64_t>());
+        out["oldestAgeSeconds"] = static_cast<Json::Int64>(rows[0]["oldest_age_seconds"].as<int64_t>());
+    }
+    co_return out;
+}
@@ -0,0 +1,85 @@
+#include "Storage/StoragePlugin.h"
+
+#include <drogon/drogon.h>
+
+#include "Storage/LocalFsStorage.h"
+#include "Storage/MinioPlugin.h"
+#include "Storage/MinioStorage.h"
+#include "Loger/Logger.h"
+
+#include <stdexcept>
+
+namespace
+{
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+} // namespace
+
+void StoragePlugin::initAndStart(const Json::Value &config)
+{
+    std::string backend = "minio";
+    if (config.isMember("backend") && config["backend"].isString())
+    {
+        backend = config["backend"].asString();
+    }
+    int workerThreads = 4;
+    if (config.isMember("worker_threads") && config["worker_threads"].isInt())
+    {
+        workerThreads = clampPositiveInt(config["worker_threads"].asInt(), workerThreads);
+    }
+
+    if (backend == "local")
+    {
+        LocalFsStorage::Config cfg;
+        cfg.ioThreads = static_cast<size_t>(workerThreads);
+        if (config.isMember("local_root") && config["local_root"].isString() &&
+            !config["local_root"].asString().empty())
+        {
+            cfg.root = config["local_root"].asString();
+        }
+        if (config.isMember("fsync_batch_ms") && config["fsync_batch_ms"].isInt() &&
+            config["fsync_batch_ms"].asInt() >= 0)
+        {
+            cfg.fsyncBatchMs = config["fsync_batch_ms"].asInt();
+        }
+        Logger::instance().info("StoragePlugin: local backend root=" + cfg.root +
+                                " fsync_batch_ms=" + std::to_string(cfg.fsyncBatchMs));
+        storage_ = std::make_unique<LocalFsStorage>(std::move(cfg));
+        isMinio_ = false;
+        return;
+    }
+
+    if (backend != "minio")
+    {
+        Logger::instance().warning("StoragePlugin: unknown backend=" + backend + ", using minio");
+    }
+    auto minioPlugin = drogon::app().getPlugin<MinioPlugin>();
+    if (!minioPlugin)
+    {
+        throw std::runtime_error("StoragePlugin: MinioPlugin is not initialized");
+    }
+    storage_ = std::make_unique<MinioStorage>(minioPlugin->clientPool(),
+                                              minioPlugin->uploader(),
+                                              static_cast<size_t>(workerThreads));
+    isMinio_ = true;
+}
+
+void StoragePlugin::shutdown()
+{
+    storage_.reset();
+}
+
+IObjectStorage &StoragePlugin::storage()
+{
+    if (!storage_)
+    {
+        throw std::runtime_error("StoragePlugin: storage backend is not initialized");
+    }
+    return *storage_;
+}
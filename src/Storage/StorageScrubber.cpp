@@ -0,0 +1,414 @@
+#include "Storage/StorageScrubber.h"
+
+#include <drogon/drogon.h>
+
+#include "Storage/BlobStorePlugin.h"
+#include "Storage/MinioPlugin.h"
+#include "Storage/StorageDeleteQueuePlugin.h"
+#include "Storage/StoragePlugin.h"
+#include "Loger/Logger.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+constexpr size_t kMaxSamples = 20;
+// Ограничение памяти под кандидатов в сироты: при переполнении новые кандидаты ждут следующего круга.
+constexpr size_t kMaxTrackedOrphans = 100000;
+
+/// Литерал text[] для параметра ANY/unnest: элементы в кавычках, \ и " экранируются.
+std::string pgTextArray(const std::vector<std::string> &values)
+{
+    std::string out = "{";
+    for (size_t i = 0; i < values.size(); ++i)
+    {
+        if (i > 0)
+        {
+            out += ",";
+        }
+        out += "\"";
+        for (const char c : values[i])
+        {
+            if (c == '"' || c == '\\')
+            {
+                out += '\\';
+            }
+            out += c;
+        }
+        out += "\"";
+    }
+    out += "}";
+    return out;
+}
+
+void addSample(StorageScrubReport &report,
+               const std::string &kind,
+               const std::string &bucket,
+               const std::string &objectKey,
+               int64_t imageId = 0)
+{
+    if (report.samples.size() >= kMaxSamples)
+    {
+        return;
+    }
+    Json::Value sample(Json::objectValue);
+    sample["kind"] = kind;
+    sample["bucket"] = bucket;
+    sample["objectKey"] = objectKey;
+    if (imageId > 0)
+    {
+        sample["imageId"] = static_cast<Json::Int64>(imageId);
+    }
+    report.samples.append(sample);
+}
+
+struct RunningGuard
+{
+    std::atomic<bool> &flag;
+    ~RunningGuard() { flag.store(false); }
+};
+} // namespace
+
+Json::Value StorageScrubReport::toJson() const
+{
+    Json::Value root(Json::objectValue);
+    root["skipped"] = skipped;
+    root["rowsScanned"] = rowsScanned;
+    root["objectsChecked"] = objectsChecked;
+    root["danglingKeys"] = danglingKeys;
+    root["danglingRowsRepaired"] = danglingRowsRepaired;
+    root["objectsListed"] = objectsListed;
+    root["orphanCandidates"] = orphanCandidates;
+    root["orphansConfirmed"] = orphansConfirmed;
+    root["orphansRemoved"] = orphansRemoved;
+    root["storageErrors"] = storageErrors;
+    root["imagesWrapped"] = imagesWrapped;
+    root["listingWrapped"] = listingWrapped;
+    root["samples"] = samples;
+    return root;
+}
+
+StorageScrubber::StorageScrubber(StorageScrubberConfig cfg) : cfg_(std::move(cfg))
+{
+}
+
+drogon::Task<StorageScrubReport> StorageScrubber::runOnce()
+{
+    StorageScrubReport report;
+
+    // Курсоры и кандидаты общие для таймера и ручного запуска — проходы не перекрываются.
+    if (running_.exchange(true))
+    {
+        report.skipped = true;
+        co_return report;
+    }
+    RunningGuard guard{running_};
+
+    auto minioPlugin = drogon::app().getPlugin<MinioPlugin>();
+    auto storagePlugin = drogon::app().getPlugin<StoragePlugin>();
+    if (!minioPlugin || !storagePlugin)
+    {
+        Logger::instance().error("StorageScrubber: MinioPlugin/StoragePlugin is not initialized");
+        co_return report;
+    }
+    IObjectStorage &storage = storagePlugin->storage();
+    const std::string bucket = minioPlugin->minioConfig().bucket;
+
+    // Блокировка уровня транзакции: снимается при её завершении на том же соединении.
+    // Сессионная pg_advisory_unlock из пула могла бы уйти в другое соединение и не снять лок.
+    auto dbClient = drogon::app().getDbClient("default");
+    std::shared_ptr<drogon::orm::Transaction> lockTrans;
+    if (cfg_.useAdvisoryLock)
+    {
+        lockTrans = co_await dbClient->newTransactionCoro();
+        const auto lockRows =
+            co_await lockTrans->execSqlCoro("SELECT pg_try_advisory_xact_lock($1) AS locked", cfg_.advisoryLockKey);
+        if (lockRows.empty() || lockRows[0]["locked"].isNull() || !lockRows[0]["locked"].as<bool>())
+        {
+            report.skipped = true;
+            co_return report;
+        }
+    }
+
+    try
+    {
+        co_await scanImages(storage, bucket, report);
+    }
+    catch (const std::exception &e)
+    {
+        Logger::instance().error("StorageScrubber: image scan failed: " + std::string(e.what()));
+    }
+    try
+    {
+        co_await scanBucket(storage, bucket, report);
+    }
+    catch (const std::exception &e)
+    {
+        Logger::instance().error("StorageScrubber: bucket scan failed: " + std::string(e.what()));
+    }
+    co_return report;
+}
+
+drogon::Task<void> StorageScrubber::scanImages(IObjectStorage &storage,
+                                               const std::string &defaultBucket,
+                                               StorageScrubReport &report)
+{
+    auto dbClient = drogon::app().getDbClient("default");
+    const auto rows = co_await dbClient->execSqlCoro(
+        "SELECT id, big_bucket, big_object_key, small_bucket, small_object_key"
+        " FROM public.milling_tool_images"
+        " WHERE id > $1"
+        " ORDER BY id"
+        " LIMIT $2",
+        imageCursor_,
+        cfg_.rowBatchSize);
+
+    for (const auto &row : rows)
+    {
+        const int64_t imageId = row["id"].as<int64_t>();
+        imageCursor_ = imageId;
+        ++report.rowsScanned;
+
+        const std::string bigKey = row["big_object_key"].isNull() ? "" : row["big_object_key"].as<std::string>();
+        const std::string smallKey = row["small_object_key"].isNull() ? "" : row["small_object_key"].as<std::string>();
+        const std::string bigBucket = row["big_bucket"].isNull() ? defaultBucket : row["big_bucket"].as<std::string>();
+        const std::string smallBucket =
+            row["small_bucket"].isNull() ? defaultBucket : row["small_bucket"].as<std::string>();
+
+        int referenced = 0;
+        int missing = 0;
+        bool inconclusive = false;
+        const std::pair<const std::string *, const std::string *> refs[] = {{&bigBucket, &bigKey},
+                                                                            {&smallBucket, &smallKey}};
+        for (const auto &ref : refs)
+        {
+            const std::string &refBucket = *ref.first;
+            const std::string &refKey = *ref.second;
+            if (refKey.empty())
+            {
+                continue;
+            }
+            ++referenced;
+            ++report.objectsChecked;
+            co_await throttle();
+            IObjectStorage::ObjectStat stat;
+            const IObjectStorage::Status status = co_await storage.stat(refBucket, refKey, stat);
+            if (status)
+            {
+                continue;
+            }
+            if (!status.notFound)
+            {
+                // Сбой хранилища — не повод считать объект пропавшим.
+                ++report.storageErrors;
+                inconclusive = true;
+                continue;
+            }
+            ++missing;
+            ++report.danglingKeys;
+            addSample(report, "dangling", refBucket, refKey, imageId);
+            Logger::instance().warning("StorageScrubber: dangling key imageId=" + std::to_string(imageId) +
+                                       " bucket=" + refBucket + " key=" + refKey);
+        }
+
+        // Строка удаляется, только если пропали все её объекты: показывать нечего,
+        // а триггер очистит ячейку каталога. Частичную потерю оставляем на ручной разбор.
+        if (cfg_.repairDangling && referenced > 0 && missing == referenced && !inconclusive)
+        {
+            if (co_await repairDanglingRow(imageId, bigBucket, bigKey, smallBucket, smallKey))
+            {
+                ++report.danglingRowsRepaired;
+            }
+        }
+    }
+
+    if (rows.size() < static_cast<size_t>(cfg_.rowBatchSize))
+    {
+        imageCursor_ = 0;
+        report.imagesWrapped = true;
+    }
+    co_return;
+}
+
+drogon::Task<bool> StorageScrubber::repairDanglingRow(int64_t imageId,
+                                                      const std::string &bigBucket,
+                                                      const std::string &bigKey,
+                                                      const std::string &smallBucket,
+                                                      const std::string &smallKey)
+{
+    auto dbClient = drogon::app().getDbClient("default");
+    auto trans = co_await dbClient->newTransactionCoro();
+
+    // Ключи сверяются повторно: строку могли обновить новой картинкой после stat.
+    const auto result = co_await trans->execSqlCoro(
+        "DELETE FROM public.milling_tool_images"
+        " WHERE id = $1"
+        "   AND COALESCE(big_object_key, '') = $2"
+        "   AND COALESCE(small_object_key, '') = $3",
+        imageId,
+        bigKey,
+        smallKey);
+    if (result.affectedRows() == 0)
+    {
+        co_return false;
+    }
+
+    // Ссылки на блобы освобождаются, иначе ref_count останется завышенным навсегда.
+    std::vector<BlobStorePlugin::BlobRef> blobRefs;
+    if (!bigKey.empty() && BlobStorePlugin::isBlobKey(bigKey))
+    {
+        blobRefs.push_back(BlobStorePlugin::BlobRef{bigBucket, bigKey, 1});
+    }
+    if (!smallKey.empty() && BlobStorePlugin::isBlobKey(smallKey))
+    {
+        blobRefs.push_back(BlobStorePlugin::BlobRef{smallBucket, smallKey, 1});
+    }
+    auto blobStore = drogon::app().getPlugin<BlobStorePlugin>();
+    if (blobStore && !blobRefs.empty())
+    {
+        co_await blobStore->release(trans, blobRefs);
+    }
+
+    Logger::instance().warning("StorageScrubber: removed image row with missing objects imageId=" +
+                               std::to_string(imageId));
+    co_return true;
+}
+
+drogon::Task<void> StorageScrubber::scanBucket(IObjectStorage &storage,
+                                               const std::string &bucket,
+                                               StorageScrubReport &report)
+{
+    std::vector<std::string> keys;
+    co_await throttle();
+    const IObjectStorage::Status listed =
+        co_await storage.list(bucket, cfg_.prefix, listCursor_, static_cast<size_t>(cfg_.listPageSize), keys);
+    if (!listed)
+    {
+        ++report.storageErrors;
+        Logger::instance().error("StorageScrubber: list failed bucket=" + bucket + " err=" + listed.error);
+        co_return;
+    }
+    report.objectsListed += static_cast<int>(keys.size());
+    if (keys.size() < static_cast<size_t>(cfg_.listPageSize))
+    {
+        listCursor_.clear();
+        report.listingWrapped = true;
+    }
+    else
+    {
+        listCursor_ = keys.back();
+    }
+    if (keys.empty())
+    {
+        co_return;
+    }
+
+    // Одна проверка на всю страницу ключей: объект нужен, если на него ссылается строка
+    // изображений, запись блоба, незакоммиченный staged write или он уже ждёт удаления.
+    // Производный вариант выдачи variants/<key>/<side>.<ext> нужен, пока нужен его исходник <key>.
+    auto dbClient = drogon::app().getDbClient("default");
+    const auto rows = co_await dbClient->execSqlCoro(
+        "SELECT k.key FROM unnest($2::text[]) AS k(key)"
+        " CROSS JOIN LATERAL (SELECT CASE WHEN left(k.key, 9) = 'variants/'"
+        "                                 THEN regexp_replace(substr(k.key, 10), '/[^/]*$', '')"
+        "                                 ELSE k.key END AS ref) r"
+        " WHERE NOT EXISTS (SELECT 1 FROM public.milling_tool_images i"
+        "                    WHERE i.big_object_key = r.ref AND COALESCE(i.big_bucket, $1) = $1)"
+        "   AND NOT EXISTS (SELECT 1 FROM public.milling_tool_images i"
+        "                    WHERE i.small_object_key = r.ref AND COALESCE(i.small_bucket, $1) = $1)"
+        "   AND NOT EXISTS (SELECT 1 FROM public.storage_blobs b WHERE b.bucket = $1 AND b.object_key = r.ref)"
+        "   AND NOT EXISTS (SELECT 1 FROM public.storage_staged_objects s"
+        "                    WHERE s.bucket = $1 AND s.object_key = r.ref)"
+        "   AND NOT EXISTS (SELECT 1 FROM public.storage_delete_queue q"
+        "                    WHERE q.bucket = $1 AND q.object_key = k.key)",
+        bucket,
+        pgTextArray(keys));
+
+    std::unordered_set<std::string> unreferenced;
+    for (const auto &row : rows)
+    {
+        unreferenced.insert(row["key"].as<std::string>());
+    }
+    // Ключи страницы, у которых снова есть ссылка, перестают быть кандидатами.
+    for (const auto &key : keys)
+    {
+        if (!unreferenced.count(key))
+        {
+            orphanSeen_.erase(key);
+        }
+    }
+
+    // Без ссылок объект может быть лишь на время транзакции записи, поэтому удаляется только
+    // объект, оставшийся без ссылок дольше orphan_grace_minutes (на одном из следующих кругов).
+    const auto now = std::chrono::steady_clock::now();
+    const auto grace = std::chrono::minutes(cfg_.orphanGraceMinutes);
+    std::vector<std::string> confirmed;
+    for (const auto &key : unreferenced)
+    {
+        ++report.orphanCandidates;
+        auto it = orphanSeen_.find(key);
+        if (it == orphanSeen_.end())
+        {
+            if (orphanSeen_.size() < kMaxTrackedOrphans)
+            {
+                orphanSeen_.emplace(key, now);
+            }
+            continue;
+        }
+        if (now - it->second < grace)
+        {
+            continue;
+        }
+        ++report.orphansConfirmed;
+        addSample(report, "orphan", bucket, key);
+        Logger::instance().warning("StorageScrubber: orphan object bucket=" + bucket + " key=" + key);
+        confirmed.push_back(key);
+    }
+    if (!cfg_.repairOrphans || confirmed.empty())
+    {
+        co_return;
+    }
+
+    auto deleteQueue = drogon::app().getPlugin<StorageDeleteQueuePlugin>();
+    if (deleteQueue && deleteQueue->enabled())
+    {
+        std::vector<StorageDeleteQueuePlugin::Object> objects;
+        objects.reserve(confirmed.size());
+        for (const auto &key : confirmed)
+        {
+            objects.push_back(StorageDeleteQueuePlugin::Object{bucket, key});
+        }
+        co_await deleteQueue->enqueue(objects);
+        report.orphansRemoved += static_cast<int>(confirmed.size());
+    }
+    else
+    {
+        co_await throttle();
+        std::vector<std::string> failedKeys;
+        (void)co_await storage.removeMany(bucket, confirmed, failedKeys);
+        report.orphansRemoved += static_cast<int>(confirmed.size() - failedKeys.size());
+        report.storageErrors += static_cast<int>(failedKeys.size());
+    }
+    for (const auto &key : confirmed)
+    {
+        orphanSeen_.erase(key);
+    }
+    co_return;
+}
+
+drogon::Task<void> StorageScrubber::throttle()
+{
+    const auto interval = std::chrono::microseconds(1000000 / std::max(cfg_.maxRequestsPerSecond, 1));
+    const auto now = std::chrono::steady_clock::now();
+    if (nextRequestAt_ <= now)
+    {
+        nextRequestAt_ = now + interval;
+        co_return;
+    }
+    const double delaySeconds = std::chrono::duration<double>(nextRequestAt_ - now).count();
+    nextRequestAt_ += interval;
+    co_await drogon::sleepCoro(drogon::app().getLoop(), delaySeconds);
+    co_return;
+}
@@ -0,0 +1,149 @@
+#include <drogon/drogon.h>
+#include <drogon/utils/coroutine.h>
+
+#include "Storage/StorageScrubberPlugin.h"
+#include "Loger/Logger.h"
+
+#include <sstream>
+#include <string>
+
+namespace
+{
+int clampPositiveInt(int value, int fallback)
+{
+    if (value <= 0)
+    {
+        return fallback;
+    }
+    return value;
+}
+
+void logReport(const StorageScrubReport &report)
+{
+    if (report.skipped)
+    {
+        return;
+    }
+    std::ostringstream oss;
+    oss << "StorageScrubberPlugin: rows=" << report.rowsScanned
+        << " checked=" << report.objectsChecked
+        << " dangling=" << report.danglingKeys
+        << " repairedRows=" << report.danglingRowsRepaired
+        << " listed=" << report.objectsListed
+        << " orphanCandidates=" << report.orphanCandidates
+        << " orphans=" << report.orphansConfirmed
+        << " removed=" << report.orphansRemoved
+        << " storageErrors=" << report.storageErrors;
+    if (report.danglingKeys > 0 || report.orphansConfirmed > 0 || report.storageErrors > 0)
+    {
+        Logger::instance().warning(oss.str());
+    }
+    else
+    {
+        Logger::instance().info(oss.str());
+    }
+}
+} // namespace
+
+void StorageScrubberPlugin::initAndStart(const Json::Value &config)
+{
+    bool enabled = false;
+    if (config.isMember("enabled") && config["enabled"].isBool())
+    {
+        enabled = config["enabled"].asBool();
+    }
+
+    StorageScrubberConfig cfg;
+    if (config.isMember("row_batch_size") && config["row_batch_size"].isInt())
+    {
+        cfg.rowBatchSize = clampPositiveInt(config["row_batch_size"].asInt(), cfg.rowBatchSize);
+    }
+    if (config.isMember("list_page_size") && config["list_page_size"].isInt())
+    {
+        cfg.listPageSize = clampPositiveInt(config["list_page_size"].asInt(), cfg.listPageSize);
+    }
+    if (config.isMember("max_requests_per_second") && config["max_requests_per_second"].isInt())
+    {
+        cfg.maxRequestsPerSecond = clampPositiveInt(config["max_requests_per_second"].asInt(), cfg.maxRequestsPerSecond);
+    }
+    if (config.isMember("prefix") && config["prefix"].isString())
+    {
+        cfg.prefix = config["prefix"].asString();
+    }
+    if (config.isMember("orphan_grace_minutes") && config["orphan_grace_minutes"].isInt())
+    {
+        cfg.orphanGraceMinutes = clampPositiveInt(config["orphan_grace_minutes"].asInt(), cfg.orphanGraceMinutes);
+    }
+    if (config.isMember("repair_dangling") && config["repair_dangling"].isBool())
+    {
+        cfg.repairDangling = config["repair_dangling"].asBool();
+    }
+    if (config.isMember("repair_orphans") && config["repair_orphans"].isBool())
+    {
+        cfg.repairOrphans = config["repair_orphans"].asBool();
+    }
+    if (config.isMember("use_advisory_lock") && config["use_advisory_lock"].isBool())
+    {
+        cfg.useAdvisoryLock = config["use_advisory_lock"].asBool();
+    }
+    if (config.isMember("advisory_lock_key") && config["advisory_lock_key"].isInt64())
+    {
+        cfg.advisoryLockKey = config["advisory_lock_key"].asInt64();
+    }
+
+    int intervalMinutes = 10;
+    if (config.isMember("interval_minutes") && config["interval_minutes"].isInt())
+    {
+        intervalMinutes = clampPositiveInt(config["interval_minutes"].asInt(), intervalMinutes);
+    }
+
+    // Ручной запуск (POST /storage/scrub) доступен и при выключенном таймере.
+    scrubber_ = std::make_shared<StorageScrubber>(cfg);
+    if (!enabled)
+    {
+        return;
+    }
+
+    const double intervalSeconds = static_cast<double>(intervalMinutes) * 60.0;
+    timerId_ = drogon::app().getLoop()->runEvery(
+        intervalSeconds,
+        drogon::async_func([this]() -> drogon::Task<void> {
+            if (!scrubber_)
+            {
+                co_return;
+            }
+            try
+            {
+                logReport(co_await scrubber_->runOnce());
+            }
+            catch (const std::exception &e)
+            {
+                Logger::instance().error("StorageScrubberPlugin: runOnce failed: " + std::string(e.what()));
+            }
+            co_return;
+        }));
+}
+
+void StorageScrubberPlugin::shutdown()
+{
+    if (timerId_ != trantor::InvalidTimerId)
+    {
+        drogon::app().getLoop()->invalidateTimer(timerId_);
+        timerId_ = trantor::InvalidTimerId;
+    }
+    scrubber_.reset();
+}
+
+drogon::Task<StorageScrubReport> StorageScrubberPlugin::runOnce()
+{
+    if (!scrubber_)
+    {
+        Logger::instance().error("StorageScrubberPlugin: scrubber is not initialized");
+        co_return StorageScrubReport{};
+    }
+    // Копия указателя: shutdown() не освободит сверку посреди прохода.
+    auto scrubber = scrubber_;
+    StorageScrubReport report = co_await scrubber->runOnce();
+    logReport(report);
+    co_return report;
+}
@@ -154,15 +154,51 @@ TableInfoCache::getColumns(const std::string &tableName)
     co_return filteredPtr;
 }
 
+drogon::Task<std::shared_ptr<const TableInfoCache::ColumnTypes>>
+TableInfoCache::getColumnTypes(const std::string &tableName)
+{
+    {
+        std::shared_lock lk(mu_);
+        auto it = typesByTable_.find(tableName);
+        if (it != typesByTable_.end())
+        {
+            co_return it->second;
+        }
+    }
+
+    const auto columns = co_await getColumns(tableName);
+    auto types = std::make_shared<ColumnTypes>();
+    if (columns && columns->isArray())
+    {
+        types->reserve(columns->size());
+        for (const auto &c : *columns)
+        {
+            if (!c.isObject() || !c["name"].isString())
+            {
+                continue;
+            }
+            ColumnType type;
+            type.dataType = c["type"].asString();
+            type.udtName = c["udt_name"].asString();
+            types->emplace(c["name"].asString(), std::move(type));
+        }
+    }
+
+    std::unique_lock lk(mu_);
+    co_return typesByTable_.emplace(tableName, std::move(types)).first->second;
+}
+
 void TableInfoCache::invalidate(const std::string &tableName)
 {
     std::unique_lock lk(mu_);
     columnsByTable_.erase(tableName);
+    typesByTable_.erase(tableName);
 }
 
 void TableInfoCache::clear()
 {
     std::unique_lock lk(mu_);
     columnsByTable_.clear();
+    typesByTable_.clear();
 }
 